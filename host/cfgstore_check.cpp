@@ -0,0 +1,677 @@
+/*
+ * ----------------------------------------------------------------------------
+ * "THE BEER-WARE LICENSE" (Revision 42):
+ * <quackmore-ff@yahoo.com> wrote this file.  As long as you retain this notice
+ * you can do whatever you want with this stuff. If we meet some day, and you
+ * think this stuff is worth it, you can buy me a beer in return. Quackmore
+ * ----------------------------------------------------------------------------
+ */
+
+// espbot_cfgstore checks, over SPIFFS and the flash simulator
+//
+// make check (the exit code is not 0 on any failure)
+// a "boot" mounts the file system again and restores the cfg from the store,
+// like espbot_init does
+// the cached cfg routes are checked with espbot_mdns, their responses are captured
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+extern "C"
+{
+#include "c_types.h"
+#include "osapi.h"
+#include "user_interface.h"
+}
+
+#include "espbot.hpp"
+#include "espbot_cfgstore.hpp"
+#include "espbot_event_codes.h"
+#include "espbot_http.hpp"
+#include "espbot_http_cache.hpp"
+#include "espbot_mdns.hpp"
+#include "espbot_spiffs.hpp"
+#include "host.hpp"
+
+static struct test_config
+{
+    bool enabled;
+    signed char level;
+    unsigned short port;
+    int offset;
+    char name[32];
+} test_cfg;
+
+#define TEST_CFG_FIELDS(FIELD, type)                  \
+    FIELD(type, enabled, "enabled", CFG_bool, 1)      \
+    FIELD(type, level, "level", CFG_int, -3)          \
+    FIELD(type, port, "port", CFG_uint, 80)           \
+    FIELD(type, offset, "offset", CFG_int, 0)         \
+    FIELD(type, name, "name", CFG_str, 0)
+
+CFG_SCHEMA(test_schema, struct test_config, test_cfg, TEST_CFG_FIELDS);
+
+static struct other_config
+{
+    int value;
+    char text[16];
+} other_cfg;
+
+#define OTHER_CFG_FIELDS(FIELD, type)          \
+    FIELD(type, value, "value", CFG_int, 7)    \
+    FIELD(type, text, "text", CFG_str, 0)
+
+CFG_SCHEMA(other_schema, struct other_config, other_cfg, OTHER_CFG_FIELDS);
+
+// BIG_CFG_COUNT of them don't fit the store
+#define BIG_CFG_COUNT 7
+
+static struct big_config
+{
+    char str[8][31];
+} big_cfg[BIG_CFG_COUNT];
+
+#define BIG_CFG_FIELDS(FIELD, type)         \
+    FIELD(type, str[0], "str0", CFG_str, 0) \
+    FIELD(type, str[1], "str1", CFG_str, 0) \
+    FIELD(type, str[2], "str2", CFG_str, 0) \
+    FIELD(type, str[3], "str3", CFG_str, 0) \
+    FIELD(type, str[4], "str4", CFG_str, 0) \
+    FIELD(type, str[5], "str5", CFG_str, 0) \
+    FIELD(type, str[6], "str6", CFG_str, 0) \
+    FIELD(type, str[7], "str7", CFG_str, 0)
+
+CFG_SCHEMA(big_schema_0, struct big_config, big_cfg[0], BIG_CFG_FIELDS);
+CFG_SCHEMA(big_schema_1, struct big_config, big_cfg[1], BIG_CFG_FIELDS);
+CFG_SCHEMA(big_schema_2, struct big_config, big_cfg[2], BIG_CFG_FIELDS);
+CFG_SCHEMA(big_schema_3, struct big_config, big_cfg[3], BIG_CFG_FIELDS);
+CFG_SCHEMA(big_schema_4, struct big_config, big_cfg[4], BIG_CFG_FIELDS);
+CFG_SCHEMA(big_schema_5, struct big_config, big_cfg[5], BIG_CFG_FIELDS);
+CFG_SCHEMA(big_schema_6, struct big_config, big_cfg[6], BIG_CFG_FIELDS);
+
+static const struct cfg_schema *big_schemas[BIG_CFG_COUNT] = {
+    &big_schema_0, &big_schema_1, &big_schema_2, &big_schema_3, &big_schema_4, &big_schema_5, &big_schema_6};
+
+#define TEST_KEY ((char *)"test.cfg")
+#define OTHER_KEY ((char *)"other.cfg")
+#define LEGACY_KEY ((char *)"legacy.cfg")
+
+#define INTERRUPTED_CUTS 64
+
+static int failures;
+
+#define CHECK(cond)                                                   \
+    do                                                                \
+    {                                                                 \
+        if (!(cond))                                                  \
+        {                                                             \
+            printf("  failed at line %d: %s\n", __LINE__, #cond);     \
+            failures++;                                               \
+        }                                                             \
+    } while (0)
+
+static void report(const char *name, int prev_failures)
+{
+    printf("%-4s %s\n", (failures == prev_failures) ? "ok" : "FAIL", name);
+}
+
+//
+// the HTTP responses are captured instead of sent
+//
+
+static char sent_body[128];
+static uint32 sent_etag;
+
+Http_header::Http_header()
+{
+    m_content_type = NULL;
+    m_acrh = NULL;
+    m_cors_preflight = false;
+    m_etag = 0;
+}
+
+Http_header::~Http_header()
+{
+}
+
+Http_parsed_req::Http_parsed_req()
+{
+    os_memset(this, 0, sizeof(Http_parsed_req));
+}
+
+// the strings are the test ones
+Http_parsed_req::~Http_parsed_req()
+{
+}
+
+char *http_format_header(struct espconn *p_espconn, Http_header *header)
+{
+    sent_etag = header->m_etag;
+    char *str = new char[1];
+    str[0] = 0;
+    return str;
+}
+
+void http_send_buffer(struct espconn *p_espconn, int order, char *msg, int msg_len)
+{
+    delete[] msg;
+}
+
+void http_send(struct espconn *p_espconn, char *msg, int msg_len)
+{
+    os_snprintf(sent_body, sizeof(sent_body), "%.*s", msg_len, msg);
+    delete[] msg;
+}
+
+void http_response(struct espconn *p_espconn, int code, char *content_type, const char *msg, bool free_msg)
+{
+    os_snprintf(sent_body, sizeof(sent_body), "%d %s", code, msg);
+    if (free_msg)
+        delete[] msg;
+}
+
+// a GET of a cached cfg route
+static char *http_get(const char *url, char *(*json_stringify)(char *dest, int len))
+{
+    struct espconn conn;
+    Http_parsed_req req;
+    req.req_method = HTTP_GET;
+    req.url = (char *)url;
+    sent_body[0] = 0;
+    http_cache_response(&conn, &req, json_stringify);
+    return sent_body;
+}
+
+// espbot_mdns needs
+extern "C"
+{
+    void espconn_mdns_init(struct mdns_info *info)
+    {
+    }
+
+    void espconn_mdns_close(void)
+    {
+    }
+
+    bool wifi_get_ip_info(uint8 if_index, struct ip_info *info)
+    {
+        os_memset(info, 0, sizeof(struct ip_info));
+        return true;
+    }
+}
+
+char *espbot_get_name(void)
+{
+    return (char *)"host";
+}
+
+//
+// helpers
+//
+
+static void set_test_cfg(int gen)
+{
+    test_cfg.enabled = (gen % 2);
+    test_cfg.level = -(gen % 100);
+    test_cfg.port = 8000 + gen;
+    test_cfg.offset = gen;
+    os_sprintf(test_cfg.name, "generation %d", gen);
+}
+
+// the fields come from the same save
+static bool test_cfg_is(int gen)
+{
+    char name[32];
+    os_sprintf(name, "generation %d", gen);
+    return ((test_cfg.enabled == (bool)(gen % 2)) &&
+            (test_cfg.level == -(gen % 100)) &&
+            (test_cfg.port == (8000 + gen)) &&
+            (test_cfg.offset == gen) &&
+            (os_strcmp(test_cfg.name, name) == 0));
+}
+
+static void boot_begin(void)
+{
+    esp_spiffs_mount();
+    cfgstore_init();
+    cfg_defaults(&test_schema);
+    cfg_defaults(&other_schema);
+}
+
+// restores both cfg, the results into res (when not NULL)
+static void boot(int *res = NULL)
+{
+    boot_begin();
+    int test_res = cfgstore_restore(TEST_KEY, &test_schema);
+    int other_res = cfgstore_restore(OTHER_KEY, &other_schema);
+    cfgstore_init_done();
+    if (res)
+    {
+        res[0] = test_res;
+        res[1] = other_res;
+    }
+}
+
+static void remove_file(char *name)
+{
+    if (!Espfile::exists(name))
+        return;
+    Espfile file(name);
+    file.remove();
+}
+
+static void clean_store(void)
+{
+    remove_file((char *)"cfgstore.a");
+    remove_file((char *)"cfgstore.b");
+    remove_file(LEGACY_KEY);
+}
+
+static char *slot_name(int slot)
+{
+    return (char *)(slot ? "cfgstore.b" : "cfgstore.a");
+}
+
+// result: the slot file length (0 when missing)
+static int slot_read(int slot, uint32 *buffer)
+{
+    int len = Espfile::size(slot_name(slot));
+    if ((len <= 0) || (len > CFGSTORE_SIZE_MAX))
+        return 0;
+    Espfile file(slot_name(slot));
+    if (file.n_read((char *)buffer, len) != len)
+        return 0;
+    return len;
+}
+
+static void slot_write(int slot, uint32 *buffer, int len)
+{
+    Espfile file(slot_name(slot));
+    file.clear();
+    file.n_append((char *)buffer, len);
+}
+
+// CRC-32 (IEEE 802.3) a bit at a time, as a reference
+static uint32 crc32(uint32 crc, char *data, int len)
+{
+    while (len-- > 0)
+    {
+        crc ^= (uint8)*data++;
+        int bit;
+        for (bit = 0; bit < 8; bit++)
+            crc = (crc >> 1) ^ ((crc & 1) ? 0xEDB88320 : 0);
+    }
+    return crc;
+}
+
+// rewrite the slot with another sequence (and a good CRC)
+static void slot_set_seq(int slot, uint32 seq)
+{
+    uint32 buffer[CFGSTORE_SIZE_MAX / 4];
+    int len = slot_read(slot, buffer);
+    buffer[1] = seq;
+    uint32 crc = crc32(0xFFFFFFFF, (char *)buffer, 12);
+    buffer[3] = ~crc32(crc, (char *)(buffer + 4), (len - 16));
+    slot_write(slot, buffer, len);
+}
+
+// the slot with the highest sequence, -1 when none
+static int newest_slot(uint32 *seq = NULL)
+{
+    uint32 header[2][CFGSTORE_SIZE_MAX / 4];
+    bool written[2];
+    written[0] = (slot_read(0, header[0]) > 0);
+    written[1] = (slot_read(1, header[1]) > 0);
+    int slot = -1;
+    if (written[0])
+        slot = 0;
+    if (written[1] && (!written[0] || ((int)(header[1][1] - header[0][1]) > 0)))
+        slot = 1;
+    if (seq && (slot >= 0))
+        *seq = header[slot][1];
+    return slot;
+}
+
+// a save request, written CFGSTORE_SAVE_DELAY later by the timer
+static void save_and_wait(void)
+{
+    cfgstore_save();
+    host_delay_us((CFGSTORE_SAVE_DELAY + 1) * 1000);
+    host_run_timers();
+}
+
+//
+// the checks
+//
+
+static void check_round_trip(void)
+{
+    int prev = failures;
+    int res[2];
+    clean_store();
+    boot(res);
+    CHECK(res[0] == CFG_cantRestore);
+    CHECK(res[1] == CFG_cantRestore);
+    CHECK(test_cfg.enabled && (test_cfg.level == -3) && (test_cfg.port == 80) && (test_cfg.name[0] == 0));
+    CHECK(!cfgstore_uptodate(&test_schema));
+    set_test_cfg(42);
+    other_cfg.value = -123456;
+    os_strcpy(other_cfg.text, "fifteen chars..");
+    save_and_wait();
+    CHECK(newest_slot() >= 0);
+    CHECK(cfgstore_uptodate(&test_schema));
+    CHECK(cfgstore_uptodate(&other_schema));
+    boot(res);
+    CHECK((res[0] == CFG_ok) && (res[1] == CFG_ok));
+    CHECK(test_cfg_is(42));
+    CHECK(other_cfg.value == -123456);
+    CHECK(os_strcmp(other_cfg.text, "fifteen chars..") == 0);
+    CHECK(cfgstore_uptodate(&test_schema));
+    report("round trip", prev);
+}
+
+static void check_legacy(void)
+{
+    int prev = failures;
+    clean_store();
+    {
+        const char *json = "{\"enabled\":0,\"level\":-100,\"port\":8080,\"offset\":-5,\"name\":\"old firmware\"}";
+        Espfile file(LEGACY_KEY);
+        file.n_append((char *)json, os_strlen(json));
+    }
+    boot_begin();
+    CHECK(cfgstore_restore(LEGACY_KEY, &test_schema) == CFG_ok);
+    CHECK(!test_cfg.enabled && (test_cfg.level == -100) && (test_cfg.port == 8080) && (test_cfg.offset == -5));
+    CHECK(os_strcmp(test_cfg.name, "old firmware") == 0);
+    // moved into the store
+    cfgstore_init_done();
+    CHECK(!Espfile::exists(LEGACY_KEY));
+    CHECK(newest_slot() >= 0);
+    boot_begin();
+    CHECK(cfgstore_restore(LEGACY_KEY, &test_schema) == CFG_ok);
+    cfgstore_init_done();
+    CHECK((test_cfg.port == 8080) && (os_strcmp(test_cfg.name, "old firmware") == 0));
+    report("legacy JSON file migration", prev);
+}
+
+static void check_interrupted_save(void)
+{
+    int prev = failures;
+    clean_store();
+    boot();
+    set_test_cfg(0);
+    CHECK(cfgstore_save() == CFG_ok);
+    CHECK(cfgstore_flush() == CFG_ok);
+    int saved = 0;
+    int cut;
+    int completed = 0;
+    // the power is cut after each flash write or erase of a save
+    // (a save takes less than INTERRUPTED_CUTS, both slots are written)
+    for (cut = 0; cut < INTERRUPTED_CUTS; cut++)
+    {
+        int gen = cut + 1;
+        set_test_cfg(gen);
+        cfgstore_save();
+        host_flash_cut_after(cut);
+        int res = cfgstore_flush();
+        host_flash_cut_after(-1);
+        boot();
+        if (res == CFG_ok)
+        {
+            completed++;
+            CHECK(test_cfg_is(gen));
+        }
+        else
+        {
+            CHECK(test_cfg_is(gen) || test_cfg_is(saved));
+        }
+        if (test_cfg_is(gen))
+            saved = gen;
+    }
+    CHECK(completed > 2);
+    printf("     %d cut points, %d saves completed\n", cut, completed);
+    report("interrupted save", prev);
+}
+
+static void check_corrupted_slot(void)
+{
+    int prev = failures;
+    uint32 buffer[CFGSTORE_SIZE_MAX / 4];
+    clean_store();
+    boot();
+    set_test_cfg(1);
+    save_and_wait();
+    set_test_cfg(2);
+    save_and_wait();
+    // a flipped bit into the newest slot records
+    int slot = newest_slot();
+    int len = slot_read(slot, buffer);
+    ((char *)buffer)[len - 3] ^= 0x10;
+    slot_write(slot, buffer, len);
+    int events = host_dia_events();
+    boot_begin();
+    CHECK(host_dia_events() > events);
+    CHECK(host_dia_last_code() == CFGSTORE_BAD_SLOT);
+    CHECK(cfgstore_restore(TEST_KEY, &test_schema) == CFG_ok);
+    cfgstore_init_done();
+    CHECK(test_cfg_is(1));
+    // the bad slot is the next written
+    set_test_cfg(3);
+    save_and_wait();
+    CHECK(newest_slot() == slot);
+    boot();
+    CHECK(test_cfg_is(3));
+    // both slots bad: nothing restored
+    int idx;
+    for (idx = 0; idx < 2; idx++)
+    {
+        len = slot_read(idx, buffer);
+        buffer[3] ^= 1;
+        slot_write(idx, buffer, len);
+    }
+    int res[2];
+    boot(res);
+    CHECK(res[0] == CFG_cantRestore);
+    CHECK(test_cfg.port == 80);
+    report("corrupted slot", prev);
+}
+
+static void check_sequence_wrap(void)
+{
+    int prev = failures;
+    clean_store();
+    boot();
+    set_test_cfg(1);
+    save_and_wait();
+    int older = newest_slot();
+    set_test_cfg(2);
+    save_and_wait();
+    int newer = newest_slot();
+    CHECK(newer == (1 - older));
+    // the newer slot wrapped around
+    slot_set_seq(older, 0xFFFFFFFF);
+    slot_set_seq(newer, 0);
+    boot();
+    CHECK(test_cfg_is(2));
+    // the other way round
+    slot_set_seq(older, 0);
+    slot_set_seq(newer, 0xFFFFFFFF);
+    boot();
+    CHECK(test_cfg_is(1));
+    // a save after the wrap
+    set_test_cfg(3);
+    save_and_wait();
+    uint32 seq = 0;
+    CHECK(newest_slot(&seq) == newer);
+    CHECK(seq == 1);
+    boot();
+    CHECK(test_cfg_is(3));
+    report("sequence wrap around", prev);
+}
+
+// simulated time, running the timers every 100 ms
+static void run_for(uint32 ms)
+{
+    uint32 elapsed;
+    for (elapsed = 0; elapsed < ms; elapsed += 100)
+    {
+        host_delay_us(100 * 1000);
+        host_run_timers();
+    }
+}
+
+static void check_coalescing(void)
+{
+    int prev = failures;
+    uint32 seq = 0;
+    uint32 new_seq = 0;
+    clean_store();
+    boot();
+    set_test_cfg(1);
+    CHECK(cfgstore_save() == CFG_ok);
+    CHECK(cfgstore_flush() == CFG_ok);
+    newest_slot(&seq);
+    // three changes within the window: one write, at the end of the window
+    int idx;
+    for (idx = 2; idx <= 4; idx++)
+    {
+        set_test_cfg(idx);
+        cfgstore_save();
+        run_for(300);
+    }
+    newest_slot(&new_seq);
+    CHECK(new_seq == seq);
+    run_for(200);
+    newest_slot(&new_seq);
+    CHECK(new_seq == (seq + 1));
+    boot();
+    CHECK(test_cfg_is(4));
+    // a change undone within the window: nothing written
+    set_test_cfg(5);
+    cfgstore_save();
+    set_test_cfg(4);
+    cfgstore_save();
+    run_for(CFGSTORE_SAVE_DELAY + 100);
+    newest_slot(&new_seq);
+    CHECK(new_seq == (seq + 1));
+    report("write coalescing", prev);
+}
+
+static void check_retries(void)
+{
+    int prev = failures;
+    uint32 seq = 0;
+    uint32 new_seq = 0;
+    clean_store();
+    boot();
+    set_test_cfg(1);
+    cfgstore_save();
+    CHECK(cfgstore_flush() == CFG_ok);
+    newest_slot(&seq);
+    // the flash cannot be written: the first write and CFGSTORE_RETRIES retries
+    int write_errors = host_dia_count(CFGSTORE_WRITE_ERROR);
+    int given_up = host_dia_count(CFGSTORE_SAVE_GIVEN_UP);
+    host_flash_cut_after(0);
+    set_test_cfg(2);
+    cfgstore_save();
+    run_for(10 * 60 * 1000);
+    CHECK(host_dia_count(CFGSTORE_WRITE_ERROR) == (write_errors + 1 + CFGSTORE_RETRIES));
+    CHECK(host_dia_count(CFGSTORE_SAVE_GIVEN_UP) == (given_up + 1));
+    host_flash_cut_after(-1);
+    // still pending for a flush (e.g. before a restart)
+    CHECK(cfgstore_flush() == CFG_ok);
+    newest_slot(&new_seq);
+    CHECK(new_seq == (seq + 1));
+    // a new request after giving up restarts the retries
+    host_flash_cut_after(0);
+    set_test_cfg(3);
+    cfgstore_save();
+    run_for(10 * 60 * 1000);
+    host_flash_cut_after(-1);
+    CHECK(host_dia_count(CFGSTORE_WRITE_ERROR) == (write_errors + 2 * (1 + CFGSTORE_RETRIES)));
+    set_test_cfg(4);
+    cfgstore_save();
+    run_for(CFGSTORE_SAVE_DELAY + 100);
+    boot();
+    CHECK(test_cfg_is(4));
+    // too long for the store: not retried
+    boot_begin();
+    cfgstore_restore(TEST_KEY, &test_schema);
+    int idx;
+    for (idx = 0; idx < BIG_CFG_COUNT; idx++)
+    {
+        char key[16];
+        os_sprintf(key, "big%d.cfg", idx);
+        CHECK(cfgstore_restore(key, big_schemas[idx]) == CFG_cantRestore);
+        int str;
+        for (str = 0; str < 8; str++)
+            os_memset(big_cfg[idx].str[str], 'a' + str, 30);
+    }
+    cfgstore_init_done();
+    int too_long = host_dia_count(CFGSTORE_TOO_LONG);
+    cfgstore_save();
+    run_for(10 * 60 * 1000);
+    CHECK(host_dia_count(CFGSTORE_TOO_LONG) == (too_long + 1));
+    // and the next request tries once again
+    cfgstore_save();
+    run_for(CFGSTORE_SAVE_DELAY + 100);
+    CHECK(host_dia_count(CFGSTORE_TOO_LONG) == (too_long + 2));
+    report("write retries", prev);
+}
+
+// a cfg changed and changed back while its save is pending
+static void check_cache_invalidation(void)
+{
+    int prev = failures;
+    uint32 seq = 0;
+    uint32 new_seq = 0;
+    clean_store();
+    boot_begin();
+    mdns_init();
+    cfgstore_init_done();
+    http_cache_init();
+    mdns_disable();
+    mdns_cfg_save();
+    CHECK(cfgstore_flush() == CFG_ok);
+    newest_slot(&seq);
+    CHECK(os_strstr(http_get("/api/mdns", mdns_cfg_json_stringify), "\"mdns_enabled\":0"));
+    uint32 etag_a = sent_etag;
+    // POST A -> B, GET, POST B -> A, all within CFGSTORE_SAVE_DELAY
+    mdns_enable();
+    mdns_cfg_save();
+    CHECK(os_strstr(http_get("/api/mdns", mdns_cfg_json_stringify), "\"mdns_enabled\":1"));
+    CHECK(sent_etag != etag_a);
+    mdns_disable();
+    mdns_cfg_save();
+    CHECK(os_strstr(http_get("/api/mdns", mdns_cfg_json_stringify), "\"mdns_enabled\":0"));
+    CHECK(sent_etag == etag_a);
+    // nothing changed at the end of the window: nothing written
+    host_delay_us((CFGSTORE_SAVE_DELAY + 1) * 1000);
+    host_run_timers();
+    newest_slot(&new_seq);
+    CHECK(new_seq == seq);
+    report("cache invalidation with a pending save", prev);
+}
+
+int main(int argc, char **argv)
+{
+    host_flash_reset();
+    // formatting
+    esp_spiffs_mount();
+    if (esp_spiffs_total_size() == 0)
+    {
+        printf("cfgstore_check: cannot mount the file system\n");
+        return 1;
+    }
+    check_round_trip();
+    check_legacy();
+    check_interrupted_save();
+    check_corrupted_slot();
+    check_sequence_wrap();
+    check_coalescing();
+    check_retries();
+    check_cache_invalidation();
+    printf("cfgstore_check: %s\n", failures ? "FAILED" : "ok");
+    return (failures != 0);
+}
@@ -0,0 +1,120 @@
+/*
+ * ----------------------------------------------------------------------------
+ * "THE BEER-WARE LICENSE" (Revision 42):
+ * <quackmore-ff@yahoo.com> wrote this file.  As long as you retain this notice
+ * you can do whatever you want with this stuff. If we meet some day, and you 
+ * think this stuff is worth it, you can buy me a beer in return. Quackmore
+ * ----------------------------------------------------------------------------
+ */
+
+// the SPI flash as a RAM image (see host.hpp)
+
+#include <stdlib.h>
+#include <string.h>
+
+extern "C"
+{
+#include "c_types.h"
+#include "spi_flash.h"
+}
+
+#include "host.hpp"
+
+static uint8 *flash_image;
+static uint32 flash_erases[HOST_FLASH_SECTORS];
+static uint32 flash_errors;
+static int flash_ops_left = -1; // before the power cut
+static struct host_flash_latency flash_latency = HOST_FLASH_LATENCY_DEFAULT;
+
+void host_flash_reset(void)
+{
+    if (flash_image == NULL)
+        flash_image = (uint8 *)malloc(HOST_FLASH_SIZE);
+    memset(flash_image, 0xFF, HOST_FLASH_SIZE);
+    memset(flash_erases, 0, sizeof(flash_erases));
+    flash_errors = 0;
+}
+
+void host_flash_set_latency(const struct host_flash_latency *latency)
+{
+    flash_latency = *latency;
+}
+
+uint32 host_flash_erase_count(int sector)
+{
+    if ((sector < 0) || (sector >= HOST_FLASH_SECTORS))
+        return 0;
+    return flash_erases[sector];
+}
+
+uint32 host_flash_errors(void)
+{
+    return flash_errors;
+}
+
+void host_flash_cut_after(int ops)
+{
+    flash_ops_left = ops;
+}
+
+// false once the power is cut (the image is left as it is)
+static bool flash_powered(void)
+{
+    if (flash_ops_left < 0)
+        return true;
+    if (flash_ops_left == 0)
+        return false;
+    flash_ops_left--;
+    return true;
+}
+
+static bool flash_op_ok(uint32 addr, uint32 *buffer, uint32 len)
+{
+    if (flash_image == NULL)
+        host_flash_reset();
+    if (((addr % 4) != 0) ||
+        (((size_t)buffer % 4) != 0) ||
+        ((len % 4) != 0) ||
+        (addr >= HOST_FLASH_SIZE) ||
+        (len > (HOST_FLASH_SIZE - addr)))
+    {
+        flash_errors++;
+        return false;
+    }
+    return true;
+}
+
+extern "C"
+{
+    SpiFlashOpResult spi_flash_read(uint32 addr, uint32 *dst, uint32 len)
+    {
+        if (!flash_op_ok(addr, dst, len))
+            return SPI_FLASH_RESULT_ERR;
+        memcpy(dst, flash_image + addr, len);
+        host_delay_us(flash_latency.read_us + ((len * flash_latency.read_ns_per_byte) / 1000));
+        return SPI_FLASH_RESULT_OK;
+    }
+
+    SpiFlashOpResult spi_flash_write(uint32 addr, uint32 *src, uint32 len)
+    {
+        if (!flash_op_ok(addr, src, len) || !flash_powered())
+            return SPI_FLASH_RESULT_ERR;
+        uint8 *data = (uint8 *)src;
+        uint32 idx;
+        // SPIFFS relies on this, e.g. clearing the page header flags one by one
+        for (idx = 0; idx < len; idx++)
+            flash_image[addr + idx] &= data[idx];
+        host_delay_us(flash_latency.write_us + ((len * flash_latency.write_ns_per_byte) / 1000));
+        return SPI_FLASH_RESULT_OK;
+    }
+
+    SpiFlashOpResult spi_flash_erase_sector(uint16 sector)
+    {
+        if (!flash_op_ok(sector * SPI_FLASH_SEC_SIZE, NULL, SPI_FLASH_SEC_SIZE) || !flash_powered())
+            return SPI_FLASH_RESULT_ERR;
+        memset(flash_image + (sector * SPI_FLASH_SEC_SIZE), 0xFF, SPI_FLASH_SEC_SIZE);
+        flash_erases[sector]++;
+        host_delay_us(flash_latency.erase_us);
+        return SPI_FLASH_RESULT_OK;
+    }
+}
@@ -0,0 +1,76 @@
+/*
+ * ----------------------------------------------------------------------------
+ * "THE BEER-WARE LICENSE" (Revision 42):
+ * <quackmore-ff@yahoo.com> wrote this file.  As long as you retain this notice
+ * you can do whatever you want with this stuff. If we meet some day, and you 
+ * think this stuff is worth it, you can buy me a beer in return. Quackmore
+ * ----------------------------------------------------------------------------
+ */
+#ifndef __HOST_HPP__
+#define __HOST_HPP__
+
+extern "C"
+{
+#include "c_types.h"
+}
+
+/*
+ * host build helpers (the SDK and the espbot modules not built for the host)
+ *
+ * there is no scheduler: posted tasks and expired timers run when called for
+ */
+
+// run the posted tasks (until the queue is empty)
+void host_run_tasks(void);
+// run the timers expired by now, and the tasks they post
+void host_run_timers(void);
+// run timers and tasks for ms milliseconds
+void host_run_for(uint32 ms);
+
+// diagnostic events so far (by dia_*_evnt)
+int host_dia_events(void);
+// the last diagnostic event code
+int host_dia_last_code(void);
+// the diagnostic events with code so far
+int host_dia_count(int code);
+
+// nanoseconds from a monotonic clock (benchmarks)
+uint64 host_ns(void);
+// simulated time (e.g. the flash latency), system_get_time includes it
+void host_delay_us(uint32 us);
+
+/*
+ * flash simulator: a RAM image of the whole flash behind spi_flash_read/write/erase_sector
+ *
+ * NOR semantics: erasing sets a sector to 0xFF, writing can only clear bits
+ * (the image is ANDed with the data)
+ * addresses, buffers and sizes must be word aligned (SPI_FLASH_RESULT_ERR otherwise)
+ * every operation advances the simulated time by the latency model
+ */
+#define HOST_FLASH_SIZE (4 * 1024 * 1024)
+#define HOST_FLASH_SECTORS (HOST_FLASH_SIZE / SPI_FLASH_SEC_SIZE)
+
+struct host_flash_latency
+{
+    uint32 read_us;           // per operation
+    uint32 read_ns_per_byte;
+    uint32 write_us;          // per operation
+    uint32 write_ns_per_byte;
+    uint32 erase_us;          // per sector
+};
+
+// typical SPI NOR figures (page program 0.7 ms per 256 bytes, sector erase 45 ms)
+#define HOST_FLASH_LATENCY_DEFAULT {5, 100, 10, 2700, 45000}
+
+// erase the whole image and clear the counters
+void host_flash_reset(void);
+void host_flash_set_latency(const struct host_flash_latency *latency);
+// the erases of a sector so far (wear)
+uint32 host_flash_erase_count(int sector);
+// misaligned or out of the flash operations
+uint32 host_flash_errors(void);
+// power cut: after ops more writes or erases every write and erase fails
+// (with no change to the image), -1 powers the flash again
+void host_flash_cut_after(int ops);
+
+#endif
@@ -0,0 +1,98 @@
+/*
+ * ----------------------------------------------------------------------------
+ * "THE BEER-WARE LICENSE" (Revision 42):
+ * <quackmore-ff@yahoo.com> wrote this file.  As long as you retain this notice
+ * you can do whatever you want with this stuff. If we meet some day, and you 
+ * think this stuff is worth it, you can buy me a beer in return. Quackmore
+ * ----------------------------------------------------------------------------
+ */
+
+// the espbot modules that are not built for the host
+
+extern "C"
+{
+#include "c_types.h"
+#include "user_interface.h"
+}
+
+#include "espbot.hpp"
+#include "espbot_diagnostic.hpp"
+#include "espbot_http.hpp"
+#include "espbot_mem_mon.hpp"
+#include "host.hpp"
+
+#define HOST_DIA_CODES 0x1000
+
+static int dia_events;
+static int dia_last_code;
+static int dia_counts[HOST_DIA_CODES];
+
+int host_dia_events(void)
+{
+    return dia_events;
+}
+
+int host_dia_last_code(void)
+{
+    return dia_last_code;
+}
+
+int host_dia_count(int code)
+{
+    if ((code < 0) || (code >= HOST_DIA_CODES))
+        return 0;
+    return dia_counts[code];
+}
+
+static void dia_evnt(int code)
+{
+    dia_events++;
+    dia_last_code = code;
+    if ((code >= 0) && (code < HOST_DIA_CODES))
+        dia_counts[code]++;
+}
+
+void dia_fatal_evnt(int code, uint32) { dia_evnt(code); }
+void dia_error_evnt(int code, uint32) { dia_evnt(code); }
+void dia_warn_evnt(int code, uint32) { dia_evnt(code); }
+void dia_info_evnt(int code, uint32) { dia_evnt(code); }
+void dia_debug_evnt(int code, uint32) { dia_evnt(code); }
+void dia_trace_evnt(int code, uint32) { dia_evnt(code); }
+
+// the log macros print nothing
+bool diag_log_err_type(int)
+{
+    return false;
+}
+
+void mem_mon_stack(void)
+{
+}
+
+// the espbot coordinator running the posted functions only
+static void host_coordinator_task(os_event_t *e)
+{
+    if (e->sig == SIG_next_function)
+    {
+        void (*command)(void) = (void (*)(void))e->par;
+        if (command)
+            command();
+    }
+}
+
+void next_function(void (*fun)(void))
+{
+    static bool task_ready = false;
+    if (!task_ready)
+    {
+        system_os_task(host_coordinator_task, USER_TASK_PRIO_0, NULL, 0);
+        task_ready = true;
+    }
+    system_os_post(USER_TASK_PRIO_0, SIG_next_function, (ETSParam)fun);
+}
+
+// no http responses are sent on the host
+bool http_send_idle(void)
+{
+    return true;
+}
@@ -0,0 +1,210 @@
+/*
+ * ----------------------------------------------------------------------------
+ * "THE BEER-WARE LICENSE" (Revision 42):
+ * <quackmore-ff@yahoo.com> wrote this file.  As long as you retain this notice
+ * you can do whatever you want with this stuff. If we meet some day, and you 
+ * think this stuff is worth it, you can buy me a beer in return. Quackmore
+ * ----------------------------------------------------------------------------
+ */
+
+// the NON-OS SDK functions used by espbot, on top of libc
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+extern "C"
+{
+#include "c_types.h"
+#include "osapi.h"
+#include "mem.h"
+#include "user_interface.h"
+}
+
+#include "host.hpp"
+
+uint64 host_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ((uint64)ts.tv_sec * 1000000000ULL) + ts.tv_nsec;
+}
+
+static uint32 host_delay;
+
+void host_delay_us(uint32 us)
+{
+    host_delay += us;
+}
+
+extern "C"
+{
+    int os_printf_plus(const char *fmt, ...)
+    {
+        va_list args;
+        va_start(args, fmt);
+        int res = vprintf(fmt, args);
+        va_end(args);
+        return res;
+    }
+
+    int os_sprintf_plus(char *buf, const char *fmt, ...)
+    {
+        va_list args;
+        va_start(args, fmt);
+        int res = vsprintf(buf, fmt, args);
+        va_end(args);
+        return res;
+    }
+
+    int os_snprintf_plus(char *buf, unsigned int len, const char *fmt, ...)
+    {
+        va_list args;
+        va_start(args, fmt);
+        int res = vsnprintf(buf, len, fmt, args);
+        va_end(args);
+        return res;
+    }
+
+    void *os_memset(void *dst, int c, size_t len) { return memset(dst, c, len); }
+    void *os_memcpy(void *dst, const void *src, size_t len) { return memcpy(dst, src, len); }
+    void *os_memmove(void *dst, const void *src, size_t len) { return memmove(dst, src, len); }
+    int os_memcmp(const void *a, const void *b, size_t len) { return memcmp(a, b, len); }
+    size_t os_strlen(const char *str) { return strlen(str); }
+    char *os_strcpy(char *dst, const char *src) { return strcpy(dst, src); }
+    char *os_strncpy(char *dst, const char *src, size_t len) { return strncpy(dst, src, len); }
+    int os_strcmp(const char *a, const char *b) { return strcmp(a, b); }
+    int os_strncmp(const char *a, const char *b, size_t len) { return strncmp(a, b, len); }
+    char *os_strstr(const char *str, const char *sub) { return (char *)strstr(str, sub); }
+    char *os_strchr(const char *str, int c) { return (char *)strchr(str, c); }
+    unsigned long os_random(void) { return (unsigned long)random(); }
+
+    void *pvPortZalloc(size_t size, const char *, int) { return calloc(1, size); }
+    void *pvPortMalloc(size_t size, const char *, int) { return malloc(size); }
+    void vPortFree(void *ptr, const char *, int) { free(ptr); }
+
+    uint32 system_get_time(void) { return (uint32)(host_ns() / 1000) + host_delay; }
+    uint32 system_get_free_heap_size(void) { return 40000; }
+    uint32 system_get_chip_id(void) { return 0x00C0FFEE; }
+    void system_soft_wdt_feed(void) {}
+    void system_set_os_print(uint8) {}
+}
+
+//
+// tasks: one queue for all the priorities
+//
+#define HOST_TASK_QUEUE_LEN 64
+
+static os_task_t host_task;
+static os_event_t host_task_queue[HOST_TASK_QUEUE_LEN];
+static int host_task_head;
+static int host_task_count;
+
+extern "C"
+{
+    bool system_os_task(os_task_t task, uint8, os_event_t *, uint8)
+    {
+        host_task = task;
+        return true;
+    }
+
+    bool system_os_post(uint8, ETSSignal sig, ETSParam par)
+    {
+        if (host_task_count >= HOST_TASK_QUEUE_LEN)
+            return false;
+        os_event_t *e = &host_task_queue[(host_task_head + host_task_count) % HOST_TASK_QUEUE_LEN];
+        e->sig = sig;
+        e->par = par;
+        host_task_count++;
+        return true;
+    }
+}
+
+void host_run_tasks(void)
+{
+    while (host_task_count > 0)
+    {
+        os_event_t e = host_task_queue[host_task_head];
+        host_task_head = (host_task_head + 1) % HOST_TASK_QUEUE_LEN;
+        host_task_count--;
+        if (host_task)
+            host_task(&e);
+    }
+}
+
+//
+// timers: a list of the armed ones
+//
+static os_timer_t *host_timers;
+
+extern "C"
+{
+    void os_timer_disarm(os_timer_t *timer)
+    {
+        os_timer_t **ptr = &host_timers;
+        while (*ptr)
+        {
+            if (*ptr == timer)
+            {
+                *ptr = timer->next;
+                break;
+            }
+            ptr = &(*ptr)->next;
+        }
+        timer->armed = false;
+    }
+
+    void os_timer_setfn(os_timer_t *timer, os_timer_func_t *fn, void *arg)
+    {
+        timer->fn = fn;
+        timer->arg = arg;
+    }
+
+    void os_timer_arm(os_timer_t *timer, uint32 ms, bool repeat)
+    {
+        os_timer_disarm(timer);
+        timer->expire = system_get_time() + (ms * 1000);
+        timer->period = (repeat ? ms : 0);
+        timer->armed = true;
+        timer->next = host_timers;
+        host_timers = timer;
+    }
+}
+
+void host_run_timers(void)
+{
+    bool fired = true;
+    while (fired)
+    {
+        fired = false;
+        uint32 now = system_get_time();
+        os_timer_t *timer;
+        for (timer = host_timers; timer; timer = timer->next)
+        {
+            if ((int32)(now - timer->expire) < 0)
+                continue;
+            if (timer->period)
+                timer->expire += (timer->period * 1000);
+            else
+                os_timer_disarm(timer);
+            timer->fn(timer->arg);
+            fired = true;
+            // the callback can change the list
+            break;
+        }
+        host_run_tasks();
+    }
+}
+
+void host_run_for(uint32 ms)
+{
+    uint32 start = system_get_time();
+    while ((system_get_time() - start) < (ms * 1000))
+    {
+        host_run_timers();
+        usleep(1000);
+    }
+}
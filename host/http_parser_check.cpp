@@ -0,0 +1,362 @@
+/*
+ * ----------------------------------------------------------------------------
+ * "THE BEER-WARE LICENSE" (Revision 42):
+ * <quackmore-ff@yahoo.com> wrote this file.  As long as you retain this notice
+ * you can do whatever you want with this stuff. If we meet some day, and you
+ * think this stuff is worth it, you can buy me a beer in return. Quackmore
+ * ----------------------------------------------------------------------------
+ */
+
+// Http_res_parser conformance: fixed length, chunked, until close,
+// interim, no body and pipelined responses, plus the syntax errors
+//
+// every case is fed whole, split in two at every offset, one byte at a time
+// and split at random offsets, each segment in an exact size buffer
+// (so the sanitizers catch reads past the segment end)
+// and must always give the same result
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+extern "C"
+{
+#include "c_types.h"
+}
+
+#include "espbot_http_parser.hpp"
+
+#define CHECK_BODY_MAX 4096
+#define CHECK_RANDOM_SPLITS 200
+
+struct parser_case
+{
+    const char *name;
+    const char *response; // NULL: generated
+    bool closes;          // the server closes the connection after the response
+    int result;           // the final Http_res_parser_err
+    int responses;        // completed responses
+    // the last response
+    int http_code;
+    const char *body;
+    int content_length;
+    bool chunked;
+    bool connection_close;
+    const char *header_name; // checked with header() when not NULL
+    const char *header_value;
+    int range_start;
+    int range_end;
+    int range_size;
+};
+
+static const struct parser_case cases[] = {
+    {"fixed length",
+     "HTTP/1.1 200 OK\r\nContent-Length: 11\r\nContent-Type: text/plain\r\n\r\nhello world",
+     false, HTTP_RES_PARSER_completed, 1, 200, "hello world", 11, false, false, "content-type", "text/plain"},
+    {"fixed length zero",
+     "HTTP/1.1 200 OK\r\nContent-Length: 0\r\n\r\n",
+     false, HTTP_RES_PARSER_completed, 1, 200, "", 0, false, false},
+    {"fixed length LF only",
+     "HTTP/1.1 200 OK\nContent-Length: 2\nX-Name:  spaced value \n\nok",
+     false, HTTP_RES_PARSER_completed, 1, 200, "ok", 2, false, false, "x-name", "spaced value"},
+    {"leading empty line",
+     "\r\nHTTP/1.1 200 OK\r\nContent-Length: 2\r\n\r\nok",
+     false, HTTP_RES_PARSER_completed, 1, 200, "ok", 2, false, false},
+    {"content range",
+     "HTTP/1.1 206 Partial Content\r\nContent-Range: bytes 4-7/10\r\nContent-Length: 4\r\n\r\nefgh",
+     false, HTTP_RES_PARSER_completed, 1, 206, "efgh", 4, false, false, NULL, NULL, 4, 7, 10},
+    {"chunked",
+     "HTTP/1.1 200 OK\r\nTransfer-Encoding: chunked\r\n\r\n5\r\nhello\r\n6\r\n world\r\n0\r\n\r\n",
+     false, HTTP_RES_PARSER_completed, 1, 200, "hello world", -1, true, false},
+    {"chunked hex, extensions, trailers",
+     "HTTP/1.1 200 OK\r\ntransfer-encoding: Chunked\r\n\r\n"
+     "1A;name=value\r\nabcdefghijklmnopqrstuvwxyz\r\n"
+     "a \r\n0123456789\r\n"
+     "0\r\nX-Checksum: 1\r\nX-Other: 2\r\n\r\n",
+     false, HTTP_RES_PARSER_completed, 1, 200, "abcdefghijklmnopqrstuvwxyz0123456789", -1, true, false},
+    {"chunked LF only",
+     "HTTP/1.1 200 OK\nTransfer-Encoding: chunked\n\n3\nabc\n0\n\n",
+     false, HTTP_RES_PARSER_completed, 1, 200, "abc", -1, true, false},
+    {"chunked wins over length",
+     "HTTP/1.1 200 OK\r\nContent-Length: 3\r\nTransfer-Encoding: chunked\r\n\r\n4\r\nwins\r\n0\r\n\r\n",
+     false, HTTP_RES_PARSER_completed, 1, 200, "wins", -1, true, false},
+    {"100 continue",
+     "HTTP/1.1 100 Continue\r\n\r\nHTTP/1.1 201 Created\r\nContent-Length: 2\r\n\r\nok",
+     false, HTTP_RES_PARSER_completed, 1, 201, "ok", 2, false, false},
+    {"204 no content",
+     "HTTP/1.1 204 No Content\r\nServer: x\r\n\r\n",
+     false, HTTP_RES_PARSER_completed, 1, 204, "", -1, false, false},
+    {"304 with length",
+     "HTTP/1.1 304 Not Modified\r\nContent-Length: 10\r\nETag: \"1a\"\r\n\r\n",
+     false, HTTP_RES_PARSER_completed, 1, 304, "", 10, false, false, "etag", "\"1a\""},
+    {"until close",
+     "HTTP/1.1 200 OK\r\nContent-Type: text/plain\r\n\r\nstreamed until the server closes",
+     true, HTTP_RES_PARSER_completed, 1, 200, "streamed until the server closes", -1, false, true},
+    {"HTTP/1.0",
+     "HTTP/1.0 200 OK\r\nContent-Length: 2\r\n\r\nok",
+     false, HTTP_RES_PARSER_completed, 1, 200, "ok", 2, false, true},
+    {"HTTP/1.0 keep-alive",
+     "HTTP/1.0 200 OK\r\nConnection: Keep-Alive\r\nContent-Length: 2\r\n\r\nok",
+     false, HTTP_RES_PARSER_completed, 1, 200, "ok", 2, false, false},
+    {"connection close",
+     "HTTP/1.1 200 OK\r\nConnection: close\r\nContent-Length: 2\r\n\r\nok",
+     false, HTTP_RES_PARSER_completed, 1, 200, "ok", 2, false, true},
+    {"pipelined",
+     "HTTP/1.1 200 OK\r\nContent-Length: 5\r\n\r\nfirst"
+     "HTTP/1.1 204 No Content\r\n\r\n"
+     "HTTP/1.1 200 OK\r\nTransfer-Encoding: chunked\r\n\r\n3\r\nbye\r\n0\r\n\r\n",
+     false, HTTP_RES_PARSER_completed, 3, 200, "bye", -1, true, false},
+    {"bad status line",
+     "HTP/1.1 200 OK\r\n\r\n",
+     false, HTTP_RES_PARSER_bad_syntax, 0},
+    {"bad status code",
+     "HTTP/1.1 2x0 OK\r\n\r\n",
+     false, HTTP_RES_PARSER_bad_syntax, 0},
+    {"bad content length",
+     "HTTP/1.1 200 OK\r\nContent-Length: 1x\r\n\r\n",
+     false, HTTP_RES_PARSER_bad_syntax, 0},
+    {"content length overflow",
+     "HTTP/1.1 200 OK\r\nContent-Length: 99999999999\r\n\r\nok",
+     false, HTTP_RES_PARSER_bad_syntax, 0},
+    {"content length above INT_MAX",
+     "HTTP/1.1 200 OK\r\nContent-Length: 2147483648\r\n\r\nok",
+     false, HTTP_RES_PARSER_bad_syntax, 0},
+    {"bad chunk size",
+     "HTTP/1.1 200 OK\r\nTransfer-Encoding: chunked\r\n\r\nzz\r\n",
+     false, HTTP_RES_PARSER_bad_syntax, 0},
+    {"empty chunk size",
+     "HTTP/1.1 200 OK\r\nTransfer-Encoding: chunked\r\n\r\n\r\n",
+     false, HTTP_RES_PARSER_bad_syntax, 0},
+    {"chunk data not terminated",
+     "HTTP/1.1 200 OK\r\nTransfer-Encoding: chunked\r\n\r\n5\r\nhelloX\r\n0\r\n\r\n",
+     false, HTTP_RES_PARSER_bad_syntax, 0},
+    {"chunk size overflow",
+     "HTTP/1.1 200 OK\r\nTransfer-Encoding: chunked\r\n\r\nFFFFFFFFF\r\n",
+     false, HTTP_RES_PARSER_bad_syntax, 0},
+    {"fixed length truncated",
+     "HTTP/1.1 200 OK\r\nContent-Length: 10\r\n\r\nabc",
+     true, HTTP_RES_PARSER_bad_syntax, 0},
+    {"header too long",
+     NULL,
+     false, HTTP_RES_PARSER_header_too_long, 0},
+};
+
+struct check_run
+{
+    char body[CHECK_BODY_MAX];
+    int body_len;
+    int responses;
+    // the last completed response
+    int http_code;
+    int content_length;
+    bool chunked;
+    bool connection_close;
+    char header[64];
+    int header_len;
+    int range_start;
+    int range_end;
+    int range_size;
+};
+
+static bool on_headers(void *param, Http_res_parser *parser)
+{
+    // a new response, the body restarts
+    ((struct check_run *)param)->body_len = 0;
+    return true;
+}
+
+static bool on_body(void *param, char *data, int len)
+{
+    struct check_run *run = (struct check_run *)param;
+    if ((run->body_len + len) > CHECK_BODY_MAX)
+        return false;
+    memcpy(run->body + run->body_len, data, len);
+    run->body_len += len;
+    return true;
+}
+
+static void completed(struct check_run *run, Http_res_parser *parser, const struct parser_case *test)
+{
+    run->responses++;
+    run->http_code = parser->http_code;
+    run->content_length = parser->content_length;
+    run->chunked = parser->chunked;
+    run->connection_close = parser->connection_close;
+    run->range_start = parser->content_range_start;
+    run->range_end = parser->content_range_end;
+    run->range_size = parser->content_range_size;
+    run->header_len = -1;
+    if (test->header_name)
+    {
+        char *value;
+        run->header_len = parser->header(test->header_name, &value);
+        if ((run->header_len >= 0) && (run->header_len < (int)sizeof(run->header)))
+            memcpy(run->header, value, run->header_len);
+    }
+}
+
+// feed the response split at the offsets, result: the final Http_res_parser_err
+static int feed(const struct parser_case *test, const char *response, int len,
+                int *splits, int split_count, struct check_run *run)
+{
+    memset(run, 0, sizeof(*run));
+    Http_res_parser parser(run, on_headers, on_body);
+    int res = HTTP_RES_PARSER_ok;
+    int idx;
+    for (idx = 0; idx <= split_count; idx++)
+    {
+        int start = (idx == 0) ? 0 : splits[idx - 1];
+        int end = (idx == split_count) ? len : splits[idx];
+        int segment_len = end - start;
+        if (segment_len == 0)
+            continue;
+        char *segment = (char *)malloc(segment_len);
+        memcpy(segment, response + start, segment_len);
+        int offset = 0;
+        while (offset < segment_len)
+        {
+            int consumed;
+            res = parser.feed(segment + offset, segment_len - offset, &consumed);
+            if (res < 0)
+            {
+                free(segment);
+                return res;
+            }
+            if (res != HTTP_RES_PARSER_completed)
+                break;
+            // the remaining bytes belong to the next response
+            completed(run, &parser, test);
+            parser.reset();
+            offset += consumed;
+        }
+        free(segment);
+    }
+    if (test->closes)
+    {
+        res = parser.closed();
+        if (res == HTTP_RES_PARSER_completed)
+            completed(run, &parser, test);
+    }
+    return res;
+}
+
+static bool expected(const struct parser_case *test, int res, struct check_run *run)
+{
+    if (res != test->result)
+        return false;
+    if (test->result < 0)
+        return true;
+    if ((run->responses != test->responses) ||
+        (run->http_code != test->http_code) ||
+        (run->body_len != (int)strlen(test->body)) ||
+        (memcmp(run->body, test->body, run->body_len) != 0) ||
+        (run->content_length != test->content_length) ||
+        (run->chunked != test->chunked) ||
+        (run->connection_close != test->connection_close) ||
+        (run->range_start != test->range_start) ||
+        (run->range_end != test->range_end) ||
+        (run->range_size != test->range_size))
+        return false;
+    if (test->header_name &&
+        ((run->header_len != (int)strlen(test->header_value)) ||
+         (memcmp(run->header, test->header_value, run->header_len) != 0)))
+        return false;
+    return true;
+}
+
+static void report(const struct parser_case *test, int res, struct check_run *run, int *splits, int split_count)
+{
+    printf("FAILED %s: result %d (expected %d), responses %d, code %d, body [%.*s]\n",
+           test->name, res, test->result, run->responses, run->http_code, run->body_len, run->body);
+    printf("       length %d, chunked %d, close %d, range %d-%d/%d, splits",
+           run->content_length, run->chunked, run->connection_close,
+           run->range_start, run->range_end, run->range_size);
+    int idx;
+    for (idx = 0; idx < split_count; idx++)
+        printf(" %d", splits[idx]);
+    printf("\n");
+}
+
+// result: the count of failed runs
+static int check(const struct parser_case *test, char *response, int len, int *runs)
+{
+    static int splits[CHECK_BODY_MAX];
+    struct check_run run;
+    int failed = 0;
+    int res;
+    int idx;
+    *runs = 0;
+    // whole and split in two at every offset
+    for (idx = 0; idx < len; idx++)
+    {
+        splits[0] = idx;
+        res = feed(test, response, len, splits, (idx ? 1 : 0), &run);
+        (*runs)++;
+        if (!expected(test, res, &run))
+        {
+            if (failed++ == 0)
+                report(test, res, &run, splits, (idx ? 1 : 0));
+        }
+    }
+    // one byte at a time
+    for (idx = 1; idx < len; idx++)
+        splits[idx - 1] = idx;
+    res = feed(test, response, len, splits, len - 1, &run);
+    (*runs)++;
+    if (!expected(test, res, &run))
+    {
+        if (failed++ == 0)
+            report(test, res, &run, splits, len - 1);
+    }
+    // random offsets
+    int rnd;
+    for (rnd = 0; rnd < CHECK_RANDOM_SPLITS; rnd++)
+    {
+        int count = 0;
+        for (idx = 1; idx < len; idx++)
+            if ((rand() % 8) == 0)
+                splits[count++] = idx;
+        res = feed(test, response, len, splits, count, &run);
+        (*runs)++;
+        if (!expected(test, res, &run))
+        {
+            if (failed++ == 0)
+                report(test, res, &run, splits, count);
+        }
+    }
+    return failed;
+}
+
+int main(int argc, char **argv)
+{
+    static char generated[2 * HTTP_RES_HEADER_MAX];
+    srand(1);
+    int failed_cases = 0;
+    unsigned int idx;
+    for (idx = 0; idx < (sizeof(cases) / sizeof(cases[0])); idx++)
+    {
+        const struct parser_case *test = &cases[idx];
+        char *response = (char *)test->response;
+        if (response == NULL)
+        {
+            // a header line longer than the header buffer
+            int len = sprintf(generated, "HTTP/1.1 200 OK\r\nX-Long: ");
+            memset(generated + len, 'x', HTTP_RES_HEADER_MAX);
+            strcpy(generated + len + HTTP_RES_HEADER_MAX, "\r\n\r\n");
+            response = generated;
+        }
+        int runs;
+        int failed = check(test, response, strlen(response), &runs);
+        if (failed)
+        {
+            printf("FAILED %s: %d of %d runs\n", test->name, failed, runs);
+            failed_cases++;
+        }
+        else
+        {
+            printf("ok     %-36s %5d runs\n", test->name, runs);
+        }
+    }
+    printf("%s\n", (failed_cases == 0) ? "http_parser_check: ok" : "http_parser_check: FAILED");
+    return (failed_cases != 0);
+}
@@ -0,0 +1,254 @@
+/*
+ * ----------------------------------------------------------------------------
+ * "THE BEER-WARE LICENSE" (Revision 42):
+ * <quackmore-ff@yahoo.com> wrote this file.  As long as you retain this notice
+ * you can do whatever you want with this stuff. If we meet some day, and you 
+ * think this stuff is worth it, you can buy me a beer in return. Quackmore
+ * ----------------------------------------------------------------------------
+ */
+
+// JSONP benchmark: cfg files, API bodies, large arrays, long strings
+// and the nesting worst case
+// then getting every key of the objects, scanning vs indexed (JSONP::index)
+//
+// make bench
+// the corpus files given on the command line are measured first
+// strings with structural chars (e.g. "GET,POST") are not accepted by JSONP
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+extern "C"
+{
+#include "c_types.h"
+}
+
+#include "espbot_json.hpp"
+#include "host.hpp"
+
+#define BENCH_MIN_BYTES (8 * 1024 * 1024) // each case parses at least this much
+#define BENCH_BUFFER_LEN (128 * 1024)
+#define BENCH_LOOKUPS_MIN (2 * 1024 * 1024) // each lookup case gets at least this many keys
+#define BENCH_TOKENS 256
+
+static char *buffer;
+
+// parse (constructor syntax check) the document in buffer, repeatedly
+static void bench(const char *name, int len)
+{
+    int reps = (BENCH_MIN_BYTES / len) + 1;
+    int err = JSON_noerr;
+    uint64 start = host_ns();
+    int idx;
+    for (idx = 0; idx < reps; idx++)
+    {
+        if (buffer[0] == '[')
+        {
+            JSONP_ARRAY arr(buffer, len);
+            err = arr.getErr();
+        }
+        else
+        {
+            JSONP obj(buffer, len);
+            err = obj.getErr();
+        }
+    }
+    double elapsed = (double)(host_ns() - start) / reps;
+    printf("%-28s %7d B %8.2f ns/B %10.1f us  %s\n",
+           name,
+           len,
+           elapsed / len,
+           elapsed / 1000,
+           (err == JSON_noerr) ? "ok" : "syntax error");
+}
+
+// parse the object in buffer and get every key, with a scan or with the index
+static double lookups_ns(int len, char keys[][256], int count, bool indexed, int reps)
+{
+    static struct jsonp_token tokens[BENCH_TOKENS];
+    char *value;
+    uint64 start = host_ns();
+    int rep;
+    for (rep = 0; rep < reps; rep++)
+    {
+        JSONP obj(buffer, len);
+        if (indexed)
+            obj.index(tokens, count);
+        int idx;
+        for (idx = 0; idx < count; idx++)
+            obj.getView(keys[idx], &value);
+    }
+    return (double)(host_ns() - start) / reps;
+}
+
+static void bench_lookups(const char *name, int len)
+{
+    static char keys[BENCH_TOKENS][256];
+    static struct jsonp_token tokens[BENCH_TOKENS];
+    if (buffer[0] != '{')
+        return;
+    // a key offset is never 0 into an object, so the index entries are counted on a zeroed table
+    memset(tokens, 0, sizeof(tokens));
+    JSONP obj(buffer, len);
+    if (obj.index(tokens, BENCH_TOKENS) != JSON_noerr)
+        return;
+    int count = 0;
+    while ((count < BENCH_TOKENS) && tokens[count].key)
+        count++;
+    // the index is sorted by hash, the lookups go in the document order
+    int idx;
+    int order[BENCH_TOKENS];
+    for (idx = 0; idx < count; idx++)
+        order[idx] = idx;
+    int jdx;
+    for (idx = 1; idx < count; idx++)
+        for (jdx = idx; (jdx > 0) && (tokens[order[jdx - 1]].key > tokens[order[jdx]].key); jdx--)
+        {
+            int tmp = order[jdx];
+            order[jdx] = order[jdx - 1];
+            order[jdx - 1] = tmp;
+        }
+    for (idx = 0; idx < count; idx++)
+    {
+        struct jsonp_token *token = &tokens[order[idx]];
+        memcpy(keys[idx], buffer + token->key, token->key_len);
+        keys[idx][token->key_len] = 0;
+    }
+    if (count == 0)
+        return;
+    int reps = (BENCH_LOOKUPS_MIN / (count * count)) + 1;
+    double scan = lookups_ns(len, keys, count, false, reps);
+    double indexed = lookups_ns(len, keys, count, true, reps);
+    printf("%-28s %7d B %4d keys %10.2f us %10.2f us  x%.1f\n",
+           name,
+           len,
+           count,
+           scan / 1000,
+           indexed / 1000,
+           scan / indexed);
+}
+
+static int load_file(const char *path)
+{
+    FILE *file = fopen(path, "rb");
+    if (file == NULL)
+        return 0;
+    int len = fread(buffer, 1, BENCH_BUFFER_LEN, file);
+    fclose(file);
+    return (len > 0) ? len : 0;
+}
+
+static const char *file_name(const char *path)
+{
+    const char *name = strrchr(path, '/');
+    return name ? name + 1 : path;
+}
+
+// [n0,n1,...] or {"a":[n0,n1,...]}
+static int make_array(int count, bool in_object)
+{
+    int len = 0;
+    if (in_object)
+        len += sprintf(buffer + len, "{\"a\":");
+    buffer[len++] = '[';
+    int idx;
+    for (idx = 0; idx < count; idx++)
+        len += sprintf(buffer + len, "%s%d", idx ? "," : "", idx * 7919);
+    buffer[len++] = ']';
+    if (in_object)
+        buffer[len++] = '}';
+    return len;
+}
+
+// {"a":{"a":...1...}} or [[...]]
+static int make_nested(int depth, bool objects)
+{
+    int len = 0;
+    int idx;
+    for (idx = 0; idx < depth; idx++)
+        len += sprintf(buffer + len, objects ? "{\"a\":" : "[");
+    if (objects)
+        buffer[len++] = '1';
+    for (idx = 0; idx < depth; idx++)
+        buffer[len++] = objects ? '}' : ']';
+    return len;
+}
+
+// {"key_00":"value...","num_01":1234,...} of about len bytes
+static int make_body(int len, int pairs)
+{
+    // one pair in four is a number
+    int str_pairs = pairs - ((pairs + 3) / 4);
+    int str_len = (len - (pairs * 16)) / str_pairs;
+    int body_len = 0;
+    buffer[body_len++] = '{';
+    int idx;
+    for (idx = 0; idx < pairs; idx++)
+    {
+        if (idx)
+            buffer[body_len++] = ',';
+        if (idx % 4)
+        {
+            body_len += sprintf(buffer + body_len, "\"key_%02d\":\"", idx);
+            int jdx;
+            for (jdx = 0; jdx < str_len; jdx++)
+                buffer[body_len++] = 'a' + (jdx % 26);
+            buffer[body_len++] = '"';
+        }
+        else
+        {
+            body_len += sprintf(buffer + body_len, "\"num_%02d\":%d", idx, idx * 7919);
+        }
+    }
+    buffer[body_len++] = '}';
+    return body_len;
+}
+
+// {"s":"...."}
+static int make_string(int str_len)
+{
+    int len = sprintf(buffer, "{\"s\":\"");
+    int idx;
+    for (idx = 0; idx < str_len; idx++)
+        buffer[len++] = "espbot \\n"[idx % 9];
+    len += sprintf(buffer + len, "\"}");
+    return len;
+}
+
+int main(int argc, char **argv)
+{
+    buffer = (char *)malloc(BENCH_BUFFER_LEN);
+    char name[32];
+    int idx;
+    for (idx = 1; idx < argc; idx++)
+    {
+        int len = load_file(argv[idx]);
+        if (len)
+            bench(file_name(argv[idx]), len);
+    }
+    bench("array 1000 numbers", make_array(1000, false));
+    bench("array 10000 numbers", make_array(10000, false));
+    bench("object + array 10000", make_array(10000, true));
+    bench("string 4096", make_string(4096));
+    // the root plus JSON_DEPTH_MAX levels are accepted, deeper ones are a syntax error
+    int depths[] = {JSON_DEPTH_MAX + 1, JSON_DEPTH_MAX + 2, 64, 4096};
+    for (idx = 0; idx < (int)(sizeof(depths) / sizeof(int)); idx++)
+    {
+        sprintf(name, "nested objects depth %d", depths[idx]);
+        bench(name, make_nested(depths[idx], true));
+        sprintf(name, "nested arrays depth %d", depths[idx]);
+        bench(name, make_nested(depths[idx], false));
+    }
+    printf("\n%-28s %9s %9s %13s %13s\n", "lookups (every key)", "", "", "scan", "indexed");
+    for (idx = 1; idx < argc; idx++)
+    {
+        int len = load_file(argv[idx]);
+        if (len)
+            bench_lookups(file_name(argv[idx]), len);
+    }
+    bench_lookups("body 4096 8 pairs", make_body(4096, 8));
+    bench_lookups("body 4096 64 pairs", make_body(4096, 64));
+    free(buffer);
+    return 0;
+}
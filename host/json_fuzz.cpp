@@ -0,0 +1,316 @@
+/*
+ * ----------------------------------------------------------------------------
+ * "THE BEER-WARE LICENSE" (Revision 42):
+ * <quackmore-ff@yahoo.com> wrote this file.  As long as you retain this notice
+ * you can do whatever you want with this stuff. If we meet some day, and you 
+ * think this stuff is worth it, you can buy me a beer in return. Quackmore
+ * ----------------------------------------------------------------------------
+ */
+
+// JSONP, JSONP_ARRAY and Json_sax fuzzing
+//
+// with libFuzzer (make libfuzzer): LLVMFuzzerTestOneInput is the target
+// otherwise (make check): a standalone driver running the corpus files given
+// on the command line and then a number of random mutations of them
+
+#include <dirent.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+extern "C"
+{
+#include "c_types.h"
+}
+
+#include "espbot_json.hpp"
+#include "espbot_json_sax.hpp"
+#include "host.hpp"
+
+// results are folded into a hash so nothing is optimized away
+static unsigned long fuzz_hash = 1;
+
+static void fuzz_fold(long value)
+{
+    fuzz_hash = fuzz_hash * 31 + value;
+}
+
+#define FUZZ_WALK_DEPTH 40
+#define FUZZ_WALK_ELEMENTS 50
+
+static const char *fuzz_keys[] = {"host", "port", "path", "a", "b", "e", "k", "x", "obj", ""};
+
+static void walk_obj(JSONP &obj, int depth);
+
+static void walk_array(JSONP_ARRAY &arr, int depth)
+{
+    if (depth > FUZZ_WALK_DEPTH)
+        return;
+    int len = arr.len();
+    int idx;
+    for (idx = 0; (idx < len) && (idx < FUZZ_WALK_ELEMENTS); idx++)
+    {
+        char str[16];
+        fuzz_fold(arr.getInt(idx));
+        arr.clearErr();
+        fuzz_fold(arr.getInt64(idx));
+        arr.clearErr();
+        fuzz_fold((long)arr.getFloat(idx));
+        arr.clearErr();
+        fuzz_fold(arr.getStrlen(idx));
+        arr.clearErr();
+        arr.getStr(idx, str, sizeof(str));
+        arr.clearErr();
+        JSONP obj = arr.getObj(idx);
+        if (arr.getErr() == JSON_noerr)
+            walk_obj(obj, depth + 1);
+        arr.clearErr();
+        JSONP_ARRAY sub = arr.getArray(idx);
+        if (arr.getErr() == JSON_noerr)
+            walk_array(sub, depth + 1);
+        arr.clearErr();
+    }
+    char *value;
+    Json_value_type type;
+    int value_len;
+    arr.rewind();
+    while ((value_len = arr.next(&value, &type)) >= 0)
+        fuzz_fold(value_len + type);
+}
+
+static void walk_obj(JSONP &obj, int depth)
+{
+    if (depth > FUZZ_WALK_DEPTH)
+        return;
+    unsigned int idx;
+    for (idx = 0; idx < (sizeof(fuzz_keys) / sizeof(char *)); idx++)
+    {
+        const char *key = fuzz_keys[idx];
+        char str[8];
+        char *value;
+        fuzz_fold(obj.getInt(key));
+        obj.clearErr();
+        fuzz_fold(obj.getUint(key));
+        obj.clearErr();
+        fuzz_fold(obj.getFixed(key, 2));
+        obj.clearErr();
+        fuzz_fold((long)obj.getFloat(key));
+        obj.clearErr();
+        fuzz_fold(obj.getStrlen(key));
+        obj.clearErr();
+        obj.getStr(key, str, sizeof(str));
+        obj.clearErr();
+        fuzz_fold(obj.getView(key, &value));
+        obj.clearErr();
+        JSONP sub = obj.getObj(key);
+        if (obj.getErr() == JSON_noerr)
+            walk_obj(sub, depth + 1);
+        obj.clearErr();
+        JSONP_ARRAY arr = obj.getArray(key);
+        if (obj.getErr() == JSON_noerr)
+            walk_array(arr, depth + 1);
+        obj.clearErr();
+    }
+}
+
+static bool fuzz_sax_cb(void *, Json_sax *sax, Json_sax_event event, Json_value_type type, char *value, int len)
+{
+    fuzz_fold(event + type + len + sax->depth());
+    if (sax->key())
+        fuzz_fold(os_strlen(sax->key()));
+    if (value)
+        fuzz_fold(os_strlen(value));
+    return true;
+}
+
+#define FUZZ_SAX_CHUNK 7
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size)
+{
+    if (size > 0xFFFF)
+        return 0;
+    // an exact size heap copy with no terminator:
+    // the sanitizer catches any read past the parser view
+    char *json = (char *)malloc(size ? size : 1);
+    memcpy(json, data, size);
+    if (size && (json[0] == '['))
+    {
+        JSONP_ARRAY arr(json, size);
+        fuzz_fold(arr.getErr());
+        if (arr.getErr() == JSON_noerr)
+            walk_array(arr, 0);
+    }
+    else
+    {
+        JSONP obj(json, size);
+        fuzz_fold(obj.getErr());
+        if (obj.getErr() == JSON_noerr)
+            walk_obj(obj, 0);
+        // a small index, so both the indexed and the JSON_outOfBoundary paths are hit
+        struct jsonp_token tokens[4];
+        JSONP indexed(json, size);
+        fuzz_fold(indexed.index(tokens, 4));
+        if (indexed.getErr() == JSON_noerr)
+            walk_obj(indexed, 0);
+    }
+    // SAX, fed as TCP segments or file pages would be
+    Json_sax sax(NULL, fuzz_sax_cb);
+    size_t pos;
+    for (pos = 0; pos < size; pos += FUZZ_SAX_CHUNK)
+        fuzz_fold(sax.feed(json + pos, ((size - pos) < FUZZ_SAX_CHUNK) ? (size - pos) : FUZZ_SAX_CHUNK));
+    fuzz_fold(sax.end());
+    free(json);
+    return 0;
+}
+
+#ifndef HOST_LIBFUZZER
+
+//
+// standalone driver
+//
+#define FUZZ_SEEDS_MAX 64
+#define FUZZ_INPUT_MAX 2048
+#define FUZZ_DEFAULT_RUNS 200000
+
+static char *seeds[FUZZ_SEEDS_MAX];
+static int seeds_len[FUZZ_SEEDS_MAX];
+static int seeds_count;
+
+static void load_seed(const char *path)
+{
+    FILE *file = fopen(path, "rb");
+    if (file == NULL)
+        return;
+    char *buffer = (char *)malloc(FUZZ_INPUT_MAX);
+    int len = fread(buffer, 1, FUZZ_INPUT_MAX, file);
+    fclose(file);
+    if ((len <= 0) || (seeds_count >= FUZZ_SEEDS_MAX))
+    {
+        free(buffer);
+        return;
+    }
+    seeds[seeds_count] = buffer;
+    seeds_len[seeds_count] = len;
+    seeds_count++;
+}
+
+// xorshift32: the same runs on every host
+static uint32 rand_state = 12345;
+
+static uint32 fuzz_rand(void)
+{
+    rand_state ^= rand_state << 13;
+    rand_state ^= rand_state >> 17;
+    rand_state ^= rand_state << 5;
+    return rand_state;
+}
+
+static const char fuzz_alphabet[] = "{}[]\",: abc123-.eE+\\u\r\n";
+
+// insert, delete, replace or duplicate a few bytes
+static int mutate(char *buffer, int len)
+{
+    int mutations = fuzz_rand() % 6;
+    int idx;
+    for (idx = 0; (idx < mutations) && (len > 0); idx++)
+    {
+        int pos = fuzz_rand() % len;
+        char new_char = fuzz_alphabet[fuzz_rand() % (sizeof(fuzz_alphabet) - 1)];
+        switch (fuzz_rand() % 4)
+        {
+        case 0:
+            buffer[pos] = new_char;
+            break;
+        case 1:
+            os_memmove(buffer + pos, buffer + pos + 1, len - pos - 1);
+            len--;
+            break;
+        case 2:
+            if (len < FUZZ_INPUT_MAX)
+            {
+                os_memmove(buffer + pos + 1, buffer + pos, len - pos);
+                buffer[pos] = new_char;
+                len++;
+            }
+            break;
+        default:
+        {
+            int end = fuzz_rand() % len;
+            int dup_len = end - pos;
+            if ((dup_len > 0) && (len + dup_len <= FUZZ_INPUT_MAX))
+            {
+                os_memmove(buffer + end, buffer + pos, len - pos);
+                len += dup_len;
+            }
+        }
+        break;
+        }
+    }
+    return len;
+}
+
+static double time_input(char *input, int len)
+{
+    uint64 start = host_ns();
+    LLVMFuzzerTestOneInput((const uint8_t *)input, len);
+    return (double)(host_ns() - start) / (len ? len : 1);
+}
+
+int main(int argc, char **argv)
+{
+    int runs = FUZZ_DEFAULT_RUNS;
+    int idx;
+    for (idx = 1; idx < argc; idx++)
+    {
+        if (strncmp(argv[idx], "-runs=", 6) == 0)
+            runs = atoi(argv[idx] + 6);
+        else
+            load_seed(argv[idx]);
+    }
+    if (seeds_count == 0)
+    {
+        fprintf(stderr, "usage: %s [-runs=N] corpus_file...\n", argv[0]);
+        return 1;
+    }
+    for (idx = 0; idx < seeds_count; idx++)
+        LLVMFuzzerTestOneInput((const uint8_t *)seeds[idx], seeds_len[idx]);
+
+    // the slowest input (ns/byte, parsing plus walking) is reported
+    char *input = (char *)malloc(FUZZ_INPUT_MAX);
+    char *worst = (char *)malloc(FUZZ_INPUT_MAX);
+    int worst_len = 0;
+    double worst_ns_per_byte = 0;
+    for (idx = 0; idx < runs; idx++)
+    {
+        int seed = fuzz_rand() % seeds_count;
+        os_memcpy(input, seeds[seed], seeds_len[seed]);
+        int len = mutate(input, seeds_len[seed]);
+        double ns_per_byte = time_input(input, len);
+        if ((len >= 16) && (ns_per_byte > worst_ns_per_byte))
+        {
+            // a candidate: timed again, keeping the fastest, so noise is not reported
+            int retry;
+            for (retry = 0; retry < 4; retry++)
+            {
+                double again = time_input(input, len);
+                if (again < ns_per_byte)
+                    ns_per_byte = again;
+            }
+        }
+        if ((len >= 16) && (ns_per_byte > worst_ns_per_byte))
+        {
+            worst_ns_per_byte = ns_per_byte;
+            os_memcpy(worst, input, len);
+            worst_len = len;
+        }
+    }
+    printf("json_fuzz: %d seeds, %d runs, hash %lx\n", seeds_count, runs, fuzz_hash);
+    printf("json_fuzz: slowest input %.1f ns/byte on %d bytes: %.*s\n", worst_ns_per_byte, worst_len, worst_len, worst);
+    free(input);
+    free(worst);
+    for (idx = 0; idx < seeds_count; idx++)
+        free(seeds[idx]);
+    return 0;
+}
+
+#endif
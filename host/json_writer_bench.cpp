@@ -0,0 +1,239 @@
+/*
+ * ----------------------------------------------------------------------------
+ * "THE BEER-WARE LICENSE" (Revision 42):
+ * <quackmore-ff@yahoo.com> wrote this file.  As long as you retain this notice
+ * you can do whatever you want with this stuff. If we meet some day, and you
+ * think this stuff is worth it, you can buy me a beer in return. Quackmore
+ * ----------------------------------------------------------------------------
+ */
+
+// Json_writer heap messages: peak heap and time per message
+//
+// the messages are the API ones (a job, the mem_mon figures, a 1 KB list)
+// the heap is measured with counting operator new[]/delete[]:
+// - exact:    the two passes of Json_writer (sizing, then writing into len + 1 bytes)
+// - doubling: the previous growing buffer (from 64 bytes, both copies live while growing),
+//             computed from the message length
+// the times compare the two passes with one pass into a fixed buffer
+// numbers are host ones, the lx106 ratio will differ
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <new>
+
+extern "C"
+{
+#include "c_types.h"
+}
+
+#include "espbot_json_writer.hpp"
+#include "host.hpp"
+
+#define BENCH_MIN_MSGS (1024 * 1024) // each case writes at least this many bytes
+#define BENCH_TRIALS 8
+#define BENCH_FIXED_LEN 2048
+#define DOUBLING_FIRST 64
+
+//
+// counting allocator
+//
+
+static size_t heap_used;
+static size_t heap_peak;
+
+void *operator new[](size_t size)
+{
+    size_t *ptr = (size_t *)malloc(sizeof(size_t) + size);
+    if (ptr == NULL)
+        return NULL;
+    *ptr = size;
+    heap_used += size;
+    if (heap_used > heap_peak)
+        heap_peak = heap_used;
+    return ptr + 1;
+}
+
+void *operator new[](size_t size, const std::nothrow_t &) throw()
+{
+    return operator new[](size);
+}
+
+void operator delete[](void *buf) throw()
+{
+    if (buf == NULL)
+        return;
+    size_t *ptr = (size_t *)buf - 1;
+    heap_used -= *ptr;
+    free(ptr);
+}
+
+static volatile size_t sink;
+
+//
+// the messages
+//
+
+typedef void (*message_fn)(Json_writer *json);
+
+// {"id":3,"type":"fs_check","status":"done","result":{"res":0}}
+static void job_msg(Json_writer *json)
+{
+    json->obj_begin();
+    json->num("id", 3);
+    json->str("type", "fs_check");
+    json->str("status", "done");
+    json->obj_begin("result");
+    json->num("res", 0);
+    json->obj_end();
+    json->num("start", 1600000000);
+    json->obj_end();
+}
+
+// the mem_mon_json_stringify fields
+static void mem_mon_msg(Json_writer *json)
+{
+    json->obj_begin();
+    json->hex("stack_max_addr", 0x3FFFFD40);
+    json->hex("stack_min_addr", 0x3FFFF8A0);
+    json->hex("heap_start_addr", 0x3FFF0C18);
+    json->unum("heap_free_size", 31528);
+    json->unum("heap_max_size", 52656);
+    json->unum("heap_min_size", 24312);
+    json->unum("heap_objs", 61);
+    json->unum("heap_max_objs", 112);
+    json->obj_end();
+}
+
+// a file list of about 1 KB
+static void list_msg(Json_writer *json)
+{
+    char name[32];
+    json->obj_begin();
+    json->array_begin("files");
+    int idx;
+    for (idx = 0; idx < 40; idx++)
+    {
+        sprintf(name, "file_%02d.cfg", idx);
+        json->obj_begin();
+        json->str("name", name);
+        json->num("size", idx * 37);
+        json->obj_end();
+    }
+    json->array_end();
+    json->obj_end();
+}
+
+//
+// measures
+//
+
+// the two passes, heap allocated
+static char *heap_write(message_fn fn)
+{
+    Json_writer json;
+    while (json.pass())
+        fn(&json);
+    return json.result();
+}
+
+// one pass into a fixed buffer
+static char *fixed_write(message_fn fn, char *buf)
+{
+    Json_writer json(buf, BENCH_FIXED_LEN);
+    while (json.pass())
+        fn(&json);
+    return json.result();
+}
+
+// the previous growing buffer: len chars need a size above len
+static void doubling_heap(int len, int *peak, int *kept)
+{
+    int size = DOUBLING_FIRST;
+    *peak = size;
+    while (size <= len)
+    {
+        // the old and the new buffer while copying
+        if ((size + (size * 2)) > *peak)
+            *peak = size + (size * 2);
+        size *= 2;
+    }
+    *kept = size;
+}
+
+static double time_ns(message_fn fn, bool heap, int reps)
+{
+    static char fixed[BENCH_FIXED_LEN];
+    uint64 start = host_ns();
+    int rep;
+    for (rep = 0; rep < reps; rep++)
+    {
+        if (heap)
+        {
+            char *msg = heap_write(fn);
+            sink += msg[0];
+            delete[] msg;
+        }
+        else
+        {
+            sink += fixed_write(fn, fixed)[0];
+        }
+    }
+    return (double)(host_ns() - start) / reps;
+}
+
+static int bench(const char *name, message_fn fn)
+{
+    static char fixed[BENCH_FIXED_LEN];
+    // the heap message must be the fixed buffer one
+    heap_used = 0;
+    heap_peak = 0;
+    char *msg = heap_write(fn);
+    int peak = (int)heap_peak;
+    int kept = (int)heap_used;
+    if ((msg == NULL) || strcmp(msg, fixed_write(fn, fixed)))
+    {
+        printf("%-12s heap message differs\n", name);
+        delete[] msg;
+        return 1;
+    }
+    int len = strlen(msg);
+    delete[] msg;
+    int old_peak;
+    int old_kept;
+    doubling_heap(len, &old_peak, &old_kept);
+
+    int reps = (BENCH_MIN_MSGS / len) + 1;
+    double best[2] = {0, 0};
+    int trial;
+    for (trial = 0; trial < BENCH_TRIALS; trial++)
+    {
+        int heap;
+        for (heap = 0; heap < 2; heap++)
+        {
+            double elapsed = time_ns(fn, (heap == 1), reps);
+            if ((trial == 0) || (elapsed < best[heap]))
+                best[heap] = elapsed;
+        }
+    }
+    printf("%-12s %5d B  peak %5d B (doubling %5d B)  kept %5d B (doubling %5d B)  1 pass %7.1f ns  2 passes %7.1f ns  x%.2f\n",
+           name,
+           len,
+           peak,
+           old_peak,
+           kept,
+           old_kept,
+           best[0],
+           best[1],
+           best[1] / best[0]);
+    return 0;
+}
+
+int main(int argc, char *argv[])
+{
+    int errors = 0;
+    errors += bench("job", job_msg);
+    errors += bench("mem_mon", mem_mon_msg);
+    errors += bench("file list", list_msg);
+    return (errors ? 1 : 0);
+}
@@ -0,0 +1,252 @@
+/*
+ * ----------------------------------------------------------------------------
+ * "THE BEER-WARE LICENSE" (Revision 42):
+ * <quackmore-ff@yahoo.com> wrote this file.  As long as you retain this notice
+ * you can do whatever you want with this stuff. If we meet some day, and you
+ * think this stuff is worth it, you can buy me a beer in return. Quackmore
+ * ----------------------------------------------------------------------------
+ */
+
+// espbot_scan (a word at a time) vs byte by byte loops
+//
+// the workloads are the ones the scans are used for: header lines, closing quotes
+// of short and long strings, the brackets of a 4 KB object, the JSON structural chars
+// every result is first compared with the byte loop one, at every start offset
+// (so every alignment) and with the match at every position
+// numbers are host ones, the lx106 ratio will differ
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+extern "C"
+{
+#include "c_types.h"
+}
+
+#include "espbot_scan.hpp"
+#include "host.hpp"
+
+#define BENCH_MIN_BYTES (64 * 1024 * 1024) // each case scans at least this much
+#define BENCH_BUFFER_LEN 8192
+#define BENCH_TRIALS 8
+
+static char *buffer;
+static volatile size_t sink;
+
+//
+// the byte by byte references
+//
+
+static __attribute__((noinline)) char *byte_char(char *ptr, char *end, char c)
+{
+    for (; ptr < end; ptr++)
+        if (*ptr == c)
+            return ptr;
+    return NULL;
+}
+
+static __attribute__((noinline)) char *byte_char2(char *ptr, char *end, char c1, char c2)
+{
+    for (; ptr < end; ptr++)
+        if ((*ptr == c1) || (*ptr == c2))
+            return ptr;
+    return NULL;
+}
+
+static __attribute__((noinline)) char *byte_json(char *ptr, char *end)
+{
+    for (; ptr < end; ptr++)
+    {
+        char c = *ptr;
+        if ((c == '"') || (c == '{') || (c == '}') || (c == '[') || (c == ']') || (c == ',') || (c == ':'))
+            return ptr;
+    }
+    return NULL;
+}
+
+typedef enum
+{
+    SCAN_char = 0,
+    SCAN_char2,
+    SCAN_json
+} Scan_type;
+
+static char *scan(Scan_type type, bool swar, char *ptr, char *end)
+{
+    switch (type)
+    {
+    case SCAN_char:
+        return swar ? scan_char(ptr, end, '\n') : byte_char(ptr, end, '\n');
+    case SCAN_char2:
+        return swar ? scan_char2(ptr, end, '{', '}') : byte_char2(ptr, end, '{', '}');
+    default:
+        return swar ? scan_json(ptr, end) : byte_json(ptr, end);
+    }
+}
+
+// result: the count of differences with the byte loop
+static int verify(void)
+{
+    static const char matches[] = "\n{}[]\",:";
+    char text[64];
+    int errors = 0;
+    int type;
+    for (type = SCAN_char; type <= SCAN_json; type++)
+    {
+        unsigned int mdx;
+        for (mdx = 0; mdx < sizeof(matches); mdx++)
+        {
+            int start;
+            int pos;
+            for (start = 0; start < 8; start++)
+                for (pos = -1; pos < 40; pos++)
+                {
+                    // bytes just below and above the matching ones, and 0x80
+                    int idx;
+                    for (idx = 0; idx < (int)sizeof(text); idx++)
+                        text[idx] = "a\x7f\x80\x09\x0b\x5c\x7c\x7e\x21\x2b\x3b"[idx % 11];
+                    if (pos >= 0)
+                        text[start + pos] = matches[mdx];
+                    int len;
+                    for (len = 0; len <= 44; len++)
+                    {
+                        char *end = text + start + len;
+                        if (scan((Scan_type)type, true, text + start, end) !=
+                            scan((Scan_type)type, false, text + start, end))
+                            errors++;
+                    }
+                }
+        }
+    }
+    return errors;
+}
+
+// scan the whole buffer, match after match
+// result: ns per scan of the buffer
+static double scan_all(Scan_type type, bool swar, int len, int reps, int *matches)
+{
+    uint64 start = host_ns();
+    int rep;
+    for (rep = 0; rep < reps; rep++)
+    {
+        char *end = buffer + len;
+        char *ptr = buffer;
+        *matches = 0;
+        while ((ptr = scan(type, swar, ptr, end)) != NULL)
+        {
+            (*matches)++;
+            ptr++;
+        }
+        sink += *matches;
+    }
+    return (double)(host_ns() - start) / reps;
+}
+
+// the best of BENCH_TRIALS, the two scans alternated
+static void bench(const char *name, Scan_type type, int len)
+{
+    int reps = (BENCH_MIN_BYTES / BENCH_TRIALS / len) + 1;
+    double best[2] = {0, 0};
+    int matches = 0;
+    int trial;
+    for (trial = 0; trial < BENCH_TRIALS; trial++)
+    {
+        int swar;
+        for (swar = 0; swar < 2; swar++)
+        {
+            double elapsed = scan_all(type, (swar == 1), len, reps, &matches);
+            if ((trial == 0) || (elapsed < best[swar]))
+                best[swar] = elapsed;
+        }
+    }
+    printf("%-32s %6d B %5d matches %8.3f ns/B %8.3f ns/B  x%.2f\n",
+           name,
+           len,
+           matches,
+           best[0] / len,
+           best[1] / len,
+           best[0] / best[1]);
+}
+
+// HTTP response header, lines of about line_len chars
+static int make_header(int line_len)
+{
+    int len = sprintf(buffer, "HTTP/1.1 200 OK\r\n");
+    int idx;
+    for (idx = 0; idx < 12; idx++)
+    {
+        len += sprintf(buffer + len, "X-Header-%02d: ", idx);
+        while ((len % line_len) != 0)
+            buffer[len++] = 'v';
+        len += sprintf(buffer + len, "\r\n");
+    }
+    len += sprintf(buffer + len, "\r\n");
+    return len;
+}
+
+// {"s":"....","s":"....",...} strings of str_len chars, up to about 4 KB
+static int make_strings(int str_len)
+{
+    int len = 0;
+    buffer[len++] = '{';
+    while (len < (4096 - str_len))
+    {
+        len += sprintf(buffer + len, "%s\"s\":\"", (len > 1) ? "," : "");
+        int idx;
+        for (idx = 0; idx < str_len; idx++)
+            buffer[len++] = 'a' + (idx % 26);
+        buffer[len++] = '"';
+    }
+    buffer[len++] = '}';
+    return len;
+}
+
+// a 4 KB cfg like object: short keys, numbers and strings, a nested object every 8 pairs
+static int make_object(void)
+{
+    int len = 0;
+    int idx = 0;
+    buffer[len++] = '{';
+    while (len < 4000)
+    {
+        if (idx)
+            buffer[len++] = ',';
+        if ((idx % 8) == 7)
+            len += sprintf(buffer + len, "\"obj_%d\":{\"enabled\":1,\"name\":\"item %d\"}", idx, idx);
+        else if (idx % 2)
+            len += sprintf(buffer + len, "\"key_%d\":\"value number %d\"", idx, idx * 31);
+        else
+            len += sprintf(buffer + len, "\"num_%d\":%d", idx, idx * 7919);
+        idx++;
+    }
+    buffer[len++] = '}';
+    return len;
+}
+
+int main(int argc, char **argv)
+{
+    buffer = (char *)malloc(BENCH_BUFFER_LEN);
+    int errors = verify();
+    printf("differences with the byte loop: %d\n", errors);
+    printf("%-32s %8s %13s %13s %13s\n", "", "", "", "byte loop", "word scan");
+    int line_lens[] = {24, 48, 96};
+    char name[40];
+    unsigned int idx;
+    for (idx = 0; idx < (sizeof(line_lens) / sizeof(int)); idx++)
+    {
+        sprintf(name, "header lines of %d ('\\n')", line_lens[idx]);
+        bench(name, SCAN_char, make_header(line_lens[idx]));
+    }
+    int str_lens[] = {8, 32, 128, 1024};
+    for (idx = 0; idx < (sizeof(str_lens) / sizeof(int)); idx++)
+    {
+        sprintf(name, "strings of %d (json)", str_lens[idx]);
+        bench(name, SCAN_json, make_strings(str_lens[idx]));
+    }
+    int len = make_object();
+    bench("4 KB object brackets ('{' '}')", SCAN_char2, len);
+    bench("4 KB object (json)", SCAN_json, len);
+    free(buffer);
+    return (errors != 0);
+}
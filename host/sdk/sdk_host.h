@@ -0,0 +1,185 @@
+/*
+ * ----------------------------------------------------------------------------
+ * "THE BEER-WARE LICENSE" (Revision 42):
+ * <quackmore-ff@yahoo.com> wrote this file.  As long as you retain this notice
+ * you can do whatever you want with this stuff. If we meet some day, and you 
+ * think this stuff is worth it, you can buy me a beer in return. Quackmore
+ * ----------------------------------------------------------------------------
+ */
+
+// NON-OS SDK declarations for the host build (implemented by host_sdk.cpp)
+
+#ifndef __SDK_HOST_H__
+#define __SDK_HOST_H__
+#include <stdint.h>
+#include <stddef.h>
+#ifdef __cplusplus
+extern "C" {
+#endif
+typedef uint8_t uint8; typedef int8_t sint8; typedef int8_t int8;
+typedef uint16_t uint16; typedef int16_t sint16; typedef int16_t int16;
+typedef uint32_t uint32; typedef int32_t sint32; typedef int32_t int32;
+typedef uint64_t uint64; typedef int64_t sint64; typedef int64_t int64;
+typedef uint8_t u8; typedef uint16_t u16; typedef uint32_t u32; typedef int32_t s32;
+#ifndef __cplusplus
+typedef unsigned char bool;
+#define true 1
+#define false 0
+#endif
+#define ICACHE_FLASH_ATTR
+#define LOCAL static
+#define BIT(n) (1UL << (n))
+int os_printf_plus(const char *fmt, ...);
+int os_sprintf_plus(char *buf, const char *fmt, ...);
+int os_snprintf_plus(char *buf, unsigned int len, const char *fmt, ...);
+#define os_printf os_printf_plus
+#define os_sprintf os_sprintf_plus
+#define os_snprintf os_snprintf_plus
+void *os_memset(void *, int, size_t);
+void *os_memcpy(void *, const void *, size_t);
+void *os_memmove(void *, const void *, size_t);
+int os_memcmp(const void *, const void *, size_t);
+size_t os_strlen(const char *);
+char *os_strcpy(char *, const char *);
+char *os_strncpy(char *, const char *, size_t);
+int os_strcmp(const char *, const char *);
+int os_strncmp(const char *, const char *, size_t);
+char *os_strstr(const char *, const char *);
+char *os_strchr(const char *, int);
+void *pvPortZalloc(size_t, const char *, int);
+void *pvPortMalloc(size_t, const char *, int);
+void vPortFree(void *, const char *, int);
+#define os_zalloc(s) pvPortZalloc(s, "", 0)
+#define os_malloc(s) pvPortMalloc(s, "", 0)
+#define os_free(p) vPortFree(p, "", 0)
+typedef void os_timer_func_t(void *);
+typedef struct _os_timer_t { struct _os_timer_t *next; uint32 expire; uint32 period; bool armed; os_timer_func_t *fn; void *arg; } os_timer_t;
+void os_timer_disarm(os_timer_t *);
+void os_timer_setfn(os_timer_t *, os_timer_func_t *, void *);
+void os_timer_arm(os_timer_t *, uint32, bool);
+typedef uint32 ETSSignal; typedef uintptr_t ETSParam; // a pointer on the host
+typedef struct ETSEventTag { ETSSignal sig; ETSParam par; } ETSEvent;
+typedef ETSEvent os_event_t;
+typedef void (*os_task_t)(os_event_t *);
+#define USER_TASK_PRIO_0 0
+#define USER_TASK_PRIO_1 1
+#define USER_TASK_PRIO_2 2
+bool system_os_task(os_task_t, uint8, os_event_t *, uint8);
+bool system_os_post(uint8, ETSSignal, ETSParam);
+uint32 system_get_free_heap_size(void);
+uint32 system_get_chip_id(void);
+uint32 system_get_time(void);
+void system_soft_wdt_feed(void);
+void system_restart(void);
+void system_upgrade_reboot(void);
+uint8 system_upgrade_userbin_check(void);
+uint8 system_upgrade_flag_check(void);
+void system_set_os_print(uint8);
+const char *system_get_sdk_version(void);
+uint32 system_get_cpu_freq(void);
+struct rst_info { uint32 reason, exccause, epc1, epc2, epc3, excvaddr, depc; };
+struct rst_info *system_get_rst_info(void);
+struct ip_addr { uint32 addr; };
+typedef struct ip_addr ip_addr_t;
+struct ip_info { struct ip_addr ip; struct ip_addr netmask; struct ip_addr gw; };
+#define IP2STR(a) 0,0,0,0
+#define IPSTR "%d.%d.%d.%d"
+#define IP4_ADDR(ipaddr, a,b,c,d) (ipaddr)->addr = ((uint32)(a)|((uint32)(b)<<8)|((uint32)(c)<<16)|((uint32)(d)<<24))
+typedef sint8 err_t;
+typedef enum { ESPCONN_NONE, ESPCONN_WAIT, ESPCONN_LISTEN, ESPCONN_CONNECT, ESPCONN_WRITE, ESPCONN_READ, ESPCONN_CLOSE } espconn_state;
+enum espconn_type { ESPCONN_INVALID = 0, ESPCONN_TCP = 0x10, ESPCONN_UDP = 0x20 };
+typedef void (*espconn_connect_callback)(void *arg);
+typedef void (*espconn_reconnect_callback)(void *arg, sint8 err);
+typedef void (*espconn_recv_callback)(void *arg, char *pdata, unsigned short len);
+typedef void (*espconn_sent_callback)(void *arg);
+typedef struct _esp_tcp { int remote_port; int local_port; uint8 local_ip[4]; uint8 remote_ip[4];
+  espconn_connect_callback connect_callback; espconn_reconnect_callback reconnect_callback;
+  espconn_connect_callback disconnect_callback; espconn_connect_callback write_finish_fn; } esp_tcp;
+typedef struct _esp_udp { int remote_port; int local_port; uint8 local_ip[4]; uint8 remote_ip[4]; } esp_udp;
+struct espconn { enum espconn_type type; espconn_state state; union { esp_tcp *tcp; esp_udp *udp; } proto;
+  espconn_recv_callback recv_callback; espconn_sent_callback sent_callback; uint8 link_cnt; void *reverse; };
+#define ESPCONN_OK 0
+#define ESPCONN_MEM -1
+#define ESPCONN_TIMEOUT -3
+#define ESPCONN_RTE -4
+#define ESPCONN_INPROGRESS -5
+#define ESPCONN_MAXNUM -7
+#define ESPCONN_ABRT -8
+#define ESPCONN_RST -9
+#define ESPCONN_CLSD -10
+#define ESPCONN_CONN -11
+#define ESPCONN_ARG -12
+#define ESPCONN_IF -14
+#define ESPCONN_ISCONN -15
+sint8 espconn_connect(struct espconn *); sint8 espconn_disconnect(struct espconn *);
+sint8 espconn_delete(struct espconn *); sint8 espconn_accept(struct espconn *);
+sint8 espconn_regist_time(struct espconn *, uint32, uint8);
+sint8 espconn_regist_connectcb(struct espconn *, espconn_connect_callback);
+sint8 espconn_regist_reconcb(struct espconn *, espconn_reconnect_callback);
+sint8 espconn_regist_disconcb(struct espconn *, espconn_connect_callback);
+sint8 espconn_regist_recvcb(struct espconn *, espconn_recv_callback);
+sint8 espconn_regist_sentcb(struct espconn *, espconn_sent_callback);
+sint8 espconn_send(struct espconn *, uint8 *, uint16);
+sint8 espconn_sent(struct espconn *, uint8 *, uint16);
+sint8 espconn_recv_hold(struct espconn *); sint8 espconn_recv_unhold(struct espconn *);
+sint8 espconn_set_opt(struct espconn *, uint8); sint8 espconn_clear_opt(struct espconn *, uint8);
+sint8 espconn_set_keepalive(struct espconn *, uint8, void *);
+typedef void (*dns_found_callback)(const char *name, ip_addr_t *ipaddr, void *callback_arg);
+err_t espconn_gethostbyname(struct espconn *, const char *, ip_addr_t *, dns_found_callback);
+uint8 espconn_tcp_get_max_con(void); sint8 espconn_tcp_set_max_con(uint8);
+#define ESPCONN_REUSEADDR 0x01
+#define ESPCONN_NODELAY 0x02
+#define ESPCONN_COPY 0x04
+#define ESPCONN_KEEPALIVE 0x08
+struct mdns_info { char *host_name; char *server_name; uint16 server_port; unsigned long ipAddr; char *txt_data[10]; };
+void espconn_mdns_init(struct mdns_info *); void espconn_mdns_close(void);
+typedef enum { SPI_FLASH_RESULT_OK, SPI_FLASH_RESULT_ERR, SPI_FLASH_RESULT_TIMEOUT } SpiFlashOpResult;
+SpiFlashOpResult spi_flash_read(uint32, uint32 *, uint32);
+SpiFlashOpResult spi_flash_write(uint32, uint32 *, uint32);
+SpiFlashOpResult spi_flash_erase_sector(uint16);
+#define SPI_FLASH_SEC_SIZE 4096
+struct bss_info { struct { struct bss_info *stqe_next; } next; uint8 bssid[6]; uint8 ssid[32]; uint8 ssid_len; uint8 channel; sint8 rssi; };
+struct scan_config { uint8 *ssid; uint8 *bssid; uint8 channel; uint8 show_hidden; };
+typedef void (*scan_done_cb_t)(void *arg, int status);
+bool wifi_station_scan(struct scan_config *, scan_done_cb_t);
+#define STATION_IF 0
+#define SOFTAP_IF 1
+#define NULL_MODE 0
+#define STATION_MODE 1
+#define SOFTAP_MODE 2
+#define STATIONAP_MODE 3
+bool wifi_get_ip_info(uint8, struct ip_info *);
+bool wifi_set_opmode_current(uint8);
+uint8 wifi_get_opmode(void);
+#define UPGRADE_FW_BIN1 0
+#define UPGRADE_FW_BIN2 1
+#define UPGRADE_FLAG_IDLE 0
+#define UPGRADE_FLAG_START 1
+#define UPGRADE_FLAG_FINISH 2
+typedef void (*upgrade_states_check_callback)(void *arg);
+struct upgrade_server_info { uint8 ip[4]; uint16 port; uint8 upgrade_flag; uint8 pre_version[16]; uint8 upgrade_version[16];
+  uint32 check_times; uint8 *url; upgrade_states_check_callback check_cb; struct espconn *pespconn; };
+bool system_upgrade_start(struct upgrade_server_info *);
+void sntp_stop(void); void sntp_init(void); uint32 sntp_get_current_timestamp(void); bool sntp_set_timezone(sint8);
+void sntp_setservername(unsigned char, char *); char *sntp_get_real_time(uint32);
+void ets_isr_mask(uint32); void ets_isr_unmask(uint32);
+#define ETS_GPIO_INTR_DISABLE()
+#define ETS_GPIO_INTR_ENABLE()
+#define ETS_INTR_LOCK()
+#define ETS_INTR_UNLOCK()
+uint32 system_get_rtc_time(void);
+bool system_rtc_mem_write(uint8, const void *, uint16);
+bool system_rtc_mem_read(uint8, void *, uint16);
+uint8 system_get_boot_version(void);
+typedef uint32 STATUS;
+typedef uint32 os_param_t;
+void system_print_meminfo(void);
+uint32 espconn_port(void);
+uint32 system_rtc_clock_cali_proc(void);
+unsigned long os_random(void);
+void system_soft_wdt_stop(void);
+void system_soft_wdt_restart(void);
+#ifdef __cplusplus
+}
+#endif
+#endif
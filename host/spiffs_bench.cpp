@@ -0,0 +1,265 @@
+/*
+ * ----------------------------------------------------------------------------
+ * "THE BEER-WARE LICENSE" (Revision 42):
+ * <quackmore-ff@yahoo.com> wrote this file.  As long as you retain this notice
+ * you can do whatever you want with this stuff. If we meet some day, and you 
+ * think this stuff is worth it, you can buy me a beer in return. Quackmore
+ * ----------------------------------------------------------------------------
+ */
+
+// SPIFFS workloads through Espfile, over the flash simulator
+//
+// make bench (or make check: the exit code is not 0 on any error)
+// times are simulated ones (see HOST_FLASH_LATENCY_DEFAULT), host CPU time included
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+extern "C"
+{
+#include "c_types.h"
+#include "osapi.h"
+#include "user_interface.h"
+}
+
+#include "espbot_spiffs.hpp"
+#include "host.hpp"
+
+#define BENCH_FILES 16
+#define BENCH_FILE_MAX 1088
+#define BENCH_LOG_LINES 512
+#define BENCH_LOG_LINE 48
+
+static int bench_errors;
+static uint32 bench_start;
+static uint32 bench_worst_us;
+static uint32 bench_op_start;
+static struct flash_stats bench_stats;
+
+static void bench_begin(void)
+{
+    os_memcpy(&bench_stats, esp_spiffs_flash_stats(), sizeof(struct flash_stats));
+    bench_worst_us = 0;
+    bench_start = system_get_time();
+}
+
+static void op_begin(void)
+{
+    bench_op_start = system_get_time();
+}
+
+static void op_end(void)
+{
+    uint32 elapsed = system_get_time() - bench_op_start;
+    if (elapsed > bench_worst_us)
+        bench_worst_us = elapsed;
+}
+
+static void bench_end(const char *name, int ops, int errs)
+{
+    uint32 elapsed = system_get_time() - bench_start;
+    struct flash_stats *stats = esp_spiffs_flash_stats();
+    printf("%-12s %5d ops %2d errs %9.1f ms %8.0f ops/s  worst %6u us  read %8u B  written %7u B  erased %4u\n",
+           name,
+           ops,
+           errs,
+           (double)elapsed / 1000,
+           (elapsed > 0) ? (((double)ops * 1000000) / elapsed) : 0,
+           bench_worst_us,
+           (stats->read_bytes - bench_stats.read_bytes),
+           (stats->write_bytes - bench_stats.write_bytes),
+           (stats->erase_ops - bench_stats.erase_ops));
+    bench_errors += errs;
+}
+
+// the expected content of the bench files
+static char *model[BENCH_FILES];
+static int model_len[BENCH_FILES];
+
+static char *bench_name(char *name, int idx)
+{
+    sprintf(name, "bench_%d.txt", idx);
+    return name;
+}
+
+static void fill(char *buffer, int len, int seed)
+{
+    int idx;
+    for (idx = 0; idx < len; idx++)
+        buffer[idx] = 'a' + ((seed + idx) % 26);
+}
+
+static int verify(int idx)
+{
+    char name[32];
+    char buffer[BENCH_FILE_MAX];
+    bench_name(name, idx);
+    if (Espfile::size(name) != model_len[idx])
+        return 1;
+    Espfile file(name);
+    if ((model_len[idx] > 0) && (file.n_read(buffer, model_len[idx]) != model_len[idx]))
+        return 1;
+    return (os_memcmp(buffer, model[idx], model_len[idx]) != 0);
+}
+
+static int verify_all(void)
+{
+    int errs = 0;
+    int idx;
+    for (idx = 0; idx < BENCH_FILES; idx++)
+        errs += verify(idx);
+    return errs;
+}
+
+// (re)write a bench file with len bytes, as a cfg save does
+static int rewrite(int idx, int len, int seed)
+{
+    char name[32];
+    int errs = 0;
+    fill(model[idx], len, seed);
+    model_len[idx] = len;
+    Espfile file(bench_name(name, idx));
+    if (file.clear() != SPIFFS_OK)
+        errs++;
+    if (file.n_append(model[idx], len) < SPIFFS_OK)
+        errs++;
+    return errs;
+}
+
+static void report_wear(void)
+{
+    int first = FS_START / SPI_FLASH_SEC_SIZE;
+    int last = FS_END / SPI_FLASH_SEC_SIZE;
+    uint32 total = 0;
+    uint32 max = 0;
+    int sector;
+    for (sector = first; sector < last; sector++)
+    {
+        uint32 count = host_flash_erase_count(sector);
+        total += count;
+        if (count > max)
+            max = count;
+    }
+    printf("wear: %d sectors, %u erases, mean %.2f max %u per sector\n",
+           (last - first),
+           total,
+           (double)total / (last - first),
+           max);
+    printf("flash: %u misaligned or out of range ops\n", host_flash_errors());
+    bench_errors += host_flash_errors();
+}
+
+int main(int argc, char **argv)
+{
+    int rewrites = (argc > 1) ? atoi(argv[1]) : 4000;
+    char name[32];
+    char buffer[BENCH_FILE_MAX];
+    int idx;
+    int errs;
+
+    host_flash_reset();
+    // mount on an erased flash: formatting
+    bench_begin();
+    op_begin();
+    esp_spiffs_mount();
+    op_end();
+    bench_end("format", 1, (esp_spiffs_total_size() == 0));
+    // mount on a formatted flash: scanning
+    bench_begin();
+    op_begin();
+    esp_spiffs_mount();
+    op_end();
+    bench_end("mount", 1, (esp_spiffs_total_size() == 0));
+    printf("FS size %u, used %u\n", esp_spiffs_total_size(), esp_spiffs_used_size());
+
+    for (idx = 0; idx < BENCH_FILES; idx++)
+        model[idx] = (char *)malloc(BENCH_FILE_MAX);
+
+    // create: 16 files of 128 bytes (two appends)
+    bench_begin();
+    errs = 0;
+    for (idx = 0; idx < BENCH_FILES; idx++)
+    {
+        op_begin();
+        fill(model[idx], 128, idx);
+        model_len[idx] = 128;
+        Espfile file(bench_name(name, idx));
+        if (file.n_append(model[idx], 64) < SPIFFS_OK)
+            errs++;
+        if (file.n_append(model[idx] + 64, 64) < SPIFFS_OK)
+            errs++;
+        op_end();
+    }
+    errs += verify_all();
+    bench_end("create", BENCH_FILES, errs);
+
+    // logging: 512 lines of 48 bytes, opening the file for each line
+    char *log_model = (char *)malloc(BENCH_LOG_LINES * BENCH_LOG_LINE);
+    fill(log_model, (BENCH_LOG_LINES * BENCH_LOG_LINE), 0);
+    os_strcpy(name, "bench.log");
+    bench_begin();
+    errs = 0;
+    for (idx = 0; idx < BENCH_LOG_LINES; idx++)
+    {
+        op_begin();
+        Espfile log(name);
+        if (log.n_append(log_model + (idx * BENCH_LOG_LINE), BENCH_LOG_LINE) < SPIFFS_OK)
+            errs++;
+        op_end();
+    }
+    bench_end("append", BENCH_LOG_LINES, errs);
+
+    // random reads: 512 reads of 32 bytes from the log
+    bench_begin();
+    errs = 0;
+    {
+        Espfile log(name);
+        int size = Espfile::size(name);
+        if (size != (BENCH_LOG_LINES * BENCH_LOG_LINE))
+            errs++;
+        for (idx = 0; idx < 512; idx++)
+        {
+            int offset = os_random() % (size - 32);
+            op_begin();
+            if (log.n_read(buffer, offset, 32) != 32)
+                errs++;
+            else if (os_memcmp(buffer, log_model + offset, 32) != 0)
+                errs++;
+            op_end();
+        }
+        log.remove();
+    }
+    free(log_model);
+    bench_end("random read", 512, errs);
+
+    // cfg saves: the files rewritten with 64..1088 bytes, until the GC runs
+    bench_begin();
+    errs = 0;
+    for (idx = 0; idx < rewrites; idx++)
+    {
+        op_begin();
+        errs += rewrite((idx % BENCH_FILES), (64 + (os_random() % (BENCH_FILE_MAX - 64))), idx);
+        op_end();
+    }
+    errs += verify_all();
+    bench_end("rewrite", rewrites, errs);
+
+    // fs check: a single SPIFFS_check call (the fs_check job step)
+    bench_begin();
+    op_begin();
+    errs = (esp_spiffs_check() != SPIFFS_OK);
+    op_end();
+    errs += verify_all();
+    bench_end("check", 1, errs);
+
+    report_wear();
+    for (idx = 0; idx < BENCH_FILES; idx++)
+    {
+        Espfile file(bench_name(name, idx));
+        file.remove();
+        free(model[idx]);
+    }
+    printf("%s\n", (bench_errors == 0) ? "spiffs_bench: ok" : "spiffs_bench: FAILED");
+    return (bench_errors != 0);
+}
@@ -0,0 +1,114 @@
+/*
+ * ----------------------------------------------------------------------------
+ * "THE BEER-WARE LICENSE" (Revision 42):
+ * <quackmore-ff@yahoo.com> wrote this file.  As long as you retain this notice
+ * you can do whatever you want with this stuff. If we meet some day, and you 
+ * think this stuff is worth it, you can buy me a beer in return. Quackmore
+ * ----------------------------------------------------------------------------
+ */
+
+// SPIFFS garbage collection: inline only vs background (fs_gc_task)
+//
+// spiffs_gc [background] [static files]
+// log files are appended and rotated on a file system filled with static files
+// (GC_STATIC_FILES by default, with 300 or more the inline collection alone
+// ends with SPIFFS_ERR_FULL: it keeps picking old blocks with no deleted pages);
+// a log line every GC_LOG_PERIOD ms of simulated time, the espbot timers and
+// tasks run in between only with "background"
+// times are simulated ones (see HOST_FLASH_LATENCY_DEFAULT)
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+extern "C"
+{
+#include "c_types.h"
+#include "osapi.h"
+#include "user_interface.h"
+}
+
+#include "espbot_spiffs.hpp"
+#include "host.hpp"
+
+#define GC_STATIC_FILES 200   // 4 KB each, 30% of the file system
+#define GC_STATIC_SIZE 4096
+#define GC_LOG_FILES 8
+#define GC_LOG_MAX 4000       // then the log is removed
+#define GC_LOG_LINES 50000
+#define GC_LOG_PERIOD 100     // ms
+
+int main(int argc, char **argv)
+{
+    bool background = ((argc > 1) && (strcmp(argv[1], "background") == 0));
+    int static_files = (argc > 2) ? atoi(argv[2]) : GC_STATIC_FILES;
+    char name[32];
+    char buffer[GC_STATIC_SIZE];
+    int log_len[GC_LOG_FILES];
+    int errs = 0;
+    int first_err = -1;
+    int idx;
+
+    host_flash_reset();
+    esp_spiffs_mount();
+    for (idx = 0; idx < static_files; idx++)
+    {
+        sprintf(name, "static_%d", idx);
+        memset(buffer, idx, GC_STATIC_SIZE);
+        Espfile file(name);
+        if (file.n_append(buffer, GC_STATIC_SIZE) != GC_STATIC_SIZE)
+            errs++;
+    }
+    memset(log_len, 0, sizeof(log_len));
+    printf("FS size %u, used %u\n", esp_spiffs_total_size(), esp_spiffs_used_size());
+
+    struct flash_stats *stats = esp_spiffs_flash_stats();
+    uint32 erases = stats->erase_ops;
+    uint32 inline_erases = 0;
+    uint32 inline_lines = 0;
+    uint32 worst_us = 0;
+    for (idx = 0; idx < GC_LOG_LINES; idx++)
+    {
+        int log = os_random() % GC_LOG_FILES;
+        int len = 20 + (os_random() % 200);
+        sprintf(name, "log_%d", log);
+        memset(buffer, ('a' + (idx % 26)), len);
+        uint32 line_erases = stats->erase_ops;
+        uint32 line_start = system_get_time();
+        {
+            Espfile file(name);
+            if (file.n_append(buffer, len) != len)
+                errs++;
+            log_len[log] += len;
+            if (log_len[log] > GC_LOG_MAX)
+            {
+                if (file.remove() != SPIFFS_OK)
+                    errs++;
+                log_len[log] = 0;
+            }
+        }
+        if ((errs > 0) && (first_err < 0))
+            first_err = idx;
+        uint32 elapsed = system_get_time() - line_start;
+        if (elapsed > worst_us)
+            worst_us = elapsed;
+        if (stats->erase_ops != line_erases)
+        {
+            inline_lines++;
+            inline_erases += (stats->erase_ops - line_erases);
+        }
+        host_delay_us(GC_LOG_PERIOD * 1000);
+        if (background)
+            host_run_timers();
+    }
+    printf("%s: %d log lines, %u with inline gc (%u erases), worst line %u us, %u background erases\n",
+           (background ? "background" : "inline only"),
+           GC_LOG_LINES,
+           inline_lines,
+           inline_erases,
+           worst_us,
+           (stats->erase_ops - erases - inline_erases));
+    if (errs)
+        printf("%d errors from line %d\n", errs, first_err);
+    return (errs != 0);
+}
@@ -21,6 +21,7 @@ extern "C"
 #include "espbot.hpp"
 #include "espbot_cron.hpp"
 #include "espbot_diagnostic.hpp"
+#include "espbot_json_writer.hpp"
 #include "espbot_timedate.hpp"
 #include "espbot_utils.hpp"
 #include "drivers.hpp"
@@ -88,54 +89,29 @@ void app_deinit_on_wifi_disconnect()
 
 char *app_info_json_stringify(char *dest, int len)
 {
-   // {"device_name":"","chip_id":"","app_name":"","app_version":"","espbot_version":"","api_version":"","drivers_version":"","sdk_version":"","boot_version":""}
-    int msg_len = 155 +
-                  os_strlen(espbot_get_name()) +
-                  10 +
-                  os_strlen(app_name) +
-                  os_strlen(app_release) +
-                  os_strlen(espbot_get_version()) +
-                  os_strlen(f_str(API_RELEASE)) +
-                  os_strlen(drivers_release) +
-                  os_strlen(system_get_sdk_version()) +
-                  10 +
-                  1;
-    char *msg;
-    if (dest == NULL)
+    Json_writer json(dest, len);
+    char num_str[11];
+    while (json.pass())
     {
-        msg = new char[msg_len];
-        if (msg == NULL)
-        {
-            dia_error_evnt(APP_INFO_STRINGIFY_HEAP_EXHAUSTED, msg_len);
-            ERROR("app_info_json_stringify heap exhausted [%d]", msg_len);
-            return NULL;
-        }
+        json.obj_begin();
+        json.str(f_str("device_name"), espbot_get_name());
+        fs_sprintf(num_str, "%d", system_get_chip_id());
+        json.str(f_str("chip_id"), num_str);
+        json.str(f_str("app_name"), app_name);
+        json.str(f_str("app_version"), app_release);
+        json.str(f_str("espbot_version"), espbot_get_version());
+        json.str(f_str("api_version"), f_str(API_RELEASE));
+        json.str(f_str("drivers_version"), drivers_release);
+        json.str(f_str("sdk_version"), system_get_sdk_version());
+        fs_sprintf(num_str, "%d", system_get_boot_version());
+        json.str(f_str("boot_version"), num_str);
+        json.obj_end();
     }
-    else
+    char *msg = json.result();
+    if (msg == NULL)
     {
-        msg = dest;
-        if (len < msg_len)
-        {
-            *msg = 0;
-            return msg;
-        }
+        dia_error_evnt(APP_INFO_STRINGIFY_HEAP_EXHAUSTED, json.len());
+        ERROR("app_info_json_stringify heap exhausted [%d]", json.len());
     }
-    fs_sprintf(msg,
-               "{\"device_name\":\"%s\",\"chip_id\":\"%d\",\"app_name\":\"%s\",",
-               espbot_get_name(),
-               system_get_chip_id(),
-               app_name);
-    fs_sprintf((msg + os_strlen(msg)),
-               "\"app_version\":\"%s\",\"espbot_version\":\"%s\",",
-               app_release,
-               espbot_get_version());
-    fs_sprintf(msg + os_strlen(msg),
-               "\"api_version\":\"%s\",\"drivers_version\":\"%s\",",
-               f_str(API_RELEASE),
-               drivers_release);
-    fs_sprintf(msg + os_strlen(msg),
-               "\"sdk_version\":\"%s\",\"boot_version\":\"%d\"}",
-               system_get_sdk_version(),
-               system_get_boot_version());
-     return msg;
+    return msg;
 }
\ No newline at end of file
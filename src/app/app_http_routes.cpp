@@ -23,6 +23,7 @@ extern "C"
 #include "espbot.hpp"
 #include "espbot_diagnostic.hpp"
 #include "espbot_http.hpp"
+#include "espbot_http_cache.hpp"
 #include "espbot_json.hpp"
 #include "espbot_mem_mon.hpp"
 #include "espbot_utils.hpp"
@@ -31,11 +32,7 @@ extern "C"
 static void get_api_info(struct espconn *ptr_espconn, Http_parsed_req *parsed_req)
 {
     ALL("get_api_info");
-    char *msg = app_info_json_stringify();
-    if (msg)
-        http_response(ptr_espconn, HTTP_OK, HTTP_CONTENT_JSON, msg, true);
-    else
-        http_response(ptr_espconn, HTTP_SERVER_ERROR, HTTP_CONTENT_JSON, f_str("Heap exhausted"), false);
+    http_cache_response(ptr_espconn, parsed_req, app_info_json_stringify);
 }
 
 static void runTest(struct espconn *ptr_espconn, Http_parsed_req *parsed_req)
@@ -32,6 +32,7 @@ extern "C"
 #include "espbot_mdns.hpp"
 #include "espbot_mem_mon.hpp"
 #include "espbot_mem_macros.h"
+#include "espbot_num.hpp"
 #include "espbot_profiler.hpp"
 #include "espbot_spiffs.hpp"
 #include "espbot_timedate.hpp"
@@ -222,6 +223,33 @@ static void IRAM dht_start_completed(void *param)
 }
 */
 
+// SPIFFS workloads (test 303)
+static uint32 fs_bench_start;
+static struct flash_stats fs_bench_stats;
+
+static void fs_bench_begin(void)
+{
+    os_memcpy(&fs_bench_stats, esp_spiffs_flash_stats(), sizeof(struct flash_stats));
+    fs_bench_start = system_get_time();
+}
+
+static void fs_bench_end(char *name, int ops, int errs)
+{
+    uint32 elapsed = system_get_time() - fs_bench_start;
+    struct flash_stats *stats = esp_spiffs_flash_stats();
+    TRACE("%s: %d ops (%d errs) in %d us -> %d ops/s",
+          name,
+          ops,
+          errs,
+          elapsed,
+          ((elapsed > 0) ? (int)(((uint64)ops * 1000000) / elapsed) : 0));
+    TRACE("%s: flash read %d bytes, written %d bytes, %d sectors erased",
+          name,
+          (stats->read_bytes - fs_bench_stats.read_bytes),
+          (stats->write_bytes - fs_bench_stats.write_bytes),
+          (stats->erase_ops - fs_bench_stats.erase_ops));
+}
+
 void run_test(int32 idx, int32 param)
 {
     struct do_seq *seq;
@@ -1382,6 +1410,209 @@ void run_test(int32 idx, int32 param)
         TRACE("heap: %d", system_get_free_heap_size());
     }
     break;
+    case 301:
+    {
+        // numbers: copy + atoi/atof vs in place parsing (1000 times each)
+        char *sample = (char *)f_str("{\"ts\":1601234567,\"tz\":-11,\"temp\":21.56}");
+        char sample_str[48];
+        os_strcpy(sample_str, sample);
+        JSONP json(sample_str);
+        char *ts;
+        int ts_len = json.getView(f_str("ts"), &ts);
+        char *temp;
+        int temp_len = json.getView(f_str("temp"), &temp);
+        char value_str[64];
+        int int_value = 0;
+        float float_value = 0;
+        int idx;
+        {
+            Profiler copy_atoi("copy + atoi");
+            for (idx = 0; idx < 1000; idx++)
+            {
+                os_memset(value_str, 0, 16);
+                os_strncpy(value_str, ts, ts_len);
+                int_value += atoi(value_str);
+            }
+        }
+        {
+            Profiler in_place_int("span_to_int");
+            for (idx = 0; idx < 1000; idx++)
+            {
+                int value;
+                span_to_int(ts, ts_len, &value);
+                int_value += value;
+            }
+        }
+        {
+            Profiler copy_atof("copy + atof");
+            for (idx = 0; idx < 1000; idx++)
+            {
+                os_memset(value_str, 0, 64);
+                os_strncpy(value_str, temp, temp_len);
+                float_value += atof(value_str);
+            }
+        }
+        {
+            Profiler in_place_float("span_to_float");
+            for (idx = 0; idx < 1000; idx++)
+            {
+                float value;
+                span_to_float(temp, temp_len, &value);
+                float_value += value;
+            }
+        }
+        {
+            Profiler in_place_fixed("span_to_fixed");
+            for (idx = 0; idx < 1000; idx++)
+            {
+                int value;
+                span_to_fixed(temp, temp_len, 2, &value);
+                int_value += value;
+            }
+        }
+        TRACE("ts %u tz %d temp %d (x100)",
+              json.getUint(f_str("ts")),
+              json.getInt(f_str("tz")),
+              json.getFixed(f_str("temp"), 2));
+        // keep the loops
+        TRACE("%d %d", int_value, (int)float_value);
+    }
+    break;
+    case 302:
+    {
+        // JSONP syntax check (100 times each), divide by the length for us/byte
+        char *cfg = (char *)f_str("{\"host\":\"192.168.1.103\",\"port\":20090,\"path\":\"/firmware/\",\"check_version\":1,\"reboot_on_completion\":1}");
+        char cfg_str[112];
+        os_strcpy(cfg_str, cfg);
+        int cfg_len = os_strlen(cfg_str);
+        char array_str[448];
+        int array_len = 0;
+        int idx;
+        array_str[array_len++] = '[';
+        for (idx = 0; idx < 64; idx++)
+        {
+            fs_sprintf((array_str + array_len), "%d,", (idx * 7919));
+            array_len += os_strlen(array_str + array_len);
+        }
+        array_str[array_len - 1] = ']';
+        array_str[array_len] = 0;
+        // deeper than JSON_DEPTH_MAX, rejected with no recursion past the limit
+        char deep_str[256];
+        int deep_len = 0;
+        for (idx = 0; idx < 40; idx++)
+        {
+            os_strcpy((deep_str + deep_len), f_str("{\"a\":"));
+            deep_len += 5;
+        }
+        deep_str[deep_len++] = '1';
+        for (idx = 0; idx < 40; idx++)
+            deep_str[deep_len++] = '}';
+        deep_str[deep_len] = 0;
+        int errs = 0;
+        {
+            Profiler cfg_check("cfg body");
+            for (idx = 0; idx < 100; idx++)
+            {
+                JSONP json(cfg_str, cfg_len);
+                errs += json.getErr();
+            }
+        }
+        {
+            Profiler array_check("64 numbers array");
+            for (idx = 0; idx < 100; idx++)
+            {
+                JSONP_ARRAY json(array_str, array_len);
+                errs += json.getErr();
+            }
+        }
+        {
+            Profiler deep_check("40 nested objects");
+            for (idx = 0; idx < 100; idx++)
+            {
+                JSONP json(deep_str, deep_len);
+                errs += json.getErr();
+            }
+        }
+        TRACE("cfg %d array %d deep %d bytes (errs %d)", cfg_len, array_len, deep_len, errs);
+    }
+    break;
+    case 303:
+    {
+        // SPIFFS workloads through Espfile (the mount is reported at boot)
+        // the bench files are removed at the end
+        char name[32];
+        char buffer[64];
+        int idx;
+        int jdx;
+        int errs;
+        os_memset(buffer, 'x', 64);
+        TRACE("FS size %d, used %d", esp_spiffs_total_size(), esp_spiffs_used_size());
+        // create: 16 files of 128 bytes
+        fs_bench_begin();
+        errs = 0;
+        for (idx = 0; idx < 16; idx++)
+        {
+            fs_sprintf(name, "bench_%d.txt", idx);
+            Espfile file(name);
+            if (file.n_append(buffer, 64) < SPIFFS_OK)
+                errs++;
+            if (file.n_append(buffer, 64) < SPIFFS_OK)
+                errs++;
+        }
+        fs_bench_end("create", 16, errs);
+        // logging: 512 lines of 48 bytes, opening the file for each line
+        os_strcpy(name, f_str("bench.log"));
+        fs_bench_begin();
+        errs = 0;
+        for (idx = 0; idx < 512; idx++)
+        {
+            Espfile log(name);
+            if (log.n_append(buffer, 48) < SPIFFS_OK)
+                errs++;
+        }
+        fs_bench_end("append", 512, errs);
+        // random reads: 512 reads of 32 bytes from the log
+        fs_bench_begin();
+        errs = 0;
+        {
+            Espfile log(name);
+            int size = Espfile::size(name);
+            for (idx = 0; idx < 512; idx++)
+            {
+                if (log.n_read(buffer, (os_random() % (size - 32)), 32) < SPIFFS_OK)
+                    errs++;
+            }
+        }
+        fs_bench_end("random read", 512, errs);
+        // GC stress: 4 files rewritten 16 times with 1 KB each
+        fs_bench_begin();
+        errs = 0;
+        for (idx = 0; idx < 64; idx++)
+        {
+            fs_sprintf(name, "bench_%d.txt", (idx % 4));
+            Espfile file(name);
+            if (file.clear() != SPIFFS_OK)
+                errs++;
+            for (jdx = 0; jdx < 16; jdx++)
+                if (file.n_append(buffer, 64) < SPIFFS_OK)
+                    errs++;
+        }
+        fs_bench_end("rewrite", 64, errs);
+        // clean up
+        for (idx = 0; idx < 16; idx++)
+        {
+            fs_sprintf(name, "bench_%d.txt", idx);
+            Espfile file(name);
+            file.remove();
+        }
+        os_strcpy(name, f_str("bench.log"));
+        {
+            Espfile log(name);
+            log.remove();
+        }
+        TRACE("FS used %d", esp_spiffs_used_size());
+    }
+    break;
     default:
         break;
     }
@@ -20,14 +20,19 @@ extern "C"
 #include "app.hpp"
 #include "espbot.hpp"
 #include "espbot_cfgfile.hpp"
+#include "espbot_cfgstore.hpp"
+#include "espbot_cors.hpp"
 #include "espbot_cron.hpp"
 #include "espbot_diagnostic.hpp"
+#include "espbot_dns.hpp"
 #include "espbot_event_codes.h"
 #include "espbot_gpio.hpp"
 #include "espbot_hal.h"
 #include "espbot_mem_mon.hpp"
 #include "espbot_mdns.hpp"
 #include "espbot_http.hpp"
+#include "espbot_http_cache.hpp"
+#include "espbot_jobs.hpp"
 #include "espbot_json.hpp"
 #include "espbot_ota.hpp"
 #include "espbot_spiffs.hpp"
@@ -48,11 +53,17 @@ extern "C"
 #endif
 char *espbot_release = APP_RELEASE;
 
-static struct
+static struct espbot_config
 {
     char device_name[32];
 } espbot_cfg;
 
+// the default name depends on the chip id (set by espbot_init)
+#define ESPBOT_CFG_FIELDS(FIELD, type) \
+    FIELD(type, device_name, "espbot_name", CFG_str, 0)
+
+CFG_SCHEMA(espbot_schema, struct espbot_config, espbot_cfg, ESPBOT_CFG_FIELDS);
+
 static struct
 {
     int graceful_rst_counter;
@@ -148,6 +159,10 @@ static void espbot_coordinator_task(os_event_t *e)
                 command();
         }
         break;
+    case SIG_jobs_step:
+        // execute a time slice of the running jobs
+        jobs_step();
+        break;
     default:
         break;
     }
@@ -186,6 +201,7 @@ void espbot_set_name(char *t_name)
         WARN("espbot_set_name truncating name to 31 characters");
     }
     os_strncpy(espbot_cfg.device_name, t_name, 31);
+    http_cache_invalidate(f_str("/api/info"));
 }
 
 #define ESPBOT_FILENAME ((char *)f_str("espbot.cfg"))
@@ -194,77 +210,24 @@ static int espbot_restore_cfg(void)
 {
     ALL("espbot_restore_cfg");
 
-    if (!Espfile::exists(ESPBOT_FILENAME))
-        return CFG_cantRestore;
-    Cfgfile cfgfile(ESPBOT_FILENAME);
-    char device_name[32];
-    os_memset(device_name, 0, 32);
-    cfgfile.getStr(f_str("espbot_name"), device_name, 31);
+    int res = cfgstore_restore(ESPBOT_FILENAME, &espbot_schema);
     mem_mon_stack();
-    if (cfgfile.getErr() != JSON_noerr)
+    if (res == CFG_error)
     {
         dia_error_evnt(ESPBOT_RESTORE_CFG_ERROR);
         ERROR("espbot_restore_cfg error");
-        mem_mon_stack();
-        return CFG_error;
-    }
-    os_strncpy(espbot_cfg.device_name, device_name, 32);
-    return CFG_ok;
-}
-
-static int espbot_saved_cfg_updated(void)
-{
-    ALL("espbot_saved_cfg_updated");
-    if (!Espfile::exists(ESPBOT_FILENAME))
-    {
-        return CFG_notUpdated;
-    }
-    Cfgfile cfgfile(ESPBOT_FILENAME);
-    char device_name[32];
-    os_memset(device_name, 0, 32);
-    cfgfile.getStr(f_str("espbot_name"), device_name, 31);
-    mem_mon_stack();
-    if (cfgfile.getErr() != JSON_noerr)
-    {
-        // no need to raise an error, the cfg file will be overwritten
-        // dia_error_evnt(ESPBOT_SAVED_CFG_UPDATED_ERROR);
-        // ERROR("espbot_saved_cfg_updated error");
-        return CFG_error;
-    }
-    if (os_strcmp(espbot_cfg.device_name, device_name) != 0)
-    {
-        return CFG_notUpdated;
     }
-    return CFG_ok;
+    return res;
 }
 
 char *espbot_cfg_json_stringify(char *dest, int len)
 {
-    // {"espbot_name":""}
-    int msg_len = 18 + 32;
-    char *msg;
-    if (dest == NULL)
-    {
-        msg = new char[msg_len];
-        if (msg == NULL)
-        {
-            dia_error_evnt(ESPBOT_CFG_STRINGIFY_HEAP_EXHAUSTED, msg_len);
-            ERROR("espbot_cfg_json_stringify heap exhausted [%d]", msg_len);
-            return NULL;
-        }
-    }
-    else
+    char *msg = cfg_json_stringify(&espbot_schema, dest, len);
+    if (msg == NULL)
     {
-        msg = dest;
-        if (len < msg_len)
-        {
-            msg[0] = 0;
-            return msg;
-        }
+        dia_error_evnt(ESPBOT_CFG_STRINGIFY_HEAP_EXHAUSTED, espbot_schema_json_len);
+        ERROR("espbot_cfg_json_stringify heap exhausted [%d]", espbot_schema_json_len);
     }
-    fs_sprintf(msg,
-               "{\"espbot_name\":\"%s\"}",
-               espbot_cfg.device_name);
     mem_mon_stack();
     return msg;
 }
@@ -272,18 +235,9 @@ char *espbot_cfg_json_stringify(char *dest, int len)
 int espbot_cfg_save(void)
 {
     ALL("espbot_cfg_save");
-    if (espbot_saved_cfg_updated() == CFG_ok)
+    if (cfgstore_uptodate(&espbot_schema))
         return CFG_ok;
-    Cfgfile cfgfile(ESPBOT_FILENAME);
-    if (cfgfile.clear() != SPIFFS_OK)
-        return CFG_error;
-    char str[50];
-    espbot_cfg_json_stringify(str, 50);
-    int res = cfgfile.n_append(str, os_strlen(str));
-    mem_mon_stack();
-    if (res < SPIFFS_OK)
-        return CFG_error;
-    return CFG_ok;
+    return cfgstore_save();
 }
 
 // GRACEFUL RESET
@@ -325,7 +279,8 @@ void espbot_reset(int t_reset)
         os_timer_arm(&espbot_state.graceful_rst_timer, 100, 0);
         break;
     case 3:
-        // reset
+        // reset (with no cfg save pending)
+        cfgstore_flush();
         if (t_reset == ESPBOT_restart)
             system_restart();
         if (t_reset == ESPBOT_rebootAfterOta)
@@ -354,6 +309,7 @@ void espbot_init(void)
 
     // MOUNT THE FILE SYSTEM
     esp_spiffs_mount();
+    cfgstore_init();
 
     // FILE SYSTEM AVAILABLE: from now on the init functions can restore the cfg saved into flash
     dia_init_custom();
@@ -376,13 +332,20 @@ void espbot_init(void)
 
     // BEFORE WIFI
     mdns_init();
+    cors_init();
     ota_init();
+    jobs_init();
     http_init();
+    http_cache_init();
     http_svr_init();
     init_http_clients_data_stuctures();
+    dns_init();
     cron_init();
     app_init_before_wifi();
 
     // WIFI START
     espwifi_init();
+
+    // every cfg restored (the ones from JSON files are moved into the store)
+    cfgstore_init_done();
 }
\ No newline at end of file
@@ -0,0 +1,121 @@
+/*
+ * ----------------------------------------------------------------------------
+ * "THE BEER-WARE LICENSE" (Revision 42):
+ * <quackmore-ff@yahoo.com> wrote this file.  As long as you retain this notice
+ * you can do whatever you want with this stuff. If we meet some day, and you 
+ * think this stuff is worth it, you can buy me a beer in return. Quackmore
+ * ----------------------------------------------------------------------------
+ */
+
+// SDK includes
+extern "C"
+{
+#include "c_types.h"
+#include "osapi.h"
+}
+
+#include "espbot_cfg_schema.hpp"
+#include "espbot_diagnostic.hpp"
+#include "espbot_mem_mon.hpp"
+
+int cfg_get_num(const struct cfg_field *field, void *cfg)
+{
+    char *ptr = (char *)cfg + field->offset;
+    bool is_signed = (field->type == CFG_int);
+    switch (field->size)
+    {
+    case 1:
+        return (is_signed ? (int)*(signed char *)ptr : (int)*(uint8 *)ptr);
+    case 2:
+        return (is_signed ? (int)*(sint16 *)ptr : (int)*(uint16 *)ptr);
+    default:
+        return *(int *)ptr;
+    }
+}
+
+void cfg_set_num(const struct cfg_field *field, void *cfg, int value)
+{
+    char *ptr = (char *)cfg + field->offset;
+    if (field->type == CFG_bool)
+        value = (value != 0);
+    switch (field->size)
+    {
+    case 1:
+        *(uint8 *)ptr = (uint8)value;
+        break;
+    case 2:
+        *(uint16 *)ptr = (uint16)value;
+        break;
+    default:
+        *(int *)ptr = value;
+        break;
+    }
+}
+
+void cfg_defaults(const struct cfg_schema *schema)
+{
+    os_memset(schema->cfg, 0, schema->cfg_size);
+    int idx;
+    for (idx = 0; idx < schema->count; idx++)
+    {
+        const struct cfg_field *field = &schema->fields[idx];
+        if (field->type != CFG_str)
+            cfg_set_num(field, schema->cfg, field->def);
+    }
+}
+
+void cfg_json_write(const struct cfg_schema *schema, Json_writer *json)
+{
+    json->obj_begin();
+    int idx;
+    for (idx = 0; idx < schema->count; idx++)
+    {
+        const struct cfg_field *field = &schema->fields[idx];
+        switch (field->type)
+        {
+        case CFG_str:
+            json->str(field->name, (char *)schema->cfg + field->offset);
+            break;
+        case CFG_uint:
+            json->unum(field->name, (uint32)cfg_get_num(field, schema->cfg));
+            break;
+        default:
+            json->num(field->name, cfg_get_num(field, schema->cfg));
+            break;
+        }
+    }
+    json->obj_end();
+}
+
+char *cfg_json_stringify(const struct cfg_schema *schema, char *dest, int len)
+{
+    Json_writer json(dest, len);
+    while (json.pass())
+    {
+        cfg_json_write(schema, &json);
+    }
+    mem_mon_stack();
+    return json.result();
+}
+
+uint32 cfg_digest(const struct cfg_schema *schema)
+{
+    // FNV-1a
+    uint32 hash = 2166136261U;
+    int idx;
+    for (idx = 0; idx < schema->count; idx++)
+    {
+        const struct cfg_field *field = &schema->fields[idx];
+        char *ptr = (char *)schema->cfg + field->offset;
+        int len = field->size;
+        int jdx;
+        for (jdx = 0; jdx < len; jdx++)
+        {
+            hash = (hash ^ (uint8)ptr[jdx]) * 16777619U;
+            // whatever follows the terminator does not matter
+            if ((field->type == CFG_str) && (ptr[jdx] == 0))
+                break;
+        }
+    }
+    return (hash ? hash : 1);
+}
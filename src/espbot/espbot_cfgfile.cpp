@@ -10,6 +10,7 @@
 #include "espbot_cfgfile.hpp"
 #include "espbot_diagnostic.hpp"
 #include "espbot_event_codes.h"
+#include "espbot_mem_mon.hpp"
 
 static char *get_file_content(Cfgfile *ptr, char *&str, char *filename)
 {
@@ -41,4 +42,112 @@ Cfgfile::~Cfgfile()
 {
   if (_json_str)
     delete _json_str;
-}
\ No newline at end of file
+}
+
+// the cfg saved as JSON files by a previous firmware are restored once
+// (then moved into the cfgstore), so the buffers are allocated just meanwhile
+
+int Cfgfile::restore(char *filename, struct json_field *fields, int count)
+{
+  char *chunk = new char[LOG_PAGE_SIZE];
+  if (chunk == NULL)
+  {
+    dia_error_evnt(CFGFILE_HEAP_EXHAUSTED, LOG_PAGE_SIZE);
+    ERROR("Cfgfile::restore heap exhausted [%d]", LOG_PAGE_SIZE);
+    return JSON_sintaxErr;
+  }
+  // reading past the end of file is an error for SPIFFS
+  int remaining = Espfile::size(filename);
+  int res = JSON_noerr;
+  {
+    Espfile file(filename);
+    Json_binder binder(fields, count);
+    while (remaining > 0)
+    {
+      int len = (remaining < LOG_PAGE_SIZE) ? remaining : LOG_PAGE_SIZE;
+      if (file.n_read(chunk, len) != len)
+      {
+        res = JSON_sintaxErr;
+        break;
+      }
+      if (binder.feed(chunk, len) != JSON_SAX_ok)
+        break;
+      remaining -= len;
+    }
+    if (res == JSON_noerr)
+      res = binder.end();
+  }
+  delete[] chunk;
+  mem_mon_stack();
+  return res;
+}
+
+struct cfgfile_restore_buffers
+{
+  uint32 copy[CFG_SIZE_MAX / 4];
+  int nums[CFG_FIELDS_MAX];
+  struct json_field fields[CFG_FIELDS_MAX];
+};
+
+int Cfgfile::restore(char *filename, const struct cfg_schema *schema, uint32 *found)
+{
+  struct cfgfile_restore_buffers *buffers = new struct cfgfile_restore_buffers;
+  if (buffers == NULL)
+  {
+    dia_error_evnt(CFGFILE_HEAP_EXHAUSTED, sizeof(struct cfgfile_restore_buffers));
+    ERROR("Cfgfile::restore heap exhausted [%d]", sizeof(struct cfgfile_restore_buffers));
+    return JSON_sintaxErr;
+  }
+  // values are bound to a copy, numbers to an int whatever the member size
+  uint32 *copy = buffers->copy;
+  int *nums = buffers->nums;
+  struct json_field *fields = buffers->fields;
+  os_memcpy(copy, schema->cfg, schema->cfg_size);
+  int idx;
+  for (idx = 0; idx < schema->count; idx++)
+  {
+    const struct cfg_field *field = &schema->fields[idx];
+    fields[idx].name = field->name;
+    if (field->type == CFG_str)
+    {
+      fields[idx].type = JSON_str;
+      fields[idx].value = (char *)copy + field->offset;
+      fields[idx].size = field->size;
+    }
+    else
+    {
+      fields[idx].type = JSON_num;
+      fields[idx].value = &nums[idx];
+      fields[idx].size = sizeof(int);
+    }
+  }
+  int res = restore(filename, fields, schema->count);
+  mem_mon_stack();
+  if ((res == JSON_notFound) && found)
+    res = JSON_noerr;
+  if (res != JSON_noerr)
+  {
+    delete buffers;
+    return res;
+  }
+  bool complete = true;
+  if (found)
+    *found = 0;
+  for (idx = 0; idx < schema->count; idx++)
+  {
+    if (!fields[idx].found)
+    {
+      complete = false;
+      continue;
+    }
+    if (found)
+      *found |= (1 << idx);
+    if (fields[idx].type == JSON_num)
+      cfg_set_num(&schema->fields[idx], copy, nums[idx]);
+  }
+  os_memcpy(schema->cfg, copy, schema->cfg_size);
+  delete buffers;
+  // a file with missing fields is not up to date
+  *schema->digest = (complete ? cfg_digest(schema) : 0);
+  return JSON_noerr;
+}
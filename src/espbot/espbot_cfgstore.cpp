@@ -0,0 +1,599 @@
+/*
+ * ----------------------------------------------------------------------------
+ * "THE BEER-WARE LICENSE" (Revision 42):
+ * <quackmore-ff@yahoo.com> wrote this file.  As long as you retain this notice
+ * you can do whatever you want with this stuff. If we meet some day, and you 
+ * think this stuff is worth it, you can buy me a beer in return. Quackmore
+ * ----------------------------------------------------------------------------
+ */
+
+// SDK includes
+extern "C"
+{
+#include "c_types.h"
+#include "osapi.h"
+#include "user_interface.h"
+}
+
+#include "espbot.hpp"
+#include "espbot_cfgstore.hpp"
+#include "espbot_diagnostic.hpp"
+#include "espbot_event_codes.h"
+#include "espbot_mem_mon.hpp"
+#include "espbot_spiffs.hpp"
+
+#define CFGSTORE_HEADER_LEN 16
+#define CFGSTORE_PAD(len) (((len) + 3) & ~3)
+
+struct cfgstore_record
+{
+    uint32 key;   // hash
+    uint16 count; // fields
+    uint16 len;   // fields length
+};
+
+struct cfgstore_field
+{
+    uint32 name; // hash
+    uint16 type; // Cfg_field_type
+    uint16 len;  // value length (padding excluded)
+};
+
+struct cfgstore_entry
+{
+    char *key;
+    const struct cfg_schema *schema;
+    bool legacy; // restored from a JSON file
+};
+
+static struct
+{
+    struct cfgstore_entry entries[CFGSTORE_ENTRIES];
+    int count;
+    int slot; // the last written slot, -1 when none is valid
+    uint32 seq;
+    uint32 *boot; // the records read by cfgstore_init
+    int boot_len;
+    uint32 generation;       // save requests
+    uint32 saved_generation; // the last request written
+    os_timer_t save_timer;
+    bool save_armed;
+    int retries; // failed writes of the pending requests
+} cfgstore;
+
+static char *cfgstore_slot_name(int slot)
+{
+    if (slot == 0)
+        return (char *)f_str("cfgstore.a");
+    return (char *)f_str("cfgstore.b");
+}
+
+// CRC-32 (IEEE 802.3) a nibble at a time
+static const uint32 crc_nibble[16] IROM_TEXT ALIGNED_4 = {
+    0x00000000, 0x1DB71064, 0x3B6E20C8, 0x26D930AC, 0x76DC4190, 0x6B6B51F4, 0x4DB26158, 0x5005713C,
+    0xEDB88320, 0xF00F9344, 0xD6D6A3E8, 0xCB61B38C, 0x9B64C2B0, 0x86D3D2D4, 0xA00AE278, 0xBDBDF21C};
+
+static uint32 cfgstore_crc(uint32 crc, char *data, int len)
+{
+    while (len-- > 0)
+    {
+        crc ^= (uint8)*data++;
+        crc = (crc >> 4) ^ crc_nibble[crc & 0x0F];
+        crc = (crc >> 4) ^ crc_nibble[crc & 0x0F];
+    }
+    return crc;
+}
+
+// the header words and the records
+static uint32 cfgstore_checksum(uint32 *header, uint32 *records, int len)
+{
+    uint32 crc = cfgstore_crc(0xFFFFFFFF, (char *)header, 12);
+    return ~cfgstore_crc(crc, (char *)records, len);
+}
+
+// FNV-1a (byte reads, the str can be in flash)
+static uint32 cfgstore_hash(const char *str)
+{
+    uint32 hash = 2166136261U;
+    while (*str)
+        hash = (hash ^ (uint8)*str++) * 16777619U;
+    return hash;
+}
+
+/*
+ * reading the store
+ */
+
+// the records are walked once, so that restoring can trust the lengths
+static bool cfgstore_valid(uint32 *header, uint32 *records, int len)
+{
+    if (cfgstore_checksum(header, records, len) != header[3])
+        return false;
+    char *ptr = (char *)records;
+    char *end = ptr + len;
+    while (ptr < end)
+    {
+        if ((end - ptr) < (int)sizeof(struct cfgstore_record))
+            return false;
+        struct cfgstore_record *record = (struct cfgstore_record *)ptr;
+        ptr += sizeof(struct cfgstore_record);
+        char *fields_end = ptr + record->len;
+        if (fields_end > end)
+            return false;
+        int idx;
+        for (idx = 0; idx < record->count; idx++)
+        {
+            if ((fields_end - ptr) < (int)sizeof(struct cfgstore_field))
+                return false;
+            struct cfgstore_field *field = (struct cfgstore_field *)ptr;
+            ptr += sizeof(struct cfgstore_field) + CFGSTORE_PAD(field->len);
+            if (ptr > fields_end)
+                return false;
+        }
+        if (ptr != fields_end)
+            return false;
+    }
+    return true;
+}
+
+// false when the slot was never written
+static bool cfgstore_header(int slot, uint32 *header)
+{
+    int size = Espfile::size(cfgstore_slot_name(slot));
+    if ((size < CFGSTORE_HEADER_LEN) || (size > CFGSTORE_SIZE_MAX))
+        return false;
+    Espfile file(cfgstore_slot_name(slot));
+    if (file.n_read((char *)header, CFGSTORE_HEADER_LEN) != CFGSTORE_HEADER_LEN)
+        return false;
+    return ((header[0] == CFGSTORE_MAGIC) &&
+            (header[2] == (uint32)(size - CFGSTORE_HEADER_LEN)) &&
+            ((header[2] % 4) == 0));
+}
+
+// NULL when the slot content is corrupted (e.g. an interrupted save)
+static uint32 *cfgstore_load(int slot, uint32 *header)
+{
+    int len = header[2];
+    uint32 *records = new uint32[(len / 4) + 1];
+    if (records == NULL)
+    {
+        dia_error_evnt(CFGSTORE_HEAP_EXHAUSTED, len);
+        ERROR("cfgstore_load heap exhausted [%d]", len);
+        return NULL;
+    }
+    Espfile file(cfgstore_slot_name(slot));
+    if ((file.n_read((char *)records, CFGSTORE_HEADER_LEN, len) != len) ||
+        !cfgstore_valid(header, records, len))
+    {
+        delete[] records;
+        dia_error_evnt(CFGSTORE_BAD_SLOT, slot);
+        ERROR("cfgstore_load bad slot %d", slot);
+        return NULL;
+    }
+    mem_mon_stack();
+    return records;
+}
+
+static void cfgstore_save_timer(void *arg);
+
+void cfgstore_init(void)
+{
+    uint32 start = system_get_time();
+    uint32 header[2][4];
+    bool written[2];
+    cfgstore.count = 0;
+    cfgstore.slot = -1;
+    cfgstore.seq = 0;
+    cfgstore.boot = NULL;
+    cfgstore.boot_len = 0;
+    cfgstore.generation = 0;
+    cfgstore.saved_generation = 0;
+    cfgstore.save_armed = false;
+    cfgstore.retries = 0;
+    os_timer_disarm(&cfgstore.save_timer);
+    os_timer_setfn(&cfgstore.save_timer, (os_timer_func_t *)cfgstore_save_timer, NULL);
+    written[0] = cfgstore_header(0, header[0]);
+    written[1] = cfgstore_header(1, header[1]);
+    // the newest first (the sequence can wrap around)
+    int slot = 0;
+    if (written[1] && (!written[0] || ((int)(header[1][1] - header[0][1]) > 0)))
+        slot = 1;
+    int idx;
+    for (idx = 0; idx < 2; idx++, slot = (1 - slot))
+    {
+        if (!written[slot])
+            continue;
+        cfgstore.boot = cfgstore_load(slot, header[slot]);
+        if (cfgstore.boot == NULL)
+            continue;
+        cfgstore.boot_len = header[slot][2];
+        cfgstore.slot = slot;
+        cfgstore.seq = header[slot][1];
+        break;
+    }
+    INFO("cfgstore_init slot %d seq %d [%d bytes] in %d us",
+         cfgstore.slot, cfgstore.seq, cfgstore.boot_len, (system_get_time() - start));
+}
+
+static struct cfgstore_record *cfgstore_find(uint32 key)
+{
+    char *ptr = (char *)cfgstore.boot;
+    char *end = ptr + cfgstore.boot_len;
+    while (ptr < end)
+    {
+        struct cfgstore_record *record = (struct cfgstore_record *)ptr;
+        if (record->key == key)
+            return record;
+        ptr += sizeof(struct cfgstore_record) + record->len;
+    }
+    return NULL;
+}
+
+static struct cfgstore_field *cfgstore_find_field(struct cfgstore_record *record, uint32 name)
+{
+    char *ptr = (char *)(record + 1);
+    int idx;
+    for (idx = 0; idx < record->count; idx++)
+    {
+        struct cfgstore_field *field = (struct cfgstore_field *)ptr;
+        if (field->name == name)
+            return field;
+        ptr += sizeof(struct cfgstore_field) + CFGSTORE_PAD(field->len);
+    }
+    return NULL;
+}
+
+static int cfgstore_restore_record(struct cfgstore_record *record, const struct cfg_schema *schema, uint32 *found)
+{
+    // values are restored into a copy
+    uint32 copy[CFG_SIZE_MAX / 4];
+    os_memcpy(copy, schema->cfg, schema->cfg_size);
+    uint32 mask = 0;
+    int idx;
+    for (idx = 0; idx < schema->count; idx++)
+    {
+        const struct cfg_field *field = &schema->fields[idx];
+        struct cfgstore_field *value = cfgstore_find_field(record, cfgstore_hash(field->name));
+        if (value == NULL)
+            continue;
+        char *data = (char *)(value + 1);
+        if (field->type == CFG_str)
+        {
+            if ((value->type != CFG_str) ||
+                (value->len == 0) ||
+                (value->len > field->size) ||
+                (data[value->len - 1] != 0))
+                return CFG_error;
+            os_memcpy(((char *)copy + field->offset), data, value->len);
+        }
+        else
+        {
+            if ((value->type == CFG_str) || (value->len != sizeof(int)))
+                return CFG_error;
+            int num;
+            os_memcpy(&num, data, sizeof(int));
+            cfg_set_num(field, copy, num);
+        }
+        mask |= (1 << idx);
+    }
+    bool complete = (mask == (uint32)((1 << schema->count) - 1));
+    if (!complete && (found == NULL))
+        return CFG_error;
+    if (found)
+        *found = mask;
+    os_memcpy(schema->cfg, copy, schema->cfg_size);
+    // a record with missing fields is not up to date
+    *schema->digest = (complete ? cfg_digest(schema) : 0);
+    return CFG_ok;
+}
+
+static struct cfgstore_entry *cfgstore_add(char *key, const struct cfg_schema *schema)
+{
+    int idx;
+    for (idx = 0; idx < cfgstore.count; idx++)
+        if (cfgstore.entries[idx].schema == schema)
+            return &cfgstore.entries[idx];
+    if (cfgstore.count >= CFGSTORE_ENTRIES)
+    {
+        dia_error_evnt(CFGSTORE_TABLE_FULL);
+        ERROR("cfgstore_add table full");
+        return NULL;
+    }
+    struct cfgstore_entry *entry = &cfgstore.entries[cfgstore.count++];
+    entry->key = key;
+    entry->schema = schema;
+    entry->legacy = false;
+    return entry;
+}
+
+int cfgstore_restore(char *key, const struct cfg_schema *schema, uint32 *found)
+{
+    ALL("cfgstore_restore");
+    struct cfgstore_entry *entry = cfgstore_add(key, schema);
+    if (entry == NULL)
+        return CFG_error;
+    struct cfgstore_record *record = cfgstore_find(cfgstore_hash(key));
+    if (record)
+    {
+        mem_mon_stack();
+        return cfgstore_restore_record(record, schema, found);
+    }
+    // saved by a previous firmware
+    if (!Espfile::exists(key))
+        return CFG_cantRestore;
+    entry->legacy = true;
+    int res = Cfgfile::restore(key, schema, found);
+    mem_mon_stack();
+    if (res != JSON_noerr)
+        return CFG_error;
+    return CFG_ok;
+}
+
+bool cfgstore_uptodate(const struct cfg_schema *schema)
+{
+    if (*schema->digest == 0)
+        return false;
+    return (*schema->digest == cfg_digest(schema));
+}
+
+/*
+ * writing the store
+ */
+
+static int cfgstore_value_len(const struct cfg_field *field, void *cfg)
+{
+    if (field->type != CFG_str)
+        return sizeof(int);
+    // terminator included (and forced)
+    char *str = (char *)cfg + field->offset;
+    int len = 0;
+    while ((len < (int)(field->size - 1)) && str[len])
+        len++;
+    return (len + 1);
+}
+
+static int cfgstore_record_len(const struct cfg_schema *schema)
+{
+    int len = sizeof(struct cfgstore_record);
+    int idx;
+    for (idx = 0; idx < schema->count; idx++)
+        len += sizeof(struct cfgstore_field) + CFGSTORE_PAD(cfgstore_value_len(&schema->fields[idx], schema->cfg));
+    return len;
+}
+
+static char *cfgstore_write_record(char *ptr, struct cfgstore_entry *entry)
+{
+    const struct cfg_schema *schema = entry->schema;
+    struct cfgstore_record *record = (struct cfgstore_record *)ptr;
+    record->key = cfgstore_hash(entry->key);
+    record->count = schema->count;
+    ptr += sizeof(struct cfgstore_record);
+    char *fields = ptr;
+    int idx;
+    for (idx = 0; idx < schema->count; idx++)
+    {
+        const struct cfg_field *field = &schema->fields[idx];
+        struct cfgstore_field *value = (struct cfgstore_field *)ptr;
+        int len = cfgstore_value_len(field, schema->cfg);
+        value->name = cfgstore_hash(field->name);
+        value->type = field->type;
+        value->len = len;
+        ptr += sizeof(struct cfgstore_field);
+        os_memset(ptr, 0, CFGSTORE_PAD(len));
+        if (field->type == CFG_str)
+        {
+            os_memcpy(ptr, ((char *)schema->cfg + field->offset), (len - 1));
+        }
+        else
+        {
+            int num = cfg_get_num(field, schema->cfg);
+            os_memcpy(ptr, &num, sizeof(int));
+        }
+        ptr += CFGSTORE_PAD(len);
+    }
+    record->len = ptr - fields;
+    return ptr;
+}
+
+// the boot records of cfg not restored (yet) are kept
+static bool cfgstore_restored(struct cfgstore_record *record)
+{
+    int idx;
+    for (idx = 0; idx < cfgstore.count; idx++)
+        if (cfgstore_hash(cfgstore.entries[idx].key) == record->key)
+            return true;
+    return false;
+}
+
+static int cfgstore_kept_len(char *dest)
+{
+    int len = 0;
+    char *ptr = (char *)cfgstore.boot;
+    char *end = ptr + cfgstore.boot_len;
+    while (ptr < end)
+    {
+        struct cfgstore_record *record = (struct cfgstore_record *)ptr;
+        int record_len = sizeof(struct cfgstore_record) + record->len;
+        if (!cfgstore_restored(record))
+        {
+            if (dest)
+                os_memcpy((dest + len), ptr, record_len);
+            len += record_len;
+        }
+        ptr += record_len;
+    }
+    return len;
+}
+
+typedef enum
+{
+    CFGSTORE_written = 0,
+    CFGSTORE_too_long, // writing again won't help
+    CFGSTORE_failed
+} Cfgstore_write_res;
+
+static int cfgstore_write(void)
+{
+    ALL("cfgstore_write");
+    int len = CFGSTORE_HEADER_LEN + cfgstore_kept_len(NULL);
+    int idx;
+    for (idx = 0; idx < cfgstore.count; idx++)
+        len += cfgstore_record_len(cfgstore.entries[idx].schema);
+    if (len > CFGSTORE_SIZE_MAX)
+    {
+        dia_error_evnt(CFGSTORE_TOO_LONG, len);
+        ERROR("cfgstore_write too long [%d]", len);
+        return CFGSTORE_too_long;
+    }
+    uint32 *buffer = new uint32[len / 4];
+    if (buffer == NULL)
+    {
+        dia_error_evnt(CFGSTORE_HEAP_EXHAUSTED, len);
+        ERROR("cfgstore_write heap exhausted [%d]", len);
+        return CFGSTORE_failed;
+    }
+    char *ptr = (char *)buffer + CFGSTORE_HEADER_LEN;
+    for (idx = 0; idx < cfgstore.count; idx++)
+        ptr = cfgstore_write_record(ptr, &cfgstore.entries[idx]);
+    cfgstore_kept_len(ptr);
+    buffer[0] = CFGSTORE_MAGIC;
+    buffer[1] = cfgstore.seq + 1;
+    buffer[2] = len - CFGSTORE_HEADER_LEN;
+    buffer[3] = cfgstore_checksum(buffer, (buffer + 4), buffer[2]);
+    // the other slot, so that the current one is valid until the new one is complete
+    int slot = ((cfgstore.slot == 0) ? 1 : 0);
+    int res;
+    {
+        Espfile file(cfgstore_slot_name(slot));
+        res = file.clear();
+        if (res == SPIFFS_OK)
+            res = file.n_append((char *)buffer, len);
+        // the last page is in the SPIFFS cache until flushed
+        if ((res == len) && ((res = file.flush()) == SPIFFS_OK))
+            res = len;
+    }
+    delete[] buffer;
+    mem_mon_stack();
+    if (res != len)
+    {
+        dia_error_evnt(CFGSTORE_WRITE_ERROR, res);
+        ERROR("cfgstore_write slot %d write error %d", slot, res);
+        return CFGSTORE_failed;
+    }
+    cfgstore.slot = slot;
+    cfgstore.seq++;
+    for (idx = 0; idx < cfgstore.count; idx++)
+    {
+        struct cfgstore_entry *entry = &cfgstore.entries[idx];
+        *entry->schema->digest = cfg_digest(entry->schema);
+        if (entry->legacy)
+        {
+            // moved into the store
+            Espfile legacy_file(entry->key);
+            legacy_file.remove();
+            entry->legacy = false;
+        }
+    }
+    DEBUG("cfgstore_write slot %d seq %d [%d bytes]", slot, cfgstore.seq, len);
+    return CFGSTORE_written;
+}
+
+static bool cfgstore_changed(void)
+{
+    int idx;
+    for (idx = 0; idx < cfgstore.count; idx++)
+        if (!cfgstore_uptodate(cfgstore.entries[idx].schema))
+            return true;
+    return false;
+}
+
+static void cfgstore_arm(uint32 delay)
+{
+    os_timer_disarm(&cfgstore.save_timer);
+    os_timer_arm(&cfgstore.save_timer, delay, 0);
+    cfgstore.save_armed = true;
+}
+
+int cfgstore_flush(void)
+{
+    ALL("cfgstore_flush");
+    os_timer_disarm(&cfgstore.save_timer);
+    cfgstore.save_armed = false;
+    if (cfgstore.saved_generation == cfgstore.generation)
+        return CFG_ok;
+    int requests = cfgstore.generation - cfgstore.saved_generation;
+    // e.g. a setting changed and then restored
+    if (!cfgstore_changed())
+    {
+        cfgstore.saved_generation = cfgstore.generation;
+        cfgstore.retries = 0;
+        DEBUG("cfgstore_flush %d requests, nothing changed", requests);
+        return CFG_ok;
+    }
+    DEBUG("cfgstore_flush %d requests", requests);
+    int res = cfgstore_write();
+    if (res == CFGSTORE_written)
+    {
+        cfgstore.saved_generation = cfgstore.generation;
+        cfgstore.retries = 0;
+        return CFG_ok;
+    }
+    if (res == CFGSTORE_too_long)
+    {
+        // dropped, the next save request will try again
+        cfgstore.saved_generation = cfgstore.generation;
+        cfgstore.retries = 0;
+        return CFG_error;
+    }
+    if (cfgstore.retries < CFGSTORE_RETRIES)
+    {
+        // still pending, try again later and later
+        cfgstore.retries++;
+        cfgstore_arm(CFGSTORE_SAVE_DELAY << cfgstore.retries);
+        return CFG_error;
+    }
+    // still pending for cfgstore_flush, the next save request restarts the retries
+    dia_error_evnt(CFGSTORE_SAVE_GIVEN_UP, requests);
+    ERROR("cfgstore_flush giving up after %d retries", cfgstore.retries);
+    cfgstore.retries = 0;
+    return CFG_error;
+}
+
+static void cfgstore_flush_task(void)
+{
+    cfgstore_flush();
+}
+
+static void cfgstore_save_timer(void *arg)
+{
+    // flash is written from the espbot task
+    next_function(cfgstore_flush_task);
+}
+
+int cfgstore_save(void)
+{
+    ALL("cfgstore_save");
+    // the first request of a window arms the timer
+    // (a pending retry is not brought forward)
+    if (!cfgstore.save_armed)
+        cfgstore_arm(CFGSTORE_SAVE_DELAY);
+    cfgstore.generation++;
+    return CFG_ok;
+}
+
+void cfgstore_init_done(void)
+{
+    int idx;
+    for (idx = 0; idx < cfgstore.count; idx++)
+    {
+        if (cfgstore.entries[idx].legacy)
+        {
+            cfgstore_write();
+            break;
+        }
+    }
+    if (cfgstore.boot)
+        delete[] cfgstore.boot;
+    cfgstore.boot = NULL;
+    cfgstore.boot_len = 0;
+}
@@ -0,0 +1,313 @@
+/*
+ * ----------------------------------------------------------------------------
+ * "THE BEER-WARE LICENSE" (Revision 42):
+ * <quackmore-ff@yahoo.com> wrote this file.  As long as you retain this notice
+ * you can do whatever you want with this stuff. If we meet some day, and you 
+ * think this stuff is worth it, you can buy me a beer in return. Quackmore
+ * ----------------------------------------------------------------------------
+ */
+
+// SDK includes
+extern "C"
+{
+#include "c_types.h"
+#include "espconn.h"
+#include "osapi.h"
+}
+
+#include "espbot.hpp"
+#include "espbot_cfgfile.hpp"
+#include "espbot_cfgstore.hpp"
+#include "espbot_cors.hpp"
+#include "espbot_diagnostic.hpp"
+#include "espbot_event_codes.h"
+#include "espbot_http_cache.hpp"
+#include "espbot_list.hpp"
+#include "espbot_mem_mon.hpp"
+#include "espbot_utils.hpp"
+
+static struct cors_config
+{
+    char origins[CORS_ORIGINS_LEN];
+    char methods[CORS_METHODS_LEN];
+    char headers[CORS_HEADERS_LEN];
+    int max_age;
+} cors_cfg;
+
+// the default policy is set by cors_init
+#define CORS_CFG_FIELDS(FIELD, type)              \
+    FIELD(type, origins, "origins", CFG_str, 0)   \
+    FIELD(type, methods, "methods", CFG_str, 0)   \
+    FIELD(type, headers, "headers", CFG_str, 0)   \
+    FIELD(type, max_age, "max_age", CFG_int, 600)
+
+CFG_SCHEMA(cors_schema, struct cors_config, cors_cfg, CORS_CFG_FIELDS);
+
+static struct
+{
+    char *preflight_headers; // precomputed on every cfg change
+} cors_state;
+
+//
+// the allowed request origin is kept per connection
+// (responses to upload segments or to queued requests can be sent
+//  while another connection is parsing its request)
+// only listed origins are stored, with the "*" policy there is nothing to keep
+//
+#define CORS_CONNS_MAX 8
+
+struct cors_conn
+{
+    struct espconn *p_espconn;
+    char origin[CORS_ORIGIN_LEN];
+};
+
+static List<struct cors_conn> *cors_conns;
+
+#define CORS_FILENAME ((char *)f_str("cors.cfg"))
+
+//
+// the preflight headers depend on the cfg only
+// so they are formatted once (when the cfg changes) and not for every OPTIONS request
+//
+static bool cors_update_headers(void)
+{
+    ALL("cors_update_headers");
+    // Access-Control-Allow-Methods: \r\n  -> 32
+    // Access-Control-Allow-Headers: \r\n  -> 32
+    // Access-Control-Max-Age: \r\n        -> 26 + 10
+    int len = 32 + os_strlen(cors_cfg.methods) + 36;
+    bool echo_headers = (os_strcmp(cors_cfg.headers, f_str("*")) == 0);
+    if (!echo_headers)
+        len += 32 + os_strlen(cors_cfg.headers);
+    char *headers = new char[len + 1];
+    if (headers == NULL)
+    {
+        dia_error_evnt(CORS_UPDATE_HEADERS_HEAP_EXHAUSTED, len + 1);
+        ERROR("cors_update_headers heap exhausted %d", len + 1);
+        return false;
+    }
+    char *ptr = headers;
+    fs_sprintf(ptr, "Access-Control-Allow-Methods: %s\r\n", cors_cfg.methods);
+    ptr += os_strlen(ptr);
+    if (!echo_headers)
+    {
+        fs_sprintf(ptr, "Access-Control-Allow-Headers: %s\r\n", cors_cfg.headers);
+        ptr += os_strlen(ptr);
+    }
+    fs_sprintf(ptr, "Access-Control-Max-Age: %d\r\n", cors_cfg.max_age);
+    if (cors_state.preflight_headers)
+        delete[] cors_state.preflight_headers;
+    cors_state.preflight_headers = headers;
+    mem_mon_stack();
+    return true;
+}
+
+static int cors_restore_cfg(void)
+{
+    ALL("cors_restore_cfg");
+
+    int res = cfgstore_restore(CORS_FILENAME, &cors_schema);
+    mem_mon_stack();
+    if (res == CFG_error)
+    {
+        dia_error_evnt(CORS_RESTORE_CFG_ERROR);
+        ERROR("cors_restore_cfg error");
+    }
+    if (res != CFG_ok)
+        return res;
+    // a negative max age is invalid, browsers would ignore it
+    if (cors_cfg.max_age < 0)
+        cors_cfg.max_age = 0;
+    if (!cors_update_headers())
+        return CFG_error;
+    return CFG_ok;
+}
+
+char *cors_cfg_json_stringify(char *dest, int len)
+{
+    char *msg = cfg_json_stringify(&cors_schema, dest, len);
+    if (msg == NULL)
+    {
+        dia_error_evnt(CORS_CFG_STRINGIFY_HEAP_EXHAUSTED, cors_schema_json_len);
+        ERROR("cors_cfg_json_stringify heap exhausted [%d]", cors_schema_json_len);
+    }
+    mem_mon_stack();
+    return msg;
+}
+
+int cors_cfg_save(void)
+{
+    ALL("cors_cfg_save");
+    http_cache_invalidate(f_str("/api/cors/cfg"));
+    if (cfgstore_uptodate(&cors_schema))
+        return CFG_ok;
+    return cfgstore_save();
+}
+
+bool cors_set_cfg(char *origins, char *methods, char *headers, int max_age)
+{
+    ALL("cors_set_cfg");
+    // keep a copy of the current cfg in case the headers cannot be updated
+    char prev_origins[CORS_ORIGINS_LEN];
+    char prev_methods[CORS_METHODS_LEN];
+    char prev_headers[CORS_HEADERS_LEN];
+    int prev_max_age = cors_cfg.max_age;
+    os_strcpy(prev_origins, cors_cfg.origins);
+    os_strcpy(prev_methods, cors_cfg.methods);
+    os_strcpy(prev_headers, cors_cfg.headers);
+
+    os_strncpy(cors_cfg.origins, origins, CORS_ORIGINS_LEN - 1);
+    cors_cfg.origins[CORS_ORIGINS_LEN - 1] = 0;
+    os_strncpy(cors_cfg.methods, methods, CORS_METHODS_LEN - 1);
+    cors_cfg.methods[CORS_METHODS_LEN - 1] = 0;
+    os_strncpy(cors_cfg.headers, headers, CORS_HEADERS_LEN - 1);
+    cors_cfg.headers[CORS_HEADERS_LEN - 1] = 0;
+    // a negative max age is invalid, browsers would ignore it
+    cors_cfg.max_age = (max_age < 0) ? 0 : max_age;
+    if (cors_update_headers())
+    {
+        // the connections origins were checked against the previous policy
+        while (!cors_conns->empty())
+            cors_conns->pop_front();
+        return true;
+    }
+    os_strcpy(cors_cfg.origins, prev_origins);
+    os_strcpy(cors_cfg.methods, prev_methods);
+    os_strcpy(cors_cfg.headers, prev_headers);
+    cors_cfg.max_age = prev_max_age;
+    return false;
+}
+
+static bool cors_any_origin(void)
+{
+    return (os_strcmp(cors_cfg.origins, f_str("*")) == 0);
+}
+
+//
+// looking for origin into the comma separated origins list
+// (spaces around the list items are ignored)
+//
+static bool cors_origin_listed(char *origin)
+{
+    int origin_len = os_strlen(origin);
+    char *item = cors_cfg.origins;
+    while (*item)
+    {
+        while (*item == ' ')
+            item++;
+        char *item_end = (char *)os_strstr(item, f_str(","));
+        if (item_end == NULL)
+            item_end = item + os_strlen(item);
+        int item_len = item_end - item;
+        while ((item_len > 0) && (item[item_len - 1] == ' '))
+            item_len--;
+        if ((item_len == origin_len) && (os_strncmp(item, origin, origin_len) == 0))
+            return true;
+        if (*item_end == 0)
+            break;
+        item = item_end + 1;
+    }
+    return false;
+}
+
+static struct cors_conn *cors_conn_find(struct espconn *p_espconn)
+{
+    struct cors_conn *conn = cors_conns->front();
+    while (conn)
+    {
+        if (conn->p_espconn == p_espconn)
+            return conn;
+        conn = cors_conns->next();
+    }
+    return NULL;
+}
+
+void cors_forget(struct espconn *p_espconn)
+{
+    ALL("cors_forget");
+    // cors_conn_find leaves the list cursor on the found element
+    if (cors_conn_find(p_espconn))
+        cors_conns->remove();
+}
+
+void cors_set_req_origin(struct espconn *p_espconn, char *origin)
+{
+    ALL("cors_set_req_origin");
+    if (cors_any_origin() || (origin == NULL))
+    {
+        cors_forget(p_espconn);
+        return;
+    }
+    if ((os_strlen(origin) >= CORS_ORIGIN_LEN) || !cors_origin_listed(origin))
+    {
+        cors_forget(p_espconn);
+        dia_debug_evnt(CORS_ORIGIN_NOT_ALLOWED);
+        DEBUG("cors origin not allowed %s", origin);
+        return;
+    }
+    struct cors_conn *conn = cors_conn_find(p_espconn);
+    if (conn == NULL)
+    {
+        conn = new struct cors_conn;
+        if (conn == NULL)
+        {
+            dia_error_evnt(CORS_ORIGIN_HEAP_EXHAUSTED, sizeof(struct cors_conn));
+            ERROR("cors_set_req_origin heap exhausted %d", sizeof(struct cors_conn));
+            return;
+        }
+        conn->p_espconn = p_espconn;
+        // when full the oldest connection is dropped
+        if (cors_conns->push_back(conn, override_when_full) != list_ok)
+        {
+            delete conn;
+            return;
+        }
+    }
+    os_strcpy(conn->origin, origin);
+}
+
+char *cors_allowed_origin(struct espconn *p_espconn)
+{
+    if (cors_any_origin())
+        return cors_cfg.origins;
+    struct cors_conn *conn = cors_conn_find(p_espconn);
+    if (conn)
+        return conn->origin;
+    return NULL;
+}
+
+bool cors_vary_origin(void)
+{
+    return !cors_any_origin();
+}
+
+bool cors_echo_req_headers(void)
+{
+    return (os_strcmp(cors_cfg.headers, f_str("*")) == 0);
+}
+
+char *cors_preflight_headers(void)
+{
+    if (cors_state.preflight_headers)
+        return cors_state.preflight_headers;
+    return (char *)"";
+}
+
+void cors_init(void)
+{
+    cors_state.preflight_headers = NULL;
+    cors_conns = new List<struct cors_conn>(CORS_CONNS_MAX, delete_content);
+    cfg_defaults(&cors_schema);
+    if (cors_restore_cfg() != CFG_ok)
+    {
+        // default policy: same as before the CORS cfg was introduced
+        // plus preflight results cached by the browser for 10 minutes
+        cors_set_cfg((char *)f_str("*"),
+                     (char *)f_str("GET,POST,PUT,DELETE,OPTIONS"),
+                     (char *)f_str("*"),
+                     600);
+        dia_warn_evnt(CORS_INIT_DEFAULT_CFG);
+        WARN("cors_init no cfg available");
+    }
+}
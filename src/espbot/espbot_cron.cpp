@@ -14,6 +14,7 @@ extern "C"
 }
 
 #include "espbot_cfgfile.hpp"
+#include "espbot_cfgstore.hpp"
 #include "espbot_cron.hpp"
 #include "espbot_diagnostic.hpp"
 #include "espbot_event_codes.h"
@@ -39,11 +40,16 @@ static os_timer_t cron_timer;
 static List<struct job> *job_list;
 
 
-static struct
+static struct cron_config
 {
     bool enabled;
 } cron_cfg;
 
+#define CRON_CFG_FIELDS(FIELD, type) \
+    FIELD(type, enabled, "cron_enabled", CFG_bool, 0)
+
+CFG_SCHEMA(cron_schema, struct cron_config, cron_cfg, CRON_CFG_FIELDS);
+
 static struct
 {
     bool running;
@@ -225,7 +231,7 @@ static int cron_restore_cfg(void);
 
 void cron_init(void)
 {
-    cron_cfg.enabled = false;
+    cfg_defaults(&cron_schema);
     cron_state.running = false;
     if (cron_restore_cfg() != CFG_ok)
     {
@@ -456,72 +462,24 @@ static int cron_restore_cfg(void)
 {
     ALL("cron_restore_cfg");
 
-    if (!Espfile::exists(CRON_FILENAME))
-        return CFG_cantRestore;
-    Cfgfile cfgfile(CRON_FILENAME);
-    int enabled = cfgfile.getInt(f_str("cron_enabled"));
-    if (cfgfile.getErr() != JSON_noerr)
+    int res = cfgstore_restore(CRON_FILENAME, &cron_schema);
+    mem_mon_stack();
+    if (res == CFG_error)
     {
         dia_error_evnt(CRON_RESTORE_CFG_ERROR);
         ERROR("cron_restore_cfg error");
-        return CFG_error;
     }
-    cron_cfg.enabled = (bool)enabled;
-    mem_mon_stack();
-    return CFG_ok;
-}
-
-static int cron_saved_cfg_updated(void)
-{
-    ALL("cron_saved_cfg_updated");
-    if (!Espfile::exists(CRON_FILENAME))
-    {
-        return CFG_notUpdated;
-    }
-    Cfgfile cfgfile(CRON_FILENAME);
-    int enabled = cfgfile.getInt(f_str("cron_enabled"));
-    mem_mon_stack();
-    if (cfgfile.getErr() != JSON_noerr)
-    {
-        // no need to raise an error, the cfg file will be overwritten
-        // dia_error_evnt(CRON_SAVED_CFG_UPDATED_ERROR);
-        // ERROR("cron_saved_cfg_updated error");
-        return CFG_error;
-    }
-    if (cron_cfg.enabled != (bool)enabled)
-    {
-        return CFG_notUpdated;
-    }
-    return CFG_ok;
+    return res;
 }
 
 char *cron_cfg_json_stringify(char *dest, int len)
 {
-    // {"cron_enabled":0}
-    int msg_len = 18 + 1;
-    char *msg;
-    if (dest == NULL)
+    char *msg = cfg_json_stringify(&cron_schema, dest, len);
+    if (msg == NULL)
     {
-        msg = new char[msg_len];
-        if (msg == NULL)
-        {
-            dia_error_evnt(CRON_CFG_STRINGIFY_HEAP_EXHAUSTED, msg_len);
-            ERROR("cron_cfg_json_stringify heap exhausted [%d]", msg_len);
-            return NULL;
-        }
+        dia_error_evnt(CRON_CFG_STRINGIFY_HEAP_EXHAUSTED, cron_schema_json_len);
+        ERROR("cron_cfg_json_stringify heap exhausted [%d]", cron_schema_json_len);
     }
-    else
-    {
-        msg = dest;
-        if (len < msg_len)
-        {
-            *msg = 0;
-            return msg;
-        }
-    }
-    fs_sprintf(msg,
-               "{\"cron_enabled\":%d}",
-               cron_cfg.enabled);
     mem_mon_stack();
     return msg;
 }
@@ -529,16 +487,7 @@ char *cron_cfg_json_stringify(char *dest, int len)
 int cron_cfg_save(void)
 {
     ALL("cron_cfg_save");
-    if (cron_saved_cfg_updated() == CFG_ok)
+    if (cfgstore_uptodate(&cron_schema))
         return CFG_ok;
-    Cfgfile cfgfile(CRON_FILENAME);
-    if (cfgfile.clear() != SPIFFS_OK)
-        return CFG_error;
-    char str[19];
-    cron_cfg_json_stringify(str, 19);
-    int res = cfgfile.n_append(str, os_strlen(str));
-    if (res < SPIFFS_OK)
-        return CFG_error;
-    mem_mon_stack();
-    return CFG_ok;
+    return cfgstore_save();
 }
\ No newline at end of file
@@ -18,8 +18,10 @@ extern "C"
 
 #include "espbot.hpp"
 #include "espbot_cfgfile.hpp"
+#include "espbot_cfgstore.hpp"
 #include "espbot_diagnostic.hpp"
 #include "espbot_event_codes.h"
+#include "espbot_http_cache.hpp"
 #include "espbot_mem_mon.hpp"
 #include "espbot_gpio.hpp"
 #include "espbot_profiler.hpp"
@@ -32,7 +34,7 @@ static struct
     int last;
 } dia_event_queue;
 
-static struct
+static struct dia_config
 {
     uint32 uart_0_bitrate;
     bool sdk_print_enabled;
@@ -47,6 +49,18 @@ static struct
     char serial_log_mask;
 } dia_cfg;
 
+#define DIA_SERIAL_LOG_DEFAULT (EVNT_TRACE | EVNT_DEBUG | EVNT_INFO | EVNT_WARN | EVNT_ERROR | EVNT_FATAL)
+
+// according to the startup sequence
+// File System errors won't be reported on the LED yet (DIAG_LED_DISABLED)
+#define DIA_CFG_FIELDS(FIELD, type)                                                   \
+    FIELD(type, led_mask, "diag_led_mask", CFG_uint, DIAG_LED_DISABLED)               \
+    FIELD(type, serial_log_mask, "serial_log_mask", CFG_uint, DIA_SERIAL_LOG_DEFAULT) \
+    FIELD(type, uart_0_bitrate, "uart_0_bitrate", CFG_uint, BIT_RATE_74880)           \
+    FIELD(type, sdk_print_enabled, "sdk_print_enabled", CFG_bool, 1)
+
+CFG_SCHEMA(dia_schema, struct dia_config, dia_cfg, DIA_CFG_FIELDS);
+
 bool diag_log_err_type(int type)
 {
     return (dia_cfg.serial_log_mask & type);
@@ -233,36 +247,12 @@ void dia_set_sdk_print_enabled(bool val)
 
 char *dia_cfg_json_stringify(char *dest, int len)
 {
-    // "{"diag_led_mask":256,"serial_log_mask":256,"uart_0_bitrate":3686400,"sdk_print_enabled":1}"
-    int msg_len = 90 + 1;
-    char *msg;
-    if (dest == NULL)
-    {
-        msg = new char[msg_len];
-        if (msg == NULL)
-        {
-            dia_error_evnt(DIAG_CFG_STRINGIFY_HEAP_EXHAUSTED, msg_len);
-            ERROR("cron_state_json_stringify heap exhausted [%d]", msg_len);
-            return NULL;
-        }
-    }
-    else
+    char *msg = cfg_json_stringify(&dia_schema, dest, len);
+    if (msg == NULL)
     {
-        msg = dest;
-        if (len < msg_len)
-        {
-            *msg = 0;
-            return msg;
-        }
+        dia_error_evnt(DIAG_CFG_STRINGIFY_HEAP_EXHAUSTED, dia_schema_json_len);
+        ERROR("dia_cfg_json_stringify heap exhausted [%d]", dia_schema_json_len);
     }
-    fs_sprintf(msg,
-               "{\"diag_led_mask\":%d,\"serial_log_mask\":%d,",
-               dia_cfg.led_mask,
-               dia_cfg.serial_log_mask);
-    fs_sprintf(msg + os_strlen(msg),
-               "\"uart_0_bitrate\":%d,\"sdk_print_enabled\":%d}",
-               dia_cfg.uart_0_bitrate,
-               dia_cfg.sdk_print_enabled);
     mem_mon_stack();
     return msg;
 }
@@ -272,80 +262,30 @@ char *dia_cfg_json_stringify(char *dest, int len)
 int dia_restore_cfg(void)
 {
     ALL("dia_restore_cfg");
-    if (!Espfile::exists(DIAG_FILENAME))
-        return CFG_cantRestore;
-    Cfgfile cfgfile(DIAG_FILENAME);
-    int uart_0_bitrate = cfgfile.getInt(f_str("uart_0_bitrate"));
-    int sdk_print_enabled = cfgfile.getInt(f_str("sdk_print_enabled"));
-    int led_mask = cfgfile.getInt(f_str("diag_led_mask"));
-    int serial_log_mask = cfgfile.getInt(f_str("serial_log_mask"));
-    if (cfgfile.getErr() != JSON_noerr)
+    int res = cfgstore_restore(DIAG_FILENAME, &dia_schema);
+    mem_mon_stack();
+    if (res == CFG_error)
     {
         dia_error_evnt(DIAG_RESTORE_CFG_ERROR);
         ERROR("dia_restore_cfg error");
-        return CFG_error;
     }
-    dia_cfg.uart_0_bitrate = (uint32)uart_0_bitrate;
-    dia_cfg.sdk_print_enabled = (bool)sdk_print_enabled;
-    dia_cfg.led_mask = (char)led_mask;
-    dia_cfg.serial_log_mask = (char)serial_log_mask;
-    mem_mon_stack();
-    return CFG_ok;
-}
-
-static int dia_saved_cfg_updated(void)
-{
-    ALL("dia_saved_cfg_updated");
-    if (!Espfile::exists(DIAG_FILENAME))
-    {
-        return CFG_notUpdated;
-    }
-    Cfgfile cfgfile(DIAG_FILENAME);
-    int uart_0_bitrate = cfgfile.getInt(f_str("uart_0_bitrate"));
-    int sdk_print_enabled = cfgfile.getInt(f_str("sdk_print_enabled"));
-    int led_mask = cfgfile.getInt(f_str("diag_led_mask"));
-    int serial_log_mask = cfgfile.getInt(f_str("serial_log_mask"));
-    if (cfgfile.getErr() != JSON_noerr)
-    {
-        // no need to raise an error, the cfg file will be overwritten
-        // dia_error_evnt(DIAG_SAVED_CFG_UPDATED_ERROR);
-        // ERROR("dia_saved_cfg_updated error");
-        return CFG_error;
-    }
-    if ((dia_cfg.uart_0_bitrate != (uint32)uart_0_bitrate) ||
-        (dia_cfg.sdk_print_enabled != (bool)sdk_print_enabled) ||
-        (dia_cfg.led_mask != (char)led_mask) ||
-        (dia_cfg.serial_log_mask != (char)serial_log_mask))
-    {
-        return CFG_notUpdated;
-    }
-    mem_mon_stack();
-    return CFG_ok;
+    return res;
 }
 
 int dia_cfg_save(void)
 {
     ALL("dia_cfg_save");
-    if (dia_saved_cfg_updated() == CFG_ok)
+    http_cache_invalidate(f_str("/api/diagnostic/cfg"));
+    if (cfgstore_uptodate(&dia_schema))
         return CFG_ok;
-    Cfgfile cfgfile(DIAG_FILENAME);
-    mem_mon_stack();
-    if (cfgfile.clear() != SPIFFS_OK)
-        return CFG_error;
-    char str[91];
-    dia_cfg_json_stringify(str, 91);
-    int res = cfgfile.n_append(str, os_strlen(str));
-    if (res < SPIFFS_OK)
-        return CFG_error;
-    return CFG_ok;
+    return cfgstore_save();
 }
 
 void dia_init_essential(void)
 {
     int idx;
     // default cfg first
-    dia_cfg.uart_0_bitrate = BIT_RATE_74880;
-    dia_cfg.sdk_print_enabled = 1;
+    cfg_defaults(&dia_schema);
     for (idx = 0; idx < EVNT_QUEUE_SIZE; idx++)
     {
         dia_event_queue.evnt[idx].timestamp = 0;
@@ -355,10 +295,6 @@ void dia_init_essential(void)
         dia_event_queue.evnt[idx].value = 0;
     }
     dia_event_queue.last = EVNT_QUEUE_SIZE - 1;
-    // according to the startup sequence
-    // File System errors won't be reported on the LED yet
-    dia_cfg.led_mask = DIAG_LED_DISABLED;
-    dia_cfg.serial_log_mask = EVNT_TRACE | EVNT_DEBUG | EVNT_INFO | EVNT_WARN | EVNT_ERROR | EVNT_FATAL;
 }
 
 void dia_init_custom(void)
@@ -0,0 +1,267 @@
+/*
+ * ----------------------------------------------------------------------------
+ * "THE BEER-WARE LICENSE" (Revision 42):
+ * <quackmore-ff@yahoo.com> wrote this file.  As long as you retain this notice
+ * you can do whatever you want with this stuff. If we meet some day, and you 
+ * think this stuff is worth it, you can buy me a beer in return. Quackmore
+ * ----------------------------------------------------------------------------
+ */
+
+// SDK includes
+extern "C"
+{
+#include "c_types.h"
+#include "espconn.h"
+#include "ip_addr.h"
+#include "mem.h"
+#include "osapi.h"
+#include "user_interface.h"
+}
+
+#include "espbot.hpp"
+#include "espbot_diagnostic.hpp"
+#include "espbot_dns.hpp"
+#include "espbot_event_codes.h"
+#include "espbot_list.hpp"
+#include "espbot_mem_mon.hpp"
+#include "espbot_utils.hpp"
+
+struct dns_cache_entry
+{
+    char name[DNS_NAME_LEN];
+    struct ip_addr ip;
+    uint32 resolved_at; // system_get_time
+};
+
+// espconn_gethostbyname passes the espconn back to the found callback
+// so it must be the first member
+struct dns_lookup
+{
+    struct espconn conn;
+    struct ip_addr ip;
+    char name[DNS_NAME_LEN];
+    void (*found_func)(void *, struct ip_addr *); // NULL when cancelled
+    void *param;
+};
+
+static List<struct dns_cache_entry> *dns_cache;
+static List<struct dns_lookup> *dns_lookups;
+static os_timer_t dns_sweep_timer;
+
+//
+// the SDK does not report the record TTL (lwIP keeps its own cache respecting it)
+// so an entry is reused for DNS_CACHE_TTL at most
+// the sweep keeps the entries age below the system_get_time wrap around (~71 minutes)
+//
+static bool dns_cache_expired(struct dns_cache_entry *entry)
+{
+    return ((system_get_time() - entry->resolved_at) > (DNS_CACHE_TTL * 1000000U));
+}
+
+static void dns_cache_sweep(void *arg)
+{
+    ALL("dns_cache_sweep");
+    struct dns_cache_entry *entry = dns_cache->front();
+    while (entry)
+    {
+        if (dns_cache_expired(entry))
+        {
+            TRACE("dns_cache_sweep %s expired", entry->name);
+            dns_cache->remove();
+            // remove leaves the cursor dangling, restart from the front
+            entry = dns_cache->front();
+            continue;
+        }
+        entry = dns_cache->next();
+    }
+    if (dns_cache->empty())
+        os_timer_disarm(&dns_sweep_timer);
+}
+
+static struct dns_cache_entry *dns_cache_find(char *host)
+{
+    struct dns_cache_entry *entry = dns_cache->front();
+    while (entry)
+    {
+        if (os_strcmp(entry->name, host) == 0)
+            return entry;
+        entry = dns_cache->next();
+    }
+    return NULL;
+}
+
+static void dns_cache_put(char *host, struct ip_addr *ip)
+{
+    ALL("dns_cache_put");
+    struct dns_cache_entry *entry = dns_cache_find(host);
+    if (entry == NULL)
+    {
+        entry = new struct dns_cache_entry;
+        if (entry == NULL)
+        {
+            dia_error_evnt(DNS_HEAP_EXHAUSTED, sizeof(struct dns_cache_entry));
+            ERROR("dns_cache_put heap exhausted %d", sizeof(struct dns_cache_entry));
+            return;
+        }
+        os_strcpy(entry->name, host);
+        // when full the oldest entry is dropped
+        if (dns_cache->push_back(entry, override_when_full) != list_ok)
+        {
+            delete entry;
+            return;
+        }
+        if (dns_cache->size() == 1)
+        {
+            os_timer_disarm(&dns_sweep_timer);
+            os_timer_arm(&dns_sweep_timer, (DNS_CACHE_SWEEP * 1000), 1);
+        }
+    }
+    entry->ip.addr = ip->addr;
+    entry->resolved_at = system_get_time();
+}
+
+// dotted IP addresses need no lookup
+static bool dns_dotted_ip(char *host, struct ip_addr *ip)
+{
+    int dots = 0;
+    char *ptr;
+    for (ptr = host; *ptr; ptr++)
+    {
+        if (*ptr == '.')
+            dots++;
+        else if ((*ptr < '0') || (*ptr > '9'))
+            return false;
+    }
+    if (dots != 3)
+        return false;
+    atoipaddr(ip, host);
+    return true;
+}
+
+bool dns_cache_lookup(char *host, struct ip_addr *ip)
+{
+    if (dns_dotted_ip(host, ip))
+        return true;
+    struct dns_cache_entry *entry = dns_cache_find(host);
+    if ((entry == NULL) || dns_cache_expired(entry))
+        return false;
+    ip->addr = entry->ip.addr;
+    return true;
+}
+
+void dns_cache_forget(char *host)
+{
+    ALL("dns_cache_forget");
+    if (dns_cache_find(host))
+        dns_cache->remove();
+}
+
+static struct dns_lookup *dns_lookup_find(struct dns_lookup *lookup)
+{
+    struct dns_lookup *ptr = dns_lookups->front();
+    while (ptr)
+    {
+        if (ptr == lookup)
+            return ptr;
+        ptr = dns_lookups->next();
+    }
+    return NULL;
+}
+
+static void dns_found(const char *name, ip_addr_t *ipaddr, void *arg)
+{
+    ALL("dns_found");
+    struct dns_lookup *lookup = dns_lookup_find((struct dns_lookup *)arg);
+    if (lookup == NULL)
+        return;
+    // the list cursor points to the lookup
+    dns_lookups->remove();
+    if (ipaddr)
+    {
+        DEBUG("dns_found %s -> %d.%d.%d.%d",
+              lookup->name,
+              ((uint8 *)&ipaddr->addr)[0],
+              ((uint8 *)&ipaddr->addr)[1],
+              ((uint8 *)&ipaddr->addr)[2],
+              ((uint8 *)&ipaddr->addr)[3]);
+        dns_cache_put(lookup->name, ipaddr);
+    }
+    else
+    {
+        dia_warn_evnt(DNS_NOT_FOUND);
+        WARN("dns_found cannot resolve %s", lookup->name);
+    }
+    if (lookup->found_func)
+        lookup->found_func(lookup->param, ipaddr);
+    delete lookup;
+    mem_mon_stack();
+}
+
+int dns_resolve(char *host, struct ip_addr *ip, void (*found_func)(void *, struct ip_addr *), void *param)
+{
+    ALL("dns_resolve");
+    if (dns_cache_lookup(host, ip))
+        return DNS_resolved;
+    if (os_strlen(host) >= DNS_NAME_LEN)
+    {
+        dia_error_evnt(DNS_NAME_TOO_LONG, os_strlen(host));
+        ERROR("dns_resolve name too long %d", os_strlen(host));
+        return DNS_error;
+    }
+    if (dns_lookups->full())
+    {
+        dia_error_evnt(DNS_TOO_MANY_LOOKUPS);
+        ERROR("dns_resolve too many lookups");
+        return DNS_error;
+    }
+    struct dns_lookup *lookup = new struct dns_lookup;
+    if (lookup == NULL)
+    {
+        dia_error_evnt(DNS_HEAP_EXHAUSTED, sizeof(struct dns_lookup));
+        ERROR("dns_resolve heap exhausted %d", sizeof(struct dns_lookup));
+        return DNS_error;
+    }
+    os_strcpy(lookup->name, host);
+    lookup->found_func = found_func;
+    lookup->param = param;
+    sint8 res = espconn_gethostbyname(&lookup->conn, lookup->name, &lookup->ip, dns_found);
+    mem_mon_stack();
+    if (res == ESPCONN_OK)
+    {
+        // found into the lwIP cache
+        dns_cache_put(lookup->name, &lookup->ip);
+        ip->addr = lookup->ip.addr;
+        delete lookup;
+        return DNS_resolved;
+    }
+    if (res != ESPCONN_INPROGRESS)
+    {
+        dia_error_evnt(DNS_LOOKUP_ERROR, res);
+        ERROR("dns_resolve lookup error %d", res);
+        delete lookup;
+        return DNS_error;
+    }
+    dns_lookups->push_back(lookup);
+    TRACE("dns_resolve looking up %s", host);
+    return DNS_in_progress;
+}
+
+void dns_cancel(void *param)
+{
+    // the lookups are kept until lwIP calls back
+    struct dns_lookup *lookup = dns_lookups->front();
+    while (lookup)
+    {
+        if (lookup->param == param)
+            lookup->found_func = NULL;
+        lookup = dns_lookups->next();
+    }
+}
+
+void dns_init(void)
+{
+    dns_cache = new List<struct dns_cache_entry>(DNS_CACHE_MAX, delete_content);
+    dns_lookups = new List<struct dns_lookup>(DNS_LOOKUPS_MAX, dont_delete_content);
+    os_timer_disarm(&dns_sweep_timer);
+    os_timer_setfn(&dns_sweep_timer, (os_timer_func_t *)dns_cache_sweep, NULL);
+}
@@ -21,189 +21,207 @@ extern "C"
 #include "espbot_mem_mon.hpp"
 #include "espbot_spiffs.hpp"
 
+// word aligned buffer for unaligned flash addresses and RAM buffers
+// (spi_flash_read and spi_flash_write work on 32 bit words)
+#define FLASH_BUFFER_LEN 64
+static uint32 flash_buffer[FLASH_BUFFER_LEN / 4];
+
+static struct flash_stats stats;
+
+struct flash_stats *esp_spiffs_flash_stats(void)
+{
+    return &stats;
+}
+
+void esp_spiffs_flash_stats_reset(void)
+{
+    os_memset(&stats, 0, sizeof(stats));
+}
+
+static s32_t flash_read(u32_t addr, uint32 *dst, u32_t len)
+{
+    uint32 start = system_get_time();
+    SpiFlashOpResult res = spi_flash_read(addr, dst, len);
+    uint32 elapsed = system_get_time() - start;
+    stats.read_ops++;
+    stats.read_bytes += len;
+    stats.read_us += elapsed;
+    if (elapsed > stats.read_max_us)
+        stats.read_max_us = elapsed;
+    system_soft_wdt_feed();
+    if (res == SPI_FLASH_RESULT_ERR)
+    {
+        dia_error_evnt(SPIFFS_FLASH_READ_ERROR, addr);
+        ERROR("Error reading flash from %X for %d bytes", addr, len);
+        return SPIFFS_FLASH_RESULT_ERR;
+    }
+    if (res == SPI_FLASH_RESULT_TIMEOUT)
+    {
+        dia_error_evnt(SPIFFS_FLASH_READ_TIMEOUT, addr);
+        ERROR("Timeout reading flash from %X for %d bytes", addr, len);
+        return SPIFFS_FLASH_RESULT_TIMEOUT;
+    }
+    return SPIFFS_OK;
+}
+
 // flash read function (checkout SPIFFS documentation)
+// only the requested words are read
 s32_t esp_spiffs_read(u32_t t_addr, u32_t t_size, u8_t *t_dst)
 {
     // TRACE("spiffs read called --------------------------------------");
-    SpiFlashOpResult res;
-    // find aligned start address
-    u32_t start_addr = (t_addr / FS_ALIGN_BYTES) * FS_ALIGN_BYTES;
-    // and how many bytes are required by alignment
-    int align_bytes = t_addr % FS_ALIGN_BYTES;
+    s32_t res;
     mem_mon_stack();
 
     // boundary checks
-    if ((start_addr < FS_START) || (start_addr >= FS_END) ||
-        (start_addr + ((t_size / FS_ALIGN_BYTES) * FS_ALIGN_BYTES) > FS_END))
+    if ((t_addr < FS_START) || (t_addr >= FS_END) || ((t_addr + t_size) > FS_END))
     {
         dia_error_evnt(SPIFFS_FLASH_READ_OUT_OF_BOUNDARY, t_addr);
         ERROR("Flash file system boundary error, reading from address: %X, size: %d", t_addr, t_size);
         return SPIFFS_FLASH_BOUNDARY_ERROR;
     }
 
-    // let's use aligned ram variables
-    // warning: using stack instead of heap will produce hallucinations
-    uint32 buffer_space = (uint32)espbot_zalloc(LOG_PAGE_SIZE + FS_ALIGN_BYTES);
-    uint32 *buffer = (uint32 *)(((buffer_space + FS_ALIGN_BYTES) / FS_ALIGN_BYTES) * FS_ALIGN_BYTES);
+    // the words holding a short span (e.g. SPIFFS headers and lookup entries)
+    // are read at once into the buffer
+    u32_t align_bytes = t_addr % FS_ALIGN_BYTES;
+    if ((align_bytes + t_size) <= FLASH_BUFFER_LEN)
+    {
+        res = flash_read((t_addr - align_bytes), flash_buffer,
+                         (((align_bytes + t_size + FS_ALIGN_BYTES - 1) / FS_ALIGN_BYTES) * FS_ALIGN_BYTES));
+        if (res != SPIFFS_OK)
+            return res;
+        os_memcpy(t_dst, ((u8_t *)flash_buffer + align_bytes), t_size);
+        return SPIFFS_OK;
+    }
+
+    // unaligned start address: the first word is read into the buffer
+    if (align_bytes > 0)
+    {
+        u32_t len = FS_ALIGN_BYTES - align_bytes;
+        res = flash_read((t_addr - align_bytes), flash_buffer, FS_ALIGN_BYTES);
+        if (res != SPIFFS_OK)
+            return res;
+        os_memcpy(t_dst, ((u8_t *)flash_buffer + align_bytes), len);
+        t_addr += len;
+        t_dst += len;
+        t_size -= len;
+    }
 
+    // whole words with an aligned destination: no copy
+    u32_t words_len = t_size - (t_size % FS_ALIGN_BYTES);
+    if ((words_len > 0) && (((size_t)t_dst % FS_ALIGN_BYTES) == 0))
+    {
+        res = flash_read(t_addr, (uint32 *)t_dst, words_len);
+        if (res != SPIFFS_OK)
+            return res;
+        t_addr += words_len;
+        t_dst += words_len;
+        t_size -= words_len;
+    }
+
+    // unaligned destination and the last bytes: through the buffer
     while (t_size > 0)
     {
-        // TRACE("bytes to be read %d, unaligned addr %X, aligned addr %X, align bytes %d",
-        //         t_size, t_addr, start_addr, align_bytes);
-        // read F_BUF_SIZE bytes from flash
-        res = spi_flash_read(start_addr, buffer, LOG_PAGE_SIZE);
-        system_soft_wdt_feed();
-        if (res == SPI_FLASH_RESULT_ERR)
-        {
-            dia_error_evnt(SPIFFS_FLASH_READ_ERROR, start_addr);
-            ERROR("Error reading flash from %X for %d bytes", start_addr, LOG_PAGE_SIZE);
-            espbot_free((void *)buffer_space);
-            return SPIFFS_FLASH_RESULT_ERR;
-        }
-        if (res == SPI_FLASH_RESULT_TIMEOUT)
-        {
-            dia_error_evnt(SPIFFS_FLASH_READ_TIMEOUT, start_addr);
-            ERROR("Timeout reading flash from %X for %d bytes", start_addr, LOG_PAGE_SIZE);
-            espbot_free((void *)buffer_space);
-            return SPIFFS_FLASH_RESULT_TIMEOUT;
-        }
+        u32_t len = (t_size < FLASH_BUFFER_LEN) ? t_size : FLASH_BUFFER_LEN;
+        res = flash_read(t_addr, flash_buffer, (((len + FS_ALIGN_BYTES - 1) / FS_ALIGN_BYTES) * FS_ALIGN_BYTES));
+        if (res != SPIFFS_OK)
+            return res;
+        os_memcpy(t_dst, flash_buffer, len);
+        t_addr += len;
+        t_dst += len;
+        t_size -= len;
+    }
+    return SPIFFS_OK;
+}
 
-        // check if must read again from flash
-        if (t_size > (LOG_PAGE_SIZE - align_bytes))
-        {
-            // discard initial bytes required by alignment (if any)
-            // and copy to destination
-            // TRACE("copying %d bytes from %X to bytes to %X",
-            //         (LOG_PAGE_SIZE - align_bytes), buffer + align_bytes, t_dst);
-            os_memcpy(t_dst, buffer + align_bytes, (LOG_PAGE_SIZE - align_bytes));
-            t_dst += (LOG_PAGE_SIZE - align_bytes);
-            t_size -= (LOG_PAGE_SIZE - align_bytes);
-            start_addr += (LOG_PAGE_SIZE);
-            align_bytes = 0;
-        }
-        else
-        {
-            // just copy required bytes
-            // TRACE("copying %d bytes from %X to bytes to %X",
-            //         t_size, buffer + align_bytes, t_dst);
-            os_memcpy(t_dst, buffer + align_bytes, t_size);
-            t_size = 0;
-        }
+static s32_t flash_write(u32_t addr, uint32 *src, u32_t len)
+{
+    uint32 start = system_get_time();
+    SpiFlashOpResult res = spi_flash_write(addr, src, len);
+    uint32 elapsed = system_get_time() - start;
+    stats.write_ops++;
+    stats.write_bytes += len;
+    stats.write_us += elapsed;
+    if (elapsed > stats.write_max_us)
+        stats.write_max_us = elapsed;
+    system_soft_wdt_feed();
+    if (res == SPI_FLASH_RESULT_ERR)
+    {
+        dia_error_evnt(SPIFFS_FLASH_WRITE_WRITE_ERROR, addr);
+        ERROR("Error writing flash from %X for %d bytes", addr, len);
+        return SPIFFS_FLASH_RESULT_ERR;
+    }
+    if (res == SPI_FLASH_RESULT_TIMEOUT)
+    {
+        dia_error_evnt(SPIFFS_FLASH_WRITE_WRITE_TIMEOUT, addr);
+        ERROR("Timeout writing flash from %X for %d bytes", addr, len);
+        return SPIFFS_FLASH_RESULT_TIMEOUT;
     }
-    espbot_free((void *)buffer_space);
     return SPIFFS_OK;
 }
 
 // flash write function (checkout SPIFFS documentation)
+// only the words holding the bytes are written, with no read:
+// flash writes can only clear bits, so the other bytes of the first
+// and last words are written as 0xFF and left as they are
 s32_t esp_spiffs_write(u32_t t_addr, u32_t t_size, u8_t *t_src)
 {
     // TRACE("spiffs write called -------------------------------------");
-    SpiFlashOpResult res;
-    // find aligned start address
-    u32_t start_addr = (t_addr / FS_ALIGN_BYTES) * FS_ALIGN_BYTES;
-    // and how many bytes are required by alignment
-    u8_t align_bytes = t_addr % FS_ALIGN_BYTES;
+    s32_t res;
+    mem_mon_stack();
 
     // boundary checks
-    if ((start_addr < FS_START) || (start_addr >= FS_END) ||
-        (start_addr + ((t_size / FS_ALIGN_BYTES) * FS_ALIGN_BYTES) > FS_END))
+    if ((t_addr < FS_START) || (t_addr >= FS_END) || ((t_addr + t_size) > FS_END))
     {
         dia_error_evnt(SPIFFS_FLASH_WRITE_OUT_OF_BOUNDARY, t_addr);
         ERROR("Flash file system boundary error, writing to address: %X, size: %d", t_addr, t_size);
         return SPIFFS_FLASH_BOUNDARY_ERROR;
     }
 
-    // let's use aligned ram variable
-    // warning: using stack instead of heap will produce hallucinations
-    uint32 buffer_space = (uint32)espbot_zalloc(LOG_PAGE_SIZE + FS_ALIGN_BYTES);
-    uint32 *buffer = (uint32 *)(((buffer_space + FS_ALIGN_BYTES) / FS_ALIGN_BYTES) * FS_ALIGN_BYTES);
-    mem_mon_stack();
-
-    while (t_size > 0)
+    // unaligned start address: the first buffer (up to the whole span when short)
+    u32_t align_bytes = t_addr % FS_ALIGN_BYTES;
+    if (align_bytes > 0)
     {
-        // TRACE("bytes to be written %d, unaligned addr %X, aligned addr %X, align bytes %d",
-        //         t_size, t_addr, start_addr, align_bytes);
-        // read LOG_PAGE_SIZE bytes from flash into buffer
-        res = spi_flash_read(start_addr, (uint32 *)buffer, LOG_PAGE_SIZE);
-        system_soft_wdt_feed();
-        if (res == SPI_FLASH_RESULT_ERR)
-        {
-            dia_error_evnt(SPIFFS_FLASH_WRITE_READ_ERROR, start_addr);
-            ERROR("Error reading flash from %X for %d bytes", start_addr, LOG_PAGE_SIZE);
-            espbot_free((void *)buffer_space);
-            return SPIFFS_FLASH_RESULT_ERR;
-        }
-        if (res == SPI_FLASH_RESULT_TIMEOUT)
-        {
-            dia_error_evnt(SPIFFS_FLASH_WRITE_READ_TIMEOUT, start_addr);
-            ERROR("Timeout reading flash from %X for %d bytes", start_addr, LOG_PAGE_SIZE);
-            espbot_free((void *)buffer_space);
-            return SPIFFS_FLASH_RESULT_TIMEOUT;
-        }
-
-        if (t_size > (LOG_PAGE_SIZE - align_bytes))
-        {
-            // discard initial bytes required by alignment (if any)
-            // and copy source data to buffer
-            // TRACE("copying %d bytes from %X to bytes to %X",
-            //         LOG_PAGE_SIZE - align_bytes, t_src, (u8_t *)buffer + align_bytes);
-            os_memcpy((u8_t *)buffer + align_bytes, t_src, LOG_PAGE_SIZE - align_bytes);
-            // and write buffer to flash
-            // TRACE("writing %d bytes to flash %X from %X",
-            //         LOG_PAGE_SIZE, start_addr, buffer);
-            res = spi_flash_write(start_addr, (uint32 *)buffer, LOG_PAGE_SIZE);
-            system_soft_wdt_feed();
-
-            if (res == SPI_FLASH_RESULT_ERR)
-            {
-                dia_error_evnt(SPIFFS_FLASH_WRITE_WRITE_ERROR, start_addr);
-                ERROR("Error writing flash from %X for %d bytes", start_addr, LOG_PAGE_SIZE);
-                espbot_free((void *)buffer_space);
-                return SPIFFS_FLASH_RESULT_ERR;
-            }
-            if (res == SPI_FLASH_RESULT_TIMEOUT)
-            {
-                dia_error_evnt(SPIFFS_FLASH_WRITE_WRITE_TIMEOUT, start_addr);
-                ERROR("Timeout writing flash from %X for %d bytes", start_addr, LOG_PAGE_SIZE);
-                espbot_free((void *)buffer_space);
-                return SPIFFS_FLASH_RESULT_TIMEOUT;
-            }
+        u32_t len = FLASH_BUFFER_LEN - align_bytes;
+        if (len > t_size)
+            len = t_size;
+        u32_t words_len = ((align_bytes + len + FS_ALIGN_BYTES - 1) / FS_ALIGN_BYTES) * FS_ALIGN_BYTES;
+        flash_buffer[0] = 0xFFFFFFFF;
+        flash_buffer[(words_len / FS_ALIGN_BYTES) - 1] = 0xFFFFFFFF;
+        os_memcpy(((u8_t *)flash_buffer + align_bytes), t_src, len);
+        res = flash_write((t_addr - align_bytes), flash_buffer, words_len);
+        if (res != SPIFFS_OK)
+            return res;
+        t_addr += len;
+        t_src += len;
+        t_size -= len;
+    }
 
-            t_src += (LOG_PAGE_SIZE - align_bytes);
-            t_size -= (LOG_PAGE_SIZE - align_bytes);
-            start_addr += (LOG_PAGE_SIZE);
-            align_bytes = 0;
-        }
-        else
-        {
-            // just copy required bytes to buffer
-            // TRACE("copying %d bytes from %X to bytes to %X",
-            //         t_size, t_src, (u8_t *)buffer + align_bytes);
-            os_memcpy((u8_t *)buffer + align_bytes, t_src, t_size);
-            // and write buffer to flash
-            // TRACE("writing %d bytes to flash %X from %X",
-            //         LOG_PAGE_SIZE, start_addr, buffer);
-            res = spi_flash_write(start_addr, (uint32 *)buffer, LOG_PAGE_SIZE);
-            system_soft_wdt_feed();
+    // whole words from an aligned source: no copy
+    u32_t words_len = t_size - (t_size % FS_ALIGN_BYTES);
+    if ((words_len > 0) && (((size_t)t_src % FS_ALIGN_BYTES) == 0))
+    {
+        res = flash_write(t_addr, (uint32 *)t_src, words_len);
+        if (res != SPIFFS_OK)
+            return res;
+        t_addr += words_len;
+        t_src += words_len;
+        t_size -= words_len;
+    }
 
-            if (res == SPI_FLASH_RESULT_ERR)
-            {
-                dia_error_evnt(SPIFFS_FLASH_WRITE_WRITE_ERROR, start_addr);
-                ERROR("Error writing flash from %X for %d bytes", start_addr, LOG_PAGE_SIZE);
-                espbot_free((void *)buffer_space);
-                return SPIFFS_FLASH_RESULT_ERR;
-            }
-            if (res == SPI_FLASH_RESULT_TIMEOUT)
-            {
-                dia_error_evnt(SPIFFS_FLASH_WRITE_WRITE_TIMEOUT, start_addr);
-                ERROR("Timeout writing flash from %X for %d bytes", start_addr, LOG_PAGE_SIZE);
-                espbot_free((void *)buffer_space);
-                return SPIFFS_FLASH_RESULT_TIMEOUT;
-            }
-            t_size = 0;
-        }
+    // unaligned source and the last bytes: through the buffer
+    while (t_size > 0)
+    {
+        u32_t len = (t_size < FLASH_BUFFER_LEN) ? t_size : FLASH_BUFFER_LEN;
+        words_len = ((len + FS_ALIGN_BYTES - 1) / FS_ALIGN_BYTES) * FS_ALIGN_BYTES;
+        flash_buffer[(words_len / FS_ALIGN_BYTES) - 1] = 0xFFFFFFFF;
+        os_memcpy(flash_buffer, t_src, len);
+        res = flash_write(t_addr, flash_buffer, words_len);
+        if (res != SPIFFS_OK)
+            return res;
+        t_addr += len;
+        t_src += len;
+        t_size -= len;
     }
-    espbot_free((void *)buffer_space);
     return SPIFFS_OK;
 }
 
@@ -232,7 +250,14 @@ s32_t esp_spiffs_erase(u32_t t_addr, u32_t t_size)
         // TRACE("bytes to be erased %d, sector num %d, sector offset %d",
         //         t_size, sect_number, sect_offset);
         // erase sector
+        uint32 start = system_get_time();
         res = spi_flash_erase_sector(sect_number);
+        uint32 elapsed = system_get_time() - start;
+        stats.erase_ops++;
+        stats.erase_us += elapsed;
+        if (elapsed > stats.erase_max_us)
+            stats.erase_max_us = elapsed;
+        stats.erase_areas[(sect_number - (FS_START / FLASH_SECT_SIZE)) / FLASH_STATS_AREA_SECTORS]++;
         if (res == SPI_FLASH_RESULT_ERR)
         {
             dia_error_evnt(SPIFFS_FLASH_ERASE_ERROR, sect_number);
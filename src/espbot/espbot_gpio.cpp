@@ -19,6 +19,7 @@ extern "C"
 #include "espbot_event_codes.h"
 #include "espbot_gpio.hpp"
 #include "espbot_json.hpp"
+#include "espbot_json_writer.hpp"
 #include "espbot_mem_mon.hpp"
 
 #define ESPBOT_INPUT_GET(input_reg, gpio_no) ((input_reg >> gpio_no) & BIT0)
@@ -284,92 +285,74 @@ bool gpio_valid_id(int idx)
 
 char *gpio_cfg_json_stringify(int gpio_id, char *dest, int len)
 {
-    // {"gpio_id":,"gpio_type":"unprovisioned"}
-    int msg_len = 48;
-    char *msg;
-    if (dest == NULL)
+    Json_writer json(dest, len);
+    const char *gpio_type = NULL;
+    switch (gpio_get_config(gpio_id))
     {
-        msg = new char[msg_len];
-        if (msg == NULL)
-        {
-            dia_error_evnt(GPIO_CFG_STRINGIFY_HEAP_EXHAUSTED, msg_len);
-            ERROR("gpio_cfg_json_stringify heap exhausted [%d]", msg_len);
-            return NULL;
-        }
-    }
-    else
-    {
-        msg = dest;
-        if (len < msg_len)
-        {
-            *msg = 0;
-            return msg;
-        }
-    }
-    int result = gpio_get_config(gpio_id);
-    switch (result)
-    {
-    case ESPBOT_GPIO_WRONG_IDX:
-        *msg = 0;
-        break;
     case ESPBOT_GPIO_UNPROVISIONED:
-        fs_sprintf(msg, "{\"gpio_id\":%d,\"gpio_type\":\"unprovisioned\"}", gpio_id);
+        gpio_type = f_str("unprovisioned");
         break;
     case ESPBOT_GPIO_INPUT:
-        fs_sprintf(msg, "{\"gpio_id\":%d,\"gpio_type\":\"input\"}", gpio_id);
+        gpio_type = f_str("input");
         break;
     case ESPBOT_GPIO_OUTPUT:
-        fs_sprintf(msg, "{\"gpio_id\":%d,\"gpio_type\":\"output\"}", gpio_id);
+        gpio_type = f_str("output");
         break;
     default:
-        *msg = 0;
+        // ESPBOT_GPIO_WRONG_IDX: empty message
         break;
     }
+    while (json.pass())
+    {
+        if (gpio_type == NULL)
+            continue;
+        json.obj_begin();
+        json.num(f_str("gpio_id"), gpio_id);
+        json.str(f_str("gpio_type"), gpio_type);
+        json.obj_end();
+    }
+    char *msg = json.result();
+    if (msg == NULL)
+    {
+        dia_error_evnt(GPIO_CFG_STRINGIFY_HEAP_EXHAUSTED, json.len());
+        ERROR("gpio_cfg_json_stringify heap exhausted [%d]", json.len());
+    }
     return msg;
 }
 
 char *gpio_state_json_stringify(int gpio_id, char *dest, int len)
 {
-    // {"gpio_id":,"gpio_level":"unprovisioned"}
-    int msg_len = 48;
-    char *msg;
-    if (dest == NULL)
+    Json_writer json(dest, len);
+    const char *gpio_level = NULL;
+    switch (gpio_read(gpio_id))
     {
-        msg = new char[msg_len];
-        if (msg == NULL)
-        {
-            dia_error_evnt(GPIO_STATE_STRINGIFY_HEAP_EXHAUSTED, msg_len);
-            ERROR("gpio_state_json_stringify heap exhausted [%d]", msg_len);
-            return NULL;
-        }
-    }
-    else
-    {
-        msg = dest;
-        if (len < msg_len)
-        {
-            msg[0] = 0;
-            return msg;
-        }
-    }
-    int result = gpio_read(gpio_id);
-    switch (result)
-    {
-    case ESPBOT_GPIO_WRONG_IDX:
-        msg[0] = 0;
-        break;
     case ESPBOT_GPIO_UNPROVISIONED:
-        fs_sprintf(msg, "{\"gpio_id\":%d,\"gpio_level\":\"unprovisioned\"}", gpio_id);
+        gpio_level = f_str("unprovisioned");
         break;
     case ESPBOT_LOW:
-        fs_sprintf(msg, "{\"gpio_id\":%d,\"gpio_level\":\"low\"}", gpio_id);
+        gpio_level = f_str("low");
         break;
     case ESPBOT_HIGH:
-        fs_sprintf(msg, "{\"gpio_id\":%d,\"gpio_level\":\"high\"}", gpio_id);
+        gpio_level = f_str("high");
         break;
     default:
-        msg[0] = 0;
+        // ESPBOT_GPIO_WRONG_IDX: empty message
         break;
     }
+    while (json.pass())
+    {
+        if (gpio_level == NULL)
+            continue;
+        json.obj_begin();
+        json.num(f_str("gpio_id"), gpio_id);
+        json.str(f_str("gpio_level"), gpio_level);
+        json.obj_end();
+    }
+    char *msg = json.result();
+    if (msg == NULL)
+    {
+        dia_error_evnt(GPIO_STATE_STRINGIFY_HEAP_EXHAUSTED, json.len());
+        ERROR("gpio_state_json_stringify heap exhausted [%d]", json.len());
+    }
     return msg;
 }
\ No newline at end of file
@@ -17,6 +17,7 @@ extern "C"
 }
 
 #include "espbot.hpp"
+#include "espbot_cors.hpp"
 #include "espbot_diagnostic.hpp"
 #include "espbot_event_codes.h"
 #include "espbot_http.hpp"
@@ -26,6 +27,7 @@ extern "C"
 #include "espbot_list.hpp"
 #include "espbot_mem_mon.hpp"
 #include "espbot_queue.hpp"
+#include "espbot_scan.hpp"
 #include "espbot_utils.hpp"
 
 static int http_msg_max_size;
@@ -50,6 +52,8 @@ const char *code_msg(int code)
         return f_str("Created");
     case HTTP_ACCEPTED:
         return f_str("Accepted");
+    case HTTP_NOT_MODIFIED:
+        return f_str("Not Modified");
     case HTTP_BAD_REQUEST:
         return f_str("Bad Request");
     case HTTP_UNAUTHORIZED:
@@ -89,15 +93,14 @@ Http_header::Http_header()
 {
     m_content_type = NULL;
     m_acrh = NULL;
-    m_origin = NULL;
+    m_cors_preflight = false;
+    m_etag = 0;
 }
 
 Http_header::~Http_header()
 {
     if (m_acrh)
         delete[] m_acrh;
-    if (m_origin)
-        delete[] m_origin;
 }
 
 //
@@ -371,6 +374,11 @@ void http_send_buffer(struct espconn *p_espconn, int order, char *msg, int len)
     system_soft_wdt_feed();
 }
 
+bool http_send_idle(void)
+{
+    return (!esp_busy_sending_data && pending_send->empty() && pending_split_send->empty());
+}
+
 bool http_espconn_in_use(struct espconn *p_espconn)
 {
     if ((p_espconn->state == ESPCONN_CONNECT) || (p_espconn->state == ESPCONN_READ) || (p_espconn->state == ESPCONN_WRITE))
@@ -402,11 +410,14 @@ void http_response(struct espconn *p_espconn, int code, char *content_type, cons
         }
     }
     // Now format the message header
-    int header_len = 110 +
+    char *allowed_origin = cors_allowed_origin(p_espconn);
+    int header_len = 77 +
                      3 +
                      os_strlen(code_msg(code)) +
                      os_strlen(content_type) +
                      os_strlen(msg);
+    if (allowed_origin)
+        header_len += 34 + os_strlen(allowed_origin) + 14;
     Heap_chunk msg_header(header_len, dont_free);
     if (msg_header.ref == NULL)
     {
@@ -416,9 +427,20 @@ void http_response(struct espconn *p_espconn, int code, char *content_type, cons
     }
     os_sprintf(msg_header.ref, "HTTP/1.1 %d %s\r\nServer: espbot\r\n"
                                "Content-Type: %s\r\n"
-                               "Content-Length: %d\r\n"
-                               "Access-Control-Allow-Origin: *\r\n\r\n",
+                               "Content-Length: %d\r\n",
                code, code_msg(code), content_type, os_strlen(msg));
+    char *ptr = msg_header.ref + os_strlen(msg_header.ref);
+    if (allowed_origin)
+    {
+        fs_sprintf(ptr, "Access-Control-Allow-Origin: %s\r\n", allowed_origin);
+        ptr = ptr + os_strlen(ptr);
+        if (cors_vary_origin())
+        {
+            fs_sprintf(ptr, "Vary: Origin\r\n");
+            ptr = ptr + os_strlen(ptr);
+        }
+    }
+    fs_sprintf(ptr, "\r\n");
     // send separately the header from the content
     // to avoid allocating twice the memory for the message
     // especially very large ones
@@ -596,7 +618,7 @@ void http_send(struct espconn *p_espconn, char *msg, int msg_len)
     mem_mon_stack();
 }
 
-char *http_format_header(class Http_header *p_header)
+char *http_format_header(struct espconn *p_espconn, class Http_header *p_header)
 {
     ALL("http_format_header");
     // allocate a buffer
@@ -607,17 +629,24 @@ char *http_format_header(class Http_header *p_header)
     // Pragma         ->  24          =  24
     //                                = 201
     int header_length = 201;
-    if (p_header->m_acrh)
+    char *allowed_origin = cors_allowed_origin(p_espconn);
+    if (allowed_origin)
     {
-        header_length += 37; // Access-Control-Request-Headers string format
-        header_length += os_strlen(p_header->m_acrh);
+        header_length += 34; // Origin string format
+        header_length += os_strlen(allowed_origin);
+        header_length += 14; // Vary string format
     }
-
-    if (p_header->m_origin)
+    if (p_header->m_etag)
+        header_length += 18; // ETag string format
+    if (p_header->m_cors_preflight)
     {
-        header_length += os_strlen(f_str("Access-Control-Allow-Methods: GET,POST,PUT,DELETE,OPTIONS\r\n"));
-        header_length += 34; // Origin string format
-        header_length += os_strlen(p_header->m_origin);
+        // the precomputed Allow-Methods, Allow-Headers and Max-Age
+        header_length += os_strlen(cors_preflight_headers());
+        if (p_header->m_acrh && cors_echo_req_headers())
+        {
+            header_length += 37; // Access-Control-Request-Headers string format
+            header_length += os_strlen(p_header->m_acrh);
+        }
     }
 
     Heap_chunk header_msg(header_length, dont_free);
@@ -639,16 +668,29 @@ char *http_format_header(class Http_header *p_header)
         ptr = ptr + os_strlen(ptr);
         // os_sprintf(ptr, "Date: Wed, 28 Nov 2018 12:00:00 GMT\r\n");
         // os_printf("---->msg: %s\n", msg.ref);
-        if (p_header->m_origin)
+        if (allowed_origin)
         {
-            fs_sprintf(ptr, "Access-Control-Allow-Origin: %s\r\n", p_header->m_origin);
+            fs_sprintf(ptr, "Access-Control-Allow-Origin: %s\r\n", allowed_origin);
             ptr = ptr + os_strlen(ptr);
-            fs_sprintf(ptr, "Access-Control-Allow-Methods: GET,POST,PUT,DELETE,OPTIONS\r\n");
+            if (cors_vary_origin())
+            {
+                fs_sprintf(ptr, "Vary: Origin\r\n");
+                ptr = ptr + os_strlen(ptr);
+            }
+        }
+        if (p_header->m_cors_preflight)
+        {
+            os_strcpy(ptr, cors_preflight_headers());
             ptr = ptr + os_strlen(ptr);
+            if (p_header->m_acrh && cors_echo_req_headers())
+            {
+                fs_sprintf(ptr, "Access-Control-Allow-Headers: Content-Type,%s\r\n", p_header->m_acrh);
+                ptr = ptr + os_strlen(ptr);
+            }
         }
-        if (p_header->m_acrh)
+        if (p_header->m_etag)
         {
-            fs_sprintf(ptr, "Access-Control-Allow-Headers: Content-Type,%s\r\n", p_header->m_acrh);
+            fs_sprintf(ptr, "ETag: \"%08X\"\r\n", p_header->m_etag);
             ptr = ptr + os_strlen(ptr);
         }
         fs_sprintf(ptr, "Pragma: no-cache\r\n\r\n");
@@ -675,6 +717,8 @@ Http_parsed_req::Http_parsed_req()
     req_method = HTTP_UNDEFINED;
     acrh = NULL;
     origin = NULL;
+    if_none_match = NULL;
+    content_type = NULL;
     url = NULL;
     content_len = 0;
     req_content = NULL;
@@ -686,12 +730,40 @@ Http_parsed_req::~Http_parsed_req()
         delete[] acrh;
     if (origin)
         delete[] origin;
+    if (if_none_match)
+        delete[] if_none_match;
+    if (content_type)
+        delete[] content_type;
     if (url)
         delete[] url;
     if (req_content)
         delete[] req_content;
 }
 
+// a CRLF into [ptr, end)
+static char *http_find_crlf(char *ptr, char *end)
+{
+    while ((ptr = scan_char(ptr, end, '\r')) != NULL)
+    {
+        if (((ptr + 1) < end) && (*(ptr + 1) == '\n'))
+            return ptr;
+        ptr++;
+    }
+    return NULL;
+}
+
+// the empty line ending the header (CRLF CRLF)
+static char *http_find_header_end(char *ptr, char *end)
+{
+    while ((ptr = http_find_crlf(ptr, end)) != NULL)
+    {
+        if (((ptr + 3) < end) && (*(ptr + 2) == '\r') && (*(ptr + 3) == '\n'))
+            return ptr;
+        ptr += 2;
+    }
+    return NULL;
+}
+
 void http_parse_request(char *req, unsigned short length, Http_parsed_req *parsed_req)
 {
     ALL("http_parse_request");
@@ -786,7 +858,7 @@ void http_parse_request(char *req, unsigned short length, Http_parsed_req *parse
     if (tmp_ptr != NULL)
     {
         tmp_ptr += 32;
-        end_ptr = (char *)os_strstr(tmp_ptr, f_str("\r\n"));
+        end_ptr = http_find_crlf(tmp_ptr, req + length);
         if (end_ptr == NULL)
         {
             dia_error_evnt(HTTP_PARSE_REQUEST_CANNOT_FIND_ACC_CTRL_REQ_HEADERS);
@@ -815,7 +887,7 @@ void http_parse_request(char *req, unsigned short length, Http_parsed_req *parse
     if (tmp_ptr != NULL)
     {
         tmp_ptr += 8;
-        end_ptr = (char *)os_strstr(tmp_ptr, f_str("\r\n"));
+        end_ptr = http_find_crlf(tmp_ptr, req + length);
         if (end_ptr == NULL)
         {
             dia_error_evnt(HTTP_PARSE_REQUEST_CANNOT_FIND_ORIGIN);
@@ -833,10 +905,68 @@ void http_parse_request(char *req, unsigned short length, Http_parsed_req *parse
         os_strncpy(parsed_req->origin, tmp_ptr, len);
     }
 
+    // checkout If-None-Match
+    tmp_ptr = req;
+    tmp_ptr = (char *)os_strstr(tmp_ptr, f_str("If-None-Match: "));
+    if (tmp_ptr == NULL)
+    {
+        tmp_ptr = req;
+        tmp_ptr = (char *)os_strstr(tmp_ptr, f_str("if-none-match: "));
+    }
+    if (tmp_ptr != NULL)
+    {
+        tmp_ptr += 15;
+        end_ptr = http_find_crlf(tmp_ptr, req + length);
+        if (end_ptr == NULL)
+        {
+            dia_error_evnt(HTTP_PARSE_REQUEST_CANNOT_FIND_IF_NONE_MATCH);
+            ERROR("http_parse_request cannot find If-None-Match");
+            return;
+        }
+        len = end_ptr - tmp_ptr;
+        parsed_req->if_none_match = new char[len + 1];
+        if (parsed_req->if_none_match == NULL)
+        {
+            dia_error_evnt(HTTP_PARSE_REQUEST_HEAP_EXHAUSTED, (len + 1));
+            ERROR("http_parse_request heap exhausted %d", (len + 1));
+            return;
+        }
+        os_strncpy(parsed_req->if_none_match, tmp_ptr, len);
+    }
+
+    // checkout Content-Type
+    tmp_ptr = req;
+    tmp_ptr = (char *)os_strstr(tmp_ptr, f_str("Content-Type: "));
+    if (tmp_ptr == NULL)
+    {
+        tmp_ptr = req;
+        tmp_ptr = (char *)os_strstr(tmp_ptr, f_str("content-type: "));
+    }
+    if (tmp_ptr != NULL)
+    {
+        tmp_ptr += 14;
+        end_ptr = http_find_crlf(tmp_ptr, req + length);
+        if (end_ptr == NULL)
+        {
+            dia_error_evnt(HTTP_PARSE_REQUEST_CANNOT_FIND_CONTENT_TYPE);
+            ERROR("http_parse_request cannot find Content-Type");
+            return;
+        }
+        len = end_ptr - tmp_ptr;
+        parsed_req->content_type = new char[len + 1];
+        if (parsed_req->content_type == NULL)
+        {
+            dia_error_evnt(HTTP_PARSE_REQUEST_HEAP_EXHAUSTED, (len + 1));
+            ERROR("http_parse_request heap exhausted %d", (len + 1));
+            return;
+        }
+        os_strncpy(parsed_req->content_type, tmp_ptr, len);
+    }
+
     // checkout for request content
     // and calculate the effective content length
     tmp_ptr = req;
-    tmp_ptr = (char *)os_strstr(tmp_ptr, f_str("\r\n\r\n"));
+    tmp_ptr = http_find_header_end(tmp_ptr, req + length);
     if (tmp_ptr == NULL)
     {
         dia_error_evnt(HTTP_PARSE_REQUEST_CANNOT_FIND_CONTENT_START);
@@ -871,7 +1001,7 @@ void http_parse_request(char *req, unsigned short length, Http_parsed_req *parse
     if (tmp_ptr != NULL)
     {
         tmp_ptr += 16;
-        end_ptr = (char *)os_strstr(tmp_ptr, f_str("\r\n"));
+        end_ptr = http_find_crlf(tmp_ptr, req + length);
         if (end_ptr == NULL)
         {
             dia_error_evnt(HTTP_PARSE_REQUEST_CANNOT_FIND_CONTENT_LEN);
@@ -899,16 +1029,20 @@ public:
     ~Http_pending_req();
     struct espconn *p_espconn;
     char *request;
+    int buffer_size; // less than content_len when the allocation was deferred
     int content_len;
     int content_received;
+    bool discarding; // the request was dropped, the rest of its body is discarded
 };
 
 Http_pending_req::Http_pending_req()
 {
     p_espconn = NULL;
     request = NULL;
+    buffer_size = 0;
     content_len = 0;
     content_received = 0;
+    discarding = false;
 }
 
 Http_pending_req::~Http_pending_req()
@@ -919,6 +1053,36 @@ Http_pending_req::~Http_pending_req()
 
 static List<Http_pending_req> *pending_requests;
 
+static void http_recv_hold(struct espconn *p_espconn);
+static bool http_recv_pressure(int incoming_len);
+
+// move the received part of the request into a buffer of the new size
+static bool http_pending_req_grow(Http_pending_req *p_req, int size)
+{
+    char *buffer = new char[size + 1];
+    if (buffer == NULL)
+        return false;
+    os_memcpy(buffer, p_req->request, p_req->content_received);
+    delete[] p_req->request;
+    p_req->request = buffer;
+    p_req->buffer_size = size;
+    return true;
+}
+
+//
+// a request dropped before its body is complete stays into the list
+// so that the remaining body segments are discarded
+// instead of being parsed as new requests
+//
+static void http_pending_req_drop(Http_pending_req *p_req)
+{
+    delete[] p_req->request;
+    p_req->request = NULL;
+    // nothing left to allocate (a held connection gets released)
+    p_req->buffer_size = p_req->content_len;
+    p_req->discarding = true;
+}
+
 void http_save_pending_request(void *arg, char *precdata, unsigned short length, Http_parsed_req *parsed_req)
 {
     ALL("http_save_pending_request");
@@ -931,7 +1095,20 @@ void http_save_pending_request(void *arg, char *precdata, unsigned short length,
     }
     // total expected message length
     int msg_len = length + (parsed_req->h_content_len - parsed_req->content_len);
-    pending_req->request = new char[msg_len + 1];
+    // when the whole message cannot be allocated now
+    // save just the received part and hold the connection until the heap is available
+    if (!http_recv_pressure(msg_len))
+        pending_req->request = new char[msg_len + 1];
+    if (pending_req->request)
+    {
+        pending_req->buffer_size = msg_len;
+    }
+    else
+    {
+        pending_req->request = new char[length + 1];
+        pending_req->buffer_size = length;
+        http_recv_hold((struct espconn *)arg);
+    }
     if (pending_req->request == NULL)
     {
         dia_error_evnt(HTTP_SAVE_PENDING_REQUEST_HEAP_EXHAUSTED, msg_len);
@@ -974,6 +1151,32 @@ void http_check_pending_requests(struct espconn *p_espconn, char *new_msg, unsig
         ERROR("http_check_pending_requests cannot find pending req for espconn %X", p_espconn);
         return;
     }
+    if (p_p_req->discarding)
+    {
+        p_p_req->content_received += length;
+        if (p_p_req->content_received >= p_p_req->content_len)
+            pending_requests->remove();
+        return;
+    }
+    // segments can still arrive while the connection is held
+    // and the request buffer is partial
+    if ((p_p_req->content_received + length) > p_p_req->buffer_size)
+    {
+        if (!http_pending_req_grow(p_p_req, p_p_req->content_len) &&
+            !http_pending_req_grow(p_p_req, (p_p_req->content_received + length)))
+        {
+            dia_error_evnt(HTTP_CHECK_PENDING_REQUESTS_HEAP_EXHAUSTED, (p_p_req->content_received + length));
+            ERROR("http_check_pending_requests heap exhausted %d", (p_p_req->content_received + length));
+            http_pending_req_drop(p_p_req);
+            p_p_req->content_received += length;
+            if (p_p_req->content_received >= p_p_req->content_len)
+                pending_requests->remove();
+            http_response(p_espconn, HTTP_SERVER_ERROR, HTTP_CONTENT_JSON, f_str("Heap exhausted"), false);
+            return;
+        }
+        if (p_p_req->buffer_size < p_p_req->content_len)
+            http_recv_hold(p_espconn);
+    }
     // add the received message part
     char *str_ptr = p_p_req->request + p_p_req->content_received;
     os_memcpy(str_ptr, new_msg, length);
@@ -1002,124 +1205,177 @@ void clean_pending_responses(struct espconn *p_espconn)
             pending_requests->remove();
             // one element removed from list, better restart from front
             p_p_req = pending_requests->front();
+            continue;
         }
-        // need to check p_p_req because of pending_requests->front() maybe was called ...
-        if (p_p_req)
-            p_p_req = pending_requests->next();
+        p_p_req = pending_requests->next();
     }
     mem_mon_stack();
 }
 
-class Http_pending_res
+//
+// receive flow control
+//
+
+struct http_held_conn
 {
-public:
-    Http_pending_res();
-    ~Http_pending_res();
     struct espconn *p_espconn;
-    char *response;
-    int content_len;
-    int content_received;
+    int checks; // the connection is released after HTTP_RECV_HOLD_MAX_CHECKS
 };
 
-Http_pending_res::Http_pending_res()
+static List<struct http_held_conn> *recv_held;
+static os_timer_t recv_hold_timer;
+
+// bytes waiting to be sent
+static int http_queued_bytes(void)
 {
-    p_espconn = NULL;
-    response = NULL;
-    content_len = 0;
-    content_received = 0;
+    int queued = 0;
+    struct http_send *p_send = pending_send->front();
+    while (p_send)
+    {
+        queued += p_send->msg_len;
+        p_send = pending_send->next();
+    }
+    struct http_split_send *p_split = pending_split_send->front();
+    while (p_split)
+    {
+        queued += (p_split->content_size - p_split->content_transferred);
+        p_split = pending_split_send->next();
+    }
+    return queued;
 }
 
-Http_pending_res::~Http_pending_res()
+static bool http_recv_pressure(int incoming_len)
 {
-    if (response)
-        delete[] response;
+    if (system_get_free_heap_size() < (uint32)(HTTP_RECV_HEAP_WATERMARK + incoming_len))
+        return true;
+    if (http_queued_bytes() > HTTP_RECV_QUEUED_MAX)
+        return true;
+    return false;
 }
 
-static List<Http_pending_res> *pending_responses;
-
-// void print_pending_response(void)
-// {
-//     os_printf("---------> pending responses\n");
-//     Http_pending_res *p_p_res = pending_responses->front();
-//     int ii=0;
-//     while (p_p_res)
-//     {
-//         os_printf("---------> response\n");
-//         os_printf("                     espconn: %X\n", p_p_res->p_espconn);
-//         os_printf("                    response: %s\n", p_p_res->response);
-//         os_printf("                 content_len: %d\n", p_p_res->content_len);
-//         os_printf("            content_received: %d\n", p_p_res->content_received);
-//         p_p_res = pending_responses->next();
-//         ii++;
-//         if (ii>4)
-//             break;
-//     }
-//     os_printf("---------> end\n");
-// }
-
-void http_save_pending_response(struct espconn *p_espconn, char *precdata, unsigned short length, Http_parsed_response *parsed_res)
+static Http_pending_req *http_recv_find_req(struct espconn *p_espconn)
 {
-    ALL("http_save_pending_response");
-    Http_pending_res *pending_res = new Http_pending_res;
-    if (pending_res == NULL)
+    Http_pending_req *p_p_req = pending_requests->front();
+    while (p_p_req)
     {
-        dia_error_evnt(HTTP_SAVE_PENDING_RESPONSE_HEAP_EXHAUSTED, sizeof(Http_pending_res));
-        ERROR("http_save_pending_response heap exhausted %d", sizeof(Http_pending_res));
-        return;
+        if (p_p_req->p_espconn == p_espconn)
+            return p_p_req;
+        p_p_req = pending_requests->next();
     }
-    // total expected message length
-    int msg_len = length + (parsed_res->h_content_len - parsed_res->content_len);
-    pending_res->response = new char[msg_len + 1];
-    if (pending_res->response == NULL)
+    return NULL;
+}
+
+static bool http_recv_should_hold(struct espconn *p_espconn)
+{
+    Http_pending_req *p_p_req = http_recv_find_req(p_espconn);
+    if (p_p_req == NULL)
+        return http_recv_pressure(0);
+    if (p_p_req->buffer_size < p_p_req->content_len)
+        return true;
+    // the request buffer is already allocated, the next segments won't use more heap
+    // (holding on heap pressure would only delay the buffer release)
+    return (http_queued_bytes() > HTTP_RECV_QUEUED_MAX);
+}
+
+static void http_recv_hold_check(void *arg)
+{
+    ALL("http_recv_hold_check");
+    struct http_held_conn *held = recv_held->front();
+    while (held)
     {
-        dia_error_evnt(HTTP_SAVE_PENDING_RESPONSE_HEAP_EXHAUSTED, msg_len);
-        ERROR("http_save_pending_response heap exhausted %d", msg_len);
-        delete pending_res;
-        return;
+        struct espconn *p_espconn = held->p_espconn;
+        if (!http_espconn_in_use(p_espconn))
+        {
+            recv_held->remove();
+            held = recv_held->front();
+            continue;
+        }
+        bool give_up = (++held->checks > HTTP_RECV_HOLD_MAX_CHECKS);
+        Http_pending_req *p_p_req = http_recv_find_req(p_espconn);
+        if (p_p_req && (p_p_req->buffer_size < p_p_req->content_len))
+        {
+            // partial request: try completing the allocation
+            if (!http_recv_pressure(p_p_req->content_len - p_p_req->buffer_size))
+                http_pending_req_grow(p_p_req, p_p_req->content_len);
+            if ((p_p_req->buffer_size < p_p_req->content_len) && give_up)
+            {
+                dia_error_evnt(HTTP_RECV_HOLD_TIMEOUT, p_p_req->content_len);
+                ERROR("http_recv_hold_check cannot allocate %d", p_p_req->content_len);
+                http_pending_req_drop(p_p_req);
+                http_response(p_espconn, HTTP_SERVER_ERROR, HTTP_CONTENT_JSON, f_str("Heap exhausted"), false);
+            }
+        }
+        if (give_up || !http_recv_should_hold(p_espconn))
+        {
+            espconn_recv_unhold(p_espconn);
+            dia_debug_evnt(HTTP_RECV_UNHOLD, (uint32)p_espconn);
+            DEBUG("http_recv_hold_check unhold espconn %X", p_espconn);
+            // http_recv_should_hold moved the pending requests cursor only
+            recv_held->remove();
+            // one element removed from list, restart from front
+            held = recv_held->front();
+            continue;
+        }
+        held = recv_held->next();
     }
-    pending_res->p_espconn = p_espconn;
-    os_memcpy(pending_res->response, precdata, length);
-    pending_res->content_len = msg_len;
-    pending_res->content_received = length;
-    List_err err = pending_responses->push_back(pending_res);
-    if (err != list_ok)
-    {
-        dia_error_evnt(HTTP_SAVE_PENDING_RESPONSE_CANNOT_SAVE_RES);
-        ERROR("http_save_pending_response cannot save pending res");
-        delete pending_res;
+    if (recv_held->empty())
         return;
-    }
+    os_timer_arm(&recv_hold_timer, HTTP_RECV_HOLD_CHECK, 0);
     mem_mon_stack();
 }
 
-void http_check_pending_responses(struct espconn *p_espconn, char *new_msg, unsigned short length, void (*msg_complete)(void *, char *, unsigned short))
+static void http_recv_hold(struct espconn *p_espconn)
 {
-    ALL("http_check_pending_responses");
-    // look for a pending request on p_espconn
-    Http_pending_res *p_p_res = pending_responses->front();
-    while (p_p_res)
+    ALL("http_recv_hold");
+    struct http_held_conn *held = recv_held->front();
+    while (held)
     {
-        if (p_p_res->p_espconn == p_espconn)
-            break;
-        p_p_res = pending_responses->next();
+        if (held->p_espconn == p_espconn)
+            return;
+        held = recv_held->next();
     }
-    if (p_p_res == NULL)
+    held = new struct http_held_conn;
+    if (held == NULL)
+        return;
+    held->p_espconn = p_espconn;
+    held->checks = 0;
+    if (recv_held->push_back(held) != list_ok)
     {
-        dia_error_evnt(HTTP_CHECK_PENDING_RESPONSE_CANNOT_FIND_RES, (uint32)p_espconn);
-        ERROR("http_check_pending_responses cannot find pending response for espconn %X", p_espconn);
+        delete held;
         return;
     }
-    // add the received message part
-    char *str_ptr = p_p_res->response + p_p_res->content_received;
-    os_memcpy(str_ptr, new_msg, length);
-    p_p_res->content_received += length;
-    // check if the message is completed
-    if (p_p_res->content_len == p_p_res->content_received)
+    espconn_recv_hold(p_espconn);
+    dia_debug_evnt(HTTP_RECV_HOLD, (uint32)p_espconn);
+    DEBUG("http_recv_hold espconn %X, heap %d, queued %d", p_espconn, system_get_free_heap_size(), http_queued_bytes());
+    if (recv_held->size() == 1)
     {
-        msg_complete((void *)p_espconn, p_p_res->response, p_p_res->content_len);
-        pending_responses->remove();
+        os_timer_disarm(&recv_hold_timer);
+        os_timer_setfn(&recv_hold_timer, (os_timer_func_t *)http_recv_hold_check, NULL);
+        os_timer_arm(&recv_hold_timer, HTTP_RECV_HOLD_CHECK, 0);
     }
-    mem_mon_stack();
+}
+
+void http_recv_flow_check(struct espconn *p_espconn)
+{
+    if (http_recv_should_hold(p_espconn))
+        http_recv_hold(p_espconn);
+}
+
+void http_recv_flow_forget(struct espconn *p_espconn)
+{
+    ALL("http_recv_flow_forget");
+    struct http_held_conn *held = recv_held->front();
+    while (held)
+    {
+        if (held->p_espconn == p_espconn)
+        {
+            recv_held->remove();
+            break;
+        }
+        held = recv_held->next();
+    }
+    if (recv_held->empty())
+        os_timer_disarm(&recv_hold_timer);
 }
 
 void http_init(void)
@@ -1130,7 +1386,7 @@ void http_init(void)
     pending_send = new Queue<struct http_send>(16);
     pending_split_send = new Queue<struct http_split_send>(16);
     pending_requests = new List<Http_pending_req>(4, delete_content);
-    pending_responses = new List<Http_pending_res>(4, delete_content);
+    recv_held = new List<struct http_held_conn>(8, delete_content);
 }
 
 void http_queues_clear(void)
@@ -1156,7 +1412,7 @@ void http_queues_clear(void)
 }
 
 //
-// HTTP parsing response
+// HTTP parsed response (filled in by Http_clt using Http_res_parser)
 //
 
 Http_parsed_response::Http_parsed_response()
@@ -1167,6 +1423,7 @@ Http_parsed_response::Http_parsed_response()
     content_range_size = 0;
     h_content_len = 0;
     content_len = 0;
+    connection_close = false;
     body = NULL;
 }
 
@@ -1175,200 +1432,3 @@ Http_parsed_response::~Http_parsed_response()
     if (body)
         delete[] body;
 }
-
-void http_parse_response(char *response, int length, Http_parsed_response *parsed_response)
-{
-    ALL("http_parse_response");
-    char *tmp_ptr = response;
-    char *end_ptr = NULL;
-    char *tmp_str = NULL;
-    int len = 0;
-
-    if (tmp_ptr == NULL)
-    {
-        dia_error_evnt(HTTP_PARSE_RESPONSE_CANNOT_PARSE_EMPTY_MSG);
-        ERROR("http_parse_response empty message");
-        return;
-    }
-
-    // looking for HTTP CODE
-    tmp_ptr = response;
-    tmp_ptr = (char *)os_strstr(tmp_ptr, f_str("HTTP"));
-    if (tmp_ptr == NULL)
-    {
-        tmp_ptr = response;
-        parsed_response->no_header_message = true;
-    }
-    else
-    {
-        parsed_response->no_header_message = false;
-        tmp_ptr = (char *)os_strstr(tmp_ptr, f_str(" "));
-        do
-        {
-            tmp_ptr++;
-        } while (*tmp_ptr == ' ');
-    }
-    if (parsed_response->no_header_message)
-    {
-        parsed_response->content_len = length;
-        parsed_response->body = new char[parsed_response->content_len + 1];
-        if (parsed_response->body == NULL)
-        {
-            dia_error_evnt(HTTP_PARSE_RESPONSE_HEAP_EXHAUSTED, (parsed_response->content_len + 1));
-            ERROR("http_parse_response heap exhausted %d", (parsed_response->content_len + 1));
-            return;
-        }
-        os_memcpy(parsed_response->body, tmp_ptr, parsed_response->content_len);
-        return;
-    }
-
-    end_ptr = (char *)os_strstr(tmp_ptr, f_str(" "));
-    if (end_ptr == NULL)
-    {
-        dia_error_evnt(HTTP_PARSE_RESPONSE_CANNOT_FIND_HTTP_TOKEN);
-        ERROR("http_parse_response - cannot find HTTP token");
-        return;
-    }
-    len = end_ptr - tmp_ptr;
-    {
-        Heap_chunk tmp_str(len + 1);
-        if (tmp_str.ref == NULL)
-        {
-            dia_error_evnt(HTTP_PARSE_RESPONSE_HEAP_EXHAUSTED, (len + 1));
-            ERROR("http_parse_response heap exhausted %d", (len + 1));
-            return;
-        }
-        os_strncpy(tmp_str.ref, tmp_ptr, len);
-        parsed_response->http_code = atoi(tmp_str.ref);
-    }
-
-    // now the content-length
-    tmp_ptr = response;
-    tmp_ptr = (char *)os_strstr(tmp_ptr, f_str("Content-Length: "));
-    if (tmp_ptr == NULL)
-    {
-        TRACE("http_parse_response didn't find any Content-Length");
-    }
-    else
-    {
-        tmp_ptr += 16;
-        end_ptr = (char *)os_strstr(tmp_ptr, f_str("\r\n"));
-        if (end_ptr == NULL)
-        {
-            dia_error_evnt(HTTP_PARSE_RESPONSE_CANNOT_FIND_CONTENT_LEN);
-            ERROR("http_parse_response cannot find Content-Length value");
-            return;
-        }
-        len = end_ptr - tmp_ptr;
-        Heap_chunk tmp_str(len + 1);
-        if (tmp_str.ref == NULL)
-        {
-            dia_error_evnt(HTTP_PARSE_RESPONSE_HEAP_EXHAUSTED, (len + 1));
-            ERROR("http_parse_response heap exhausted %d", (len + 1));
-            return;
-        }
-        os_strncpy(tmp_str.ref, tmp_ptr, len);
-        parsed_response->h_content_len = atoi(tmp_str.ref);
-    }
-    // now Content-Range (if any)
-    tmp_ptr = response;
-    tmp_ptr = (char *)os_strstr(tmp_ptr, f_str("Content-Range: "));
-    if (tmp_ptr == NULL)
-    {
-        TRACE("http_parse_response didn't find any Content-Range");
-    }
-    else
-    {
-        tmp_ptr = (char *)os_strstr(tmp_ptr, f_str("bytes"));
-        if (tmp_ptr == NULL)
-        {
-            dia_error_evnt(HTTP_PARSE_RESPONSE_CANNOT_FIND_CONTENT_RANGE);
-            ERROR("http_parse_response cannot find Content-Range value");
-            return;
-        }
-        // range start
-        tmp_ptr += os_strlen(f_str("bytes "));
-        end_ptr = (char *)os_strstr(tmp_ptr, f_str("-"));
-        if (end_ptr == NULL)
-        {
-            dia_error_evnt(HTTP_PARSE_RESPONSE_CANNOT_FIND_RANGE_START);
-            ERROR("http_parse_response cannot find range start");
-            return;
-        }
-        len = end_ptr - tmp_ptr;
-        {
-            Heap_chunk tmp_str(len + 1);
-            if (tmp_str.ref == NULL)
-            {
-                dia_error_evnt(HTTP_PARSE_RESPONSE_HEAP_EXHAUSTED, (len + 1));
-                ERROR("http_parse_response heap exhausted %d", (len + 1));
-                return;
-            }
-            os_strncpy(tmp_str.ref, tmp_ptr, len);
-            parsed_response->content_range_start = atoi(tmp_str.ref);
-        }
-        // range end
-        tmp_ptr = end_ptr + 1;
-        end_ptr = (char *)os_strstr(tmp_ptr, f_str("/"));
-        if (end_ptr == NULL)
-        {
-            dia_error_evnt(HTTP_PARSE_RESPONSE_CANNOT_FIND_RANGE_END);
-            ERROR("http_parse_response cannot find range end");
-            return;
-        }
-        len = end_ptr - tmp_ptr;
-        {
-            Heap_chunk tmp_str(len + 1);
-            if (tmp_str.ref == NULL)
-            {
-                dia_error_evnt(HTTP_PARSE_RESPONSE_HEAP_EXHAUSTED, (len + 1));
-                ERROR("http_parse_response heap exhausted %d", (len + 1));
-                return;
-            }
-            os_strncpy(tmp_str.ref, tmp_ptr, len);
-            parsed_response->content_range_end = atoi(tmp_str.ref);
-        }
-        // range size
-        tmp_ptr = end_ptr + 1;
-        end_ptr = (char *)os_strstr(tmp_ptr, f_str("\r\n"));
-        if (end_ptr == NULL)
-        {
-            dia_error_evnt(HTTP_PARSE_RESPONSE_CANNOT_FIND_RANGE_SIZE);
-            ERROR("http_parse_response cannot find Content-Range size");
-            return;
-        }
-        len = end_ptr - tmp_ptr;
-        {
-            Heap_chunk tmp_str(len + 1);
-            if (tmp_str.ref == NULL)
-            {
-                dia_error_evnt(HTTP_PARSE_RESPONSE_HEAP_EXHAUSTED, (len + 1));
-                ERROR("http_parse_response heap exhausted %d", (len + 1));
-                return;
-            }
-            os_strncpy(tmp_str.ref, tmp_ptr, len);
-            parsed_response->content_range_size = atoi(tmp_str.ref);
-        }
-    }
-    // finally the body
-    tmp_ptr = response;
-    tmp_ptr = (char *)os_strstr(tmp_ptr, f_str("\r\n\r\n"));
-    if (tmp_ptr == NULL)
-    {
-        dia_error_evnt(HTTP_PARSE_RESPONSE_CANNOT_FIND_CONTENT_START);
-        ERROR("http_parse_response cannot find Content start");
-        return;
-    }
-    tmp_ptr += 4;
-    len = length - (tmp_ptr - response);
-    parsed_response->content_len = len;
-    parsed_response->body = new char[len + 1];
-    if (parsed_response->body == NULL)
-    {
-        dia_error_evnt(HTTP_PARSE_RESPONSE_HEAP_EXHAUSTED, (len + 1));
-        ERROR("http_parse_response heap exhausted %d", (len + 1));
-        return;
-    }
-    os_memcpy(parsed_response->body, tmp_ptr, len);
-    mem_mon_stack();
-}
\ No newline at end of file
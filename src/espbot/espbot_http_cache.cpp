@@ -0,0 +1,290 @@
+/*
+ * ----------------------------------------------------------------------------
+ * "THE BEER-WARE LICENSE" (Revision 42):
+ * <quackmore-ff@yahoo.com> wrote this file.  As long as you retain this notice
+ * you can do whatever you want with this stuff. If we meet some day, and you 
+ * think this stuff is worth it, you can buy me a beer in return. Quackmore
+ * ----------------------------------------------------------------------------
+ */
+
+// SDK includes
+extern "C"
+{
+#include "c_types.h"
+#include "mem.h"
+#include "osapi.h"
+}
+
+#include "espbot.hpp"
+#include "espbot_diagnostic.hpp"
+#include "espbot_event_codes.h"
+#include "espbot_http.hpp"
+#include "espbot_http_cache.hpp"
+#include "espbot_json_writer.hpp"
+#include "espbot_list.hpp"
+#include "espbot_mem_mon.hpp"
+#include "espbot_utils.hpp"
+
+struct http_cache_entry
+{
+    char *route;
+    char *body;
+    int body_len;
+    uint32 etag;
+    uint32 last_used;
+};
+
+static List<struct http_cache_entry> *http_cache;
+
+static struct
+{
+    uint32 tick;        // LRU clock
+    int bytes;          // cached bodies size
+    uint32 hits;
+    uint32 misses;
+    uint32 not_modified;
+    uint32 bytes_saved; // cached bytes served without formatting them again
+} http_cache_state;
+
+void http_cache_init(void)
+{
+    http_cache = new List<struct http_cache_entry>(HTTP_CACHE_MAX_ENTRIES, delete_content);
+    os_memset(&http_cache_state, 0, sizeof(http_cache_state));
+}
+
+// FNV-1a
+static uint32 http_cache_etag(char *body, int len)
+{
+    uint32 hash = 2166136261U;
+    int idx;
+    for (idx = 0; idx < len; idx++)
+    {
+        hash ^= (uint8)body[idx];
+        hash *= 16777619U;
+    }
+    // 0 means no ETag
+    if (hash == 0)
+        hash = 1;
+    return hash;
+}
+
+static struct http_cache_entry *http_cache_find(const char *route)
+{
+    struct http_cache_entry *entry = http_cache->front();
+    while (entry)
+    {
+        if (os_strcmp(entry->route, route) == 0)
+            return entry;
+        entry = http_cache->next();
+    }
+    return NULL;
+}
+
+// the list cursor must point to the entry to be removed
+static void http_cache_remove_current(struct http_cache_entry *entry)
+{
+    http_cache_state.bytes -= entry->body_len;
+    delete[] entry->route;
+    delete[] entry->body;
+    http_cache->remove();
+}
+
+static void http_cache_evict_lru(void)
+{
+    struct http_cache_entry *lru = NULL;
+    struct http_cache_entry *entry = http_cache->front();
+    while (entry)
+    {
+        if ((lru == NULL) || (entry->last_used < lru->last_used))
+            lru = entry;
+        entry = http_cache->next();
+    }
+    if (lru == NULL)
+        return;
+    // move the cursor to the LRU entry
+    entry = http_cache->front();
+    while (entry && (entry != lru))
+        entry = http_cache->next();
+    TRACE("http_cache evicting %s", lru->route);
+    http_cache_remove_current(lru);
+}
+
+static struct http_cache_entry *http_cache_put(char *route, char *body, int body_len)
+{
+    ALL("http_cache_put");
+    if (body_len > HTTP_CACHE_MAX_BYTES)
+        return NULL;
+    while ((http_cache->full() || ((http_cache_state.bytes + body_len) > HTTP_CACHE_MAX_BYTES)) &&
+           (http_cache->size() > 0))
+        http_cache_evict_lru();
+    struct http_cache_entry *entry = new struct http_cache_entry;
+    if (entry == NULL)
+    {
+        dia_error_evnt(HTTP_CACHE_PUT_HEAP_EXHAUSTED, sizeof(struct http_cache_entry));
+        ERROR("http_cache_put heap exhausted %d", sizeof(struct http_cache_entry));
+        return NULL;
+    }
+    entry->route = new char[os_strlen(route) + 1];
+    entry->body = new char[body_len + 1];
+    if ((entry->route == NULL) || (entry->body == NULL))
+    {
+        dia_error_evnt(HTTP_CACHE_PUT_HEAP_EXHAUSTED, (os_strlen(route) + body_len + 2));
+        ERROR("http_cache_put heap exhausted %d", (os_strlen(route) + body_len + 2));
+        if (entry->route)
+            delete[] entry->route;
+        if (entry->body)
+            delete[] entry->body;
+        delete entry;
+        return NULL;
+    }
+    os_strcpy(entry->route, route);
+    os_memcpy(entry->body, body, body_len);
+    entry->body_len = body_len;
+    entry->etag = http_cache_etag(body, body_len);
+    entry->last_used = ++http_cache_state.tick;
+    if (http_cache->push_back(entry) != list_ok)
+    {
+        delete[] entry->route;
+        delete[] entry->body;
+        delete entry;
+        return NULL;
+    }
+    http_cache_state.bytes += body_len;
+    mem_mon_stack();
+    return entry;
+}
+
+static bool http_cache_etag_match(char *if_none_match, uint32 etag)
+{
+    if (if_none_match == NULL)
+        return false;
+    char etag_str[11];
+    fs_sprintf(etag_str, "\"%08X\"", etag);
+    // If-None-Match can be a list of ETags or "*"
+    if (os_strstr(if_none_match, etag_str))
+        return true;
+    if (os_strcmp(if_none_match, f_str("*")) == 0)
+        return true;
+    return false;
+}
+
+static void http_cache_send(struct espconn *p_espconn, int code, char *body, int body_len, uint32 etag)
+{
+    Http_header header;
+    header.m_code = code;
+    header.m_content_type = (char *)HTTP_CONTENT_JSON;
+    header.m_content_length = body_len;
+    header.m_content_range_start = 0;
+    header.m_content_range_end = 0;
+    header.m_content_range_total = 0;
+    header.m_etag = etag;
+    char *header_str = http_format_header(p_espconn, &header);
+    if (header_str == NULL)
+    {
+        if (body)
+            delete[] body;
+        http_response(p_espconn, HTTP_SERVER_ERROR, HTTP_CONTENT_JSON, f_str("Heap exhausted"), false);
+        return;
+    }
+    http_send_buffer(p_espconn, 0, header_str, os_strlen(header_str));
+    if (body)
+        http_send(p_espconn, body, body_len);
+}
+
+void http_cache_response(struct espconn *p_espconn,
+                         Http_parsed_req *parsed_req,
+                         char *(*json_stringify)(char *dest, int len))
+{
+    ALL("http_cache_response");
+    struct http_cache_entry *entry = http_cache_find(parsed_req->url);
+    if (entry)
+    {
+        http_cache_state.hits++;
+        http_cache_state.bytes_saved += entry->body_len;
+        entry->last_used = ++http_cache_state.tick;
+        if (http_cache_etag_match(parsed_req->if_none_match, entry->etag))
+        {
+            http_cache_state.not_modified++;
+            http_cache_send(p_espconn, HTTP_NOT_MODIFIED, NULL, 0, entry->etag);
+            return;
+        }
+        // http_send will free the message once sent
+        char *body = new char[entry->body_len + 1];
+        if (body == NULL)
+        {
+            dia_error_evnt(HTTP_CACHE_RESPONSE_HEAP_EXHAUSTED, entry->body_len + 1);
+            ERROR("http_cache_response heap exhausted %d", entry->body_len + 1);
+            http_response(p_espconn, HTTP_SERVER_ERROR, HTTP_CONTENT_JSON, f_str("Heap exhausted"), false);
+            return;
+        }
+        os_memcpy(body, entry->body, entry->body_len);
+        http_cache_send(p_espconn, HTTP_OK, body, entry->body_len, entry->etag);
+        return;
+    }
+    http_cache_state.misses++;
+    char *msg = json_stringify(NULL, 0);
+    if (msg == NULL)
+    {
+        http_response(p_espconn, HTTP_SERVER_ERROR, HTTP_CONTENT_JSON, f_str("Heap exhausted"), false);
+        return;
+    }
+    int msg_len = os_strlen(msg);
+    entry = http_cache_put(parsed_req->url, msg, msg_len);
+    // when the content cannot be cached it's sent anyway, just with no ETag
+    http_cache_send(p_espconn, HTTP_OK, msg, msg_len, (entry ? entry->etag : 0));
+    mem_mon_stack();
+}
+
+void http_cache_invalidate(const char *route)
+{
+    ALL("http_cache_invalidate");
+    // cfg restore functions can run before the cache is initialized
+    if (http_cache == NULL)
+        return;
+    struct http_cache_entry *entry = http_cache_find(route);
+    if (entry)
+        http_cache_remove_current(entry);
+}
+
+void http_cache_invalidate_all(void)
+{
+    ALL("http_cache_invalidate_all");
+    if (http_cache == NULL)
+        return;
+    struct http_cache_entry *entry = http_cache->front();
+    while (entry)
+    {
+        http_cache_remove_current(entry);
+        // remove leaves the cursor dangling, restart from the front
+        entry = http_cache->front();
+    }
+}
+
+char *http_cache_stats_json_stringify(char *dest, int len)
+{
+    uint32 requests = http_cache_state.hits + http_cache_state.misses;
+    int hit_rate = 0;
+    if (requests > 0)
+        hit_rate = (int)(((uint64)http_cache_state.hits * 100) / requests);
+    Json_writer json(dest, len);
+    while (json.pass())
+    {
+        json.obj_begin();
+        json.num(f_str("entries"), http_cache->size());
+        json.num(f_str("bytes"), http_cache_state.bytes);
+        json.unum(f_str("hits"), http_cache_state.hits);
+        json.unum(f_str("misses"), http_cache_state.misses);
+        json.num(f_str("hit_rate"), hit_rate);
+        json.unum(f_str("not_modified"), http_cache_state.not_modified);
+        json.unum(f_str("bytes_saved"), http_cache_state.bytes_saved);
+        json.obj_end();
+    }
+    char *msg = json.result();
+    if (msg == NULL)
+    {
+        dia_error_evnt(HTTP_CACHE_STATS_STRINGIFY_HEAP_EXHAUSTED, json.len());
+        ERROR("http_cache_stats_json_stringify heap exhausted [%d]", json.len());
+    }
+    mem_mon_stack();
+    return msg;
+}
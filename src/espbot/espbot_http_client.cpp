@@ -17,11 +17,14 @@ extern "C"
 
 #include "espbot.hpp"
 #include "espbot_diagnostic.hpp"
+#include "espbot_dns.hpp"
 #include "espbot_event_codes.h"
 #include "espbot_json.hpp"
+#include "espbot_json_writer.hpp"
 #include "espbot_http.hpp"
 #include "espbot_list.hpp"
 #include "espbot_mem_mon.hpp"
+#include "espbot_spiffs.hpp"
 #include "espbot_utils.hpp"
 #include "espbot_http_client.hpp"
 
@@ -36,10 +39,13 @@ typedef struct _A_espconn_http_clt
 } A_espconn_http_clt;
 
 static List<A_espconn_http_clt> *http_clt_espconn;
+static List<Http_clt> *http_clt_pool;
 
 void init_http_clients_data_stuctures(void)
 {
-    http_clt_espconn = new List<A_espconn_http_clt>(4, delete_content);
+    // idle clients in the pool keep their association
+    http_clt_espconn = new List<A_espconn_http_clt>(4 + HTTP_CLT_POOL_MAX_IDLE, delete_content);
+    http_clt_pool = new List<Http_clt>(HTTP_CLT_POOL_MAX_IDLE, dont_delete_content);
 }
 
 static Http_clt *get_client(struct espconn *p_pespconn)
@@ -116,14 +122,58 @@ static void http_clt_send_req_timeout_function(void *arg)
     INFO("http_clt_send_req_timeout_function");
     Http_clt *clnt = (Http_clt *)arg;
     mem_mon_stack();
-    clnt->update_status(HTTP_CLT_RESPONSE_TIMEOUT);
+    clnt->response_failed(HTTP_CLT_RESPONSE_TIMEOUT);
+}
+
+static void http_clt_host_resolved(void *param, struct ip_addr *ip)
+{
+    ALL("http_clt_host_resolved");
+    Http_clt *clnt = (Http_clt *)param;
+    clnt->host_resolved(ip);
+}
+
+static void http_clt_reuse_connected(void *arg)
+{
+    ALL("http_clt_reuse_connected");
+    Http_clt *clnt = (Http_clt *)arg;
+    clnt->update_status(HTTP_CLT_CONNECTED);
     clnt->call_completed_func();
 }
 
+//
+// REQUEST QUEUE
+//
+
+struct http_clt_queued_req
+{
+    char *msg; // NULL once sent (http_send frees it)
+    int msg_len;
+    void (*completed_func)(void *);
+    void *param;
+};
+
+static void http_clt_queue_completed(void *arg)
+{
+    Http_clt *clnt = (Http_clt *)arg;
+    clnt->queue_completed();
+}
+
 //
 // RECEIVING
 //
 
+static bool http_clt_res_headers(void *param, Http_res_parser *parser)
+{
+    Http_clt *clnt = (Http_clt *)param;
+    return clnt->res_headers(parser);
+}
+
+static bool http_clt_res_body(void *param, char *data, int len)
+{
+    Http_clt *clnt = (Http_clt *)param;
+    return clnt->res_body(data, len);
+}
+
 static void http_client_recv(void *arg, char *precdata, unsigned short length)
 {
     struct espconn *ptr_espconn = (struct espconn *)arg;
@@ -136,57 +186,14 @@ static void http_client_recv(void *arg, char *precdata, unsigned short length)
         return;
     }
     os_timer_disarm(&client->_send_req_timeout_timer);
-    mem_mon_stack();
-    DEBUG("http_client_recv msg %s", precdata);
     TRACE("http_client_recv msg len %d", length);
-    // in case of binary message
-    // int ii;
-    // os_printf("msg hex: ");
-    // for (ii = 0; ii < length; ii++)
-    //     os_printf("%X ", precdata[ii]);
-    // os_printf("\n");
-    Http_parsed_response *parsed_response = new Http_parsed_response;
-    http_parse_response(precdata, length, parsed_response);
-    TRACE("http_client_recv parsed res\n"
-          "            espconn %X\n"
-          "          http code %d\n"
-          "content_range_start %d\n"
-          "  content_range_end %d\n"
-          " content_range_size %d\n"
-          " header content len %d\n"
-          "        content len %d\n"
-          "               body %s",
-          ptr_espconn, 
-          parsed_response->http_code, 
-          parsed_response->content_range_start, 
-          parsed_response->content_range_end, 
-          parsed_response->content_range_size, 
-          parsed_response->h_content_len, 
-          parsed_response->content_len, 
-          parsed_response->body);
-    if (!parsed_response->no_header_message && (parsed_response->h_content_len > parsed_response->content_len))
-    {
-        os_timer_arm(&client->_send_req_timeout_timer, client->_comm_timeout, 0);
-        TRACE("http_client_recv message has been splitted waiting for completion ...");
-        http_save_pending_response(ptr_espconn, precdata, length, parsed_response);
-        delete parsed_response;
-        TRACE("http_client_recv pending response saved ...");
-        return;
-    }
-    if (parsed_response->no_header_message)
-    {
-        os_timer_arm(&client->_send_req_timeout_timer, client->_comm_timeout, 0);
-        TRACE("http_client_recv no header, checking pending responses ...");
-        http_check_pending_responses(ptr_espconn, parsed_response->body, parsed_response->content_len, http_client_recv);
-        delete parsed_response;
-        TRACE("http_client_recv response checked ...");
-        return;
-    }
-    client->update_status(HTTP_CLT_RESPONSE_READY);
-    client->parsed_response = parsed_response;
-    client->call_completed_func();
-    delete parsed_response;
     mem_mon_stack();
+    // a response can be split over several segments
+    // and a segment can contain more than one (pipelined) response
+    int consumed = client->recv(precdata, length);
+    // the completed function could have deleted the client
+    if ((consumed < length) && get_client(ptr_espconn))
+        http_client_recv(ptr_espconn, precdata + consumed, length - consumed);
 }
 
 //
@@ -203,6 +210,11 @@ static void http_client_recon(void *arg, sint8 err)
           pesp_conn->proto.tcp->remote_ip[3],
           pesp_conn->proto.tcp->remote_port,
           err);
+    // an idle connection was reset, no more reusable
+    Http_clt *client = get_client(pesp_conn);
+    if (client &&
+        ((client->get_status() == HTTP_CLT_CONNECTED) || (client->get_status() == HTTP_CLT_RESPONSE_READY)))
+        client->update_status(HTTP_CLT_DISCONNECTED);
     mem_mon_stack();
 }
 
@@ -225,6 +237,16 @@ static void http_client_discon(void *arg)
     // }
     // client->update_status(HTTP_CLT_DISCONNECTED);
     // client->call_completed_func();
+    Http_clt *client = get_client(pesp_conn);
+    mem_mon_stack();
+    // a body with no Content-Length ends here
+    // (the client could be deleted by the completion callback)
+    if (client && client->recv_closed())
+        return;
+    // an idle connection was closed by the server, no more reusable
+    if (client &&
+        ((client->get_status() == HTTP_CLT_CONNECTED) || (client->get_status() == HTTP_CLT_RESPONSE_READY)))
+        client->update_status(HTTP_CLT_DISCONNECTED);
     mem_mon_stack();
 }
 
@@ -262,21 +284,66 @@ Http_clt::Http_clt()
 {
     ALL("Http_clt");
     _status = HTTP_CLT_DISCONNECTED;
+    _resolving_port = 0;
     _completed_func = NULL;
     _param = NULL;
     this->parsed_response = NULL;
     this->request = NULL;
+    this->keep_alive = false;
+    _parser = NULL;
+    _response = NULL;
+    _discard = false;
+    _body = NULL;
+    _body_len = 0;
+    _body_size = 0;
+    _streaming = false;
+    _on_headers = NULL;
+    _on_body_chunk = NULL;
+    _stream_recv_hold = false;
+    _stream_held = false;
+    _req_queue = NULL;
+    _req_sent = 0;
+    _pipelining = false;
+    os_timer_disarm(&_connect_timeout_timer);
+    os_timer_disarm(&_send_req_timeout_timer);
+    os_timer_disarm(&_idle_timer);
     add_client_espconn_association(this, &_esp_conn);
 }
 
 Http_clt::~Http_clt()
 {
     ALL("~Http_clt");
+    os_timer_disarm(&_connect_timeout_timer);
+    os_timer_disarm(&_send_req_timeout_timer);
+    os_timer_disarm(&_idle_timer);
     del_client_association(this);
+    dns_cancel((void *)this);
+    if (_req_queue)
+    {
+        struct http_clt_queued_req *req = _req_queue->front();
+        while (req)
+        {
+            if (req->msg)
+                delete[] req->msg;
+            delete req;
+            _req_queue->pop();
+            req = _req_queue->front();
+        }
+        delete _req_queue;
+    }
+    if (_parser)
+        delete _parser;
+    if (_response)
+        delete _response;
+    if (_body)
+        delete[] _body;
     if ((_status != HTTP_CLT_DISCONNECTED) &&
         (_status != HTTP_CLT_CONNECT_FAILURE) &&
         (_status != HTTP_CLT_CONNECT_TIMEOUT) &&
-        (_status != HTTP_CLT_CONNECTING))
+        (_status != HTTP_CLT_CONNECTING) &&
+        (_status != HTTP_CLT_RESOLVING) &&
+        (_status != HTTP_CLT_RESOLVE_FAILURE) &&
+        (_esp_conn.state != ESPCONN_CLOSE))
     {
         espconn_disconnect(&_esp_conn);
     }
@@ -289,6 +356,18 @@ void Http_clt::connect(struct ip_addr t_server,
                       int comm_tout)
 {
     ALL("Http_clt::connect");
+    if (is_connected_to(t_server, t_port) && is_reusable())
+    {
+        // no need for a new connection
+        // the callback is anyway called asynchronously as for a new connection
+        _completed_func = completed_func;
+        _param = param;
+        _comm_timeout = comm_tout;
+        os_timer_disarm(&_connect_timeout_timer);
+        os_timer_setfn(&_connect_timeout_timer, (os_timer_func_t *)http_clt_reuse_connected, (void *)this);
+        os_timer_arm(&_connect_timeout_timer, 1, 0);
+        return;
+    }
     os_memcpy(&_host, &t_server, sizeof(struct ip_addr));
     _port = t_port;
 
@@ -323,6 +402,49 @@ void Http_clt::connect(struct ip_addr t_server,
     }
 }
 
+void Http_clt::connect(char *host,
+                       uint32 t_port,
+                       void (*completed_func)(void *),
+                       void *param,
+                       int comm_tout)
+{
+    ALL("Http_clt::connect");
+    struct ip_addr ip;
+    int res = dns_resolve(host, &ip, http_clt_host_resolved, (void *)this);
+    if (res == DNS_resolved)
+    {
+        // cached (or a dotted IP), no DNS round-trip
+        connect(ip, t_port, completed_func, param, comm_tout);
+        return;
+    }
+    _completed_func = completed_func;
+    _param = param;
+    _comm_timeout = comm_tout;
+    if (res == DNS_in_progress)
+    {
+        // the address could be a different one, the current connection won't be reused
+        if (is_reusable())
+            espconn_disconnect(&_esp_conn);
+        _resolving_port = t_port;
+        update_status(HTTP_CLT_RESOLVING);
+        return;
+    }
+    update_status(HTTP_CLT_RESOLVE_FAILURE);
+    call_completed_func();
+}
+
+void Http_clt::host_resolved(struct ip_addr *ip)
+{
+    ALL("Http_clt::host_resolved");
+    if (ip == NULL)
+    {
+        update_status(HTTP_CLT_RESOLVE_FAILURE);
+        call_completed_func();
+        return;
+    }
+    connect(*ip, _resolving_port, _completed_func, _param, _comm_timeout);
+}
+
 void Http_clt::disconnect(void (*completed_func)(void *), void *param)
 {
     ALL("Http_clt::disconnect");
@@ -341,6 +463,7 @@ void Http_clt::disconnect(void (*completed_func)(void *), void *param)
 void Http_clt::send_req(char *t_msg, int msg_len, void (*completed_func)(void *), void *param)
 {
     ALL("Http_clt::send_req");
+    _streaming = false;
     _completed_func = completed_func;
     _param = param;
     this->request = new char[msg_len + 1];
@@ -357,6 +480,14 @@ void Http_clt::send_req(char *t_msg, int msg_len, void (*completed_func)(void *)
     {
     case HTTP_CLT_CONNECTED:
     case HTTP_CLT_RESPONSE_READY:
+        if (!response_init())
+        {
+            delete[] this->request;
+            this->request = NULL;
+            _status = HTTP_CLT_CANNOT_SEND_REQUEST;
+            call_completed_func();
+            break;
+        }
         DEBUG("Http_clt::send_req msg %s\n", this->request);
         http_send(&_esp_conn, this->request, this->req_len);
         _status = HTTP_CLT_WAITING_RESPONSE;
@@ -374,6 +505,436 @@ void Http_clt::send_req(char *t_msg, int msg_len, void (*completed_func)(void *)
     mem_mon_stack();
 }
 
+void Http_clt::send_req_stream(char *t_msg, int msg_len,
+                               bool (*on_headers)(void *, Http_parsed_response *),
+                               bool (*on_body_chunk)(void *, char *, int),
+                               void (*on_complete)(void *),
+                               void *param,
+                               bool recv_hold)
+{
+    ALL("Http_clt::send_req_stream");
+    if ((_status != HTTP_CLT_CONNECTED) && (_status != HTTP_CLT_RESPONSE_READY))
+    {
+        // send_req will report the error
+        send_req(t_msg, msg_len, on_complete, param);
+        return;
+    }
+    send_req(t_msg, msg_len, on_complete, param);
+    if (_status != HTTP_CLT_WAITING_RESPONSE)
+        return;
+    _on_headers = on_headers;
+    _on_body_chunk = on_body_chunk;
+    _stream_recv_hold = recv_hold;
+    _streaming = true;
+}
+
+void Http_clt::recv_resume(void)
+{
+    ALL("Http_clt::recv_resume");
+    if (!_stream_held)
+        return;
+    _stream_held = false;
+    espconn_recv_unhold(&_esp_conn);
+    os_timer_arm(&_send_req_timeout_timer, _comm_timeout, 0);
+}
+
+int Http_clt::get_header(const char *name, char **value)
+{
+    if (_parser == NULL)
+        return -1;
+    return _parser->header(name, value);
+}
+
+// ready for receiving a new response
+bool Http_clt::response_init(void)
+{
+    if (_parser == NULL)
+    {
+        _parser = new Http_res_parser((void *)this, http_clt_res_headers, http_clt_res_body);
+        if (_parser == NULL)
+        {
+            dia_error_evnt(HTTP_CLT_RECV_HEAP_EXHAUSTED, sizeof(Http_res_parser));
+            ERROR("Http_clt::response_init heap exhausted %d", sizeof(Http_res_parser));
+            return false;
+        }
+    }
+    _parser->reset();
+    if (_response)
+    {
+        delete _response;
+        _response = NULL;
+    }
+    if (_body)
+    {
+        delete[] _body;
+        _body = NULL;
+    }
+    _discard = false;
+    if (_stream_held)
+    {
+        espconn_recv_unhold(&_esp_conn);
+        _stream_held = false;
+    }
+    return true;
+}
+
+int Http_clt::recv(char *data, int len)
+{
+    ALL("Http_clt::recv");
+    if (_discard || (_parser == NULL) || (_status != HTTP_CLT_WAITING_RESPONSE))
+    {
+        // no response expected (or the remains of a failed one)
+        TRACE("Http_clt::recv ignoring %d bytes", len);
+        return len;
+    }
+    // a pipelined response following the completed one
+    if (_parser->completed())
+        _parser->reset();
+    int consumed;
+    int res = _parser->feed(data, len, &consumed);
+    switch (res)
+    {
+    case HTTP_RES_PARSER_ok:
+        // waiting for more data
+        if (_streaming && _stream_recv_hold)
+        {
+            // no timeout while the caller keeps receiving paused
+            espconn_recv_hold(&_esp_conn);
+            _stream_held = true;
+        }
+        else
+        {
+            os_timer_arm(&_send_req_timeout_timer, _comm_timeout, 0);
+        }
+        return len;
+    case HTTP_RES_PARSER_completed:
+        response_complete();
+        return consumed;
+    case HTTP_RES_PARSER_aborted:
+        // refused by a callback (that already reported the reason)
+        response_failed(HTTP_CLT_RESPONSE_ERROR);
+        return len;
+    case HTTP_RES_PARSER_heap_exhausted:
+        dia_error_evnt(HTTP_CLT_RECV_HEAP_EXHAUSTED, (HTTP_RES_HEADER_MAX + 1));
+        ERROR("Http_clt::recv heap exhausted %d", (HTTP_RES_HEADER_MAX + 1));
+        response_failed(HTTP_CLT_RESPONSE_ERROR);
+        return len;
+    default:
+        dia_error_evnt(HTTP_CLT_RECV_BAD_RESPONSE, res);
+        ERROR("Http_clt::recv bad response err %d", res);
+        response_failed(HTTP_CLT_RESPONSE_ERROR);
+        return len;
+    }
+}
+
+bool Http_clt::recv_closed(void)
+{
+    ALL("Http_clt::recv_closed");
+    if (_discard || (_parser == NULL) || (_status != HTTP_CLT_WAITING_RESPONSE))
+        return false;
+    // a completed response was already delivered, the next one is missing
+    if (_parser->completed())
+        _parser->reset();
+    if (_parser->closed() == HTTP_RES_PARSER_completed)
+        response_complete();
+    else
+        // closed before the end of the response
+        response_failed(HTTP_CLT_RESPONSE_ERROR);
+    return true;
+}
+
+bool Http_clt::res_headers(Http_res_parser *parser)
+{
+    ALL("Http_clt::res_headers");
+    Http_parsed_response *response = new Http_parsed_response;
+    if (response == NULL)
+    {
+        dia_error_evnt(HTTP_CLT_RECV_HEAP_EXHAUSTED, sizeof(Http_parsed_response));
+        ERROR("Http_clt::res_headers heap exhausted %d", sizeof(Http_parsed_response));
+        return false;
+    }
+    response->no_header_message = false;
+    response->http_code = parser->http_code;
+    response->content_range_start = parser->content_range_start;
+    response->content_range_end = parser->content_range_end;
+    response->content_range_size = parser->content_range_size;
+    response->h_content_len = (parser->content_length > 0) ? parser->content_length : 0;
+    response->connection_close = parser->connection_close;
+    _response = response;
+    this->parsed_response = response;
+    TRACE("Http_clt::res_headers http code %d, content len %d, chunked %d",
+          parser->http_code,
+          parser->content_length,
+          parser->chunked);
+    if (_streaming)
+    {
+        keep_alive = !parser->connection_close;
+        if (_on_headers)
+            return _on_headers(_param, response);
+        return true;
+    }
+    // the body buffer, exact size when Content-Length is known
+    if (parser->content_length >= 0)
+        _body_size = parser->content_length + 1;
+    else
+        _body_size = HTTP_CLT_BODY_CHUNK;
+    _body_len = 0;
+    _body = new char[_body_size];
+    if (_body == NULL)
+    {
+        dia_error_evnt(HTTP_CLT_RECV_HEAP_EXHAUSTED, _body_size);
+        ERROR("Http_clt::res_headers heap exhausted %d", _body_size);
+        return false;
+    }
+    return true;
+}
+
+bool Http_clt::res_body(char *data, int len)
+{
+    if (_streaming)
+    {
+        if (_on_body_chunk)
+            return _on_body_chunk(_param, data, len);
+        return true;
+    }
+    if ((_body_len + len + 1) > _body_size)
+    {
+        // chunked or until close: growing the buffer
+        int size = _body_size * 2;
+        while (size < (_body_len + len + 1))
+            size *= 2;
+        char *body = new char[size];
+        if (body == NULL)
+        {
+            dia_error_evnt(HTTP_CLT_RECV_HEAP_EXHAUSTED, size);
+            ERROR("Http_clt::res_body heap exhausted %d", size);
+            return false;
+        }
+        os_memcpy(body, _body, _body_len);
+        delete[] _body;
+        _body = body;
+        _body_size = size;
+    }
+    os_memcpy(_body + _body_len, data, len);
+    _body_len += len;
+    return true;
+}
+
+// the completed function could delete the client: nothing can be done afterwards
+void Http_clt::response_complete(void)
+{
+    ALL("Http_clt::response_complete");
+    if (_stream_held)
+    {
+        espconn_recv_unhold(&_esp_conn);
+        _stream_held = false;
+    }
+    os_timer_disarm(&_send_req_timeout_timer);
+    Http_parsed_response *response = _response;
+    _response = NULL;
+    if (response && !_streaming)
+    {
+        _body[_body_len] = 0;
+        response->body = _body;
+        response->content_len = _body_len;
+        _body = NULL;
+        TRACE("Http_clt::response_complete body %s", response->body);
+    }
+    keep_alive = !_parser->connection_close;
+    this->parsed_response = response;
+    update_status(HTTP_CLT_RESPONSE_READY);
+    call_completed_func();
+    if (response)
+        delete response;
+    mem_mon_stack();
+}
+
+// the completed function could delete the client: nothing can be done afterwards
+void Http_clt::response_failed(Http_clt_status_type status)
+{
+    ALL("Http_clt::response_failed");
+    if (_stream_held)
+    {
+        espconn_recv_unhold(&_esp_conn);
+        _stream_held = false;
+    }
+    os_timer_disarm(&_send_req_timeout_timer);
+    if (_body)
+    {
+        delete[] _body;
+        _body = NULL;
+    }
+    // the data left of an incomplete response are ignored
+    // and the connection cannot be reused
+    _discard = true;
+    keep_alive = false;
+    Http_parsed_response *response = _response;
+    _response = NULL;
+    this->parsed_response = response;
+    update_status(status);
+    call_completed_func();
+    if (response)
+        delete response;
+}
+
+bool Http_clt::queue_req(char *t_msg, int msg_len, void (*completed_func)(void *), void *param)
+{
+    ALL("Http_clt::queue_req");
+    if ((_status != HTTP_CLT_CONNECTED) &&
+        (_status != HTTP_CLT_RESPONSE_READY) &&
+        (_status != HTTP_CLT_WAITING_RESPONSE))
+    {
+        INFO("Http_clt::queue_req - cannot queue request status is %d", _status);
+        return false;
+    }
+    if (_req_queue == NULL)
+    {
+        _req_queue = new Queue<struct http_clt_queued_req>(HTTP_CLT_REQ_QUEUE_MAX);
+        if (_req_queue == NULL)
+        {
+            dia_error_evnt(HTTP_CLT_QUEUE_REQ_HEAP_EXHAUSTED, sizeof(Queue<struct http_clt_queued_req>));
+            ERROR("Http_clt::queue_req heap exhausted %d", sizeof(Queue<struct http_clt_queued_req>));
+            return false;
+        }
+    }
+    if (_req_queue->full())
+    {
+        dia_warn_evnt(HTTP_CLT_QUEUE_REQ_FULL);
+        WARN("Http_clt::queue_req queue full");
+        return false;
+    }
+    struct http_clt_queued_req *req = new struct http_clt_queued_req;
+    if (req == NULL)
+    {
+        dia_error_evnt(HTTP_CLT_QUEUE_REQ_HEAP_EXHAUSTED, sizeof(struct http_clt_queued_req));
+        ERROR("Http_clt::queue_req heap exhausted %d", sizeof(struct http_clt_queued_req));
+        return false;
+    }
+    req->msg = new char[msg_len + 1];
+    if (req->msg == NULL)
+    {
+        dia_error_evnt(HTTP_CLT_QUEUE_REQ_HEAP_EXHAUSTED, (msg_len + 1));
+        ERROR("Http_clt::queue_req heap exhausted %d", (msg_len + 1));
+        delete req;
+        return false;
+    }
+    os_memcpy(req->msg, t_msg, msg_len);
+    req->msg_len = msg_len;
+    req->completed_func = completed_func;
+    req->param = param;
+    _req_queue->push(req);
+    queue_send();
+    mem_mon_stack();
+    return true;
+}
+
+void Http_clt::queue_send(void)
+{
+    ALL("Http_clt::queue_send");
+    while (_req_sent < _req_queue->size())
+    {
+        if (_req_sent == 0)
+        {
+            if ((_status != HTTP_CLT_CONNECTED) && (_status != HTTP_CLT_RESPONSE_READY))
+                return;
+        }
+        else
+        {
+            // pipelining only once the server proved to keep the connection alive
+            if (!_pipelining || !keep_alive || (_req_sent >= HTTP_CLT_PIPELINE_DEPTH))
+                return;
+        }
+        // the first request not sent yet
+        struct http_clt_queued_req *req = _req_queue->front();
+        int idx;
+        for (idx = 0; idx < _req_sent; idx++)
+            req = _req_queue->next();
+        _streaming = false;
+        if ((_req_sent == 0) && !response_init())
+            return;
+        _completed_func = http_clt_queue_completed;
+        _param = (void *)this;
+        DEBUG("Http_clt::queue_send msg %s", req->msg);
+        // http_send will free the message once sent
+        http_send(&_esp_conn, req->msg, req->msg_len);
+        req->msg = NULL;
+        _req_sent++;
+        _status = HTTP_CLT_WAITING_RESPONSE;
+        os_timer_disarm(&_send_req_timeout_timer);
+        os_timer_setfn(&_send_req_timeout_timer, (os_timer_func_t *)http_clt_send_req_timeout_function, (void *)this);
+        os_timer_arm(&_send_req_timeout_timer, _comm_timeout, 0);
+    }
+}
+
+// the completed functions could delete the client
+// so nothing can be done after the last one is called
+void Http_clt::queue_completed(void)
+{
+    ALL("Http_clt::queue_completed");
+    struct http_clt_queued_req *req;
+    bool last;
+    if (_req_queue == NULL)
+        return;
+    if (_status == HTTP_CLT_RESPONSE_READY)
+    {
+        req = _req_queue->front();
+        if (req == NULL)
+            return;
+        _req_queue->pop();
+        _req_sent--;
+        last = _req_queue->empty();
+        if (req->completed_func)
+            req->completed_func(req->param);
+        delete req;
+        if (last)
+            return;
+        if (keep_alive)
+        {
+            if (_req_sent > 0)
+            {
+                // the pipelined requests are still waiting for their responses
+                _status = HTTP_CLT_WAITING_RESPONSE;
+                os_timer_arm(&_send_req_timeout_timer, _comm_timeout, 0);
+            }
+            queue_send();
+            return;
+        }
+        // the server is closing the connection
+        update_status(HTTP_CLT_DISCONNECTED);
+    }
+    // error: the connection cannot be trusted anymore, completing all the queued requests
+    Http_clt_status_type status = _status;
+    keep_alive = false;
+    _req_sent = 0;
+    os_timer_disarm(&_send_req_timeout_timer);
+    while (!_req_queue->empty())
+    {
+        req = _req_queue->front();
+        _req_queue->pop();
+        last = _req_queue->empty();
+        if (req->msg)
+            delete[] req->msg;
+        _status = status;
+        if (req->completed_func)
+            req->completed_func(req->param);
+        delete req;
+        if (last)
+            return;
+    }
+}
+
+void Http_clt::set_pipelining(bool enabled)
+{
+    _pipelining = enabled;
+}
+
+int Http_clt::queued_reqs(void)
+{
+    if (_req_queue == NULL)
+        return 0;
+    return _req_queue->size();
+}
+
 Http_clt_status_type Http_clt::get_status(void)
 {
     return _status;
@@ -385,6 +946,30 @@ void Http_clt::update_status(Http_clt_status_type t_status)
     print_status();
 }
 
+bool Http_clt::is_connected_to(struct ip_addr host, uint32 port)
+{
+    return ((_host.addr == host.addr) && (_port == port));
+}
+
+bool Http_clt::is_reusable(void)
+{
+    if (!keep_alive && (_status != HTTP_CLT_CONNECTED))
+        return false;
+    if ((_status != HTTP_CLT_CONNECTED) && (_status != HTTP_CLT_RESPONSE_READY))
+        return false;
+    if ((_esp_conn.state == ESPCONN_NONE) || (_esp_conn.state == ESPCONN_CLOSE))
+        return false;
+    return true;
+}
+
+void Http_clt::park(void)
+{
+    // an idle client must not call back its previous user
+    _completed_func = NULL;
+    _param = NULL;
+    this->parsed_response = NULL;
+}
+
 void Http_clt::call_completed_func(void)
 {
     if (_completed_func)
@@ -426,10 +1011,270 @@ void Http_clt::print_status(void)
     case HTTP_CLT_RESPONSE_TIMEOUT:
         status = (char *)f_str("RESPONSE_TIMEOUT");
         break;
+    case HTTP_CLT_RESOLVING:
+        status = (char *)f_str("RESOLVING");
+        break;
+    case HTTP_CLT_RESOLVE_FAILURE:
+        status = (char *)f_str("RESOLVE_FAILURE");
+        break;
     default:
         status = (char *)f_str("UNKNOWN");
         break;
     }
     TRACE("Http_clt status --> %s", status);
     mem_mon_stack();
-}
\ No newline at end of file
+}
+//
+// DOWNLOAD TO FILE
+//
+
+struct http_clt_download
+{
+    Http_clt *client;
+    Espfile *file;
+    char filename[32];
+    void (*completed_func)(void *);
+    void *param;
+};
+
+static bool download_on_headers(void *param, Http_parsed_response *response)
+{
+    struct http_clt_download *download = (struct http_clt_download *)param;
+    if ((response->http_code < 200) || (response->http_code > 299))
+    {
+        INFO("http_clt_download_file %s http code %d", download->filename, response->http_code);
+        return false;
+    }
+    download->file = new Espfile(download->filename);
+    if (download->file == NULL)
+    {
+        dia_error_evnt(HTTP_CLT_DOWNLOAD_HEAP_EXHAUSTED, sizeof(Espfile));
+        ERROR("download_on_headers heap exhausted %d", sizeof(Espfile));
+        return false;
+    }
+    if (download->file->clear() != SPIFFS_OK)
+    {
+        dia_error_evnt(HTTP_CLT_DOWNLOAD_FILE_WRITE_ERROR);
+        ERROR("download_on_headers cannot write %s", download->filename);
+        return false;
+    }
+    return true;
+}
+
+static bool download_on_body_chunk(void *param, char *data, int len)
+{
+    struct http_clt_download *download = (struct http_clt_download *)param;
+    if (download->file->n_append(data, len) < SPIFFS_OK)
+    {
+        dia_error_evnt(HTTP_CLT_DOWNLOAD_FILE_WRITE_ERROR);
+        ERROR("download_on_body_chunk cannot write %s", download->filename);
+        return false;
+    }
+    return true;
+}
+
+static void download_on_complete(void *param)
+{
+    ALL("download_on_complete");
+    struct http_clt_download *download = (struct http_clt_download *)param;
+    bool failed = (download->client->get_status() != HTTP_CLT_RESPONSE_READY);
+    if (download->file)
+    {
+        // closing the file will flush the cache
+        delete download->file;
+        if (failed)
+        {
+            // no partial files
+            Espfile partial(download->filename);
+            partial.remove();
+        }
+    }
+    void (*completed_func)(void *) = download->completed_func;
+    void *completed_param = download->param;
+    delete download;
+    mem_mon_stack();
+    if (completed_func)
+        completed_func(completed_param);
+}
+
+void http_clt_download_file(Http_clt *client,
+                            char *request,
+                            int req_len,
+                            char *filename,
+                            void (*completed_func)(void *),
+                            void *param)
+{
+    ALL("http_clt_download_file");
+    struct http_clt_download *download = new struct http_clt_download;
+    if (download == NULL)
+    {
+        dia_error_evnt(HTTP_CLT_DOWNLOAD_HEAP_EXHAUSTED, sizeof(struct http_clt_download));
+        ERROR("http_clt_download_file heap exhausted %d", sizeof(struct http_clt_download));
+        client->update_status(HTTP_CLT_CANNOT_SEND_REQUEST);
+        if (completed_func)
+            completed_func(param);
+        return;
+    }
+    download->client = client;
+    download->file = NULL;
+    os_strncpy(download->filename, filename, 31);
+    download->filename[31] = 0;
+    download->completed_func = completed_func;
+    download->param = param;
+    client->send_req_stream(request, req_len,
+                            download_on_headers,
+                            download_on_body_chunk,
+                            download_on_complete,
+                            download);
+}
+
+//
+// CONNECTION POOL
+//
+
+static struct
+{
+    uint32 idle_timeout;
+    uint32 new_clients;
+    uint32 reused;
+    uint32 expired;   // closed after the idle timeout
+    uint32 discarded; // closed by the server or pool full
+} http_clt_pool_state = {HTTP_CLT_POOL_IDLE_TIMEOUT, 0, 0, 0, 0};
+
+// result: true when the client was found (and removed) into the pool
+static bool http_clt_pool_take(Http_clt *client)
+{
+    Http_clt *ptr = http_clt_pool->front();
+    while (ptr)
+    {
+        if (ptr == client)
+        {
+            http_clt_pool->remove();
+            os_timer_disarm(&client->_idle_timer);
+            return true;
+        }
+        ptr = http_clt_pool->next();
+    }
+    return false;
+}
+
+static void http_clt_pool_idle_expired(void *arg)
+{
+    ALL("http_clt_pool_idle_expired");
+    Http_clt *client = (Http_clt *)arg;
+    if (http_clt_pool_take(client))
+    {
+        http_clt_pool_state.expired++;
+        delete client;
+    }
+    mem_mon_stack();
+}
+
+Http_clt *http_clt_pool_get(struct ip_addr host, uint32 port)
+{
+    ALL("http_clt_pool_get");
+    Http_clt *client = http_clt_pool->front();
+    while (client)
+    {
+        if (client->is_connected_to(host, port))
+        {
+            http_clt_pool_take(client);
+            // health check: the server could have closed the connection meanwhile
+            if (client->is_reusable())
+            {
+                http_clt_pool_state.reused++;
+                TRACE("http_clt_pool_get reusing client %X", client);
+                return client;
+            }
+            http_clt_pool_state.discarded++;
+            delete client;
+            // one element removed from list, better restart from front
+            client = http_clt_pool->front();
+            continue;
+        }
+        client = http_clt_pool->next();
+    }
+    client = new Http_clt;
+    if (client == NULL)
+    {
+        dia_error_evnt(HTTP_CLT_POOL_GET_HEAP_EXHAUSTED, sizeof(Http_clt));
+        ERROR("http_clt_pool_get heap exhausted %d", sizeof(Http_clt));
+        return NULL;
+    }
+    http_clt_pool_state.new_clients++;
+    mem_mon_stack();
+    return client;
+}
+
+Http_clt *http_clt_pool_get(char *host, uint32 port)
+{
+    struct ip_addr ip;
+    // the idle connections are known by address
+    if (!dns_cache_lookup(host, &ip))
+        ip.addr = 0;
+    return http_clt_pool_get(ip, port);
+}
+
+void http_clt_pool_release(Http_clt *client)
+{
+    ALL("http_clt_pool_release");
+    if (client == NULL)
+        return;
+    os_timer_disarm(&client->_connect_timeout_timer);
+    os_timer_disarm(&client->_send_req_timeout_timer);
+    if ((http_clt_pool_state.idle_timeout == 0) || !client->is_reusable())
+    {
+        delete client;
+        return;
+    }
+    if (http_clt_pool->full())
+    {
+        // make room closing the oldest idle connection
+        Http_clt *oldest = http_clt_pool->front();
+        http_clt_pool_take(oldest);
+        http_clt_pool_state.discarded++;
+        delete oldest;
+    }
+    if (http_clt_pool->push_back(client) != list_ok)
+    {
+        delete client;
+        return;
+    }
+    client->park();
+    os_timer_disarm(&client->_idle_timer);
+    os_timer_setfn(&client->_idle_timer, (os_timer_func_t *)http_clt_pool_idle_expired, (void *)client);
+    os_timer_arm(&client->_idle_timer, http_clt_pool_state.idle_timeout, 0);
+    TRACE("http_clt_pool_release client %X kept alive", client);
+    mem_mon_stack();
+}
+
+void http_clt_pool_set_idle_timeout(uint32 idle_timeout_ms)
+{
+    // 0 disables the pool
+    http_clt_pool_state.idle_timeout = idle_timeout_ms;
+}
+
+char *http_clt_pool_stats_json_stringify(char *dest, int len)
+{
+    Json_writer json(dest, len);
+    while (json.pass())
+    {
+        json.obj_begin();
+        json.num(f_str("idle"), http_clt_pool->size());
+        json.num(f_str("max_idle"), HTTP_CLT_POOL_MAX_IDLE);
+        json.unum(f_str("idle_timeout"), http_clt_pool_state.idle_timeout);
+        json.unum(f_str("new_clients"), http_clt_pool_state.new_clients);
+        json.unum(f_str("reused"), http_clt_pool_state.reused);
+        json.unum(f_str("expired"), http_clt_pool_state.expired);
+        json.unum(f_str("discarded"), http_clt_pool_state.discarded);
+        json.obj_end();
+    }
+    char *msg = json.result();
+    if (msg == NULL)
+    {
+        dia_error_evnt(HTTP_CLT_POOL_STATS_STRINGIFY_HEAP_EXHAUSTED, json.len());
+        ERROR("http_clt_pool_stats_json_stringify heap exhausted [%d]", json.len());
+    }
+    mem_mon_stack();
+    return msg;
+}
@@ -0,0 +1,433 @@
+/*
+ * ----------------------------------------------------------------------------
+ * "THE BEER-WARE LICENSE" (Revision 42):
+ * <quackmore-ff@yahoo.com> wrote this file.  As long as you retain this notice
+ * you can do whatever you want with this stuff. If we meet some day, and you 
+ * think this stuff is worth it, you can buy me a beer in return. Quackmore
+ * ----------------------------------------------------------------------------
+ */
+
+// SDK includes
+extern "C"
+{
+#include "c_types.h"
+#include "mem.h"
+#include "osapi.h"
+}
+
+#include "espbot.hpp"
+#include "espbot_diagnostic.hpp"
+#include "espbot_event_codes.h"
+#include "espbot_http_parser.hpp"
+#include "espbot_mem_mon.hpp"
+#include "espbot_scan.hpp"
+#include "espbot_utils.hpp"
+
+//
+// header value views helpers
+//
+
+static inline char http_lower(char cc)
+{
+    if ((cc >= 'A') && (cc <= 'Z'))
+        return cc + ('a' - 'A');
+    return cc;
+}
+
+static bool http_view_equal_ci(char *view, const char *str, int len)
+{
+    int idx;
+    for (idx = 0; idx < len; idx++)
+        if (http_lower(view[idx]) != http_lower(str[idx]))
+            return false;
+    return true;
+}
+
+static bool http_view_contains_ci(char *view, int view_len, const char *token)
+{
+    int token_len = os_strlen(token);
+    int idx;
+    for (idx = 0; idx <= (view_len - token_len); idx++)
+        if (http_view_equal_ci(view + idx, token, token_len))
+            return true;
+    return false;
+}
+
+// result: the count of digits converted, a digit overflowing an int stops the conversion
+static int http_view_int(char *view, int view_len, int *value)
+{
+    int idx = 0;
+    *value = 0;
+    while ((idx < view_len) && (view[idx] >= '0') && (view[idx] <= '9'))
+    {
+        int digit = view[idx] - '0';
+        if (*value > ((0x7FFFFFFF - digit) / 10))
+            break;
+        *value = (*value * 10) + digit;
+        idx++;
+    }
+    return idx;
+}
+
+//
+// Http_res_parser
+//
+
+Http_res_parser::Http_res_parser(void *param,
+                                 bool (*on_headers)(void *param, Http_res_parser *parser),
+                                 bool (*on_body)(void *param, char *data, int len))
+{
+    m_param = param;
+    m_on_headers = on_headers;
+    m_on_body = on_body;
+    // allocated on the first feed
+    m_header = NULL;
+    reset();
+}
+
+Http_res_parser::~Http_res_parser()
+{
+    if (m_header)
+        delete[] m_header;
+}
+
+void Http_res_parser::reset(void)
+{
+    m_state = RES_header;
+    m_header_len = 0;
+    m_line_len = 0;
+    m_remaining = 0;
+    m_digits = 0;
+    http_code = 0;
+    connection_close = false;
+    content_length = -1;
+    chunked = false;
+    content_range_start = 0;
+    content_range_end = 0;
+    content_range_size = 0;
+}
+
+bool Http_res_parser::completed(void)
+{
+    return (m_state == RES_completed);
+}
+
+int Http_res_parser::header(const char *name, char **value)
+{
+    if (m_header == NULL)
+        return -1;
+    int name_len = os_strlen(name);
+    char *end = m_header + m_header_len;
+    // skip the status line
+    char *line = scan_char(m_header, end, '\n');
+    if (line == NULL)
+        return -1;
+    line++;
+    while (line < end)
+    {
+        char *line_end = scan_char(line, end, '\n');
+        if (line_end == NULL)
+            line_end = end;
+        if (((line_end - line) > name_len) &&
+            (line[name_len] == ':') &&
+            http_view_equal_ci(line, name, name_len))
+        {
+            char *ptr = line + name_len + 1;
+            while ((ptr < line_end) && ((*ptr == ' ') || (*ptr == '\t')))
+                ptr++;
+            char *value_end = line_end;
+            while ((value_end > ptr) &&
+                   ((*(value_end - 1) == '\r') || (*(value_end - 1) == ' ') || (*(value_end - 1) == '\t')))
+                value_end--;
+            *value = ptr;
+            return (value_end - ptr);
+        }
+        line = line_end + 1;
+    }
+    return -1;
+}
+
+int Http_res_parser::parse_header(void)
+{
+    ALL("Http_res_parser::parse_header");
+    // status line: HTTP/1.1 200 OK
+    if ((m_header_len < 12) || (os_strncmp(m_header, f_str("HTTP/1."), 7) != 0))
+        return HTTP_RES_PARSER_bad_syntax;
+    bool http_1_0 = (m_header[7] == '0');
+    char *ptr = m_header + 8;
+    while (*ptr == ' ')
+        ptr++;
+    if (http_view_int(ptr, 3, &http_code) != 3)
+        return HTTP_RES_PARSER_bad_syntax;
+    if ((http_code >= 100) && (http_code < 200))
+    {
+        // interim response, the final one will follow
+        m_header_len = 0;
+        m_line_len = 0;
+        http_code = 0;
+        return HTTP_RES_PARSER_ok;
+    }
+    char *value;
+    int value_len;
+    value_len = header(f_str("Content-Length"), &value);
+    if (value_len >= 0)
+    {
+        if ((value_len == 0) || (http_view_int(value, value_len, &content_length) != value_len))
+            return HTTP_RES_PARSER_bad_syntax;
+    }
+    value_len = header(f_str("Transfer-Encoding"), &value);
+    if ((value_len > 0) && http_view_contains_ci(value, value_len, f_str("chunked")))
+    {
+        // chunked framing wins over Content-Length (RFC 7230)
+        chunked = true;
+        content_length = -1;
+    }
+    value_len = header(f_str("Connection"), &value);
+    if (value_len > 0)
+        connection_close = (http_view_contains_ci(value, value_len, f_str("close")) ||
+                            (http_1_0 && !http_view_contains_ci(value, value_len, f_str("keep-alive"))));
+    else
+        connection_close = http_1_0;
+    // Content-Range: bytes 0-1023/4096
+    value_len = header(f_str("Content-Range"), &value);
+    if ((value_len > 6) && http_view_equal_ci(value, f_str("bytes "), 6))
+    {
+        ptr = value + 6;
+        char *value_end = value + value_len;
+        ptr += http_view_int(ptr, value_end - ptr, &content_range_start);
+        if ((ptr < value_end) && (*ptr == '-'))
+            ptr++;
+        ptr += http_view_int(ptr, value_end - ptr, &content_range_end);
+        if ((ptr < value_end) && (*ptr == '/'))
+            ptr++;
+        http_view_int(ptr, value_end - ptr, &content_range_size);
+    }
+    TRACE("Http_res_parser code %d, len %d, chunked %d, close %d",
+          http_code, content_length, chunked, connection_close);
+    // the body framing
+    if ((http_code == 204) || (http_code == 304))
+    {
+        m_state = RES_completed;
+    }
+    else if (chunked)
+    {
+        m_remaining = 0;
+        m_digits = 0;
+        m_state = RES_chunk_size;
+    }
+    else if (content_length >= 0)
+    {
+        m_remaining = content_length;
+        m_state = (content_length == 0) ? RES_completed : RES_body_fixed;
+    }
+    else
+    {
+        m_state = RES_body_until_close;
+    }
+    if (!m_on_headers(m_param, this))
+        return HTTP_RES_PARSER_aborted;
+    mem_mon_stack();
+    return HTTP_RES_PARSER_ok;
+}
+
+int Http_res_parser::feed(char *data, int len, int *consumed)
+{
+    int idx = 0;
+    int avail;
+    int res;
+    char *line_end;
+    *consumed = len;
+    if (m_header == NULL)
+    {
+        m_header = new char[HTTP_RES_HEADER_MAX + 1];
+        if (m_header == NULL)
+        {
+            m_state = RES_error;
+            return HTTP_RES_PARSER_heap_exhausted;
+        }
+    }
+    while (idx < len)
+    {
+        char cc = data[idx];
+        switch (m_state)
+        {
+        case RES_header:
+            // copying up to the line end at once
+            line_end = scan_char(data + idx, data + len, '\n');
+            avail = (line_end ? (line_end + 1) : (data + len)) - (data + idx);
+            if ((m_header_len + avail) > HTTP_RES_HEADER_MAX)
+            {
+                m_state = RES_error;
+                return HTTP_RES_PARSER_header_too_long;
+            }
+            os_memcpy(m_header + m_header_len, data + idx, avail);
+            m_header_len += avail;
+            idx += avail;
+            if (line_end == NULL)
+            {
+                m_line_len += avail;
+                break;
+            }
+            // the line length, with no CR and LF
+            m_line_len += avail - 1;
+            if ((m_line_len > 0) && (m_header[m_header_len - 2] == '\r'))
+                m_line_len--;
+            if (m_line_len > 0)
+            {
+                m_line_len = 0;
+                break;
+            }
+            // an empty line
+            if (m_header_len <= 2)
+            {
+                // before the status line, ignored
+                m_header_len = 0;
+                break;
+            }
+            res = parse_header();
+            if (res != HTTP_RES_PARSER_ok)
+            {
+                m_state = RES_error;
+                return res;
+            }
+            if (m_state == RES_completed)
+            {
+                *consumed = idx;
+                return HTTP_RES_PARSER_completed;
+            }
+            break;
+        case RES_body_fixed:
+        case RES_body_until_close:
+            avail = len - idx;
+            if ((m_state == RES_body_fixed) && (avail > m_remaining))
+                avail = m_remaining;
+            if (!m_on_body(m_param, data + idx, avail))
+            {
+                m_state = RES_error;
+                return HTTP_RES_PARSER_aborted;
+            }
+            idx += avail;
+            if (m_state == RES_body_fixed)
+            {
+                m_remaining -= avail;
+                if (m_remaining == 0)
+                {
+                    m_state = RES_completed;
+                    *consumed = idx;
+                    return HTTP_RES_PARSER_completed;
+                }
+            }
+            break;
+        case RES_chunk_size:
+            idx++;
+            if (((cc >= '0') && (cc <= '9')) ||
+                ((http_lower(cc) >= 'a') && (http_lower(cc) <= 'f')))
+            {
+                if (m_remaining > 0x07FFFFFF)
+                {
+                    m_state = RES_error;
+                    return HTTP_RES_PARSER_bad_syntax;
+                }
+                m_remaining = (m_remaining << 4) + ((cc <= '9') ? (cc - '0') : (http_lower(cc) - 'a' + 10));
+                m_digits++;
+            }
+            else if ((cc == ';') || (cc == ' ') || (cc == '\t'))
+            {
+                m_state = RES_chunk_ext;
+            }
+            else if (cc == '\n')
+            {
+                if (m_digits == 0)
+                {
+                    m_state = RES_error;
+                    return HTTP_RES_PARSER_bad_syntax;
+                }
+                if (m_remaining == 0)
+                {
+                    // last chunk
+                    m_line_len = 0;
+                    m_state = RES_trailers;
+                }
+                else
+                {
+                    m_state = RES_chunk_data;
+                }
+            }
+            else if (cc != '\r')
+            {
+                m_state = RES_error;
+                return HTTP_RES_PARSER_bad_syntax;
+            }
+            break;
+        case RES_chunk_ext:
+            // chunk extensions are ignored, the LF is processed as the chunk size end
+            if (cc == '\n')
+                m_state = RES_chunk_size;
+            else
+                idx++;
+            break;
+        case RES_chunk_data:
+            avail = len - idx;
+            if (avail > m_remaining)
+                avail = m_remaining;
+            if (!m_on_body(m_param, data + idx, avail))
+            {
+                m_state = RES_error;
+                return HTTP_RES_PARSER_aborted;
+            }
+            idx += avail;
+            m_remaining -= avail;
+            if (m_remaining == 0)
+                m_state = RES_chunk_data_end;
+            break;
+        case RES_chunk_data_end:
+            idx++;
+            if (cc == '\r')
+                break;
+            if (cc != '\n')
+            {
+                m_state = RES_error;
+                return HTTP_RES_PARSER_bad_syntax;
+            }
+            m_remaining = 0;
+            m_digits = 0;
+            m_state = RES_chunk_size;
+            break;
+        case RES_trailers:
+            idx++;
+            if (cc == '\r')
+                break;
+            if (cc != '\n')
+            {
+                m_line_len++;
+                break;
+            }
+            if (m_line_len > 0)
+            {
+                m_line_len = 0;
+                break;
+            }
+            m_state = RES_completed;
+            *consumed = idx;
+            return HTTP_RES_PARSER_completed;
+        case RES_completed:
+            *consumed = idx;
+            return HTTP_RES_PARSER_completed;
+        default:
+            return HTTP_RES_PARSER_bad_syntax;
+        }
+    }
+    return HTTP_RES_PARSER_ok;
+}
+
+int Http_res_parser::closed(void)
+{
+    if ((m_state == RES_body_until_close) || (m_state == RES_completed))
+    {
+        connection_close = true;
+        m_state = RES_completed;
+        return HTTP_RES_PARSER_completed;
+    }
+    m_state = RES_error;
+    return HTTP_RES_PARSER_bad_syntax;
+}
@@ -19,13 +19,19 @@ extern "C"
 
 #include "app_http_routes.hpp"
 #include "espbot.hpp"
+#include "espbot_cors.hpp"
 #include "espbot_cron.hpp"
 #include "espbot_diagnostic.hpp"
 #include "espbot_event_codes.h"
 #include "espbot_gpio.hpp"
 #include "espbot_http.hpp"
+#include "espbot_http_cache.hpp"
+#include "espbot_http_client.hpp"
 #include "espbot_http_routes.hpp"
+#include "espbot_jobs.hpp"
 #include "espbot_json.hpp"
+#include "espbot_json_sax.hpp"
+#include "espbot_json_writer.hpp"
 #include "espbot_mem_mon.hpp"
 #include "espbot_mdns.hpp"
 #include "espbot_ota.hpp"
@@ -35,6 +41,10 @@ extern "C"
 #include "espbot_http_server.hpp"
 #include "espbot_wifi.hpp"
 
+// request bodies with several fields are indexed once (see JSONP::index)
+// bodies with more pairs are scanned for every field
+#define ROUTES_BODY_TOKENS 8
+
 static os_timer_t delay_timer;
 
 void init_controllers(void)
@@ -42,16 +52,74 @@ void init_controllers(void)
     os_timer_disarm(&delay_timer);
 }
 
-static void getAPlist(void *param)
+//
+// ASYNCHRONOUS JOBS
+//
+// expensive requests are executed as jobs:
+// the reply is a 202 with the job id and the job status/result
+// is available at /api/jobs/{id}
+//
+
+static void job_accepted(struct espconn *ptr_espconn, int job_id)
 {
-    struct espconn *ptr_espconn = (struct espconn *)param;
-    ALL("getAPlist");
-    char *scan_list = espwifi_scan_results_json_stringify();
-    if (scan_list)
-        http_response(ptr_espconn, HTTP_OK, HTTP_CONTENT_JSON, scan_list, true);
+    ALL("job_accepted");
+    if (job_id == JOB_table_full)
+    {
+        http_response(ptr_espconn, HTTP_CONFLICT, HTTP_CONTENT_JSON, f_str("Too many jobs, try again later"), false);
+        return;
+    }
+    if (job_id == JOB_same_type_pending)
+    {
+        http_response(ptr_espconn, HTTP_CONFLICT, HTTP_CONTENT_JSON, f_str("A job of the same type is pending, try again later"), false);
+        return;
+    }
+    if (job_id < 0)
+    {
+        http_response(ptr_espconn, HTTP_SERVER_ERROR, HTTP_CONTENT_JSON, f_str("Heap exhausted"), false);
+        return;
+    }
+    char *msg = jobs_json_stringify(job_id);
+    if (msg)
+        http_response(ptr_espconn, HTTP_ACCEPTED, HTTP_CONTENT_JSON, msg, true);
     else
         http_response(ptr_espconn, HTTP_SERVER_ERROR, HTTP_CONTENT_JSON, f_str("Heap exhausted"), false);
+}
+
+static void job_set_msg(int job_id, const char *str)
+{
+    Heap_chunk msg(os_strlen(str), dont_free);
+    if (msg.ref == NULL)
+    {
+        dia_error_evnt(ROUTES_JOB_HEAP_EXHAUSTED, os_strlen(str) + 1);
+        ERROR("job_set_msg heap exhausted %d", os_strlen(str) + 1);
+        return;
+    }
+    os_strcpy(msg.ref, str);
+    jobs_set_result(job_id, msg.ref);
+}
+
+static void wifi_scan_completed(void *param)
+{
+    ALL("wifi_scan_completed");
+    int job_id = (int)param;
+    char *scan_list = espwifi_scan_results_json_stringify();
     espwifi_free_ap_list();
+    if (scan_list)
+    {
+        jobs_set_result(job_id, scan_list);
+        jobs_set_completed(job_id, true);
+    }
+    else
+    {
+        jobs_set_completed(job_id, false);
+    }
+}
+
+static Job_step_res wifi_scan_job(int job_id, void *param)
+{
+    ALL("wifi_scan_job");
+    espwifi_scan_for_ap(NULL, wifi_scan_completed, (void *)job_id);
+    return JOB_step_waiting;
 }
 
 static const char *get_file_mime_type(char *filename)
@@ -193,19 +261,7 @@ void return_file(struct espconn *p_espconn, Http_parsed_req *parsed_req, char *f
     header.m_content_range_start = 0;
     header.m_content_range_end = 0;
     header.m_content_range_total = 0;
-    if (parsed_req->origin)
-    {
-        header.m_origin = new char[(os_strlen(parsed_req->origin) + 1)];
-        if (header.m_origin == NULL)
-        {
-            dia_error_evnt(ROUTES_RETURN_FILE_HEAP_EXHAUSTED, (os_strlen(parsed_req->origin) + 1));
-            ERROR("return_file heap exhausted %d", (os_strlen(parsed_req->origin) + 1));
-            http_response(p_espconn, HTTP_SERVER_ERROR, HTTP_CONTENT_JSON, f_str("Heap exhausted"), false);
-            return;
-        }
-        os_strcpy(header.m_origin, parsed_req->origin);
-    }
-    char *header_str = http_format_header(&header);
+    char *header_str = http_format_header(p_espconn, &header);
     if (header_str == NULL)
     {
         dia_error_evnt(ROUTES_RETURN_FILE_HEAP_EXHAUSTED, (os_strlen(header_str)));
@@ -312,21 +368,7 @@ void preflight_response(struct espconn *p_espconn, Http_parsed_req *parsed_req)
     Http_header header;
     header.m_code = HTTP_OK;
     header.m_content_type = (char *)get_file_mime_type(HTTP_CONTENT_JSON);
-    if (parsed_req->origin)
-    {
-        header.m_origin = new char[os_strlen(parsed_req->origin) + 1];
-        if (header.m_origin == NULL)
-        {
-            dia_error_evnt(ROUTES_PREFLIGHT_RESPONSE_HEAP_EXHAUSTED, (os_strlen(parsed_req->origin) + 1));
-            http_response(p_espconn, HTTP_SERVER_ERROR, HTTP_CONTENT_JSON, f_str("Heap exhausted"), false);
-            return;
-        }
-        os_strcpy(header.m_origin, parsed_req->origin);
-    }
-    else
-    {
-        header.m_origin = NULL;
-    }
+    header.m_cors_preflight = true;
     if (parsed_req->acrh)
     {
         header.m_acrh = new char[os_strlen(parsed_req->acrh) + 1];
@@ -346,7 +388,7 @@ void preflight_response(struct espconn *p_espconn, Http_parsed_req *parsed_req)
     header.m_content_range_start = 0;
     header.m_content_range_end = 0;
     header.m_content_range_total = 0;
-    char *header_str = http_format_header(&header);
+    char *header_str = http_format_header(p_espconn, &header);
     if (header_str == NULL)
     {
         dia_error_evnt(ROUTES_PREFLIGHT_RESPONSE_HEAP_EXHAUSTED);
@@ -357,6 +399,54 @@ void preflight_response(struct espconn *p_espconn, Http_parsed_req *parsed_req)
     http_send_buffer(p_espconn, 0, header_str, os_strlen(header_str));
 }
 
+static void getCorsCfg(struct espconn *ptr_espconn, Http_parsed_req *parsed_req)
+{
+    ALL("getCorsCfg");
+    http_cache_response(ptr_espconn, parsed_req, cors_cfg_json_stringify);
+}
+
+static void setCorsCfg(struct espconn *ptr_espconn, Http_parsed_req *parsed_req)
+{
+    ALL("setCorsCfg");
+    // the policy fields are comma separated lists
+    // that JSONP cannot tell from the object structure, so binding them from SAX events
+    char origins[CORS_ORIGINS_LEN];
+    char methods[CORS_METHODS_LEN];
+    char headers[CORS_HEADERS_LEN];
+    int max_age;
+    struct json_field fields[] = {
+        {f_str("origins"), JSON_str, origins, CORS_ORIGINS_LEN, false},
+        {f_str("methods"), JSON_str, methods, CORS_METHODS_LEN, false},
+        {f_str("headers"), JSON_str, headers, CORS_HEADERS_LEN, false},
+        {f_str("max_age"), JSON_num, &max_age, sizeof(int), false}};
+    Json_binder req_corscfg(fields, 4);
+    req_corscfg.feed(parsed_req->req_content, parsed_req->content_len);
+    if (req_corscfg.end() != JSON_noerr)
+    {
+        http_response(ptr_espconn, HTTP_BAD_REQUEST, HTTP_CONTENT_JSON, f_str("Json bad syntax"), false);
+        return;
+    }
+    if ((os_strlen(origins) == 0) || (os_strlen(methods) == 0) || (os_strlen(headers) == 0))
+    {
+        http_response(ptr_espconn, HTTP_BAD_REQUEST, HTTP_CONTENT_JSON, f_str("Empty CORS policy field"), false);
+        return;
+    }
+    if (!cors_set_cfg(origins, methods, headers, max_age))
+    {
+        http_response(ptr_espconn, HTTP_SERVER_ERROR, HTTP_CONTENT_JSON, f_str("Heap exhausted"), false);
+        return;
+    }
+    cors_cfg_save();
+    // the new policy applies to this very response too
+    cors_set_req_origin(ptr_espconn, parsed_req->origin);
+    char *msg = cors_cfg_json_stringify();
+    if (msg)
+        http_response(ptr_espconn, HTTP_OK, HTTP_CONTENT_JSON, msg, true);
+    else
+        http_response(ptr_espconn, HTTP_SERVER_ERROR, HTTP_CONTENT_JSON, f_str("Heap exhausted"), false);
+    mem_mon_stack();
+}
+
 static void getCron(struct espconn *ptr_espconn, Http_parsed_req *parsed_req)
 {
     ALL("getCron");
@@ -391,6 +481,26 @@ static void setCron(struct espconn *ptr_espconn, Http_parsed_req *parsed_req)
     mem_mon_stack();
 }
 
+static void getHttpCache(struct espconn *ptr_espconn, Http_parsed_req *parsed_req)
+{
+    ALL("getHttpCache");
+    char *msg = http_cache_stats_json_stringify();
+    if (msg)
+        http_response(ptr_espconn, HTTP_OK, HTTP_CONTENT_JSON, msg, true);
+    else
+        http_response(ptr_espconn, HTTP_SERVER_ERROR, HTTP_CONTENT_JSON, f_str("Heap exhausted"), false);
+}
+
+static void getHttpClientPool(struct espconn *ptr_espconn, Http_parsed_req *parsed_req)
+{
+    ALL("getHttpClientPool");
+    char *msg = http_clt_pool_stats_json_stringify();
+    if (msg)
+        http_response(ptr_espconn, HTTP_OK, HTTP_CONTENT_JSON, msg, true);
+    else
+        http_response(ptr_espconn, HTTP_SERVER_ERROR, HTTP_CONTENT_JSON, f_str("Heap exhausted"), false);
+}
+
 static void getLastReset(struct espconn *ptr_espconn, Http_parsed_req *parsed_req)
 {
     ALL("getLastReset");
@@ -422,6 +532,46 @@ static void getMemDump(struct espconn *ptr_espconn, Http_parsed_req *parsed_req)
     mem_mon_stack();
 }
 
+#define HEX_DUMP_JOB_SLICE 128 // bytes dumped on each job step
+
+struct hex_dump
+{
+    char *address;
+    int length;
+    int dumped;
+    char *msg;
+    int msg_len;
+};
+
+static void hex_dump_job_release(void *param)
+{
+    struct hex_dump *dump = (struct hex_dump *)param;
+    if (dump->msg)
+        delete[] dump->msg;
+    delete dump;
+}
+
+static Job_step_res hex_dump_job(int job_id, void *param)
+{
+    ALL("hex_dump_job");
+    struct hex_dump *dump = (struct hex_dump *)param;
+    int cnt;
+    for (cnt = 0; (cnt < HEX_DUMP_JOB_SLICE) && (dump->dumped < dump->length); cnt++)
+    {
+        os_sprintf(dump->msg + dump->msg_len, " %X", *(dump->address + dump->dumped));
+        dump->msg_len += os_strlen(dump->msg + dump->msg_len);
+        dump->dumped++;
+    }
+    mem_mon_stack();
+    if (dump->dumped < dump->length)
+        return JOB_step_again;
+    fs_sprintf(dump->msg + dump->msg_len, "\"}");
+    // the job result will take care of the msg
+    jobs_set_result(job_id, dump->msg);
+    dump->msg = NULL;
+    return JOB_step_completed;
+}
+
 static void getHexMemDump(struct espconn *ptr_espconn, Http_parsed_req *parsed_req)
 {
     ALL("getHexMemDump");
@@ -434,11 +584,31 @@ static void getHexMemDump(struct espconn *ptr_espconn, Http_parsed_req *parsed_r
         http_response(ptr_espconn, HTTP_BAD_REQUEST, HTTP_CONTENT_JSON, f_str("Json bad syntax"), false);
         return;
     }
-    char *msg = mem_dump_hex_json_stringify(address_str, length);
-    if (msg)
-        http_response(ptr_espconn, HTTP_OK, HTTP_CONTENT_JSON, msg, true);
-    else
+    // {"address":"3FFE8950","length":00000,"content":" 33 2E 30 2E 34 28 39 35"}
+    int msg_len = 50 + (length * 3) + 1;
+    struct hex_dump *dump = new struct hex_dump;
+    char *msg = new char[msg_len];
+    if ((dump == NULL) || (msg == NULL))
+    {
+        if (dump)
+            delete dump;
+        if (msg)
+            delete[] msg;
+        dia_error_evnt(ROUTES_GETHEXMEMDUMP_HEAP_EXHAUSTED, msg_len);
+        ERROR("getHexMemDump heap exhausted %d", msg_len);
         http_response(ptr_espconn, HTTP_SERVER_ERROR, HTTP_CONTENT_JSON, f_str("Heap exhausted"), false);
+        return;
+    }
+    dump->address = (char *)atoh(address_str);
+    dump->length = length;
+    dump->dumped = 0;
+    dump->msg = msg;
+    fs_sprintf(msg,
+               "{\"address\":\"%X\",\"length\":%d,\"content\":\"",
+               dump->address,
+               dump->length);
+    dump->msg_len = os_strlen(msg);
+    job_accepted(ptr_espconn, jobs_add(f_str("hex_mem_dump"), hex_dump_job, hex_dump_job_release, dump));
     mem_mon_stack();
 }
 
@@ -462,17 +632,15 @@ static void ackDiagnosticEvents(struct espconn *ptr_espconn, Http_parsed_req *pa
 static void getDiagnosticCfg(struct espconn *ptr_espconn, Http_parsed_req *parsed_req)
 {
     ALL("getDiagnosticCfg");
-    char *msg = dia_cfg_json_stringify();
-    if (msg)
-        http_response(ptr_espconn, HTTP_OK, HTTP_CONTENT_JSON, msg, true);
-    else
-        http_response(ptr_espconn, HTTP_SERVER_ERROR, HTTP_CONTENT_JSON, f_str("Heap exhausted"), false);
+    http_cache_response(ptr_espconn, parsed_req, dia_cfg_json_stringify);
 }
 
 static void setDiagnosticCfg(struct espconn *ptr_espconn, Http_parsed_req *parsed_req)
 {
     ALL("setDiagnosticCfg");
     JSONP diag_cfg(parsed_req->req_content, parsed_req->content_len);
+    struct jsonp_token tokens[ROUTES_BODY_TOKENS];
+    diag_cfg.index(tokens, ROUTES_BODY_TOKENS);
     int diag_led_mask = diag_cfg.getInt(f_str("diag_led_mask"));
     int serial_log_mask = diag_cfg.getInt(f_str("serial_log_mask"));
     int sdk_print_enabled = diag_cfg.getInt(f_str("sdk_print_enabled"));
@@ -632,19 +800,7 @@ static void getDiagnosticEvents(struct espconn *ptr_espconn, Http_parsed_req *pa
     header.m_content_range_end = 0;
     header.m_content_range_total = 0;
     bool heap_exhausted = false;
-    if (parsed_req->origin)
-    {
-        header.m_origin = new char[(os_strlen(parsed_req->origin) + 1)];
-        if (header.m_origin == NULL)
-        {
-            dia_error_evnt(ROUTES_GETDIAGNOSTICEVENTS_HEAP_EXHAUSTED, (os_strlen(parsed_req->origin) + 1));
-            ERROR("getDiagnosticEvents heap exhausted %d", (os_strlen(parsed_req->origin) + 1));
-            heap_exhausted = true;
-        }
-        else
-            os_strcpy(header.m_origin, parsed_req->origin);
-    }
-    char *header_str = http_format_header(&header);
+    char *header_str = http_format_header(ptr_espconn, &header);
     if (header_str == NULL)
     {
         dia_error_evnt(ROUTES_GETDIAGNOSTICEVENTS_HEAP_EXHAUSTED, (os_strlen(header_str)));
@@ -807,15 +963,61 @@ static void getFs(struct espconn *ptr_espconn, Http_parsed_req *parsed_req)
     http_response(ptr_espconn, HTTP_OK, HTTP_CONTENT_JSON, msg.ref, true);
 }
 
+static void getFsStats(struct espconn *ptr_espconn, Http_parsed_req *parsed_req)
+{
+    ALL("getFsStats");
+    char *msg = esp_spiffs_stats_json_stringify();
+    if (msg)
+        http_response(ptr_espconn, HTTP_OK, HTTP_CONTENT_JSON, msg, true);
+    else
+        http_response(ptr_espconn, HTTP_SERVER_ERROR, HTTP_CONTENT_JSON, f_str("Heap exhausted"), false);
+}
+
+// responding with the counters being cleared
+static void resetFsStats(struct espconn *ptr_espconn, Http_parsed_req *parsed_req)
+{
+    ALL("resetFsStats");
+    char *msg = esp_spiffs_stats_json_stringify();
+    esp_spiffs_stats_reset();
+    if (msg)
+        http_response(ptr_espconn, HTTP_OK, HTTP_CONTENT_JSON, msg, true);
+    else
+        http_response(ptr_espconn, HTTP_SERVER_ERROR, HTTP_CONTENT_JSON, f_str("Heap exhausted"), false);
+}
+
+//
+// SPIFFS_check cannot be split into steps: it walks the lookup pages, the index pages
+// and the data pages keeping its state on the stack and has no resume point
+// so the check is a single step taking the espbot task for its whole duration
+// (about 1.6 s for an almost empty FS over the host flash simulator;
+//  the soft watchdog is fed by every flash read)
+//
+static Job_step_res fs_check_job(int job_id, void *param)
+{
+    ALL("fs_check_job");
+    s32_t res = esp_spiffs_check();
+    Json_writer json;
+    while (json.pass())
+    {
+        json.obj_begin();
+        json.num(f_str("fs_check_result"), res);
+        json.obj_end();
+    }
+    // jobs_set_result takes care of the heap allocated message
+    char *msg = json.result();
+    if (msg)
+        jobs_set_result(job_id, msg);
+    mem_mon_stack();
+    if (res == SPIFFS_OK)
+        return JOB_step_completed;
+    else
+        return JOB_step_failed;
+}
+
 static void checkFS(struct espconn *ptr_espconn, Http_parsed_req *parsed_req)
 {
     ALL("checkFS");
-    http_response(ptr_espconn, HTTP_ACCEPTED, HTTP_CONTENT_JSON, f_str("{\"msg\":\"FS check started...\"}"), false);
-
-    // give some time to the http reply before starting the FS check
-    os_timer_disarm(&delay_timer);
-    os_timer_setfn(&delay_timer, (os_timer_func_t *)esp_spiffs_check, NULL);
-    os_timer_arm(&delay_timer, 1000, 0);
+    job_accepted(ptr_espconn, jobs_add(f_str("fs_check"), fs_check_job, NULL, NULL));
 }
 
 static void getFileList(struct espconn *ptr_espconn, Http_parsed_req *parsed_req)
@@ -1145,20 +1347,80 @@ static void setGpioLevel(struct espconn *ptr_espconn, Http_parsed_req *parsed_re
     mem_mon_stack();
 }
 
-static void getMdns(struct espconn *ptr_espconn, Http_parsed_req *parsed_req)
+static void getJobs(struct espconn *ptr_espconn, Http_parsed_req *parsed_req)
 {
-    ALL("getMdns");
-    char *msg = mdns_cfg_json_stringify();
+    ALL("getJobs");
+    char *msg = jobs_list_json_stringify();
+    if (msg)
+        http_response(ptr_espconn, HTTP_OK, HTTP_CONTENT_JSON, msg, true);
+    else
+        http_response(ptr_espconn, HTTP_SERVER_ERROR, HTTP_CONTENT_JSON, f_str("Heap exhausted"), false);
+}
+
+static void getJob(struct espconn *ptr_espconn, Http_parsed_req *parsed_req)
+{
+    ALL("getJob");
+    char *job_id_str = parsed_req->url + os_strlen(f_str("/api/jobs/"));
+    if (os_strlen(job_id_str) == 0)
+    {
+        http_response(ptr_espconn, HTTP_BAD_REQUEST, HTTP_CONTENT_JSON, f_str("No job ID provided"), false);
+        return;
+    }
+    int job_id = atoi(job_id_str);
+    if (!jobs_exists(job_id))
+    {
+        http_response(ptr_espconn, HTTP_NOT_FOUND, HTTP_CONTENT_JSON, f_str("Job not found"), false);
+        return;
+    }
+    char *msg = jobs_json_stringify(job_id);
     if (msg)
         http_response(ptr_espconn, HTTP_OK, HTTP_CONTENT_JSON, msg, true);
     else
         http_response(ptr_espconn, HTTP_SERVER_ERROR, HTTP_CONTENT_JSON, f_str("Heap exhausted"), false);
+    mem_mon_stack();
+}
+
+static void cancelJob(struct espconn *ptr_espconn, Http_parsed_req *parsed_req)
+{
+    ALL("cancelJob");
+    char *job_id_str = parsed_req->url + os_strlen(f_str("/api/jobs/"));
+    if (os_strlen(job_id_str) == 0)
+    {
+        http_response(ptr_espconn, HTTP_BAD_REQUEST, HTTP_CONTENT_JSON, f_str("No job ID provided"), false);
+        return;
+    }
+    int job_id = atoi(job_id_str);
+    switch (jobs_cancel(job_id))
+    {
+    case JOB_not_found:
+        http_response(ptr_espconn, HTTP_NOT_FOUND, HTTP_CONTENT_JSON, f_str("Job not found"), false);
+        return;
+    case JOB_already_finished:
+        http_response(ptr_espconn, HTTP_CONFLICT, HTTP_CONTENT_JSON, f_str("Job already finished"), false);
+        return;
+    default:
+        break;
+    }
+    char *msg = jobs_json_stringify(job_id);
+    if (msg)
+        http_response(ptr_espconn, HTTP_OK, HTTP_CONTENT_JSON, msg, true);
+    else
+        http_response(ptr_espconn, HTTP_SERVER_ERROR, HTTP_CONTENT_JSON, f_str("Heap exhausted"), false);
+    mem_mon_stack();
+}
+
+static void getMdns(struct espconn *ptr_espconn, Http_parsed_req *parsed_req)
+{
+    ALL("getMdns");
+    http_cache_response(ptr_espconn, parsed_req, mdns_cfg_json_stringify);
 }
 
 static void setMdns(struct espconn *ptr_espconn, Http_parsed_req *parsed_req)
 {
     ALL("setMdns");
     JSONP mdns_cfg(parsed_req->req_content, parsed_req->content_len);
+    struct jsonp_token tokens[ROUTES_BODY_TOKENS];
+    mdns_cfg.index(tokens, ROUTES_BODY_TOKENS);
     int mdns_enabled = mdns_cfg.getInt(f_str("mdns_enabled"));
     if (mdns_cfg.getErr() != JSON_noerr)
     {
@@ -1193,6 +1455,8 @@ static void setTimedateCfg(struct espconn *ptr_espconn, Http_parsed_req *parsed_
 {
     ALL("setTimedateCfg");
     JSONP req_timedate(parsed_req->req_content, parsed_req->content_len);
+    struct jsonp_token tokens[ROUTES_BODY_TOKENS];
+    req_timedate.index(tokens, ROUTES_BODY_TOKENS);
     int sntp_enabled = req_timedate.getInt(f_str("sntp_enabled"));
     int timezone = req_timedate.getInt(f_str("timezone"));
     if (req_timedate.getErr() != JSON_noerr)
@@ -1230,14 +1494,15 @@ static void setTimedate(struct espconn *ptr_espconn, Http_parsed_req *parsed_req
 {
     ALL("setTimedate");
     JSONP req_timedate(parsed_req->req_content, parsed_req->content_len);
-    int32 timestamp = (int32)req_timedate.getInt(f_str("timestamp"));
+    // past 2038 a timestamp does not fit an int
+    uint32 timestamp = req_timedate.getUint(f_str("timestamp"));
     if (req_timedate.getErr() != JSON_noerr)
     {
         http_response(ptr_espconn, HTTP_BAD_REQUEST, HTTP_CONTENT_JSON, f_str("Json bad syntax"), false);
         return;
     }
 
-    timedate_set_time_manually((uint32)timestamp);
+    timedate_set_time_manually(timestamp);
 
     char *msg = timedate_state_json_stringify();
     if (msg)
@@ -1247,49 +1512,64 @@ static void setTimedate(struct espconn *ptr_espconn, Http_parsed_req *parsed_req
     mem_mon_stack();
 }
 
-static void ota_answer_on_completion(void *param)
+static void ota_job_completed(void *param)
 {
-    struct espconn *ptr_espconn = (struct espconn *)param;
+    int job_id = (int)param;
     switch (ota_get_last_result())
     {
     case OTA_success:
-        http_response(ptr_espconn, HTTP_OK, HTTP_CONTENT_JSON, f_str("{\"msg\":\"OTA completed. Rebooting...\"}"), false);
-        break;
-    case OTA_failed:
-        http_response(ptr_espconn, HTTP_SERVER_ERROR, HTTP_CONTENT_JSON, f_str("OTA failed"), false);
+        job_set_msg(job_id, f_str("{\"msg\":\"OTA completed. Rebooting...\"}"));
+        jobs_set_completed(job_id, true);
         break;
     case OTA_already_to_the_lastest:
-        http_response(ptr_espconn, HTTP_OK, HTTP_CONTENT_JSON, f_str("{\"msg\":\"Binary version already to the latest\"}"), false);
+        job_set_msg(job_id, f_str("{\"msg\":\"Binary version already to the latest\"}"));
+        jobs_set_completed(job_id, true);
         break;
+    case OTA_failed:
     default:
+        job_set_msg(job_id, f_str("{\"msg\":\"OTA failed\"}"));
+        jobs_set_completed(job_id, false);
         break;
     }
 }
 
+static Job_step_res ota_job(int job_id, void *param)
+{
+    ALL("ota_job");
+    Ota_status_type status = ota_get_status();
+    if ((status != OTA_idle) &&
+        (status != OTA_already_to_the_lastest) &&
+        (status != OTA_failed))
+    {
+        job_set_msg(job_id, f_str("{\"msg\":\"OTA already in progress\"}"));
+        return JOB_step_failed;
+    }
+    ota_set_cb_on_completion(ota_job_completed);
+    ota_set_cb_param((void *)job_id);
+    ota_start();
+    return JOB_step_waiting;
+}
+
 static void startOTA(struct espconn *ptr_espconn, Http_parsed_req *parsed_req)
 {
     ALL("startOTA");
-    ota_set_cb_on_completion(ota_answer_on_completion);
-    ota_set_cb_param((void *)ptr_espconn);
-    ota_start();
+    job_accepted(ptr_espconn, jobs_add(f_str("ota"), ota_job, NULL, NULL));
 }
 
 static void getOtaCfg(struct espconn *ptr_espconn, Http_parsed_req *parsed_req)
 {
     ALL("getOtaCfg");
-    char *msg = ota_cfg_json_stringify();
-    if (msg)
-        http_response(ptr_espconn, HTTP_OK, HTTP_CONTENT_JSON, msg, true);
-    else
-        http_response(ptr_espconn, HTTP_SERVER_ERROR, HTTP_CONTENT_JSON, f_str("Heap exhausted"), false);
+    http_cache_response(ptr_espconn, parsed_req, ota_cfg_json_stringify);
 }
 
 static void setOtaCfg(struct espconn *ptr_espconn, Http_parsed_req *parsed_req)
 {
     ALL("setOtaCfg");
     JSONP req_otacfg(parsed_req->req_content, parsed_req->content_len);
-    char host[16];
-    req_otacfg.getStr(f_str("host"), host, 16);
+    struct jsonp_token tokens[ROUTES_BODY_TOKENS];
+    req_otacfg.index(tokens, ROUTES_BODY_TOKENS);
+    char host[OTA_HOST_LEN];
+    req_otacfg.getStr(f_str("host"), host, OTA_HOST_LEN);
     int port = req_otacfg.getInt(f_str("port"));
     char path[128];
     req_otacfg.getStr(f_str("path"), path, 128);
@@ -1327,17 +1607,15 @@ static void getWifi(struct espconn *ptr_espconn, Http_parsed_req *parsed_req)
 static void getWifiApCfg(struct espconn *ptr_espconn, Http_parsed_req *parsed_req)
 {
     ALL("getWifiApCfg");
-    char *msg = espwifi_cfg_json_stringify();
-    if (msg)
-        http_response(ptr_espconn, HTTP_OK, HTTP_CONTENT_JSON, msg, true);
-    else
-        http_response(ptr_espconn, HTTP_SERVER_ERROR, HTTP_CONTENT_JSON, f_str("Heap exhausted"), false);
+    http_cache_response(ptr_espconn, parsed_req, espwifi_cfg_json_stringify);
 }
 
 static void setWifiApCfg(struct espconn *ptr_espconn, Http_parsed_req *parsed_req)
 {
     ALL("setWifiApCfg");
     JSONP req_apcfg(parsed_req->req_content, parsed_req->content_len);
+    struct jsonp_token tokens[ROUTES_BODY_TOKENS];
+    req_apcfg.index(tokens, ROUTES_BODY_TOKENS);
     int ap_channel = req_apcfg.getInt(f_str("ap_channel"));
     char ap_pwd[64];
     req_apcfg.getStr(f_str("ap_pwd"), ap_pwd, 64);
@@ -1464,6 +1742,16 @@ void espbot_http_routes(struct espconn *ptr_espconn, Http_parsed_req *parsed_req
         return_file(ptr_espconn, parsed_req, file_name);
         return;
     }
+    if ((0 == os_strcmp(parsed_req->url, f_str("/api/cors/cfg"))) && (parsed_req->req_method == HTTP_GET))
+    {
+        getCorsCfg(ptr_espconn, parsed_req);
+        return;
+    }
+    if ((0 == os_strcmp(parsed_req->url, f_str("/api/cors/cfg"))) && (parsed_req->req_method == HTTP_POST))
+    {
+        setCorsCfg(ptr_espconn, parsed_req);
+        return;
+    }
     if ((0 == os_strcmp(parsed_req->url, f_str("/api/cron"))) && (parsed_req->req_method == HTTP_GET))
     {
         getCron(ptr_espconn, parsed_req);
@@ -1474,6 +1762,16 @@ void espbot_http_routes(struct espconn *ptr_espconn, Http_parsed_req *parsed_req
         setCron(ptr_espconn, parsed_req);
         return;
     }
+    if ((0 == os_strcmp(parsed_req->url, f_str("/api/debug/httpCache"))) && (parsed_req->req_method == HTTP_GET))
+    {
+        getHttpCache(ptr_espconn, parsed_req);
+        return;
+    }
+    if ((0 == os_strcmp(parsed_req->url, f_str("/api/debug/httpClientPool"))) && (parsed_req->req_method == HTTP_GET))
+    {
+        getHttpClientPool(ptr_espconn, parsed_req);
+        return;
+    }
     if ((0 == os_strcmp(parsed_req->url, f_str("/api/debug/lastReset"))) && (parsed_req->req_method == HTTP_GET))
     {
         getLastReset(ptr_espconn, parsed_req);
@@ -1554,6 +1852,16 @@ void espbot_http_routes(struct espconn *ptr_espconn, Http_parsed_req *parsed_req
         getFs(ptr_espconn, parsed_req);
         return;
     }
+    if ((0 == os_strcmp(parsed_req->url, f_str("/api/fs/stats"))) && (parsed_req->req_method == HTTP_GET))
+    {
+        getFsStats(ptr_espconn, parsed_req);
+        return;
+    }
+    if ((0 == os_strcmp(parsed_req->url, f_str("/api/fs/stats"))) && (parsed_req->req_method == HTTP_DELETE))
+    {
+        resetFsStats(ptr_espconn, parsed_req);
+        return;
+    }
     if ((0 == os_strcmp(parsed_req->url, f_str("/api/fs/check"))) && (parsed_req->req_method == HTTP_POST))
     {
         checkFS(ptr_espconn, parsed_req);
@@ -1579,6 +1887,21 @@ void espbot_http_routes(struct espconn *ptr_espconn, Http_parsed_req *parsed_req
         setGpioLevel(ptr_espconn, parsed_req);
         return;
     }
+    if ((0 == os_strcmp(parsed_req->url, f_str("/api/jobs"))) && (parsed_req->req_method == HTTP_GET))
+    {
+        getJobs(ptr_espconn, parsed_req);
+        return;
+    }
+    if ((0 == os_strncmp(parsed_req->url, f_str("/api/jobs/"), os_strlen(f_str("/api/jobs/")))) && (parsed_req->req_method == HTTP_GET))
+    {
+        getJob(ptr_espconn, parsed_req);
+        return;
+    }
+    if ((0 == os_strncmp(parsed_req->url, f_str("/api/jobs/"), os_strlen(f_str("/api/jobs/")))) && (parsed_req->req_method == HTTP_DELETE))
+    {
+        cancelJob(ptr_espconn, parsed_req);
+        return;
+    }
     if ((0 == os_strcmp(parsed_req->url, f_str("/api/mdns"))) && (parsed_req->req_method == HTTP_GET))
     {
         getMdns(ptr_espconn, parsed_req);
@@ -1643,7 +1966,7 @@ void espbot_http_routes(struct espconn *ptr_espconn, Http_parsed_req *parsed_req
     }
     if ((0 == os_strcmp(parsed_req->url, f_str("/api/wifi/scan"))) && (parsed_req->req_method == HTTP_GET))
     {
-        espwifi_scan_for_ap(NULL, getAPlist, (void *)ptr_espconn);
+        job_accepted(ptr_espconn, jobs_add(f_str("wifi_scan"), wifi_scan_job, NULL, NULL));
         return;
     }
     if ((0 == os_strcmp(parsed_req->url, f_str("/api/wifi/ap/cfg"))) && (parsed_req->req_method == HTTP_GET))
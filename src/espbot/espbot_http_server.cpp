@@ -19,12 +19,14 @@ extern "C"
 }
 
 #include "espbot.hpp"
+#include "espbot_cors.hpp"
 #include "espbot_diagnostic.hpp"
 #include "espbot_event_codes.h"
 #include "espbot_http.hpp"
 #include "espbot_http_routes.hpp"
 #include "espbot_json.hpp"
 #include "espbot_mem_mon.hpp"
+#include "espbot_multipart.hpp"
 #include "espbot_queue.hpp"
 #include "espbot_http_server.hpp"
 #include "espbot_utils.hpp"
@@ -41,7 +43,16 @@ static void http_svr_recv(void *arg, char *precdata, unsigned short length)
     struct espconn *ptr_espconn = (struct espconn *)arg;
     Http_parsed_req parsed_req;
     DEBUG("http_svr_recv on %X, len %u, msg %s", ptr_espconn, length, precdata);
+    // pause the sender when running out of resources
+    http_recv_flow_check(ptr_espconn);
+    // multipart uploads are written to files segment by segment
+    if (http_upload_recv(ptr_espconn, precdata, length))
+        return;
     http_parse_request(precdata, length, &parsed_req);
+    // every response on this connection (upload segments, queued requests, errors)
+    // uses the origin of the last request header
+    if (!parsed_req.no_header_message)
+        cors_set_req_origin(ptr_espconn, parsed_req.origin);
     TRACE("http_svr_recv parsed req\n"
           "no_header_message: %d\n"
           "           method: %d\n"
@@ -54,6 +65,8 @@ static void http_svr_recv(void *arg, char *precdata, unsigned short length)
           parsed_req.content_len,
           parsed_req.req_content);
     mem_mon_stack();
+    if (!parsed_req.no_header_message && parsed_req.url && http_upload_start(ptr_espconn, &parsed_req))
+        return;
     if (!parsed_req.no_header_message && (parsed_req.h_content_len > parsed_req.content_len))
     {
         TRACE("http_svr_recv message has been splitted waiting for completion ...");
@@ -87,6 +100,11 @@ static void http_svr_recon(void *arg, sint8 err)
           pesp_conn->proto.tcp->remote_ip[3],
           pesp_conn->proto.tcp->remote_port,
           err);
+    // an aborted connection gets no disconnect callback
+    http_recv_flow_forget(pesp_conn);
+    clean_pending_responses(pesp_conn);
+    http_upload_forget(pesp_conn);
+    cors_forget(pesp_conn);
 }
 
 static void http_svr_discon(void *arg)
@@ -99,6 +117,11 @@ static void http_svr_discon(void *arg)
           pesp_conn->proto.tcp->remote_ip[2],
           pesp_conn->proto.tcp->remote_ip[3],
           pesp_conn->proto.tcp->remote_port);
+    http_recv_flow_forget(pesp_conn);
+    // e.g. a request body that was being discarded
+    clean_pending_responses(pesp_conn);
+    http_upload_forget(pesp_conn);
+    cors_forget(pesp_conn);
 }
 
 static void http_svr_listen(void *arg)
@@ -0,0 +1,470 @@
+/*
+ * ----------------------------------------------------------------------------
+ * "THE BEER-WARE LICENSE" (Revision 42):
+ * <quackmore-ff@yahoo.com> wrote this file.  As long as you retain this notice
+ * you can do whatever you want with this stuff. If we meet some day, and you 
+ * think this stuff is worth it, you can buy me a beer in return. Quackmore
+ * ----------------------------------------------------------------------------
+ */
+
+// SDK includes
+extern "C"
+{
+#include "c_types.h"
+#include "osapi.h"
+#include "user_interface.h"
+}
+
+#include "espbot.hpp"
+#include "espbot_diagnostic.hpp"
+#include "espbot_event_codes.h"
+#include "espbot_json_writer.hpp"
+#include "espbot_jobs.hpp"
+#include "espbot_list.hpp"
+#include "espbot_mem_mon.hpp"
+#include "espbot_utils.hpp"
+
+struct espbot_job
+{
+    int id;
+    const char *type;
+    Job_status status;
+    bool waiting;
+    uint32 queued_time;
+    uint32 start_time;
+    Job_step_res (*step)(int, void *);
+    void (*release)(void *);
+    void *param;
+    char *result;
+};
+
+static List<struct espbot_job> *job_list;
+
+static struct
+{
+    int last_id;
+    bool step_posted;
+    os_timer_t step_timer;
+} jobs_state;
+
+static char *readable_job_status(Job_status status)
+{
+    switch (status)
+    {
+    case JOB_queued:
+        return (char *)f_str("queued");
+    case JOB_running:
+        return (char *)f_str("running");
+    case JOB_completed:
+        return (char *)f_str("completed");
+    case JOB_failed:
+        return (char *)f_str("failed");
+    case JOB_cancelled:
+        return (char *)f_str("cancelled");
+    default:
+        return (char *)f_str("unknown");
+    }
+}
+
+static bool job_finished(struct espbot_job *job)
+{
+    if ((job->status == JOB_completed) ||
+        (job->status == JOB_failed) ||
+        (job->status == JOB_cancelled))
+        return true;
+    else
+        return false;
+}
+
+static struct espbot_job *job_find(int job_id)
+{
+    struct espbot_job *job = job_list->front();
+    while (job)
+    {
+        if (job->id == job_id)
+            return job;
+        job = job_list->next();
+    }
+    return NULL;
+}
+
+static void job_release(struct espbot_job *job)
+{
+    if (job->release && job->param)
+        job->release(job->param);
+    job->release = NULL;
+    job->param = NULL;
+}
+
+static void job_delete(struct espbot_job *job)
+{
+    job_release(job);
+    if (job->result)
+        delete[] job->result;
+    delete job;
+}
+
+static void job_finish(struct espbot_job *job, Job_status status)
+{
+    job->status = status;
+    job->waiting = false;
+    job_release(job);
+    switch (status)
+    {
+    case JOB_completed:
+        dia_debug_evnt(JOBS_COMPLETED, job->id);
+        DEBUG("job %d (%s) completed", job->id, job->type);
+        break;
+    case JOB_failed:
+        dia_warn_evnt(JOBS_FAILED, job->id);
+        WARN("job %d (%s) failed", job->id, job->type);
+        break;
+    case JOB_cancelled:
+        dia_info_evnt(JOBS_CANCELLED, job->id);
+        INFO("job %d (%s) cancelled", job->id, job->type);
+        break;
+    default:
+        break;
+    }
+}
+
+static void jobs_post_step(void)
+{
+    if (jobs_state.step_posted)
+        return;
+    if (system_os_post(USER_TASK_PRIO_0, SIG_jobs_step, '0'))
+    {
+        jobs_state.step_posted = true;
+    }
+    else
+    {
+        // espbot task queue is full, try again later
+        os_timer_disarm(&jobs_state.step_timer);
+        os_timer_arm(&jobs_state.step_timer, 50, 0);
+    }
+}
+
+static void jobs_timer_function(void *param)
+{
+    jobs_post_step();
+}
+
+// check if there is something to do on next time slice
+static void jobs_check_pending(void)
+{
+    int running = 0;
+    bool queued = false;
+    bool stepping = false;
+    struct espbot_job *job = job_list->front();
+    while (job)
+    {
+        if (job->status == JOB_running)
+        {
+            running++;
+            if (!job->waiting)
+                stepping = true;
+        }
+        if (job->status == JOB_queued)
+            queued = true;
+        job = job_list->next();
+    }
+    if (stepping || (queued && (running < JOBS_MAX_RUNNING)))
+        jobs_post_step();
+}
+
+void jobs_init(void)
+{
+    jobs_state.last_id = 0;
+    jobs_state.step_posted = false;
+    os_timer_disarm(&jobs_state.step_timer);
+    os_timer_setfn(&jobs_state.step_timer, (os_timer_func_t *)jobs_timer_function, NULL);
+    job_list = new List<struct espbot_job>(JOBS_MAX_COUNT, dont_delete_content);
+}
+
+int jobs_add(const char *type,
+             Job_step_res (*step)(int job_id, void *param),
+             void (*release)(void *param),
+             void *param)
+{
+    ALL("jobs_add");
+    struct espbot_job *pending = job_list->front();
+    while (pending)
+    {
+        if (!job_finished(pending) && (os_strcmp(pending->type, type) == 0))
+        {
+            dia_info_evnt(JOBS_ADD_SAME_TYPE_PENDING, pending->id);
+            INFO("jobs_add job %d (%s) still pending", pending->id, type);
+            if (release && param)
+                release(param);
+            return JOB_same_type_pending;
+        }
+        pending = job_list->next();
+    }
+    if (job_list->full())
+    {
+        // make room removing the oldest finished job
+        struct espbot_job *job = job_list->front();
+        while (job)
+        {
+            if (job_finished(job))
+            {
+                job_list->remove();
+                job_delete(job);
+                break;
+            }
+            job = job_list->next();
+        }
+    }
+    if (job_list->full())
+    {
+        dia_warn_evnt(JOBS_ADD_TABLE_FULL);
+        WARN("jobs_add job table full");
+        if (release && param)
+            release(param);
+        return JOB_table_full;
+    }
+    struct espbot_job *new_job = new struct espbot_job;
+    if (new_job == NULL)
+    {
+        dia_error_evnt(JOBS_ADD_HEAP_EXHAUSTED, sizeof(struct espbot_job));
+        ERROR("jobs_add heap exhausted %d", sizeof(struct espbot_job));
+        if (release && param)
+            release(param);
+        return JOB_heap_exhausted;
+    }
+    jobs_state.last_id++;
+    if (jobs_state.last_id > 0x7FFF)
+        jobs_state.last_id = 1;
+    new_job->id = jobs_state.last_id;
+    new_job->type = type;
+    new_job->status = JOB_queued;
+    new_job->waiting = false;
+    new_job->queued_time = system_get_time();
+    new_job->step = step;
+    new_job->release = release;
+    new_job->param = param;
+    new_job->result = NULL;
+    if (job_list->push_back(new_job) != list_ok)
+    {
+        dia_error_evnt(JOBS_ADD_HEAP_EXHAUSTED, sizeof(struct espbot_job));
+        ERROR("jobs_add heap exhausted %d", sizeof(struct espbot_job));
+        job_delete(new_job);
+        return JOB_heap_exhausted;
+    }
+    DEBUG("job %d (%s) queued", new_job->id, new_job->type);
+    // the job will be started by the espbot task after JOBS_START_DELAY
+    os_timer_disarm(&jobs_state.step_timer);
+    os_timer_arm(&jobs_state.step_timer, JOBS_START_DELAY, 0);
+    mem_mon_stack();
+    return new_job->id;
+}
+
+void jobs_set_result(int job_id, char *result)
+{
+    struct espbot_job *job = job_find(job_id);
+    if ((job == NULL) || (job->status != JOB_running))
+    {
+        // nobody is going to read it
+        if (result)
+            delete[] result;
+        return;
+    }
+    if (job->result)
+        delete[] job->result;
+    job->result = result;
+}
+
+void jobs_set_completed(int job_id, bool success)
+{
+    ALL("jobs_set_completed");
+    struct espbot_job *job = job_find(job_id);
+    if ((job == NULL) || (job->status != JOB_running))
+        return;
+    if (success)
+        job_finish(job, JOB_completed);
+    else
+        job_finish(job, JOB_failed);
+    // a slot is now available for queued jobs
+    jobs_check_pending();
+}
+
+int jobs_cancel(int job_id)
+{
+    ALL("jobs_cancel");
+    struct espbot_job *job = job_find(job_id);
+    if (job == NULL)
+        return JOB_not_found;
+    if (job_finished(job))
+        return JOB_already_finished;
+    job_finish(job, JOB_cancelled);
+    jobs_check_pending();
+    return JOB_ok;
+}
+
+bool jobs_exists(int job_id)
+{
+    if (job_find(job_id))
+        return true;
+    else
+        return false;
+}
+
+void jobs_step(void)
+{
+    ALL("jobs_step");
+    jobs_state.step_posted = false;
+    struct espbot_job *job;
+    int running = 0;
+    bool delayed = false;
+    bool waiting = false;
+
+    job = job_list->front();
+    while (job)
+    {
+        if ((job->status == JOB_running) && job->waiting)
+        {
+            if ((system_get_time() - job->start_time) > (JOBS_WAIT_TIMEOUT * 1000000))
+                job_finish(job, JOB_failed);
+            else
+                waiting = true;
+        }
+        if (job->status == JOB_running)
+            running++;
+        job = job_list->next();
+    }
+    // start queued jobs, oldest first, within the concurrency limit
+    job = job_list->front();
+    while (job && (running < JOBS_MAX_RUNNING))
+    {
+        if (job->status == JOB_queued)
+        {
+            if ((system_get_time() - job->queued_time) < (JOBS_START_DELAY * 1000))
+            {
+                delayed = true;
+            }
+            else
+            {
+                job->status = JOB_running;
+                job->start_time = system_get_time();
+                running++;
+                dia_debug_evnt(JOBS_STARTED, job->id);
+                DEBUG("job %d (%s) started", job->id, job->type);
+            }
+        }
+        job = job_list->next();
+    }
+    // a job step may call other jobs functions (moving the list cursor)
+    // so first select the jobs to be executed
+    struct espbot_job *stepping[JOBS_MAX_RUNNING];
+    int stepping_count = 0;
+    job = job_list->front();
+    while (job && (stepping_count < JOBS_MAX_RUNNING))
+    {
+        if ((job->status == JOB_running) && !job->waiting)
+        {
+            stepping[stepping_count] = job;
+            stepping_count++;
+        }
+        job = job_list->next();
+    }
+    // then give each running job a time slice
+    int idx;
+    for (idx = 0; idx < stepping_count; idx++)
+    {
+        job = stepping[idx];
+        Job_step_res res = job->step(job->id, job->param);
+        system_soft_wdt_feed();
+        // the job could have been completed or cancelled during the step
+        if (job->status != JOB_running)
+            continue;
+        switch (res)
+        {
+        case JOB_step_again:
+            break;
+        case JOB_step_waiting:
+            job->waiting = true;
+            waiting = true;
+            break;
+        case JOB_step_completed:
+            job_finish(job, JOB_completed);
+            break;
+        case JOB_step_failed:
+        default:
+            job_finish(job, JOB_failed);
+            break;
+        }
+    }
+    jobs_check_pending();
+    if (!jobs_state.step_posted)
+    {
+        // nothing to do on next time slice
+        // but queued jobs will have to be started and waiting jobs checked
+        if (delayed)
+        {
+            os_timer_disarm(&jobs_state.step_timer);
+            os_timer_arm(&jobs_state.step_timer, JOBS_START_DELAY, 0);
+        }
+        else if (waiting)
+        {
+            os_timer_disarm(&jobs_state.step_timer);
+            os_timer_arm(&jobs_state.step_timer, 1000, 0);
+        }
+    }
+    mem_mon_stack();
+}
+
+char *jobs_json_stringify(int job_id, char *dest, int len)
+{
+    struct espbot_job *job = job_find(job_id);
+    if (job == NULL)
+        return NULL;
+    Json_writer json(dest, len);
+    while (json.pass())
+    {
+        json.obj_begin();
+        json.num(f_str("id"), job->id);
+        json.str(f_str("type"), job->type);
+        json.str(f_str("status"), readable_job_status(job->status));
+        // the result is JSON already
+        json.raw(f_str("result"), job->result);
+        json.obj_end();
+    }
+    char *msg = json.result();
+    if (msg == NULL)
+    {
+        dia_error_evnt(JOBS_STRINGIFY_HEAP_EXHAUSTED, json.len());
+        ERROR("jobs_json_stringify heap exhausted [%d]", json.len());
+    }
+    mem_mon_stack();
+    return msg;
+}
+
+char *jobs_list_json_stringify(char *dest, int len)
+{
+    Json_writer json(dest, len);
+    while (json.pass())
+    {
+        json.obj_begin();
+        json.array_begin(f_str("jobs"));
+        struct espbot_job *job = job_list->front();
+        while (job)
+        {
+            json.obj_begin();
+            json.num(f_str("id"), job->id);
+            json.str(f_str("type"), job->type);
+            json.str(f_str("status"), readable_job_status(job->status));
+            json.obj_end();
+            job = job_list->next();
+        }
+        json.array_end();
+        json.obj_end();
+    }
+    char *msg = json.result();
+    if (msg == NULL)
+    {
+        dia_error_evnt(JOBS_LIST_STRINGIFY_HEAP_EXHAUSTED, json.len());
+        ERROR("jobs_list_json_stringify heap exhausted [%d]", json.len());
+    }
+    mem_mon_stack();
+    return msg;
+}
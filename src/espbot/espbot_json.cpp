@@ -10,17 +10,25 @@
 // SDK includes
 extern "C"
 {
+#include "c_types.h"
 #include "osapi.h"
 }
 
 #include "espbot_json.hpp"
 #include "espbot_mem_mon.hpp"
-#include "espbot_utils.hpp"
+#include "espbot_num.hpp"
+#include "espbot_scan.hpp"
+
+// the nesting level being checked (nested values are checked by recursion)
+static int json_depth;
 
 JSONP::JSONP()
 {
     _jstr = NULL;
     _len = 0;
+    _syntax_ok = false;
+    _tokens = NULL;
+    _tokens_count = 0;
     _cursor = _jstr;
     _cur_name = NULL;
     _cur_name_len = 0;
@@ -34,6 +42,8 @@ JSONP::JSONP(char *t_str)
 {
     _jstr = t_str;
     _len = os_strlen(_jstr);
+    _tokens = NULL;
+    _tokens_count = 0;
     _cursor = _jstr;
     _cur_name = NULL;
     _cur_name_len = 0;
@@ -42,12 +52,15 @@ JSONP::JSONP(char *t_str)
     _cur_value_len = 0;
     _err = JSON_noerr;
     _err = syntax_check();
+    _syntax_ok = (_err == JSON_noerr);
 }
 
 JSONP::JSONP(char *t_str, int t_len)
 {
     _jstr = t_str;
     _len = t_len;
+    _tokens = NULL;
+    _tokens_count = 0;
     _cursor = _jstr;
     _cur_name = NULL;
     _cur_name_len = 0;
@@ -56,25 +69,30 @@ JSONP::JSONP(char *t_str, int t_len)
     _cur_value_len = 0;
     _err = JSON_noerr;
     _err = syntax_check();
+    _syntax_ok = (_err == JSON_noerr);
 }
 
 /**
  * @brief 
  * 
  * @param t_str 
+ * @param end 
  * @return char* 
  */
 
-static char *find_object_end(char *t_str)
+static char *find_object_end(char *t_str, char *end)
 {
     int paired_brackets = 0;
     char *tmp_ptr = t_str;
     mem_mon_stack();
-    while (*tmp_ptr) // looking for '{' and '}'
+    // looking for '{' and '}'
+    while ((tmp_ptr = scan_char2(tmp_ptr, end, '{', '}')) != NULL)
     {
         if (*tmp_ptr == '{')
+        {
             paired_brackets++;
-        if (*tmp_ptr == '}')
+        }
+        else
         {
             paired_brackets--;
             if (paired_brackets == 0)
@@ -82,27 +100,30 @@ static char *find_object_end(char *t_str)
         }
         tmp_ptr++;
     }
-    if ((*tmp_ptr == 0) || (paired_brackets > 0))
-        return NULL;
+    return NULL;
 }
 
 /**
  * @brief 
  * 
  * @param t_str 
+ * @param end 
  * @return char* 
  */
 
-static char *find_array_end(char *t_str)
+static char *find_array_end(char *t_str, char *end)
 {
     int paired_brackets = 0;
     char *tmp_ptr = t_str;
     mem_mon_stack();
-    while (*tmp_ptr) // looking for '[' and ']'
+    // looking for '[' and ']'
+    while ((tmp_ptr = scan_char2(tmp_ptr, end, '[', ']')) != NULL)
     {
         if (*tmp_ptr == '[')
+        {
             paired_brackets++;
-        if (*tmp_ptr == ']')
+        }
+        else
         {
             paired_brackets--;
             if (paired_brackets == 0)
@@ -110,8 +131,7 @@ static char *find_array_end(char *t_str)
         }
         tmp_ptr++;
     }
-    if ((*tmp_ptr == 0) || (paired_brackets > 0))
-        return NULL;
+    return NULL;
 }
 
 /**
@@ -161,15 +181,11 @@ int JSONP::syntax_check(void)
         else
             return (ptr - _jstr + 1);
         ptr++;
-        while ((ptr - _jstr) < _len) // looking for ending '"'
-        {
-            if (*ptr == '"')
-                break;
-            if ((*ptr == '{') || (*ptr == '}') || (*ptr == '[') || (*ptr == ']') || (*ptr == ':') || (*ptr == ','))
-                return (ptr - _jstr + 1);
-            ptr++;
-        }
-        if ((ptr - _jstr) == _len)
+        // looking for ending '"'
+        ptr = scan_json(ptr, (_jstr + _len));
+        if (ptr == NULL)
+            return (_len + 1);
+        if (*ptr != '"')
             return (ptr - _jstr + 1);
         ptr++;
         while ((ptr - _jstr) < _len) // looking for ':'
@@ -232,9 +248,16 @@ int JSONP::syntax_check(void)
         }
         else if (_cur_type == JSON_obj)
         {
-            char *object_end = find_object_end(ptr);
+            char *object_end = find_object_end(ptr, (_jstr + _len));
+            if (object_end == NULL)
+                return (_len + 1);
+            if (json_depth >= JSON_DEPTH_MAX)
+                return (ptr - _jstr + 1);
+            // checked by the constructor
+            json_depth++;
             JSONP JSONP(ptr, ((object_end - ptr) + 1));
-            int res = JSONP.syntax_check();
+            json_depth--;
+            int res = JSONP.getErr();
             mem_mon_stack();
             if (res > JSON_noerr)
                 return (ptr - _jstr + res);
@@ -242,8 +265,14 @@ int JSONP::syntax_check(void)
         }
         else if (_cur_type == JSONP_array)
         {
-            char *array_end = find_array_end(ptr);
+            char *array_end = find_array_end(ptr, (_jstr + _len));
+            if (array_end == NULL)
+                return (_len + 1);
+            if (json_depth >= JSON_DEPTH_MAX)
+                return (ptr - _jstr + 1);
+            json_depth++;
             JSONP_ARRAY array_str(ptr, ((array_end - ptr) + 1));
+            json_depth--;
             int res = array_str.getErr();
             mem_mon_stack();
             if (res > JSON_noerr)
@@ -260,15 +289,11 @@ int JSONP::syntax_check(void)
             }
             else
                 return (ptr - _jstr + 1);
-            while ((ptr - _jstr) < _len) // looking for ending '"'
-            {
-                if (*ptr == '"')
-                    break;
-                if ((*ptr == '{') || (*ptr == '}') || (*ptr == '[') || (*ptr == ']') || (*ptr == ':') || (*ptr == ','))
-                    return (ptr - _jstr + 1);
-                ptr++;
-            }
-            if ((ptr - _jstr) == _len)
+            // looking for ending '"'
+            ptr = scan_json(ptr, (_jstr + _len));
+            if (ptr == NULL)
+                return (_len + 1);
+            if (*ptr != '"')
                 return (ptr - _jstr + 1);
         }
         ptr++;
@@ -350,19 +375,14 @@ int JSONP::find_pair(void)
     else
         return JSON_pairNotFound;
     _cursor++;
-    while ((_cursor - _jstr) < _len) // looking for ending '"'
+    // looking for ending '"'
+    _cursor = scan_json(_cursor, (_jstr + _len));
+    if ((_cursor == NULL) || (*_cursor != '"'))
     {
-        if (*_cursor == '"')
-        {
-            _cur_name_len = (_cursor - _cur_name);
-            break;
-        }
-        if ((*_cursor == '{') || (*_cursor == '}') || (*_cursor == '[') || (*_cursor == ']') || (*_cursor == ':') || (*_cursor == ','))
-            return JSON_pairNotFound;
-        _cursor++;
-    }
-    if ((_cursor - _jstr) == _len)
+        _cursor = _jstr + _len;
         return JSON_pairNotFound;
+    }
+    _cur_name_len = (_cursor - _cur_name);
     _cursor++;
     while ((_cursor - _jstr) < _len) // looking for ':'
     {
@@ -430,12 +450,12 @@ int JSONP::find_pair(void)
     }
     else if (_cur_type == JSON_obj)
     {
-        _cursor = find_object_end(_cursor);
+        _cursor = find_object_end(_cursor, (_jstr + _len));
         _cur_value_len = _cursor - _cur_value + 1;
     }
     else if (_cur_type == JSONP_array)
     {
-        _cursor = find_array_end(_cursor);
+        _cursor = find_array_end(_cursor, (_jstr + _len));
         _cur_value_len = _cursor - _cur_value + 1;
     }
     else
@@ -449,19 +469,14 @@ int JSONP::find_pair(void)
         else
             return JSON_pairNotFound;
         _cur_value = _cursor;
-        while ((_cursor - _jstr) < _len) // looking for ending '"'
+        // looking for ending '"'
+        _cursor = scan_json(_cursor, (_jstr + _len));
+        if ((_cursor == NULL) || (*_cursor != '"'))
         {
-            if (*_cursor == '"')
-            {
-                _cur_value_len = _cursor - _cur_value;
-                break;
-            }
-            if ((*_cursor == '{') || (*_cursor == '}') || (*_cursor == '[') || (*_cursor == ']') || (*_cursor == ':') || (*_cursor == ','))
-                return JSON_pairNotFound;
-            _cursor++;
-        }
-        if ((_cursor - _jstr) == _len)
+            _cursor = _jstr + _len;
             return JSON_pairNotFound;
+        }
+        _cur_value_len = _cursor - _cur_value;
     }
     _cursor++;
     while ((_cursor - _jstr) < _len) // looking for ending '}' or ','
@@ -490,10 +505,13 @@ int JSONP::find_pair(void)
 
 int JSONP::find_key(const char *t_string)
 {
-    _cursor = _jstr;
     mem_mon_stack();
-    if (syntax_check() != JSON_noerr)
+    // the syntax was checked once by the constructor
+    if (!_syntax_ok)
         return JSON_notFound;
+    if (_tokens)
+        return find_token(t_string);
+    _cursor = _jstr;
     while (find_pair() == JSON_pairFound)
     {
         if ((_cur_name_len == os_strlen(t_string)) &&
@@ -503,66 +521,185 @@ int JSONP::find_key(const char *t_string)
     return JSON_notFound;
 }
 
-int JSONP::getInt(const char *name)
+// FNV-1a folded to 16 bits
+static unsigned short jsonp_key_hash(const char *key, int len)
+{
+    uint32 hash = 2166136261U;
+    int idx;
+    for (idx = 0; idx < len; idx++)
+    {
+        hash ^= (uint8)key[idx];
+        hash *= 16777619U;
+    }
+    return (unsigned short)(hash ^ (hash >> 16));
+}
+
+int JSONP::index(struct jsonp_token *tokens, int max_tokens)
+{
+    _tokens = NULL;
+    _tokens_count = 0;
+    if (!_syntax_ok)
+        return JSON_sintaxErr;
+    if (_len > 0xFFFF)
+        return JSON_outOfBoundary;
+    int count = 0;
+    struct jsonp_token token;
+    _cursor = _jstr;
+    while (find_pair() == JSON_pairFound)
+    {
+        if ((count == max_tokens) || (_cur_name_len > 0xFF))
+            return JSON_outOfBoundary;
+        token.key_hash = jsonp_key_hash(_cur_name, _cur_name_len);
+        token.key_len = _cur_name_len;
+        token.type = _cur_type;
+        token.key = _cur_name - _jstr;
+        token.value = _cur_value - _jstr;
+        token.value_len = _cur_value_len;
+        // sorted by hash, pairs with the same hash keep their order
+        int idx = count;
+        while ((idx > 0) && (tokens[idx - 1].key_hash > token.key_hash))
+        {
+            tokens[idx] = tokens[idx - 1];
+            idx--;
+        }
+        tokens[idx] = token;
+        count++;
+    }
+    mem_mon_stack();
+    _tokens = tokens;
+    _tokens_count = count;
+    return JSON_noerr;
+}
+
+int JSONP::find_token(const char *t_string)
+{
+    int key_len = os_strlen(t_string);
+    unsigned short hash = jsonp_key_hash(t_string, key_len);
+    // the first token with the same hash
+    int low = 0;
+    int high = _tokens_count;
+    while (low < high)
+    {
+        int mid = (low + high) / 2;
+        if (_tokens[mid].key_hash < hash)
+            low = mid + 1;
+        else
+            high = mid;
+    }
+    while ((low < _tokens_count) && (_tokens[low].key_hash == hash))
+    {
+        struct jsonp_token *token = &_tokens[low];
+        if ((token->key_len == key_len) &&
+            (os_strncmp((_jstr + token->key), t_string, key_len) == 0))
+        {
+            _cur_name = _jstr + token->key;
+            _cur_name_len = token->key_len;
+            _cur_type = (Json_value_type)token->type;
+            _cur_value = _jstr + token->value;
+            _cur_value_len = token->value_len;
+            return JSON_found;
+        }
+        low++;
+    }
+    return JSON_notFound;
+}
+
+int JSONP::getView(const char *name, char **value, Json_value_type *type)
 {
     if (_err != JSON_noerr)
-        return 0;
+        return -1;
     if (find_key(name) == JSON_notFound)
     {
         _err = JSON_notFound;
-        return 0;
+        return -1;
+    }
+    *value = _cur_value;
+    if (type)
+        *type = _cur_type;
+    return _cur_value_len;
+}
+
+// the value of name is a number (_cur_value)
+bool JSONP::num_value(const char *name)
+{
+    if (_err != JSON_noerr)
+        return false;
+    if (find_key(name) == JSON_notFound)
+    {
+        _err = JSON_notFound;
+        return false;
     }
     if (_cur_type != JSON_num)
+    {
+        _err = JSON_typeMismatch;
+        return false;
+    }
+    return true;
+}
+
+int JSONP::getInt(const char *name)
+{
+    int value;
+    if (!num_value(name))
+        return 0;
+    if (!span_to_int(_cur_value, _cur_value_len, &value))
     {
         _err = JSON_typeMismatch;
         return 0;
     }
-    // check if value is a float
-    int idx;
-    for (idx = 0; idx < _cur_value_len; idx++)
-        if (_cur_value[idx] == '.')
-        {
-            _err = JSON_typeMismatch;
-            return 0;
-        }
-    char value_str[16];
-    mem_mon_stack();
+    return value;
+}
 
-    os_memset(value_str, 0, 16);
-    if (_cur_value_len > 15)
+uint32 JSONP::getUint(const char *name)
+{
+    uint32 value;
+    if (!num_value(name))
+        return 0;
+    if (!span_to_uint(_cur_value, _cur_value_len, &value))
     {
         _err = JSON_typeMismatch;
         return 0;
     }
-    os_strncpy(value_str, _cur_value, _cur_value_len);
-    return atoi(value_str);
+    return value;
 }
 
-float JSONP::getFloat(const char *name)
+sint64 JSONP::getInt64(const char *name)
 {
-    if (_err != JSON_noerr)
-        return 0.0;
-    if (find_key(name) == JSON_notFound)
+    sint64 value;
+    if (!num_value(name))
+        return 0;
+    if (!span_to_int64(_cur_value, _cur_value_len, &value))
     {
-        _err = JSON_notFound;
-        return 0.0;
+        _err = JSON_typeMismatch;
+        return 0;
     }
-    if (_cur_type != JSON_num)
+    return value;
+}
+
+int JSONP::getFixed(const char *name, int decimals)
+{
+    int value;
+    if (!num_value(name))
+        return 0;
+    if (!span_to_fixed(_cur_value, _cur_value_len, decimals, &value))
     {
         _err = JSON_typeMismatch;
-        return 0.0;
+        return 0;
     }
-    char value_str[64];
-    mem_mon_stack();
+    return value;
+}
 
-    os_memset(value_str, 0, 64);
-    if (_cur_value_len > 63)
+float JSONP::getFloat(const char *name)
+{
+    float value;
+    if (!num_value(name))
+        return 0.0;
+    if (!span_to_float(_cur_value, _cur_value_len, &value))
     {
         _err = JSON_typeMismatch;
         return 0.0;
     }
-    os_strncpy(value_str, _cur_value, _cur_value_len);
-    return atof(value_str);
+    return value;
 }
 
 void JSONP::getStr(const char *name, char *dest, int len)
@@ -672,12 +809,17 @@ JSONP_ARRAY::JSONP_ARRAY()
 {
     _jstr = NULL;
     _len = 0;
+    _syntax_ok = false;
+    _elems = NULL;
+    _elems_tried = false;
+    _iter = NULL;
+    _iter_id = 0;
     _cursor = _jstr;
     _el_count = 0;
     _cur_id = -1;
-    char *_cur_el = NULL;
-    int _cur_len = 0;
-    Json_value_type _cur_type = JSON_unknown;
+    _cur_el = NULL;
+    _cur_len = 0;
+    _cur_type = JSON_unknown;
 
     _err = JSON_empty;
 }
@@ -686,30 +828,75 @@ JSONP_ARRAY::JSONP_ARRAY(char *t_str)
 {
     _jstr = t_str;
     _len = os_strlen(t_str);
+    _elems = NULL;
+    _elems_tried = false;
+    _iter = NULL;
+    _iter_id = 0;
     _cursor = _jstr;
     _el_count = 0;
     _cur_id = -1;
-    char *_cur_el = NULL;
-    int _cur_len = 0;
-    Json_value_type _cur_type = JSON_unknown;
+    _cur_el = NULL;
+    _cur_len = 0;
+    _cur_type = JSON_unknown;
 
     _err = JSON_noerr;
     _err = syntax_check();
+    _syntax_ok = (_err == JSON_noerr);
 }
 
 JSONP_ARRAY::JSONP_ARRAY(char *t_str, int t_len)
 {
     _jstr = t_str;
     _len = t_len;
+    _elems = NULL;
+    _elems_tried = false;
+    _iter = NULL;
+    _iter_id = 0;
     _cursor = _jstr;
     _el_count = 0;
     _cur_id = -1;
-    char *_cur_el = NULL;
-    int _cur_len = 0;
-    Json_value_type _cur_type = JSON_unknown;
+    _cur_el = NULL;
+    _cur_len = 0;
+    _cur_type = JSON_unknown;
 
     _err = JSON_noerr;
     _err = syntax_check();
+    _syntax_ok = (_err == JSON_noerr);
+}
+
+JSONP_ARRAY::JSONP_ARRAY(const JSONP_ARRAY &src)
+{
+    _elems = NULL;
+    *this = src;
+}
+
+JSONP_ARRAY &JSONP_ARRAY::operator=(const JSONP_ARRAY &src)
+{
+    if (this == &src)
+        return *this;
+    if (_elems)
+        delete[] _elems;
+    _jstr = src._jstr;
+    _len = src._len;
+    _syntax_ok = src._syntax_ok;
+    _elems = NULL;
+    _elems_tried = false;
+    _iter = src._iter;
+    _iter_id = src._iter_id;
+    _cursor = src._cursor;
+    _el_count = src._el_count;
+    _cur_id = src._cur_id;
+    _cur_el = src._cur_el;
+    _cur_len = src._cur_len;
+    _cur_type = src._cur_type;
+    _err = src._err;
+    return *this;
+}
+
+JSONP_ARRAY::~JSONP_ARRAY()
+{
+    if (_elems)
+        delete[] _elems;
 }
 
 int JSONP_ARRAY::syntax_check(void)
@@ -787,8 +974,14 @@ int JSONP_ARRAY::syntax_check(void)
         }
         else if (_cur_type == JSON_obj)
         {
-            char *object_end = find_object_end(ptr);
+            char *object_end = find_object_end(ptr, (_jstr + _len));
+            if (object_end == NULL)
+                return (_len + 1);
+            if (json_depth >= JSON_DEPTH_MAX)
+                return (ptr - _jstr + 1);
+            json_depth++;
             JSONP obj(ptr, ((object_end - ptr) + 1));
+            json_depth--;
             int res = obj.getErr();
             mem_mon_stack();
             if (res > JSON_noerr)
@@ -797,9 +990,16 @@ int JSONP_ARRAY::syntax_check(void)
         }
         else if (_cur_type == JSONP_array)
         {
-            char *array_end = find_array_end(ptr);
+            char *array_end = find_array_end(ptr, (_jstr + _len));
+            if (array_end == NULL)
+                return (_len + 1);
+            if (json_depth >= JSON_DEPTH_MAX)
+                return (ptr - _jstr + 1);
+            // checked by the constructor
+            json_depth++;
             JSONP_ARRAY array_str(ptr, ((array_end - ptr) + 1));
-            int res = array_str.syntax_check();
+            json_depth--;
+            int res = array_str.getErr();
             mem_mon_stack();
             if (res > JSON_noerr)
                 return (ptr - _jstr + res);
@@ -815,15 +1015,11 @@ int JSONP_ARRAY::syntax_check(void)
             }
             else
                 return (ptr - _jstr + 1);
-            while ((ptr - _jstr) < _len) // looking for ending '"'
-            {
-                if (*ptr == '"')
-                    break;
-                if ((*ptr == '{') || (*ptr == '}') || (*ptr == '[') || (*ptr == ']') || (*ptr == ':') || (*ptr == ','))
-                    return (ptr - _jstr + 1);
-                ptr++;
-            }
-            if ((ptr - _jstr) == _len)
+            // looking for ending '"'
+            ptr = scan_json(ptr, (_jstr + _len));
+            if (ptr == NULL)
+                return (_len + 1);
+            if (*ptr != '"')
                 return (ptr - _jstr + 1);
         }
         ptr++;
@@ -860,16 +1056,128 @@ int JSONP_ARRAY::syntax_check(void)
 
 int JSONP_ARRAY::len(void)
 {
-    // don't repeat the counting every time...
-    if (_el_count == 0)
+    // counted by the constructor syntax check (0 for empty or bad arrays)
+    return _el_count;
+}
+
+//
+// the element starting at ptr (the syntax was already checked)
+// result: where the next element starts, NULL when this is the last one
+//
+static char *jsonp_array_elem(char *ptr, char *end, char **el, int *el_len, Json_value_type *type)
+{
+    while ((ptr < end) && ((*ptr == ' ') || (*ptr == '\r') || (*ptr == '\n')))
+        ptr++;
+    *el = ptr;
+    *el_len = 0;
+    *type = JSON_unknown;
+    if (ptr >= end)
+        return NULL;
+    switch (*ptr)
     {
-        syntax_check();
+    case '"':
+        *type = JSON_str;
+        ptr++;
+        *el = ptr;
+        ptr = scan_char(ptr, end, '"');
+        if (ptr == NULL)
+            ptr = end;
+        *el_len = ptr - *el;
+        ptr++;
+        break;
+    case '{':
+        *type = JSON_obj;
+        ptr = find_object_end(ptr, end) + 1;
+        *el_len = ptr - *el;
+        break;
+    case '[':
+        *type = JSONP_array;
+        ptr = find_array_end(ptr, end) + 1;
+        *el_len = ptr - *el;
+        break;
+    default:
+        *type = JSON_num;
+        while ((ptr < end) && (*ptr != ',') && (*ptr != ']') && (*ptr != ' ') && (*ptr != '\r') && (*ptr != '\n'))
+            ptr++;
+        *el_len = ptr - *el;
+        break;
     }
-    return _el_count;
+    while ((ptr < end) && (*ptr != ',') && (*ptr != ']'))
+        ptr++;
+    if ((ptr < end) && (*ptr == ','))
+        return (ptr + 1);
+    return NULL;
+}
+
+char *JSONP_ARRAY::first_elem(void)
+{
+    char *ptr = _jstr;
+    while (((ptr - _jstr) < _len) && (*ptr != '['))
+        ptr++;
+    return (ptr + 1);
+}
+
+void JSONP_ARRAY::build_offsets(void)
+{
+    _elems_tried = true;
+    if (!_syntax_ok || (_el_count < JSON_ARRAY_OFFSETS_MIN) || (_len > 0xFFFF))
+        return;
+    // when the heap is exhausted the elements are scanned for
+    _elems = new struct jsonp_elem[_el_count];
+    if (_elems == NULL)
+        return;
+    char *ptr = first_elem();
+    char *el;
+    int el_len;
+    Json_value_type type;
+    int idx;
+    for (idx = 0; (idx < _el_count) && ptr; idx++)
+    {
+        ptr = jsonp_array_elem(ptr, (_jstr + _len), &el, &el_len, &type);
+        _elems[idx].start = el - _jstr;
+        _elems[idx].len = el_len;
+        _elems[idx].type = type;
+    }
+    mem_mon_stack();
+    if (idx < _el_count)
+    {
+        delete[] _elems;
+        _elems = NULL;
+    }
+}
+
+void JSONP_ARRAY::rewind(void)
+{
+    _iter_id = 0;
+    _iter = NULL;
+    if (_syntax_ok)
+        _iter = first_elem();
+}
+
+int JSONP_ARRAY::next(char **value, Json_value_type *type)
+{
+    if ((_iter == NULL) || (_iter_id >= _el_count))
+        return -1;
+    int el_len;
+    Json_value_type el_type;
+    _iter = jsonp_array_elem(_iter, (_jstr + _len), value, &el_len, &el_type);
+    _iter_id++;
+    if (type)
+        *type = el_type;
+    return el_len;
 }
 
 int JSONP_ARRAY::find_elem(int idx)
 {
+    if (!_elems_tried)
+        build_offsets();
+    if (_elems)
+    {
+        _cur_el = _jstr + _elems[idx].start;
+        _cur_len = _elems[idx].len;
+        _cur_type = (Json_value_type)_elems[idx].type;
+        return idx;
+    }
     char *ptr = _cursor;
     bool another_elem_found = false;
     int tmp_elem_count = 0;
@@ -952,14 +1260,14 @@ int JSONP_ARRAY::find_elem(int idx)
         }
         else if (_cur_type == JSON_obj)
         {
-            char *object_end = find_object_end(ptr);
+            char *object_end = find_object_end(ptr, (_jstr + _len));
             ptr = object_end;
             // calculate the element len
             _cur_len = (ptr + 1 - _cur_el);
         }
         else if (_cur_type == JSONP_array)
         {
-            char *array_end = find_array_end(ptr);
+            char *array_end = find_array_end(ptr, (_jstr + _len));
             ptr = array_end;
             // calculate the element len
             _cur_len = (ptr + 1 - _cur_el);
@@ -974,20 +1282,12 @@ int JSONP_ARRAY::find_elem(int idx)
             }
             else
                 return -1;
-            while ((ptr - _jstr) < _len) // looking for ending '"'
-            {
-                if (*ptr == '"')
-                {
-                    // calculate the element len
-                    _cur_len = (ptr - _cur_el);
-                    break;
-                }
-                if ((*ptr == '{') || (*ptr == '}') || (*ptr == '[') || (*ptr == ']') || (*ptr == ':') || (*ptr == ','))
-                    return -1;
-                ptr++;
-            }
-            if ((ptr - _jstr) == _len)
+            // looking for ending '"'
+            ptr = scan_json(ptr, (_jstr + _len));
+            if ((ptr == NULL) || (*ptr != '"'))
                 return -1;
+            // calculate the element len
+            _cur_len = (ptr - _cur_el);
         }
         // check if this is the idx elem
         if (tmp_elem_count == idx)
@@ -1023,15 +1323,16 @@ int JSONP_ARRAY::find_elem(int idx)
     return -1; // couldn't find the element idx
 }
 
-int JSONP_ARRAY::getInt(int idx)
+// the element idx is a number (_cur_el)
+bool JSONP_ARRAY::num_elem(int idx)
 {
     if (_err != JSON_noerr)
-        return 0;
+        return false;
     // check array boundaries
     if ((idx < 0) || (idx >= _el_count))
     {
         _err = JSON_outOfBoundary;
-        return 0;
+        return false;
     }
     // if not already to element idx
     if (idx != _cur_id)
@@ -1041,70 +1342,79 @@ int JSONP_ARRAY::getInt(int idx)
     {
         // not found
         _err = JSON_notFound;
-        return 0;
+        return false;
     }
     if (_cur_type != JSON_num)
     {
         _err = JSON_typeMismatch;
-        return 0;
+        return false;
     }
-    // check if value is a float
-    int ii;
-    for (ii = 0; ii < _cur_len; ii++)
-        if (_cur_el[ii] == '.')
-        {
-            _err = JSON_typeMismatch;
-            return 0;
-        }
-    char value_str[16];
-    mem_mon_stack();
+    return true;
+}
 
-    os_memset(value_str, 0, 16);
-    if (_cur_len > 15)
+int JSONP_ARRAY::getInt(int idx)
+{
+    int value;
+    if (!num_elem(idx))
+        return 0;
+    if (!span_to_int(_cur_el, _cur_len, &value))
     {
         _err = JSON_typeMismatch;
         return 0;
     }
-    os_strncpy(value_str, _cur_el, _cur_len);
-    return atoi(value_str);
+    return value;
 }
 
-float JSONP_ARRAY::getFloat(int idx)
+uint32 JSONP_ARRAY::getUint(int idx)
 {
-    if (_err != JSON_noerr)
-        return 0.0;
-    // check array boundaries
-    if ((idx < 0) || (idx >= _el_count))
+    uint32 value;
+    if (!num_elem(idx))
+        return 0;
+    if (!span_to_uint(_cur_el, _cur_len, &value))
     {
-        _err = JSON_outOfBoundary;
-        return 0.0;
+        _err = JSON_typeMismatch;
+        return 0;
     }
-    // if not already to element idx
-    if (idx != _cur_id)
-        // look for the element idx
-        _cur_id = find_elem(idx);
-    if (_cur_id != idx)
+    return value;
+}
+
+sint64 JSONP_ARRAY::getInt64(int idx)
+{
+    sint64 value;
+    if (!num_elem(idx))
+        return 0;
+    if (!span_to_int64(_cur_el, _cur_len, &value))
     {
-        // not found
-        _err = JSON_notFound;
-        return 0.0;
+        _err = JSON_typeMismatch;
+        return 0;
     }
-    if (_cur_type != JSON_num)
+    return value;
+}
+
+int JSONP_ARRAY::getFixed(int idx, int decimals)
+{
+    int value;
+    if (!num_elem(idx))
+        return 0;
+    if (!span_to_fixed(_cur_el, _cur_len, decimals, &value))
     {
         _err = JSON_typeMismatch;
-        return 0.0;
+        return 0;
     }
-    char value_str[64];
-    mem_mon_stack();
+    return value;
+}
 
-    os_memset(value_str, 0, 64);
-    if (_cur_len > 63)
+float JSONP_ARRAY::getFloat(int idx)
+{
+    float value;
+    if (!num_elem(idx))
+        return 0.0;
+    if (!span_to_float(_cur_el, _cur_len, &value))
     {
         _err = JSON_typeMismatch;
         return 0.0;
     }
-    os_strncpy(value_str, _cur_el, _cur_len);
-    return atof(value_str);
+    return value;
 }
 
 void JSONP_ARRAY::getStr(int idx, char *dest, int len)
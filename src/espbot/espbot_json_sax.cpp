@@ -0,0 +1,458 @@
+/*
+ * ----------------------------------------------------------------------------
+ * "THE BEER-WARE LICENSE" (Revision 42):
+ * <quackmore-ff@yahoo.com> wrote this file.  As long as you retain this notice
+ * you can do whatever you want with this stuff. If we meet some day, and you 
+ * think this stuff is worth it, you can buy me a beer in return. Quackmore
+ * ----------------------------------------------------------------------------
+ */
+
+// SDK includes
+extern "C"
+{
+#include "c_types.h"
+#include "osapi.h"
+}
+
+#include "espbot_diagnostic.hpp"
+#include "espbot_json_sax.hpp"
+#include "espbot_mem_mon.hpp"
+#include "espbot_num.hpp"
+
+static inline bool sax_space(char cc)
+{
+    return ((cc == ' ') || (cc == '\t') || (cc == '\r') || (cc == '\n'));
+}
+
+static inline bool sax_digit(char cc)
+{
+    return ((cc >= '0') && (cc <= '9'));
+}
+
+static int sax_hex(char cc)
+{
+    if (sax_digit(cc))
+        return (cc - '0');
+    if ((cc >= 'a') && (cc <= 'f'))
+        return (cc - 'a' + 10);
+    if ((cc >= 'A') && (cc <= 'F'))
+        return (cc - 'A' + 10);
+    return -1;
+}
+
+// -?(0|[1-9][0-9]*)(\.[0-9]+)?([eE][+-]?[0-9]+)?
+static bool sax_number_ok(char *str, int len)
+{
+    char *end = str + len;
+    if ((str < end) && (*str == '-'))
+        str++;
+    if ((str == end) || !sax_digit(*str))
+        return false;
+    if (*str == '0')
+        str++;
+    else
+        while ((str < end) && sax_digit(*str))
+            str++;
+    if ((str < end) && (*str == '.'))
+    {
+        str++;
+        if ((str == end) || !sax_digit(*str))
+            return false;
+        while ((str < end) && sax_digit(*str))
+            str++;
+    }
+    if ((str < end) && ((*str == 'e') || (*str == 'E')))
+    {
+        str++;
+        if ((str < end) && ((*str == '+') || (*str == '-')))
+            str++;
+        if ((str == end) || !sax_digit(*str))
+            return false;
+        while ((str < end) && sax_digit(*str))
+            str++;
+    }
+    return (str == end);
+}
+
+Json_sax::Json_sax(void *param, Json_sax_cb on_event)
+{
+    m_param = param;
+    m_on_event = on_event;
+    m_state = SAX_value;
+    m_err = JSON_SAX_ok;
+    m_depth = 0;
+    m_key[0] = 0;
+    m_has_key = false;
+    m_string_is_key = false;
+    m_value[0] = 0;
+    m_len = 0;
+    m_unicode = 0;
+    m_unicode_digits = 0;
+}
+
+// with no callback keys and strings are not kept
+int Json_sax::push_char(char c)
+{
+    if ((m_on_event == NULL) && (m_state != SAX_number) && (m_state != SAX_literal))
+        return JSON_SAX_ok;
+    if (m_string_is_key)
+    {
+        if (m_len >= (JSON_SAX_KEY_LEN - 1))
+            return JSON_SAX_too_long;
+        m_key[m_len++] = c;
+        return JSON_SAX_ok;
+    }
+    if (m_len >= (JSON_SAX_VALUE_LEN - 1))
+        return JSON_SAX_too_long;
+    m_value[m_len++] = c;
+    return JSON_SAX_ok;
+}
+
+int Json_sax::emit(Json_sax_event event, Json_value_type type)
+{
+    if (m_on_event == NULL)
+        return JSON_SAX_ok;
+    if (!m_on_event(m_param, this, event, type, m_value, m_len))
+        return JSON_SAX_aborted;
+    return JSON_SAX_ok;
+}
+
+int Json_sax::open(char c)
+{
+    if (m_depth >= JSON_SAX_DEPTH)
+        return JSON_SAX_too_deep;
+    m_len = 0;
+    m_value[0] = 0;
+    int res = emit(((c == '{') ? JSON_SAX_obj_begin : JSON_SAX_array_begin), ((c == '{') ? JSON_obj : JSONP_array));
+    m_stack[m_depth++] = c;
+    m_has_key = false;
+    m_state = ((c == '{') ? SAX_key_or_end : SAX_value_or_end);
+    return res;
+}
+
+int Json_sax::close(char c)
+{
+    if ((m_depth == 0) || (m_stack[m_depth - 1] != ((c == '}') ? '{' : '[')))
+        return JSON_SAX_bad_syntax;
+    m_depth--;
+    m_has_key = false;
+    m_len = 0;
+    m_value[0] = 0;
+    int res = emit(((c == '}') ? JSON_SAX_obj_end : JSON_SAX_array_end), ((c == '}') ? JSON_obj : JSONP_array));
+    m_state = ((m_depth == 0) ? SAX_done : SAX_after_value);
+    return res;
+}
+
+// a number or a literal was terminated by a delimiter (or by the end of data)
+int Json_sax::scalar_end(void)
+{
+    m_value[m_len] = 0;
+    Json_value_type type;
+    if (m_state == SAX_number)
+    {
+        if (!sax_number_ok(m_value, m_len))
+            return JSON_SAX_bad_syntax;
+        type = JSON_num;
+    }
+    else
+    {
+        if ((os_strcmp(m_value, f_str("true")) != 0) &&
+            (os_strcmp(m_value, f_str("false")) != 0) &&
+            (os_strcmp(m_value, f_str("null")) != 0))
+            return JSON_SAX_bad_syntax;
+        type = JSON_unknown;
+    }
+    m_state = ((m_depth == 0) ? SAX_done : SAX_after_value);
+    return emit(JSON_SAX_value, type);
+}
+
+int Json_sax::parse(char c)
+{
+    switch (m_state)
+    {
+    case SAX_value_or_end:
+        if (c == ']')
+            return close(c);
+        // no break
+    case SAX_value:
+        if (sax_space(c))
+            return JSON_SAX_ok;
+        m_len = 0;
+        if ((c == '{') || (c == '['))
+            return open(c);
+        if (c == '"')
+        {
+            m_string_is_key = false;
+            m_state = SAX_string;
+            return JSON_SAX_ok;
+        }
+        if ((c == '-') || sax_digit(c))
+        {
+            m_state = SAX_number;
+            return push_char(c);
+        }
+        if ((c == 't') || (c == 'f') || (c == 'n'))
+        {
+            m_state = SAX_literal;
+            return push_char(c);
+        }
+        return JSON_SAX_bad_syntax;
+    case SAX_key_or_end:
+        if (c == '}')
+            return close(c);
+        // no break
+    case SAX_key:
+        if (sax_space(c))
+            return JSON_SAX_ok;
+        if (c != '"')
+            return JSON_SAX_bad_syntax;
+        m_len = 0;
+        m_string_is_key = true;
+        m_state = SAX_string;
+        return JSON_SAX_ok;
+    case SAX_colon:
+        if (sax_space(c))
+            return JSON_SAX_ok;
+        if (c != ':')
+            return JSON_SAX_bad_syntax;
+        m_state = SAX_value;
+        return JSON_SAX_ok;
+    case SAX_string:
+        if (c == '\\')
+        {
+            m_state = SAX_escape;
+            return JSON_SAX_ok;
+        }
+        if (c == '"')
+        {
+            if (m_string_is_key)
+            {
+                m_key[m_len] = 0;
+                m_has_key = true;
+                m_string_is_key = false;
+                m_state = SAX_colon;
+                return JSON_SAX_ok;
+            }
+            if (m_len < JSON_SAX_VALUE_LEN)
+                m_value[m_len] = 0;
+            m_state = ((m_depth == 0) ? SAX_done : SAX_after_value);
+            return emit(JSON_SAX_value, JSON_str);
+        }
+        if ((unsigned char)c < 0x20)
+            return JSON_SAX_bad_syntax;
+        return push_char(c);
+    case SAX_escape:
+        m_state = SAX_string;
+        switch (c)
+        {
+        case '"':
+        case '\\':
+        case '/':
+            return push_char(c);
+        case 'b':
+            return push_char('\b');
+        case 'f':
+            return push_char('\f');
+        case 'n':
+            return push_char('\n');
+        case 'r':
+            return push_char('\r');
+        case 't':
+            return push_char('\t');
+        case 'u':
+            m_unicode = 0;
+            m_unicode_digits = 0;
+            m_state = SAX_unicode;
+            return JSON_SAX_ok;
+        default:
+            return JSON_SAX_bad_syntax;
+        }
+    case SAX_unicode:
+    {
+        int digit = sax_hex(c);
+        if (digit < 0)
+            return JSON_SAX_bad_syntax;
+        m_unicode = (m_unicode << 4) | digit;
+        if (++m_unicode_digits < 4)
+            return JSON_SAX_ok;
+        m_state = SAX_string;
+        // UTF-8 (surrogate pairs are not combined)
+        if (m_unicode < 0x80)
+            return push_char((char)m_unicode);
+        int res;
+        if (m_unicode < 0x800)
+        {
+            res = push_char((char)(0xC0 | (m_unicode >> 6)));
+        }
+        else
+        {
+            res = push_char((char)(0xE0 | (m_unicode >> 12)));
+            if (res == JSON_SAX_ok)
+                res = push_char((char)(0x80 | ((m_unicode >> 6) & 0x3F)));
+        }
+        if (res == JSON_SAX_ok)
+            res = push_char((char)(0x80 | (m_unicode & 0x3F)));
+        return res;
+    }
+    case SAX_number:
+        if (sax_digit(c) || (c == '.') || (c == 'e') || (c == 'E') || (c == '+') || (c == '-'))
+            return push_char(c);
+        return scalar_end();
+    case SAX_literal:
+        if ((c >= 'a') && (c <= 'z'))
+            return push_char(c);
+        return scalar_end();
+    case SAX_after_value:
+        if (sax_space(c))
+            return JSON_SAX_ok;
+        if ((c == '}') || (c == ']'))
+            return close(c);
+        if (c != ',')
+            return JSON_SAX_bad_syntax;
+        m_has_key = false;
+        m_state = ((m_stack[m_depth - 1] == '{') ? SAX_key : SAX_value);
+        return JSON_SAX_ok;
+    case SAX_done:
+        if (sax_space(c))
+            return JSON_SAX_ok;
+        return JSON_SAX_bad_syntax;
+    default:
+        return m_err;
+    }
+}
+
+int Json_sax::feed(char *data, int len)
+{
+    if (m_err != JSON_SAX_ok)
+        return m_err;
+    int idx;
+    for (idx = 0; idx < len; idx++)
+    {
+        Json_sax_state prev_state = m_state;
+        m_err = (Json_sax_err)parse(data[idx]);
+        // the delimiter ending a number or a literal belongs to what follows
+        if ((m_err == JSON_SAX_ok) &&
+            ((prev_state == SAX_number) || (prev_state == SAX_literal)) &&
+            (m_state != prev_state))
+            m_err = (Json_sax_err)parse(data[idx]);
+        if (m_err != JSON_SAX_ok)
+        {
+            m_state = SAX_error;
+            break;
+        }
+    }
+    mem_mon_stack();
+    return m_err;
+}
+
+int Json_sax::end(void)
+{
+    if (m_err != JSON_SAX_ok)
+        return m_err;
+    if ((m_depth == 0) && ((m_state == SAX_number) || (m_state == SAX_literal)))
+        m_err = (Json_sax_err)scalar_end();
+    else if (m_state != SAX_done)
+        m_err = JSON_SAX_bad_syntax;
+    if (m_err != JSON_SAX_ok)
+        m_state = SAX_error;
+    return m_err;
+}
+
+bool Json_sax::completed(void)
+{
+    return (m_state == SAX_done);
+}
+
+int Json_sax::depth(void)
+{
+    return m_depth;
+}
+
+char *Json_sax::key(void)
+{
+    if (m_has_key && (m_depth > 0) && (m_stack[m_depth - 1] == '{'))
+        return m_key;
+    return NULL;
+}
+
+//
+// Json_binder
+//
+
+Json_binder::Json_binder(struct json_field *fields, int count) : m_sax(this, on_event)
+{
+    m_fields = fields;
+    m_count = count;
+    m_err = JSON_noerr;
+    int idx;
+    for (idx = 0; idx < m_count; idx++)
+        m_fields[idx].found = false;
+}
+
+bool Json_binder::on_event(void *param, Json_sax *sax, Json_sax_event event, Json_value_type type, char *value, int len)
+{
+    Json_binder *binder = (Json_binder *)param;
+    // the root object pairs only
+    if ((event != JSON_SAX_value) || (sax->depth() != 1) || (sax->key() == NULL))
+        return true;
+    int idx;
+    struct json_field *field = NULL;
+    for (idx = 0; idx < binder->m_count; idx++)
+        if (os_strcmp(sax->key(), binder->m_fields[idx].name) == 0)
+        {
+            field = &binder->m_fields[idx];
+            break;
+        }
+    if (field == NULL)
+        return true;
+    if (field->type == JSON_str)
+    {
+        if ((type != JSON_str) || (len >= field->size))
+        {
+            binder->m_err = JSON_typeMismatch;
+            return false;
+        }
+        os_memcpy(field->value, value, len + 1);
+    }
+    else
+    {
+        if (type == JSON_num)
+        {
+            // integers only, in the int range
+            if (!span_to_int(value, len, (int *)field->value))
+            {
+                binder->m_err = JSON_typeMismatch;
+                return false;
+            }
+        }
+        else if ((type == JSON_unknown) && (value[0] != 'n'))
+        {
+            *((int *)field->value) = ((value[0] == 't') ? 1 : 0);
+        }
+        else
+        {
+            binder->m_err = JSON_typeMismatch;
+            return false;
+        }
+    }
+    field->found = true;
+    return true;
+}
+
+int Json_binder::feed(char *data, int len)
+{
+    return m_sax.feed(data, len);
+}
+
+int Json_binder::end(void)
+{
+    if (m_err != JSON_noerr)
+        return m_err;
+    if (m_sax.end() != JSON_SAX_ok)
+        return JSON_sintaxErr;
+    int idx;
+    for (idx = 0; idx < m_count; idx++)
+        if (!m_fields[idx].found)
+            return JSON_notFound;
+    return JSON_noerr;
+}
@@ -0,0 +1,354 @@
+/*
+ * ----------------------------------------------------------------------------
+ * "THE BEER-WARE LICENSE" (Revision 42):
+ * <quackmore-ff@yahoo.com> wrote this file.  As long as you retain this notice
+ * you can do whatever you want with this stuff. If we meet some day, and you 
+ * think this stuff is worth it, you can buy me a beer in return. Quackmore
+ * ----------------------------------------------------------------------------
+ */
+
+// SDK includes
+extern "C"
+{
+#include "c_types.h"
+#include "osapi.h"
+}
+
+#include "espbot_diagnostic.hpp"
+#include "espbot_json_writer.hpp"
+#include "espbot_mem_mon.hpp"
+
+Json_writer::Json_writer(char *dest, int len)
+{
+    m_buf = dest;
+    m_size = (dest ? len : 0);
+    m_len = 0;
+    m_total = 0;
+    m_heap = (dest == NULL);
+    m_pass = 0;
+    m_err = false;
+    m_param = NULL;
+    m_flush = NULL;
+    m_not_first = 0;
+    m_depth = 0;
+}
+
+Json_writer::Json_writer(char *buf, int len, void *param, bool (*flush)(void *param, char *data, int len))
+{
+    m_buf = buf;
+    m_size = len;
+    m_len = 0;
+    m_total = 0;
+    m_heap = false;
+    m_pass = 0;
+    m_err = false;
+    m_param = param;
+    m_flush = flush;
+    m_not_first = 0;
+    m_depth = 0;
+}
+
+Json_writer::~Json_writer()
+{
+    // not released by result()
+    if (m_heap && m_buf)
+        delete[] m_buf;
+}
+
+// room for one more char (and the terminator)
+bool Json_writer::room(void)
+{
+    if ((m_len + 1) < m_size)
+        return true;
+    if (m_flush)
+    {
+        if (!m_flush(m_param, m_buf, m_len))
+            return false;
+        m_len = 0;
+        return true;
+    }
+    return false;
+}
+
+void Json_writer::put(char c)
+{
+    // keep counting, so that len() tells the needed size
+    m_total++;
+    if (m_err)
+        return;
+    if (!room())
+    {
+        // a heap message not fitting is just sized, pass() allocates it
+        if (!m_heap)
+            m_err = true;
+        return;
+    }
+    m_buf[m_len++] = c;
+}
+
+void Json_writer::put_str(const char *str)
+{
+    // byte reads only (str can be a flash string)
+    while (*str)
+        put(*str++);
+}
+
+void Json_writer::put_escaped(const char *str, int len)
+{
+    int idx;
+    for (idx = 0; idx < len; idx++)
+    {
+        char c = str[idx];
+        switch (c)
+        {
+        case '"':
+        case '\\':
+            put('\\');
+            put(c);
+            break;
+        case '\n':
+            put('\\');
+            put('n');
+            break;
+        case '\r':
+            put('\\');
+            put('r');
+            break;
+        case '\t':
+            put('\\');
+            put('t');
+            break;
+        default:
+            if ((unsigned char)c < 0x20)
+            {
+                put('\\');
+                put('u');
+                put('0');
+                put('0');
+                put_hex(((unsigned char)c >> 4));
+                put_hex(((unsigned char)c & 0x0F));
+            }
+            else
+            {
+                put(c);
+            }
+            break;
+        }
+    }
+}
+
+void Json_writer::put_uint(uint32 value)
+{
+    char digits[10];
+    int idx = 0;
+    do
+    {
+        digits[idx++] = '0' + (value % 10);
+        value /= 10;
+    } while (value);
+    while (idx > 0)
+        put(digits[--idx]);
+}
+
+void Json_writer::put_hex(uint32 value)
+{
+    char digits[8];
+    int idx = 0;
+    do
+    {
+        int nibble = value & 0x0F;
+        digits[idx++] = ((nibble < 10) ? ('0' + nibble) : ('A' + nibble - 10));
+        value >>= 4;
+    } while (value);
+    while (idx > 0)
+        put(digits[--idx]);
+}
+
+void Json_writer::value_begin(const char *key)
+{
+    if (m_depth > 0)
+    {
+        uint32 mask = (1 << (m_depth - 1));
+        if (m_not_first & mask)
+            put(',');
+        m_not_first |= mask;
+    }
+    if (key)
+    {
+        put('"');
+        put_str(key);
+        put('"');
+        put(':');
+    }
+}
+
+void Json_writer::open(const char *key, char c)
+{
+    value_begin(key);
+    if (m_depth >= JSON_WRITER_DEPTH)
+    {
+        m_err = true;
+        return;
+    }
+    put(c);
+    m_depth++;
+    m_not_first &= ~(1 << (m_depth - 1));
+}
+
+void Json_writer::close(char c)
+{
+    if (m_depth > 0)
+        m_depth--;
+    put(c);
+}
+
+void Json_writer::obj_begin(const char *key)
+{
+    open(key, '{');
+}
+
+void Json_writer::obj_end(void)
+{
+    close('}');
+}
+
+void Json_writer::array_begin(const char *key)
+{
+    open(key, '[');
+}
+
+void Json_writer::array_end(void)
+{
+    close(']');
+}
+
+void Json_writer::str(const char *key, const char *value)
+{
+    if (value == NULL)
+    {
+        raw(key, NULL);
+        return;
+    }
+    str_begin(key);
+    str_append(value, os_strlen(value));
+    str_end();
+}
+
+void Json_writer::num(const char *key, int value)
+{
+    value_begin(key);
+    if (value < 0)
+    {
+        put('-');
+        put_uint((uint32)(-(value + 1)) + 1);
+        return;
+    }
+    put_uint((uint32)value);
+}
+
+void Json_writer::unum(const char *key, uint32 value)
+{
+    value_begin(key);
+    put_uint(value);
+}
+
+void Json_writer::hex(const char *key, uint32 value)
+{
+    value_begin(key);
+    put('"');
+    put_hex(value);
+    put('"');
+}
+
+void Json_writer::raw(const char *key, const char *json)
+{
+    value_begin(key);
+    if (json)
+        put_str(json);
+    else
+        put_str(f_str("null"));
+}
+
+void Json_writer::str_begin(const char *key)
+{
+    value_begin(key);
+    put('"');
+}
+
+void Json_writer::str_append(const char *value, int len)
+{
+    put_escaped(value, len);
+}
+
+void Json_writer::str_end(void)
+{
+    put('"');
+}
+
+bool Json_writer::pass(void)
+{
+    if (m_pass == 0)
+    {
+        m_pass++;
+        return true;
+    }
+    if (!m_heap || m_err || (m_total < m_size))
+        return false;
+    // the message did not fit: allocate it exactly and write it again
+    if (m_pass >= JSON_WRITER_PASSES)
+    {
+        m_err = true;
+        return false;
+    }
+    if (m_buf)
+        delete[] m_buf;
+    m_size = m_total + 1;
+    m_buf = new char[m_size];
+    if (m_buf == NULL)
+    {
+        m_size = 0;
+        m_err = true;
+        return false;
+    }
+    m_pass++;
+    m_len = 0;
+    m_total = 0;
+    m_not_first = 0;
+    m_depth = 0;
+    return true;
+}
+
+int Json_writer::len(void)
+{
+    return m_total;
+}
+
+char *Json_writer::result(void)
+{
+    mem_mon_stack();
+    if (m_flush)
+    {
+        if (m_err || ((m_len > 0) && !m_flush(m_param, m_buf, m_len)))
+            return NULL;
+        m_len = 0;
+        return m_buf;
+    }
+    if (m_heap)
+    {
+        // not sized and allocated by pass()
+        if (m_err || (m_buf == NULL) || (m_total >= m_size))
+            return NULL;
+        m_buf[m_len] = 0;
+        char *msg = m_buf;
+        // the caller owns the message
+        m_buf = NULL;
+        return msg;
+    }
+    if (m_size == 0)
+        return m_buf;
+    if (m_err)
+        m_buf[0] = 0;
+    else
+        m_buf[m_len] = 0;
+    return m_buf;
+}
@@ -18,18 +18,25 @@ extern "C"
 
 #include "espbot.hpp"
 #include "espbot_cfgfile.hpp"
+#include "espbot_cfgstore.hpp"
 #include "espbot_diagnostic.hpp"
 #include "espbot_event_codes.h"
+#include "espbot_http_cache.hpp"
 #include "espbot_mem_mon.hpp"
 #include "espbot_mdns.hpp"
 #include "espbot_utils.hpp"
 #include "espbot_http_server.hpp"
 
-static struct
+static struct mdns_config
 {
     bool enabled;
 } mdns_cfg;
 
+#define MDNS_CFG_FIELDS(FIELD, type) \
+    FIELD(type, enabled, "mdns_enabled", CFG_bool, 0)
+
+CFG_SCHEMA(mdns_schema, struct mdns_config, mdns_cfg, MDNS_CFG_FIELDS);
+
 static struct
 {
     bool running;
@@ -42,72 +49,24 @@ static int mdns_restore_cfg(void)
 {
     ALL("mdns_restore_cfg");
 
-    if (!Espfile::exists(MDNS_FILENAME))
-        return CFG_cantRestore;
-    Cfgfile cfgfile(MDNS_FILENAME);
-    int enabled = cfgfile.getInt(f_str("mdns_enabled"));
-    if (cfgfile.getErr() != JSON_noerr)
+    int res = cfgstore_restore(MDNS_FILENAME, &mdns_schema);
+    mem_mon_stack();
+    if (res == CFG_error)
     {
         dia_error_evnt(MDNS_RESTORE_CFG_ERROR);
         ERROR("mdns_restore_cfg error");
-        return CFG_error;
     }
-    mdns_cfg.enabled = (bool)enabled;
-    mem_mon_stack();
-    return CFG_ok;
-}
-
-static int mdns_saved_cfg_updated(void)
-{
-    ALL("mdns_saved_cfg_updated");
-    if (!Espfile::exists(MDNS_FILENAME))
-    {
-        return CFG_notUpdated;
-    }
-    Cfgfile cfgfile(MDNS_FILENAME);
-    int enabled = cfgfile.getInt(f_str("mdns_enabled"));
-    if (cfgfile.getErr() != JSON_noerr)
-    {
-        // no need to raise an error, the cfg file will be overwritten
-        // dia_error_evnt(MDNS_SAVED_CFG_UPDATED_ERROR);
-        // ERROR("mdns_saved_cfg_updated error");
-        return CFG_error;
-    }
-    if (mdns_cfg.enabled != (bool)enabled)
-    {
-        return CFG_notUpdated;
-    }
-    mem_mon_stack();
-    return CFG_ok;
+    return res;
 }
 
 char *mdns_cfg_json_stringify(char *dest, int len)
 {
-    // {"mdns_enabled":0}
-    int msg_len = 18 + 1;
-    char *msg;
-    if (dest == NULL)
+    char *msg = cfg_json_stringify(&mdns_schema, dest, len);
+    if (msg == NULL)
     {
-        msg = new char[msg_len];
-        if (msg == NULL)
-        {
-            dia_error_evnt(MDNS_CFG_STRINGIFY_HEAP_EXHAUSTED, msg_len);
-            ERROR("mdns_cfg_json_stringify heap exhausted [%d]", msg_len);
-            return NULL;
-        }
+        dia_error_evnt(MDNS_CFG_STRINGIFY_HEAP_EXHAUSTED, mdns_schema_json_len);
+        ERROR("mdns_cfg_json_stringify heap exhausted [%d]", mdns_schema_json_len);
     }
-    else
-    {
-        msg = dest;
-        if (len < msg_len)
-        {
-            *msg = 0;
-            return msg;
-        }
-    }
-    fs_sprintf(msg,
-               "{\"mdns_enabled\":%d}",
-               mdns_cfg.enabled);
     mem_mon_stack();
     return msg;
 }
@@ -115,18 +74,10 @@ char *mdns_cfg_json_stringify(char *dest, int len)
 int mdns_cfg_save(void)
 {
     ALL("mdns_cfg_save");
-    if (mdns_saved_cfg_updated() == CFG_ok)
+    http_cache_invalidate(f_str("/api/mdns"));
+    if (cfgstore_uptodate(&mdns_schema))
         return CFG_ok;
-    Cfgfile cfgfile(MDNS_FILENAME);
-    if (cfgfile.clear() != SPIFFS_OK)
-        return CFG_error;
-    char str[19];
-    mdns_cfg_json_stringify(str, 19);
-    int res = cfgfile.n_append(str, os_strlen(str));
-    if (res < SPIFFS_OK)
-        return CFG_error;
-    mem_mon_stack();
-    return CFG_ok;
+    return cfgstore_save();
 }
 
 void mdns_start(char *app_alias)
@@ -184,7 +135,7 @@ bool mdns_is_enabled(void)
 
 void mdns_init(void)
 {
-    mdns_cfg.enabled = false;
+    cfg_defaults(&mdns_schema);
     mdns_state.running = false;
 
     if (mdns_restore_cfg() != CFG_ok)
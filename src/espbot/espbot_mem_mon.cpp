@@ -17,6 +17,7 @@ extern "C"
 #include "espbot.hpp"
 #include "espbot_diagnostic.hpp"
 #include "espbot_event_codes.h"
+#include "espbot_json_writer.hpp"
 #include "espbot_mem_mon.hpp"
 #include "espbot_timedate.hpp"
 #include "espbot_utils.hpp"
@@ -94,121 +95,83 @@ void espbot_free(void *addr)
 
 char *mem_mon_json_stringify(char *dest, int len)
 {
-    // {"stack_max_addr":"3FFFFE00","stack_min_addr":"3FFFE660","heap_start_addr":"3FFF17A8","heap_free_size":41368,"heap_max_size":43096,"heap_min_size":39488,"heap_objs":99999,"heap_max_objs":99999}
-
-    int msg_len = 193 + 1;
-    char *msg;
-    if (dest == NULL)
+    Json_writer json(dest, len);
+    // sampled once, every pass writes the same figures
+    uint32 heap_free_size = system_get_free_heap_size();
+    while (json.pass())
     {
-        msg = new char[msg_len];
-        if (msg == NULL)
-        {
-            dia_error_evnt(MEM_MON_STRINGIFY_HEAP_EXHAUSTED, msg_len);
-            ERROR("mem_mon_json_stringify heap exhausted [%d]", msg_len);
-            return NULL;
-        }
+        json.obj_begin();
+        json.hex(f_str("stack_max_addr"), stack_max_addr);
+        json.hex(f_str("stack_min_addr"), stack_min_addr);
+        json.hex(f_str("heap_start_addr"), heap_start_addr);
+        json.unum(f_str("heap_free_size"), heap_free_size);
+        json.unum(f_str("heap_max_size"), max_heap_size);
+        json.unum(f_str("heap_min_size"), min_heap_size);
+        json.unum(f_str("heap_objs"), heap_objs);
+        json.unum(f_str("heap_max_objs"), max_heap_objs);
+        json.obj_end();
     }
-    else
+    char *msg = json.result();
+    if (msg == NULL)
     {
-        msg = dest;
-        if (len < msg_len)
-        {
-            *msg = 0;
-            return msg;
-        }
+        dia_error_evnt(MEM_MON_STRINGIFY_HEAP_EXHAUSTED, json.len());
+        ERROR("mem_mon_json_stringify heap exhausted [%d]", json.len());
     }
-    fs_sprintf(msg,
-               "{\"stack_max_addr\":\"%X\",\"stack_min_addr\":\"%X\",",
-               stack_max_addr,
-               stack_min_addr);
-    fs_sprintf((msg + os_strlen(msg)),
-               "\"heap_start_addr\":\"%X\",\"heap_free_size\":%d,",
-               heap_start_addr,
-               system_get_free_heap_size());
-    fs_sprintf((msg + os_strlen(msg)),
-               "\"heap_max_size\":%d,\"heap_min_size\":%d,",
-               max_heap_size,
-               min_heap_size);
-    fs_sprintf((msg + os_strlen(msg)),
-               "\"heap_objs\":%d,\"heap_max_objs\":%d}",
-               heap_objs,
-               max_heap_objs);
     mem_mon_stack();
     return msg;
 }
 
 char *mem_dump_json_stringify(char *address_str, int dump_len, char *dest, int len)
 {
-    // {"address":"3FFE8950","length":00000,"content":""}
-    int msg_len = 50 + dump_len + 1;
-    char *msg;
-    if (dest == NULL)
+    char *address = (char *)atoh(address_str);
+    Json_writer json(dest, len);
+    while (json.pass())
     {
-        msg = new char[msg_len];
-        if (msg == NULL)
-        {
-            dia_error_evnt(MEM_DUMP_STRINGIFY_HEAP_EXHAUSTED, msg_len);
-            ERROR("mem_dump_json_stringify heap exhausted [%d]", msg_len);
-            return NULL;
-        }
+        json.obj_begin();
+        json.hex(f_str("address"), (uint32)address);
+        json.num(f_str("length"), dump_len);
+        json.str_begin(f_str("content"));
+        json.str_append(address, dump_len);
+        json.str_end();
+        json.obj_end();
     }
-    else
+    char *msg = json.result();
+    if (msg == NULL)
     {
-        msg = dest;
-        if (len < msg_len)
-        {
-            *msg = 0;
-            return msg;
-        }
+        dia_error_evnt(MEM_DUMP_STRINGIFY_HEAP_EXHAUSTED, json.len());
+        ERROR("mem_dump_json_stringify heap exhausted [%d]", json.len());
     }
-    char *address = (char *)atoh(address_str);
-    fs_sprintf(msg,
-               "{\"address\":\"%X\",\"length\":%d,\"content\":\"",
-               address,
-               dump_len);
-    int cnt;
-    for (cnt = 0; cnt < dump_len; cnt++)
-        os_sprintf(msg + os_strlen(msg), "%c", *(address + cnt));
-    fs_sprintf(msg + os_strlen(msg), "\"}");
     mem_mon_stack();
     return msg;
 }
 
 char *mem_dump_hex_json_stringify(char *address_str, int dump_len, char *dest, int len)
 {
-    // {"address":"3FFE8950","length":00000,"content":""}
-    // {"address":"3FFE8950","length":00000,"content":" 33 2E 30 2E 34 28 39 35 33 32 63 65 62 29 0 0 70 76 50 6F 72 74 4D 61"}
-
-    int msg_len = 50 + (dump_len * 3) + 1;
-    char *msg;
-    if (dest == NULL)
+    // {"address":"3FFE8950","length":24,"content":" 33 2E 30 2E 34 28 39 35 33 32 63 65 62 29 0 0 70 76 50 6F 72 74 4D 61"}
+    char *address = (char *)atoh(address_str);
+    Json_writer json(dest, len);
+    while (json.pass())
     {
-        msg = new char[msg_len];
-        if (msg == NULL)
+        json.obj_begin();
+        json.hex(f_str("address"), (uint32)address);
+        json.num(f_str("length"), dump_len);
+        json.str_begin(f_str("content"));
+        char byte_str[4];
+        int cnt;
+        for (cnt = 0; cnt < dump_len; cnt++)
         {
-            dia_error_evnt(MEM_DUMP_HEX_STRINGIFY_HEAP_EXHAUSTED, msg_len);
-            ERROR("mem_dump_json_stringify heap exhausted [%d]", msg_len);
-            return NULL;
+            fs_sprintf(byte_str, " %X", (uint8)address[cnt]);
+            json.str_append(byte_str, os_strlen(byte_str));
         }
+        json.str_end();
+        json.obj_end();
     }
-    else
+    char *msg = json.result();
+    if (msg == NULL)
     {
-        msg = dest;
-        if (len < msg_len)
-        {
-            *msg = 0;
-            return msg;
-        }
+        dia_error_evnt(MEM_DUMP_HEX_STRINGIFY_HEAP_EXHAUSTED, json.len());
+        ERROR("mem_dump_hex_json_stringify heap exhausted [%d]", json.len());
     }
-    char *address = (char *)atoh(address_str);
-    fs_sprintf(msg,
-               "{\"address\":\"%X\",\"length\":%d,\"content\":\"",
-               address,
-               dump_len);
-    int cnt;
-    for (cnt = 0; cnt < dump_len; cnt++)
-        os_sprintf(msg + os_strlen(msg), " %X", *(address + cnt));
-    fs_sprintf(msg + os_strlen(msg), "\"}");
     mem_mon_stack();
     return msg;
 }
@@ -235,60 +198,37 @@ char *mem_last_reset_json_stringify(char *dest, int len)
     //     uint32 excvaddr;
     //     uint32 depc;
     // };
-    // {"date":"","reason":"","exccause":"","epc1":"","epc2":"","epc3":"","evcvaddr":"","depc":"","sp":"","spDump":[]}
-    // array item "01234567",
-    int msg_len = 111 + 24 + 7 * 8 + 11 * 19 + 1;
-    char *msg;
-    if (dest == NULL)
-    {
-        msg = new char[msg_len];
-        if (msg == NULL)
-        {
-            dia_error_evnt(MEM_LAST_RESET_STRINGIFY_HEAP_EXHAUSTED, msg_len);
-            ERROR("mem_last_reset_json_stringify heap exhausted [%d]", msg_len);
-            return NULL;
-        }
-    }
-    else
+    struct rst_info *last_rst = system_get_rst_info();
+    Json_writer json(dest, len);
+    while (json.pass())
     {
-        msg = dest;
-        if (len < msg_len)
+        json.obj_begin();
+        json.str(f_str("date"), timedate_get_timestr(espbot_get_last_reboot_time()));
+        json.hex(f_str("reason"), last_rst->reason);
+        json.hex(f_str("exccause"), last_rst->exccause);
+        json.hex(f_str("epc1"), last_rst->epc1);
+        json.hex(f_str("epc2"), last_rst->epc2);
+        json.hex(f_str("epc3"), last_rst->epc3);
+        json.hex(f_str("evcvaddr"), last_rst->excvaddr);
+        json.hex(f_str("depc"), last_rst->depc);
+        json.hex(f_str("sp"), get_last_crash_SP());
+        json.array_begin(f_str("spDump"));
+        uint32 address;
+        int res = get_last_crash_stack_dump(0, &address);
+        while (res == 0)
         {
-            *msg = 0;
-            return msg;
+            json.hex(NULL, address);
+            res = get_last_crash_stack_dump(1, &address);
         }
+        json.array_end();
+        json.obj_end();
     }
-    struct rst_info *last_rst = system_get_rst_info();
-    fs_sprintf(msg,
-               "{\"date\":\"%s\","
-               "\"reason\":\"%X\","
-               "\"exccause\":\"%X\","
-               "\"epc1\":\"%X\",",
-               timedate_get_timestr(espbot_get_last_reboot_time()),
-               last_rst->reason,
-               last_rst->exccause,
-               last_rst->epc1);
-    fs_sprintf(msg + os_strlen(msg),
-               "\"epc2\":\"%X\","
-               "\"epc3\":\"%X\","
-               "\"evcvaddr\":\"%X\","
-               "\"depc\":\"%X\",",
-               last_rst->epc2,
-               last_rst->epc3,
-               last_rst->excvaddr,
-               last_rst->depc);
-    fs_sprintf(msg + os_strlen(msg),
-               "\"sp\":\"%X\","
-               "\"spDump\":[",
-               get_last_crash_SP());
-    uint32 address;
-    int res = get_last_crash_stack_dump(0, &address);
-    while (res == 0)
+    char *msg = json.result();
+    if (msg == NULL)
     {
-        fs_sprintf(msg + os_strlen(msg), "\"%X\",", address);
-        res = get_last_crash_stack_dump(1, &address);
+        dia_error_evnt(MEM_LAST_RESET_STRINGIFY_HEAP_EXHAUSTED, json.len());
+        ERROR("mem_last_reset_json_stringify heap exhausted [%d]", json.len());
     }
-    fs_sprintf(msg + os_strlen(msg) - 1, "]}");
     mem_mon_stack();
     return msg;
 }
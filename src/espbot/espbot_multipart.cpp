@@ -0,0 +1,520 @@
+/*
+ * ----------------------------------------------------------------------------
+ * "THE BEER-WARE LICENSE" (Revision 42):
+ * <quackmore-ff@yahoo.com> wrote this file.  As long as you retain this notice
+ * you can do whatever you want with this stuff. If we meet some day, and you 
+ * think this stuff is worth it, you can buy me a beer in return. Quackmore
+ * ----------------------------------------------------------------------------
+ */
+
+// SDK includes
+extern "C"
+{
+#include "c_types.h"
+#include "mem.h"
+#include "osapi.h"
+}
+
+#include "espbot.hpp"
+#include "espbot_diagnostic.hpp"
+#include "espbot_event_codes.h"
+#include "espbot_http.hpp"
+#include "espbot_list.hpp"
+#include "espbot_mem_mon.hpp"
+#include "espbot_multipart.hpp"
+#include "espbot_spiffs.hpp"
+#include "espbot_utils.hpp"
+
+//
+// MULTIPART PARSER
+//
+
+Multipart_parser::Multipart_parser(void *param,
+                                   bool (*on_part_begin)(void *param, char *name, char *filename),
+                                   bool (*on_part_data)(void *param, char *data, int len),
+                                   bool (*on_part_end)(void *param))
+{
+    m_param = param;
+    m_on_part_begin = on_part_begin;
+    m_on_part_data = on_part_data;
+    m_on_part_end = on_part_end;
+    m_state = MP_error;
+    m_delimiter = NULL;
+    m_delimiter_len = 0;
+    m_match = 0;
+    m_headers = NULL;
+    m_headers_len = 0;
+}
+
+Multipart_parser::~Multipart_parser()
+{
+    if (m_delimiter)
+        delete[] m_delimiter;
+    if (m_headers)
+        delete[] m_headers;
+}
+
+int Multipart_parser::init(char *content_type)
+{
+    ALL("Multipart_parser::init");
+    // multipart/form-data; boundary=----WebKitFormBoundary7MA4YWxkTrZu0gW
+    char *boundary = (char *)os_strstr(content_type, f_str("boundary="));
+    if (boundary == NULL)
+        return MULTIPART_bad_syntax;
+    boundary += 9;
+    if (*boundary == '"')
+        boundary++;
+    int boundary_len = 0;
+    while (boundary[boundary_len] &&
+           (boundary[boundary_len] != '"') &&
+           (boundary[boundary_len] != ';'))
+        boundary_len++;
+    if ((boundary_len == 0) || (boundary_len > MULTIPART_BOUNDARY_MAX))
+        return MULTIPART_bad_syntax;
+    m_delimiter = new char[4 + boundary_len + 1];
+    m_headers = new char[MULTIPART_HEADERS_MAX + 1];
+    if ((m_delimiter == NULL) || (m_headers == NULL))
+        return MULTIPART_heap_exhausted;
+    os_strcpy(m_delimiter, f_str("\r\n--"));
+    os_strncpy(m_delimiter + 4, boundary, boundary_len);
+    m_delimiter_len = 4 + boundary_len;
+    // the body starts with "--boundary": act like the leading CRLF was already matched
+    m_match = 2;
+    m_state = MP_preamble;
+    return MULTIPART_ok;
+}
+
+bool Multipart_parser::completed(void)
+{
+    return (m_state == MP_epilogue);
+}
+
+int Multipart_parser::emit(char *data, int len)
+{
+    if ((m_state != MP_data) || (len <= 0))
+        return MULTIPART_ok;
+    if (!m_on_part_data(m_param, data, len))
+        return MULTIPART_aborted;
+    return MULTIPART_ok;
+}
+
+// looking for a Content-Disposition parameter value e.g. filename="index.html"
+static char *multipart_header_param(char *headers, const char *param, int param_len)
+{
+    char *ptr = headers;
+    while ((ptr = (char *)os_strstr(ptr, param)) != NULL)
+    {
+        // name=" is also the tail of filename="
+        if ((ptr == headers) || (*(ptr - 1) == ' ') || (*(ptr - 1) == ';'))
+            return ptr + param_len;
+        ptr += param_len;
+    }
+    return NULL;
+}
+
+static void multipart_param_terminate(char *value)
+{
+    if (value == NULL)
+        return;
+    char *value_end = (char *)os_strstr(value, f_str("\""));
+    if (value_end)
+        *value_end = 0;
+}
+
+int Multipart_parser::parse_headers(void)
+{
+    m_headers[m_headers_len] = 0;
+    // find both the values before terminating them in place
+    char *filename = multipart_header_param(m_headers, f_str("filename=\""), 10);
+    char *name = multipart_header_param(m_headers, f_str("name=\""), 6);
+    multipart_param_terminate(filename);
+    multipart_param_terminate(name);
+    if (!m_on_part_begin(m_param, name, filename))
+        return MULTIPART_aborted;
+    return MULTIPART_ok;
+}
+
+int Multipart_parser::feed(char *data, int len)
+{
+    int idx = 0;
+    int run_start = 0; // part data not yet passed to on_part_data
+    int res;
+    while (idx < len)
+    {
+        char cc = data[idx];
+        switch (m_state)
+        {
+        case MP_preamble:
+        case MP_data:
+            if (cc == m_delimiter[m_match])
+            {
+                if (m_match == 0)
+                {
+                    // the data before a possible delimiter
+                    res = emit(data + run_start, idx - run_start);
+                    if (res != MULTIPART_ok)
+                    {
+                        m_state = MP_error;
+                        return res;
+                    }
+                }
+                m_match++;
+                idx++;
+                run_start = idx;
+                if (m_match == m_delimiter_len)
+                {
+                    if ((m_state == MP_data) && !m_on_part_end(m_param))
+                    {
+                        m_state = MP_error;
+                        return MULTIPART_aborted;
+                    }
+                    m_match = 0;
+                    m_state = MP_after_delimiter;
+                }
+            }
+            else if (m_match > 0)
+            {
+                // false alarm: the matched bytes were data
+                // (CR is found only at the delimiter start, so restarting the match is enough)
+                res = emit(m_delimiter, m_match);
+                if (res != MULTIPART_ok)
+                {
+                    m_state = MP_error;
+                    return res;
+                }
+                m_match = 0;
+                run_start = idx;
+            }
+            else
+            {
+                idx++;
+            }
+            break;
+        case MP_after_delimiter:
+            idx++;
+            if (cc == '-')
+                m_state = MP_end_dash;
+            else if (cc == '\r')
+                m_state = MP_delimiter_cr;
+            else if ((cc != ' ') && (cc != '\t')) // transport padding
+            {
+                m_state = MP_error;
+                return MULTIPART_bad_syntax;
+            }
+            break;
+        case MP_end_dash:
+            idx++;
+            if (cc != '-')
+            {
+                m_state = MP_error;
+                return MULTIPART_bad_syntax;
+            }
+            m_state = MP_epilogue;
+            break;
+        case MP_delimiter_cr:
+            idx++;
+            if (cc != '\n')
+            {
+                m_state = MP_error;
+                return MULTIPART_bad_syntax;
+            }
+            m_headers_len = 0;
+            m_state = MP_headers;
+            break;
+        case MP_headers:
+            idx++;
+            if (m_headers_len >= MULTIPART_HEADERS_MAX)
+            {
+                m_state = MP_error;
+                return MULTIPART_headers_too_long;
+            }
+            m_headers[m_headers_len++] = cc;
+            // headers end with an empty line (a part with no headers starts with it)
+            if ((cc == '\n') &&
+                (((m_headers_len == 2) && (m_headers[0] == '\r')) ||
+                 ((m_headers_len >= 4) && (os_strncmp(m_headers + m_headers_len - 4, f_str("\r\n\r\n"), 4) == 0))))
+            {
+                res = parse_headers();
+                if (res != MULTIPART_ok)
+                {
+                    m_state = MP_error;
+                    return res;
+                }
+                m_state = MP_data;
+                m_match = 0;
+                run_start = idx;
+            }
+            break;
+        case MP_epilogue:
+            // ignored
+            return MULTIPART_ok;
+        default:
+            return MULTIPART_bad_syntax;
+        }
+    }
+    // the bytes matching the delimiter stay into m_match
+    if (m_match == 0)
+        return emit(data + run_start, len - run_start);
+    return MULTIPART_ok;
+}
+
+//
+// HTTP UPLOAD
+//
+
+struct http_upload
+{
+    struct espconn *p_espconn;
+    Multipart_parser *parser;
+    Espfile *file;
+    int content_len;
+    int content_received;
+    int files;
+    int bytes;
+    int err_code; // the error response was already sent
+    const char *err_msg;
+};
+
+static List<struct http_upload> *uploads;
+
+static bool upload_part_begin(void *param, char *name, char *filename)
+{
+    struct http_upload *upload = (struct http_upload *)param;
+    // not a file (a form field)
+    if ((filename == NULL) || (*filename == 0))
+        return true;
+    // some browsers send the full client path
+    char *ptr = filename;
+    while (*ptr)
+    {
+        if ((*ptr == '/') || (*ptr == '\\'))
+            filename = ptr + 1;
+        ptr++;
+    }
+    if ((*filename == 0) || (os_strlen(filename) >= SPIFFS_OBJ_NAME_LEN))
+    {
+        upload->err_code = HTTP_BAD_REQUEST;
+        upload->err_msg = f_str("Bad file name");
+        return false;
+    }
+    upload->file = new Espfile(filename);
+    if (upload->file == NULL)
+    {
+        dia_error_evnt(UPLOAD_HEAP_EXHAUSTED, sizeof(Espfile));
+        ERROR("upload_part_begin heap exhausted %d", sizeof(Espfile));
+        upload->err_code = HTTP_SERVER_ERROR;
+        upload->err_msg = f_str("Heap exhausted");
+        return false;
+    }
+    // overwrite existing files
+    if (upload->file->clear() != SPIFFS_OK)
+    {
+        dia_error_evnt(UPLOAD_FILE_WRITE_ERROR);
+        ERROR("upload_part_begin cannot write %s", filename);
+        upload->err_code = HTTP_SERVER_ERROR;
+        upload->err_msg = f_str("Error writing file");
+        return false;
+    }
+    DEBUG("upload_part_begin file %s", filename);
+    return true;
+}
+
+static bool upload_part_data(void *param, char *data, int len)
+{
+    struct http_upload *upload = (struct http_upload *)param;
+    if (upload->file == NULL)
+        return true;
+    if (upload->file->n_append(data, len) < SPIFFS_OK)
+    {
+        dia_error_evnt(UPLOAD_FILE_WRITE_ERROR);
+        ERROR("upload_part_data cannot write file");
+        upload->err_code = HTTP_SERVER_ERROR;
+        upload->err_msg = f_str("Error writing file");
+        return false;
+    }
+    upload->bytes += len;
+    return true;
+}
+
+static bool upload_part_end(void *param)
+{
+    struct http_upload *upload = (struct http_upload *)param;
+    if (upload->file == NULL)
+        return true;
+    // closing the file will flush the cache
+    delete upload->file;
+    upload->file = NULL;
+    upload->files++;
+    return true;
+}
+
+// deletes the upload at the list cursor
+static void http_upload_delete(struct http_upload *upload)
+{
+    if (upload->file)
+        delete upload->file;
+    if (upload->parser)
+        delete upload->parser;
+    uploads->remove();
+}
+
+// uploads on connections closed without a disconnect or reconnect callback
+// are dropped (the espconn may have been reused by a new connection)
+static struct http_upload *http_upload_find(struct espconn *p_espconn)
+{
+    struct http_upload *upload = uploads->front();
+    while (upload)
+    {
+        if (!http_espconn_in_use(upload->p_espconn))
+        {
+            WARN("http_upload_find dropping upload on espconn %X", upload->p_espconn);
+            http_upload_delete(upload);
+            // one element removed from list, restart from front
+            upload = uploads->front();
+            continue;
+        }
+        if (upload->p_espconn == p_espconn)
+            return upload;
+        upload = uploads->next();
+    }
+    return NULL;
+}
+
+static void http_upload_remove(struct espconn *p_espconn)
+{
+    struct http_upload *upload = http_upload_find(p_espconn);
+    if (upload == NULL)
+        return;
+    http_upload_delete(upload);
+}
+
+static void http_upload_feed(struct http_upload *upload, char *data, int len)
+{
+    ALL("http_upload_feed");
+    struct espconn *p_espconn = upload->p_espconn;
+    upload->content_received += len;
+    // after an error the remaining data are just discarded
+    if (upload->err_code == 0)
+    {
+        int res = upload->parser->feed(data, len);
+        if (res != MULTIPART_ok)
+        {
+            if (upload->err_code == 0)
+            {
+                dia_error_evnt(UPLOAD_BAD_SYNTAX, res);
+                ERROR("http_upload_feed multipart error %d", res);
+                upload->err_code = HTTP_BAD_REQUEST;
+                upload->err_msg = f_str("Multipart bad syntax");
+            }
+            if (upload->file)
+            {
+                delete upload->file;
+                upload->file = NULL;
+            }
+            http_response(p_espconn, upload->err_code, HTTP_CONTENT_JSON, upload->err_msg, false);
+        }
+    }
+    if (upload->content_received < upload->content_len)
+        return;
+    if (upload->err_code == 0)
+    {
+        if (upload->parser->completed())
+        {
+            dia_info_evnt(UPLOAD_COMPLETED, upload->files);
+            INFO("upload completed, %d files, %d bytes", upload->files, upload->bytes);
+            // {"msg":"Files uploaded","files":,"bytes":}
+            char msg[42 + 6 + 10 + 1];
+            fs_sprintf(msg, "{\"msg\":\"Files uploaded\",\"files\":%d,\"bytes\":%d}", upload->files, upload->bytes);
+            http_response(p_espconn, HTTP_CREATED, HTTP_CONTENT_JSON, msg, false);
+        }
+        else
+        {
+            dia_error_evnt(UPLOAD_BAD_SYNTAX, MULTIPART_bad_syntax);
+            ERROR("http_upload_feed multipart incomplete");
+            http_response(p_espconn, HTTP_BAD_REQUEST, HTTP_CONTENT_JSON, f_str("Multipart bad syntax"), false);
+        }
+    }
+    http_upload_remove(p_espconn);
+    mem_mon_stack();
+}
+
+bool http_upload_start(struct espconn *p_espconn, Http_parsed_req *parsed_req)
+{
+    ALL("http_upload_start");
+    if (parsed_req->req_method != HTTP_POST)
+        return false;
+    if (os_strcmp(parsed_req->url, f_str("/api/file")) != 0)
+        return false;
+    if ((parsed_req->content_type == NULL) ||
+        (os_strncmp(parsed_req->content_type, f_str("multipart/form-data"), 19) != 0))
+        return false;
+    if (uploads == NULL)
+        uploads = new List<struct http_upload>(HTTP_UPLOAD_MAX_COUNT, delete_content);
+    // a full walk of the list drops the uploads left by aborted connections
+    if (uploads)
+        http_upload_find(NULL);
+    if ((uploads == NULL) || uploads->full())
+    {
+        dia_error_evnt(UPLOAD_TABLE_FULL);
+        ERROR("http_upload_start too many uploads");
+        http_response(p_espconn, HTTP_CONFLICT, HTTP_CONTENT_JSON, f_str("Too many uploads"), false);
+        return true;
+    }
+    struct http_upload *upload = new struct http_upload;
+    if (upload == NULL)
+    {
+        dia_error_evnt(UPLOAD_HEAP_EXHAUSTED, sizeof(struct http_upload));
+        ERROR("http_upload_start heap exhausted %d", sizeof(struct http_upload));
+        http_response(p_espconn, HTTP_SERVER_ERROR, HTTP_CONTENT_JSON, f_str("Heap exhausted"), false);
+        return true;
+    }
+    os_memset(upload, 0, sizeof(struct http_upload));
+    upload->p_espconn = p_espconn;
+    upload->content_len = parsed_req->h_content_len;
+    upload->parser = new Multipart_parser(upload, upload_part_begin, upload_part_data, upload_part_end);
+    int res = (upload->parser ? upload->parser->init(parsed_req->content_type) : MULTIPART_heap_exhausted);
+    if (res != MULTIPART_ok)
+    {
+        if (res == MULTIPART_heap_exhausted)
+        {
+            dia_error_evnt(UPLOAD_HEAP_EXHAUSTED, MULTIPART_HEADERS_MAX);
+            ERROR("http_upload_start heap exhausted %d", MULTIPART_HEADERS_MAX);
+            http_response(p_espconn, HTTP_SERVER_ERROR, HTTP_CONTENT_JSON, f_str("Heap exhausted"), false);
+        }
+        else
+        {
+            http_response(p_espconn, HTTP_BAD_REQUEST, HTTP_CONTENT_JSON, f_str("Multipart boundary missing"), false);
+        }
+        if (upload->parser)
+            delete upload->parser;
+        delete upload;
+        return true;
+    }
+    if (uploads->push_back(upload) != list_ok)
+    {
+        delete upload->parser;
+        delete upload;
+        http_response(p_espconn, HTTP_SERVER_ERROR, HTTP_CONTENT_JSON, f_str("Heap exhausted"), false);
+        return true;
+    }
+    http_upload_feed(upload, parsed_req->req_content, parsed_req->content_len);
+    return true;
+}
+
+bool http_upload_recv(struct espconn *p_espconn, char *data, int len)
+{
+    if (uploads == NULL)
+        return false;
+    struct http_upload *upload = http_upload_find(p_espconn);
+    if (upload == NULL)
+        return false;
+    http_upload_feed(upload, data, len);
+    return true;
+}
+
+void http_upload_forget(struct espconn *p_espconn)
+{
+    if (uploads == NULL)
+        return;
+    http_upload_remove(p_espconn);
+}
@@ -0,0 +1,305 @@
+/*
+ * ----------------------------------------------------------------------------
+ * "THE BEER-WARE LICENSE" (Revision 42):
+ * <quackmore-ff@yahoo.com> wrote this file.  As long as you retain this notice
+ * you can do whatever you want with this stuff. If we meet some day, and you 
+ * think this stuff is worth it, you can buy me a beer in return. Quackmore
+ * ----------------------------------------------------------------------------
+ */
+
+// SDK includes
+extern "C"
+{
+#include "c_types.h"
+}
+
+#include "espbot_mem_macros.h"
+#include "espbot_num.hpp"
+
+//
+// a JSON number as mantissa * 10^exp
+// (the mantissa takes as many digits as an uint32 can, the others are just counted)
+//
+struct span_num
+{
+    bool negative;
+    uint32 mant;
+    bool full;
+    int exp;
+    int next_digit; // the first digit not fitting the mantissa (for rounding)
+};
+
+static inline bool is_digit(char c)
+{
+    return ((c >= '0') && (c <= '9'));
+}
+
+// result: the digit was taken into the mantissa
+static inline bool span_add_digit(struct span_num *num, uint32 digit)
+{
+    if (!num->full)
+    {
+        // 4294967295
+        if ((num->mant < 429496729) || ((num->mant == 429496729) && (digit <= 5)))
+        {
+            num->mant = num->mant * 10 + digit;
+            return true;
+        }
+        num->full = true;
+        num->next_digit = digit;
+    }
+    return false;
+}
+
+static bool span_split(const char *ptr, int len, struct span_num *num)
+{
+    const char *end = ptr + len;
+    num->negative = false;
+    num->mant = 0;
+    num->full = false;
+    num->exp = 0;
+    num->next_digit = 0;
+    if ((ptr < end) && (*ptr == '-'))
+    {
+        num->negative = true;
+        ptr++;
+    }
+    if ((ptr == end) || !is_digit(*ptr))
+        return false;
+    // integer part
+    while ((ptr < end) && is_digit(*ptr))
+    {
+        if (!span_add_digit(num, (*ptr - '0')))
+            num->exp++;
+        ptr++;
+    }
+    // fraction
+    if ((ptr < end) && (*ptr == '.'))
+    {
+        ptr++;
+        if ((ptr == end) || !is_digit(*ptr))
+            return false;
+        while ((ptr < end) && is_digit(*ptr))
+        {
+            if (span_add_digit(num, (*ptr - '0')))
+                num->exp--;
+            ptr++;
+        }
+    }
+    // exponent
+    if ((ptr < end) && ((*ptr == 'e') || (*ptr == 'E')))
+    {
+        ptr++;
+        bool exp_negative = false;
+        if ((ptr < end) && ((*ptr == '+') || (*ptr == '-')))
+        {
+            exp_negative = (*ptr == '-');
+            ptr++;
+        }
+        if ((ptr == end) || !is_digit(*ptr))
+            return false;
+        int exp = 0;
+        while ((ptr < end) && is_digit(*ptr))
+        {
+            // way out of any range, just saturate
+            if (exp < 10000)
+                exp = exp * 10 + (*ptr - '0');
+            ptr++;
+        }
+        num->exp += (exp_negative ? -exp : exp);
+    }
+    return (ptr == end);
+}
+
+//
+// integers: the digits are accumulated with an overflow check on every digit
+// (max is the absolute value limit)
+//
+static bool span_to_u32(const char *ptr, int len, bool *negative, uint32 *value)
+{
+    const char *end = ptr + len;
+    *negative = false;
+    if ((ptr < end) && (*ptr == '-'))
+    {
+        *negative = true;
+        ptr++;
+    }
+    if (ptr == end)
+        return false;
+    uint32 acc = 0;
+    while (ptr < end)
+    {
+        if (!is_digit(*ptr))
+            return false;
+        uint32 digit = (*ptr - '0');
+        // 4294967295
+        if ((acc > 429496729) || ((acc == 429496729) && (digit > 5)))
+            return false;
+        acc = acc * 10 + digit;
+        ptr++;
+    }
+    *value = acc;
+    return true;
+}
+
+static bool span_to_u64(const char *ptr, int len, bool *negative, uint64 *value)
+{
+    const char *end = ptr + len;
+    *negative = false;
+    if ((ptr < end) && (*ptr == '-'))
+    {
+        *negative = true;
+        ptr++;
+    }
+    if (ptr == end)
+        return false;
+    uint64 acc = 0;
+    while (ptr < end)
+    {
+        if (!is_digit(*ptr))
+            return false;
+        uint32 digit = (*ptr - '0');
+        // 18446744073709551615
+        if ((acc > 1844674407370955161ULL) || ((acc == 1844674407370955161ULL) && (digit > 5)))
+            return false;
+        acc = acc * 10 + digit;
+        ptr++;
+    }
+    *value = acc;
+    return true;
+}
+
+bool span_to_int(const char *ptr, int len, int *value)
+{
+    bool negative;
+    uint32 abs_value;
+    if (!span_to_u32(ptr, len, &negative, &abs_value))
+        return false;
+    if (abs_value > (negative ? 2147483648U : 2147483647U))
+        return false;
+    *value = (negative ? (int)(0U - abs_value) : (int)abs_value);
+    return true;
+}
+
+bool span_to_uint(const char *ptr, int len, uint32 *value)
+{
+    bool negative;
+    uint32 abs_value;
+    if (!span_to_u32(ptr, len, &negative, &abs_value))
+        return false;
+    // "-0" is fine
+    if (negative && abs_value)
+        return false;
+    *value = abs_value;
+    return true;
+}
+
+bool span_to_int64(const char *ptr, int len, sint64 *value)
+{
+    bool negative;
+    uint64 abs_value;
+    if (!span_to_u64(ptr, len, &negative, &abs_value))
+        return false;
+    if (abs_value > (negative ? 9223372036854775808ULL : 9223372036854775807ULL))
+        return false;
+    *value = (negative ? (sint64)(0ULL - abs_value) : (sint64)abs_value);
+    return true;
+}
+
+bool span_to_uint64(const char *ptr, int len, uint64 *value)
+{
+    bool negative;
+    uint64 abs_value;
+    if (!span_to_u64(ptr, len, &negative, &abs_value))
+        return false;
+    if (negative && abs_value)
+        return false;
+    *value = abs_value;
+    return true;
+}
+
+bool span_to_fixed(const char *ptr, int len, int decimals, int *value)
+{
+    struct span_num num;
+    if (!span_split(ptr, len, &num))
+        return false;
+    uint32 abs_value = num.mant;
+    int exp = num.exp + decimals;
+    int round_digit = num.next_digit;
+    if (abs_value == 0)
+        exp = 0;
+    // every significant digit dropped
+    if (exp < -10)
+    {
+        abs_value = 0;
+        round_digit = 0;
+        exp = 0;
+    }
+    while (exp > 0)
+    {
+        if (abs_value > 429496729)
+            return false;
+        abs_value *= 10;
+        exp--;
+    }
+    while (exp < 0)
+    {
+        round_digit = abs_value % 10;
+        abs_value /= 10;
+        exp++;
+    }
+    if (round_digit >= 5)
+    {
+        if (abs_value == 0xFFFFFFFF)
+            return false;
+        abs_value++;
+    }
+    if (abs_value > (num.negative ? 2147483648U : 2147483647U))
+        return false;
+    *value = (num.negative ? (int)(0U - abs_value) : (int)abs_value);
+    return true;
+}
+
+// 10^idx
+static const float pow10_table[] IROM_TEXT ALIGNED_4 = {
+    1e0f, 1e1f, 1e2f, 1e3f, 1e4f, 1e5f, 1e6f, 1e7f, 1e8f, 1e9f,
+    1e10f, 1e11f, 1e12f, 1e13f, 1e14f, 1e15f, 1e16f, 1e17f, 1e18f, 1e19f,
+    1e20f, 1e21f, 1e22f, 1e23f, 1e24f, 1e25f, 1e26f, 1e27f, 1e28f, 1e29f,
+    1e30f, 1e31f, 1e32f, 1e33f, 1e34f, 1e35f, 1e36f, 1e37f, 1e38f};
+
+#define NUM_POW10_MAX 38
+#define NUM_FLOAT_MAX 3.40282347e38f
+
+bool span_to_float(const char *ptr, int len, float *value)
+{
+    struct span_num num;
+    if (!span_split(ptr, len, &num))
+        return false;
+    // one multiplication (or division) by an exact power of ten when possible
+    float result = (float)num.mant;
+    int exp = num.exp;
+    if ((num.mant != 0) && (exp > 0))
+    {
+        if (exp > NUM_POW10_MAX)
+            return false;
+        result *= pow10_table[exp];
+        if (result > NUM_FLOAT_MAX)
+            return false;
+    }
+    if ((num.mant != 0) && (exp < 0))
+    {
+        exp = -exp;
+        if (exp > NUM_POW10_MAX)
+        {
+            result /= pow10_table[NUM_POW10_MAX];
+            exp -= NUM_POW10_MAX;
+        }
+        // below the smallest denormal
+        if (exp > NUM_POW10_MAX)
+            result = 0;
+        else
+            result /= pow10_table[exp];
+    }
+    *value = (num.negative ? -result : result);
+    return true;
+}
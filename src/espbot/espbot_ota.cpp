@@ -19,8 +19,11 @@ extern "C"
 
 #include "espbot.hpp"
 #include "espbot_cfgfile.hpp"
+#include "espbot_cfgstore.hpp"
 #include "espbot_diagnostic.hpp"
+#include "espbot_dns.hpp"
 #include "espbot_event_codes.h"
+#include "espbot_http_cache.hpp"
 #include "espbot_mem_mon.hpp"
 #include "espbot_ota.hpp"
 #include "espbot_utils.hpp"
@@ -35,21 +38,30 @@ static struct
     void *cb_param;
 } ota_state;
 
-static struct
+static struct ota_config
 {
-    char host_str[16];
-    ip_addr host;
+    char host_str[OTA_HOST_LEN];
     unsigned int port;
     char path[128];
     bool check_version;
     bool reboot_on_completion;
 } ota_cfg;
 
+// host and path defaults are set by ota_init
+#define OTA_CFG_FIELDS(FIELD, type)                                        \
+    FIELD(type, host_str, "host", CFG_str, 0)                              \
+    FIELD(type, port, "port", CFG_uint, 0)                                 \
+    FIELD(type, path, "path", CFG_str, 0)                                  \
+    FIELD(type, check_version, "check_version", CFG_bool, 0)               \
+    FIELD(type, reboot_on_completion, "reboot_on_completion", CFG_bool, 0)
+
+CFG_SCHEMA(ota_schema, struct ota_config, ota_cfg, OTA_CFG_FIELDS);
+
 void ota_set_host(char *t_str)
 {
-    os_memset(ota_cfg.host_str, 0, 16);
-    os_strncpy(ota_cfg.host_str, t_str, 15);
-    atoipaddr(&ota_cfg.host, t_str);
+    // resolved when needed (through the DNS cache)
+    os_memset(ota_cfg.host_str, 0, OTA_HOST_LEN);
+    os_strncpy(ota_cfg.host_str, t_str, (OTA_HOST_LEN - 1));
 }
 
 void ota_set_port(unsigned int val)
@@ -212,12 +224,13 @@ static int release_cmp(char *cur_rel, char *avail_rel)
     return 0;
 }
 
-static void check_for_new_release_cleanup(void *param)
+static void check_for_new_release_cleanup(void)
 {
     ALL("check_for_new_release_cleanup");
     if (ota_client)
     {
-        delete ota_client;
+        // the connection is kept open for the next version check
+        http_clt_pool_release(ota_client);
         ota_client = NULL;
     }
     next_function(ota_engine);
@@ -257,7 +270,7 @@ static void check_version(void *param)
         ota_state.status = OTA_failed;
         break;
     }
-    ota_client->disconnect(check_for_new_release_cleanup, NULL);
+    check_for_new_release_cleanup();
     mem_mon_stack();
 }
 
@@ -268,14 +281,14 @@ static void ota_ask_version(void *param)
     {
     case HTTP_CLT_CONNECTED:
     {
-        // "GET version.txt HTTP/1.1rnHost: 111.222.333.444rnrn" 52 chars
-        int req_len = 52 + os_strlen(ota_cfg.path);
+        // "GET version.txt HTTP/1.1rnHost: rnrn" 36 chars
+        int req_len = 36 + os_strlen(ota_cfg.host_str) + os_strlen(ota_cfg.path) + 1;
         Heap_chunk req(req_len);
         if (req.ref == NULL)
         {
             ERROR("ota_ask_version - heap exausted [%d]", req_len);
             ota_state.status = OTA_failed;
-            ota_client->disconnect(check_for_new_release_cleanup, NULL);
+            check_for_new_release_cleanup();
             break;
         }
         fs_sprintf(req.ref,
@@ -288,7 +301,7 @@ static void ota_ask_version(void *param)
         dia_error_evnt(OTA_ASK_VERSION_UNEXPECTED_WEBCLIENT_STATUS, ota_client->get_status());
         ERROR("ota_ask_version unexpected http client status %d", ota_client->get_status());
         ota_state.status = OTA_failed;
-        ota_client->disconnect(check_for_new_release_cleanup, NULL);
+        check_for_new_release_cleanup();
         break;
     }
     mem_mon_stack();
@@ -325,6 +338,82 @@ static void ota_cleanup(void)
     }
 }
 
+static void ota_upgrade_start(struct ip_addr *host_ip)
+{
+    ALL("ota_upgrade_start");
+    char *binary_file;
+    switch (system_upgrade_userbin_check())
+    {
+    case UPGRADE_FW_BIN1:
+        binary_file = (char *)f_str("user2.bin");
+        break;
+    case UPGRADE_FW_BIN2:
+        binary_file = (char *)f_str("user1.bin");
+        break;
+    default:
+        dia_error_evnt(OTA_TIMER_FUNCTION_USERBIN_ID_UNKNOWN);
+        ERROR("OTA: bad userbin number");
+        ota_state.status = OTA_failed;
+        next_function(ota_engine);
+        return;
+    }
+    upgrade_svr = new struct upgrade_server_info;
+    if (upgrade_svr == NULL)
+    {
+        dia_error_evnt(OTA_ENGINE_HEAP_EXHAUSTED, sizeof(upgrade_server_info));
+        ERROR("ota_engine heap exhausted %d", sizeof(upgrade_server_info));
+        ota_state.status = OTA_failed;
+        next_function(ota_engine);
+        return;
+    }
+    // "GET  HTTP/1.1rnHost: :rnConnection: closernrn"
+    int url_len = 46 + // format string
+                  os_strlen(ota_cfg.host_str) +
+                  5 +  // port
+                  os_strlen(ota_cfg.path) +
+                  os_strlen(binary_file);
+    url = new char[url_len];
+    if (url == NULL)
+    {
+        dia_error_evnt(OTA_ENGINE_HEAP_EXHAUSTED, url_len);
+        ERROR("OTA save_cfg heap exhausted %d", url_len);
+        ota_state.status = OTA_failed;
+        next_function(ota_engine);
+        return;
+    }
+    *((uint32 *)(upgrade_svr->ip)) = host_ip->addr;
+    upgrade_svr->port = ota_cfg.port;
+    upgrade_svr->check_times = 10000;
+    upgrade_svr->check_cb = ota_completed_cb;
+    // upgrade_svr->pespconn = pespconn;
+    fs_sprintf(url,
+               "GET %s%s HTTP/1.1\r\nHost: %s:%d\r\n"
+               "Connection: close\r\n"
+               "\r\n",
+               ota_cfg.path, binary_file, ota_cfg.host_str, ota_cfg.port);
+    TRACE("ota_engine url %s", url);
+    upgrade_svr->url = (uint8 *)url;
+    if (system_upgrade_start(upgrade_svr) == false)
+    {
+        dia_error_evnt(OTA_CANNOT_START_UPGRADE);
+        ERROR("OTA cannot start upgrade");
+        ota_state.status = OTA_failed;
+    }
+    mem_mon_stack();
+}
+
+static void ota_host_resolved(void *param, struct ip_addr *ip)
+{
+    ALL("ota_host_resolved");
+    if (ip == NULL)
+    {
+        ota_state.status = OTA_failed;
+        next_function(ota_engine);
+        return;
+    }
+    ota_upgrade_start(ip);
+}
+
 static void ota_engine(void)
 {
     TRACE("OTA status -> %s", readable_ota_status(ota_state.status));
@@ -335,9 +424,15 @@ static void ota_engine(void)
         ota_state.last_result = OTA_idle;
         if (ota_cfg.check_version)
         {
+            ota_client = http_clt_pool_get(ota_cfg.host_str, ota_cfg.port);
+            if (ota_client == NULL)
+            {
+                ota_state.status = OTA_failed;
+                next_function(ota_engine);
+                break;
+            }
             ota_state.status = OTA_version_checking;
-            ota_client = new Http_clt;
-            ota_client->connect(ota_cfg.host, ota_cfg.port, ota_ask_version, NULL, 6000);
+            ota_client->connect(ota_cfg.host_str, ota_cfg.port, ota_ask_version, NULL, 6000);
         }
         else
         {
@@ -363,63 +458,19 @@ static void ota_engine(void)
     }
     case OTA_upgrading:
     {
-        char *binary_file;
-        switch (system_upgrade_userbin_check())
+        struct ip_addr ip;
+        switch (dns_resolve(ota_cfg.host_str, &ip, ota_host_resolved, NULL))
         {
-        case UPGRADE_FW_BIN1:
-            binary_file = (char *)f_str("user2.bin");
+        case DNS_resolved:
+            ota_upgrade_start(&ip);
             break;
-        case UPGRADE_FW_BIN2:
-            binary_file = (char *)f_str("user1.bin");
+        case DNS_in_progress:
+            // ota_host_resolved will go on
             break;
         default:
-            dia_error_evnt(OTA_TIMER_FUNCTION_USERBIN_ID_UNKNOWN);
-            ERROR("OTA: bad userbin number");
             ota_state.status = OTA_failed;
             next_function(ota_engine);
-            return;
-        }
-        upgrade_svr = new struct upgrade_server_info;
-        if (upgrade_svr == NULL)
-        {
-            dia_error_evnt(OTA_ENGINE_HEAP_EXHAUSTED, sizeof(upgrade_server_info));
-            ERROR("ota_engine heap exhausted %d", sizeof(upgrade_server_info));
-            ota_state.status = OTA_failed;
-            next_function(ota_engine);
-            return;
-        }
-        // "GET  HTTP/1.1rnHost: :rnConnection: closernrn"
-        int url_len = 46 + // format string
-                      15 + // ip
-                      5 +  // port
-                      os_strlen(ota_cfg.path) +
-                      os_strlen(binary_file);
-        url = new char[url_len];
-        if (url == NULL)
-        {
-            dia_error_evnt(OTA_ENGINE_HEAP_EXHAUSTED, url_len);
-            ERROR("OTA save_cfg heap exhausted %d", url_len);
-            ota_state.status = OTA_failed;
-            next_function(ota_engine);
-            return;
-        }
-        *((uint32 *)(upgrade_svr->ip)) = ota_cfg.host.addr;
-        upgrade_svr->port = ota_cfg.port;
-        upgrade_svr->check_times = 10000;
-        upgrade_svr->check_cb = ota_completed_cb;
-        // upgrade_svr->pespconn = pespconn;
-        fs_sprintf(url,
-                   "GET %s%s HTTP/1.1\r\nHost: %s:%d\r\n"
-                   "Connection: close\r\n"
-                   "\r\n",
-                   ota_cfg.path, binary_file, ota_cfg.host_str, ota_cfg.port);
-        TRACE("ota_engine url %s", url);
-        upgrade_svr->url = (uint8 *)url;
-        if (system_upgrade_start(upgrade_svr) == false)
-        {
-            dia_error_evnt(OTA_CANNOT_START_UPGRADE);
-            ERROR("OTA cannot start upgrade");
-            ota_state.status = OTA_failed;
+            break;
         }
         break;
     }
@@ -499,104 +550,24 @@ static int ota_restore_cfg(void)
 {
     ALL("ota_restore_cfg");
 
-    if (!Espfile::exists(OTA_FILENAME))
-        return CFG_cantRestore;
-    Cfgfile cfgfile(OTA_FILENAME);
-    char host_str[16];
-    os_memset(host_str, 0, 16);
-    cfgfile.getStr(f_str("host"), host_str, 16);
-    int port = cfgfile.getInt(f_str("port"));
-    char path[128];
-    os_memset(path, 0, 128);
-    cfgfile.getStr(f_str("path"), path, 128);
-    int check_version = cfgfile.getInt(f_str("check_version"));
-    int reboot_on_completion = cfgfile.getInt(f_str("reboot_on_completion"));
+    int res = cfgstore_restore(OTA_FILENAME, &ota_schema);
     mem_mon_stack();
-    if (cfgfile.getErr() != JSON_noerr)
+    if (res == CFG_error)
     {
         dia_error_evnt(OTA_RESTORE_CFG_ERROR);
         ERROR("ota_restore_cfg error");
-        mem_mon_stack();
-        return CFG_error;
     }
-    ota_set_host(host_str);
-    ota_cfg.port = port;
-    ota_set_path(path);
-    ota_cfg.check_version = (bool)check_version;
-    ota_cfg.reboot_on_completion = (bool)reboot_on_completion;
-    return CFG_ok;
-}
-
-static int ota_saved_cfg_updated(void)
-{
-    ALL("ota_saved_cfg_updated");
-    if (!Espfile::exists(OTA_FILENAME))
-    {
-        return CFG_notUpdated;
-    }
-    Cfgfile cfgfile(OTA_FILENAME);
-    char host_str[16];
-    os_memset(host_str, 0, 16);
-    cfgfile.getStr(f_str("host"), host_str, 16);
-    int port = cfgfile.getInt(f_str("port"));
-    char path[128];
-    os_memset(path, 0, 128);
-    cfgfile.getStr(f_str("path"), path, 128);
-    int check_version = cfgfile.getInt(f_str("check_version"));
-    int reboot_on_completion = cfgfile.getInt(f_str("reboot_on_completion"));
-    mem_mon_stack();
-    if (cfgfile.getErr() != JSON_noerr)
-    {
-        // no need to raise an error, the cfg file will be overwritten
-        // dia_error_evnt(OTA_SAVED_CFG_UPDATED_ERROR);
-        // ERROR("ota_saved_cfg_updated error");
-        return CFG_error;
-    }
-    if ((os_strcmp(ota_cfg.host_str, host_str) != 0) ||
-        (ota_cfg.port != port) ||
-        (os_strcmp(ota_cfg.path, path) != 0) ||
-        (ota_cfg.check_version != (bool)check_version) ||
-        (ota_cfg.reboot_on_completion != (bool)reboot_on_completion))
-    {
-        return CFG_notUpdated;
-    }
-    return CFG_ok;
+    return res;
 }
 
 char *ota_cfg_json_stringify(char *dest, int len)
 {
-    // {"host":"192.168.1.201","port":20090,"path":"","check_version":0,"reboot_on_completion":1}
-    // int msg_len = 90 + 128 + 1;
-    int msg_len = 90 + os_strlen(ota_cfg.path) + 1;
-    char *msg;
-    if (dest == NULL)
+    char *msg = cfg_json_stringify(&ota_schema, dest, len);
+    if (msg == NULL)
     {
-        msg = new char[msg_len];
-        if (msg == NULL)
-        {
-            dia_error_evnt(OTA_CFG_STRINGIFY_HEAP_EXHAUSTED, msg_len);
-            ERROR("ota_cfg_json_stringify heap exhausted [%d]", msg_len);
-            return NULL;
-        }
+        dia_error_evnt(OTA_CFG_STRINGIFY_HEAP_EXHAUSTED, ota_schema_json_len);
+        ERROR("ota_cfg_json_stringify heap exhausted [%d]", ota_schema_json_len);
     }
-    else
-    {
-        msg = dest;
-        if (len < msg_len)
-        {
-            msg[0] = 0;
-            return msg;
-        }
-    }
-    fs_sprintf(msg,
-               "{\"host\":\"%s\",\"port\":%d,\"path\":\"%s\",",
-               ota_cfg.host_str,
-               ota_cfg.port,
-               ota_cfg.path);
-    fs_sprintf((msg + os_strlen(msg)),
-               "\"check_version\":%d,\"reboot_on_completion\":%d}",
-               ota_cfg.check_version,
-               ota_cfg.reboot_on_completion);
     mem_mon_stack();
     return msg;
 }
@@ -604,18 +575,10 @@ char *ota_cfg_json_stringify(char *dest, int len)
 int ota_cfg_save(void)
 {
     ALL("ota_cfg_save");
-    if (ota_saved_cfg_updated() == CFG_ok)
+    http_cache_invalidate(f_str("/api/ota/cfg"));
+    if (cfgstore_uptodate(&ota_schema))
         return CFG_ok;
-    Cfgfile cfgfile(OTA_FILENAME);
-    if (cfgfile.clear() != SPIFFS_OK)
-        return CFG_error;
-    char str[(90 + 128 + 1)];
-    ota_cfg_json_stringify(str, (90 + 128 + 1));
-    int res = cfgfile.n_append(str, os_strlen(str));
-    mem_mon_stack();
-    if (res < SPIFFS_OK)
-        return CFG_error;
-    return CFG_ok;
+    return cfgstore_save();
 }
 
 void ota_init(void)
@@ -624,11 +587,9 @@ void ota_init(void)
     if (ota_restore_cfg() != CFG_ok)
     {
         // something went wrong while loading flash config
+        cfg_defaults(&ota_schema);
         ota_set_host("0.0.0.0");
-        ota_cfg.port = 0;
         ota_set_path((char *)f_str("/"));
-        ota_cfg.check_version = false;
-        ota_cfg.reboot_on_completion = false;
         dia_warn_evnt(OTA_INIT_DEFAULT_CFG);
         WARN("OTA init starting with default configuration");
     }
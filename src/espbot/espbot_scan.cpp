@@ -0,0 +1,126 @@
+/*
+ * ----------------------------------------------------------------------------
+ * "THE BEER-WARE LICENSE" (Revision 42):
+ * <quackmore-ff@yahoo.com> wrote this file.  As long as you retain this notice
+ * you can do whatever you want with this stuff. If we meet some day, and you 
+ * think this stuff is worth it, you can buy me a beer in return. Quackmore
+ * ----------------------------------------------------------------------------
+ */
+
+// SDK includes
+extern "C"
+{
+#include "c_types.h"
+}
+
+#include "espbot_scan.hpp"
+
+// words are loaded from char buffers
+typedef uint32 __attribute__((__may_alias__)) scan_word;
+
+#define SCAN_ONES 0x01010101U
+#define SCAN_HIGHS 0x80808080U
+
+static inline uint32 scan_bytes(char c)
+{
+    return (SCAN_ONES * (uint8)c);
+}
+
+// the high bit of a byte is set when that byte of w is zero
+// (bytes above a zero one can be flagged too, that's fine since
+//  a matching word is checked again byte by byte)
+static inline uint32 scan_zero(uint32 w)
+{
+    return ((w - SCAN_ONES) & ~w);
+}
+
+static inline bool scan_aligned(char *ptr)
+{
+    return ((((size_t)ptr) & 0x03) == 0);
+}
+
+char *scan_char(char *ptr, char *end, char c)
+{
+    while ((ptr < end) && !scan_aligned(ptr))
+    {
+        if (*ptr == c)
+            return ptr;
+        ptr++;
+    }
+    uint32 pattern = scan_bytes(c);
+    while ((end - ptr) >= 4)
+    {
+        if (scan_zero(*(scan_word *)ptr ^ pattern) & SCAN_HIGHS)
+            break;
+        ptr += 4;
+    }
+    while (ptr < end)
+    {
+        if (*ptr == c)
+            return ptr;
+        ptr++;
+    }
+    return NULL;
+}
+
+char *scan_char2(char *ptr, char *end, char c1, char c2)
+{
+    while ((ptr < end) && !scan_aligned(ptr))
+    {
+        if ((*ptr == c1) || (*ptr == c2))
+            return ptr;
+        ptr++;
+    }
+    uint32 pattern1 = scan_bytes(c1);
+    uint32 pattern2 = scan_bytes(c2);
+    while ((end - ptr) >= 4)
+    {
+        uint32 word = *(scan_word *)ptr;
+        if ((scan_zero(word ^ pattern1) | scan_zero(word ^ pattern2)) & SCAN_HIGHS)
+            break;
+        ptr += 4;
+    }
+    while (ptr < end)
+    {
+        if ((*ptr == c1) || (*ptr == c2))
+            return ptr;
+        ptr++;
+    }
+    return NULL;
+}
+
+static inline bool scan_json_char(char c)
+{
+    return ((c == '"') || (c == '{') || (c == '}') || (c == '[') || (c == ']') || (c == ',') || (c == ':'));
+}
+
+char *scan_json(char *ptr, char *end)
+{
+    while ((ptr < end) && !scan_aligned(ptr))
+    {
+        if (scan_json_char(*ptr))
+            return ptr;
+        ptr++;
+    }
+    while ((end - ptr) >= 4)
+    {
+        uint32 word = *(scan_word *)ptr;
+        // '[' (0x5B) and '{' (0x7B), ']' (0x5D) and '}' (0x7D) differ by 0x20 only
+        uint32 folded = word | scan_bytes(0x20);
+        uint32 found = scan_zero(folded ^ scan_bytes('{')) |
+                       scan_zero(folded ^ scan_bytes('}')) |
+                       scan_zero(word ^ scan_bytes('"')) |
+                       scan_zero(word ^ scan_bytes(',')) |
+                       scan_zero(word ^ scan_bytes(':'));
+        if (found & SCAN_HIGHS)
+            break;
+        ptr += 4;
+    }
+    while (ptr < end)
+    {
+        if (scan_json_char(*ptr))
+            return ptr;
+        ptr++;
+    }
+    return NULL;
+}
@@ -10,11 +10,21 @@
 extern "C"
 {
 #include "espbot_event_codes.h"
+#include "osapi.h"
+#include "user_interface.h"
 }
 
+#include "espbot.hpp"
 #include "espbot_mem_mon.hpp"
 #include "espbot_spiffs.hpp"
 #include "espbot_diagnostic.hpp"
+#include "espbot_http.hpp"
+#include "espbot_json_writer.hpp"
+
+extern "C"
+{
+#include "spiffs_nucleus.h"
+}
 
 /**
  * @brief file system possible status
@@ -51,6 +61,75 @@ static struct
     int status;
 } esp_spiffs;
 
+/**
+ * @brief background garbage collection
+ * 
+ * SPIFFS counts the gc runs, those not made by fs_gc_task are inline ones
+ * 
+ */
+#if !SPIFFS_GC_STATS
+#error "the background garbage collection needs SPIFFS_GC_STATS"
+#endif
+
+static struct
+{
+    os_timer_t timer;
+    u32_t background_runs;
+    u32_t inline_runs; // reported so far
+} fs_gc;
+
+static bool fs_gc_needed(void)
+{
+    // nothing to reclaim with no deleted pages
+    return ((esp_spiffs.handler.free_blocks < FS_GC_FREE_BLOCKS) && (esp_spiffs.handler.stats_p_deleted > 0));
+}
+
+// one GC run (a block) per task
+static void fs_gc_task(void)
+{
+    ALL("fs_gc_task");
+    if ((esp_spiffs.status != FS_mounted) || !http_send_idle() || !fs_gc_needed())
+        return;
+    spiffs *fs = &esp_spiffs.handler;
+    u32_t gc_runs = fs->stats_gc_runs;
+    u32_t free_blocks = fs->free_blocks;
+    // a block with deleted pages only is just erased
+    if (SPIFFS_gc_quick(fs, 0) != SPIFFS_OK)
+    {
+        // otherwise asking for the current free space
+        // SPIFFS_gc cleans (moving the used pages) and erases one block
+        // but with 2 free blocks or less it runs up to SPIFFS_GC_MAX_RUNS times
+        // so that is left to the inline collection (one more block for the moved pages)
+        if (fs->free_blocks > 3)
+        {
+            s32_t free_pages = ((SPIFFS_PAGES_PER_BLOCK(fs) - SPIFFS_OBJ_LOOKUP_PAGES(fs)) * (fs->block_count - 2)) -
+                               fs->stats_p_allocated - fs->stats_p_deleted;
+            if (free_pages < 0)
+                free_pages = 0;
+            SPIFFS_gc(fs, (free_pages * SPIFFS_DATA_PAGE_SIZE(fs)));
+        }
+    }
+    SPIFFS_clearerr(fs);
+    fs_gc.background_runs += (fs->stats_gc_runs - gc_runs);
+    // the event loop runs in between
+    if ((fs->free_blocks > free_blocks) && fs_gc_needed())
+        next_function(fs_gc_task);
+    mem_mon_stack();
+}
+
+static void fs_gc_tick(void *arg)
+{
+    u32_t inline_runs = esp_spiffs.handler.stats_gc_runs - fs_gc.background_runs;
+    if (inline_runs != fs_gc.inline_runs)
+    {
+        dia_info_evnt(SPIFFS_GC_INLINE, (inline_runs - fs_gc.inline_runs));
+        INFO("SPIFFS inline garbage collection, %d runs", (inline_runs - fs_gc.inline_runs));
+        fs_gc.inline_runs = inline_runs;
+    }
+    if (fs_gc_needed())
+        next_function(fs_gc_task);
+}
+
 /**
  * @brief mounting the file system
  * 
@@ -69,6 +148,7 @@ static struct
 void esp_spiffs_mount(void)
 {
     esp_spiffs.status = FS_unmounted;
+    uint32 mount_start = system_get_time();
 
     esp_spiffs.config.phys_size = FS_END - FS_START;
     esp_spiffs.config.phys_addr = FS_START;
@@ -133,8 +213,14 @@ void esp_spiffs_mount(void)
         }
     }
     dia_info_evnt(SPIFFS_INIT_FS_MOUNTED);
-    INFO("File System mounted");
+    INFO("File System mounted in %d us (%d flash reads, %d erases)",
+         (system_get_time() - mount_start),
+         esp_spiffs_flash_stats()->read_ops,
+         esp_spiffs_flash_stats()->erase_ops);
     esp_spiffs.status = FS_mounted;
+    os_timer_disarm(&fs_gc.timer);
+    os_timer_setfn(&fs_gc.timer, (os_timer_func_t *)fs_gc_tick, NULL);
+    os_timer_arm(&fs_gc.timer, FS_GC_PERIOD, 1);
     u32_t total = 0;
     u32_t used = 0;
     res = SPIFFS_info(&esp_spiffs.handler, &total, &used);
@@ -200,6 +286,73 @@ s32_t esp_spiffs_check()
     return res;
 }
 
+static void flash_op_json_write(Json_writer *json, const char *name, u32_t ops, u32_t us, u32_t max_us)
+{
+    json->obj_begin(name);
+    json->unum(f_str("ops"), ops);
+    json->unum(f_str("us"), us);
+    json->unum(f_str("max_us"), max_us);
+}
+
+char *esp_spiffs_stats_json_stringify(char *dest, int len)
+{
+    struct flash_stats *stats = esp_spiffs_flash_stats();
+    Json_writer json(dest, len);
+    while (json.pass())
+    {
+        json.obj_begin();
+        json.obj_begin(f_str("flash"));
+        flash_op_json_write(&json, f_str("read"), stats->read_ops, stats->read_us, stats->read_max_us);
+        json.unum(f_str("bytes"), stats->read_bytes);
+        json.obj_end();
+        flash_op_json_write(&json, f_str("write"), stats->write_ops, stats->write_us, stats->write_max_us);
+        json.unum(f_str("bytes"), stats->write_bytes);
+        json.obj_end();
+        // the erased sectors by flash area (wear hotspots)
+        flash_op_json_write(&json, f_str("erase"), stats->erase_ops, stats->erase_us, stats->erase_max_us);
+        json.num(f_str("area_sectors"), FLASH_STATS_AREA_SECTORS);
+        json.array_begin(f_str("areas"));
+        int idx;
+        for (idx = 0; idx < FLASH_STATS_AREAS; idx++)
+            json.unum(NULL, stats->erase_areas[idx]);
+        json.array_end();
+        json.obj_end();
+        json.obj_end();
+    #if SPIFFS_CACHE && SPIFFS_CACHE_STATS
+        json.obj_begin(f_str("cache"));
+        json.unum(f_str("hits"), esp_spiffs.handler.cache_hits);
+        json.unum(f_str("misses"), esp_spiffs.handler.cache_misses);
+        json.obj_end();
+    #endif
+        json.unum(f_str("gc_runs"), esp_spiffs.handler.stats_gc_runs);
+        json.unum(f_str("gc_background"), fs_gc.background_runs);
+        json.unum(f_str("gc_inline"), (esp_spiffs.handler.stats_gc_runs - fs_gc.background_runs));
+        json.unum(f_str("free_blocks"), esp_spiffs.handler.free_blocks);
+        json.unum(f_str("max_erase_count"), esp_spiffs.handler.max_erase_count);
+        json.obj_end();
+    }
+    char *msg = json.result();
+    if (msg == NULL)
+    {
+        dia_error_evnt(SPIFFS_STATS_STRINGIFY_HEAP_EXHAUSTED, json.len());
+        ERROR("esp_spiffs_stats_json_stringify heap exhausted [%d]", json.len());
+    }
+    mem_mon_stack();
+    return msg;
+}
+
+void esp_spiffs_stats_reset(void)
+{
+    esp_spiffs_flash_stats_reset();
+#if SPIFFS_CACHE && SPIFFS_CACHE_STATS
+    esp_spiffs.handler.cache_hits = 0;
+    esp_spiffs.handler.cache_misses = 0;
+#endif
+    esp_spiffs.handler.stats_gc_runs = 0;
+    fs_gc.background_runs = 0;
+    fs_gc.inline_runs = 0;
+}
+
 struct spiffs_dirent *esp_spiffs_list(int file_idx)
 {
     if (esp_spiffs.status != FS_mounted)
@@ -403,6 +556,33 @@ s32_t Espfile::clear()
     return res;
 }
 
+s32_t Espfile::flush()
+{
+    s32_t res = SPIFFS_OK;
+    if (esp_spiffs.status != FS_mounted)
+    {
+        dia_error_evnt(ESPFILE_FLUSH_FS_NOT_MOUNTED);
+        ERROR("Espfile::flush FS not mounted");
+        return SPIFFS_ERR_NOT_MOUNTED;
+    }
+    if ((_handler < 0) || (_err != SPIFFS_OK))
+    {
+        // there was a previous error managing this file...
+        // any further operation is not consistent
+        return SPIFFSESP_ERR_NOTCONSISTENT;
+    }
+    res = SPIFFS_fflush(&esp_spiffs.handler, _handler);
+    if (res != SPIFFS_OK)
+    {
+        _err = SPIFFS_errno(&esp_spiffs.handler);
+        dia_error_evnt(ESPFILE_FLUSH_ERROR, _err);
+        ERROR("Espfile::flush error %d flushing file %s", _err, _name);
+        return res;
+    }
+    mem_mon_stack();
+    return res;
+}
+
 s32_t Espfile::remove()
 {
     s32_t res = SPIFFS_OK;
@@ -18,6 +18,7 @@ extern "C"
 
 #include "espbot.hpp"
 #include "espbot_cfgfile.hpp"
+#include "espbot_cfgstore.hpp"
 #include "espbot_diagnostic.hpp"
 #include "espbot_event_codes.h"
 #include "espbot_mem_mon.hpp"
@@ -26,12 +27,18 @@ extern "C"
 #include "espbot_utils.hpp"
 #include "espbot_rtc_mem_map.h"
 
-static struct
+static struct timedate_config
 {
     bool sntp_enabled;
     signed char timezone;
 } timedate_cfg;
 
+#define TIMEDATE_CFG_FIELDS(FIELD, type)                   \
+    FIELD(type, sntp_enabled, "sntp_enabled", CFG_bool, 0) \
+    FIELD(type, timezone, "timezone", CFG_int, 0) // UTC
+
+CFG_SCHEMA(timedate_schema, struct timedate_config, timedate_cfg, TIMEDATE_CFG_FIELDS);
+
 static struct
 {
     bool sntp_running;
@@ -166,114 +173,47 @@ bool timedate_sntp_enabled(void)
 static int timedate_restore_cfg(void)
 {
     ALL("timedate_restore_cfg");
-    if (!Espfile::exists(TIMEDATE_FILENAME))
-        return CFG_cantRestore;
-    Cfgfile cfgfile(TIMEDATE_FILENAME);
-    int sntp_enabled = cfgfile.getInt(f_str("sntp_enabled"));
-    int timezone = cfgfile.getInt(f_str("timezone"));
-    if (cfgfile.getErr() != JSON_noerr)
+    int res = cfgstore_restore(TIMEDATE_FILENAME, &timedate_schema);
+    mem_mon_stack();
+    if (res == CFG_error)
     {
         dia_error_evnt(TIMEDATE_RESTORE_CFG_ERROR);
         ERROR("timedate_restore_cfg error");
-        return CFG_error;
-    }
-    timedate_cfg.sntp_enabled = (bool)sntp_enabled;
-    timedate_cfg.timezone = (signed char)timezone;
-    mem_mon_stack();
-    return CFG_ok;
-}
-
-static int timedate_saved_cfg_updated(void)
-{
-    ALL("timedate_saved_cfg_updated");
-    if (!Espfile::exists(TIMEDATE_FILENAME))
-    {
-        return CFG_notUpdated;
-    }
-    Cfgfile cfgfile(TIMEDATE_FILENAME);
-    int sntp_enabled = cfgfile.getInt(f_str("sntp_enabled"));
-    int timezone = cfgfile.getInt(f_str("timezone"));
-    if (cfgfile.getErr() != JSON_noerr)
-    {
-        // no need to raise an error, the cfg file will be overwritten
-        // dia_error_evnt(TIMEDATE_SAVED_CFG_UPDATED_ERROR);
-        // ERROR("timedate_saved_cfg_updated error");
-        return CFG_error;
     }
-    if ((timedate_cfg.sntp_enabled != (bool)sntp_enabled) ||
-        (timedate_cfg.timezone != (signed char)timezone))
-    {
-        return CFG_notUpdated;
-    }
-    mem_mon_stack();
-    return CFG_ok;
+    return res;
 }
 
 char *timedate_cfg_json_stringify(char *dest, int len)
 {
-    // {"sntp_enabled":1, "timezone":-12}
-    int msg_len = 34 + 1;
-    char *msg;
-    if (dest == NULL)
+    char *msg = cfg_json_stringify(&timedate_schema, dest, len);
+    if (msg == NULL)
     {
-        msg = new char[msg_len];
-        if (msg == NULL)
-        {
-            dia_error_evnt(TIMEDATE_CFG_STRINGIFY_HEAP_EXHAUSTED, msg_len);
-            ERROR("timedate_cfg_json_stringify heap exhausted [%d]", msg_len);
-            return NULL;
-        }
-    }
-    else
-    {
-        msg = dest;
-        if (len < msg_len)
-        {
-            *msg = 0;
-            return msg;
-        }
+        dia_error_evnt(TIMEDATE_CFG_STRINGIFY_HEAP_EXHAUSTED, timedate_schema_json_len);
+        ERROR("timedate_cfg_json_stringify heap exhausted [%d]", timedate_schema_json_len);
     }
-    fs_sprintf(msg,
-               "{\"sntp_enabled\":%d,\"timezone\":%d}",
-               timedate_cfg.sntp_enabled,
-               timedate_cfg.timezone);
     mem_mon_stack();
     return msg;
 }
 
 char *timedate_state_json_stringify(char *dest, int len)
 {
-    // {"timestamp":1589272200,"timedate":"Tue May 12 09:30:00 2020","sntp_enabled":0,"timezone":-12}
-    int msg_len = 94 + 1;
-    char *msg;
-    if (dest == NULL)
+    Json_writer json(dest, len);
+    uint32 current_timestamp = timedate_get_timestamp();
+    while (json.pass())
     {
-        msg = new char[msg_len];
-        if (msg == NULL)
-        {
-            dia_error_evnt(TIMEDATE_STATE_STRINGIFY_HEAP_EXHAUSTED, msg_len);
-            ERROR("timedate_state_json_stringify heap exhausted [%d]", msg_len);
-            return NULL;
-        }
+        json.obj_begin();
+        json.unum(f_str("timestamp"), current_timestamp);
+        json.str(f_str("date"), timedate_get_timestr(current_timestamp));
+        json.num(f_str("sntp_enabled"), timedate_cfg.sntp_enabled);
+        json.num(f_str("timezone"), timedate_cfg.timezone);
+        json.obj_end();
     }
-    else
+    char *msg = json.result();
+    if (msg == NULL)
     {
-        msg = dest;
-        if (len < msg_len)
-        {
-            *msg = 0;
-            return msg;
-        }
+        dia_error_evnt(TIMEDATE_STATE_STRINGIFY_HEAP_EXHAUSTED, json.len());
+        ERROR("timedate_state_json_stringify heap exhausted [%d]", json.len());
     }
-    uint32 current_timestamp = timedate_get_timestamp();
-    fs_sprintf(msg,
-               "{\"timestamp\":%d,\"date\":\"%s\",",
-               current_timestamp,
-               timedate_get_timestr(current_timestamp));
-    fs_sprintf(msg + os_strlen(msg),
-               "\"sntp_enabled\":%d,\"timezone\":%d}",
-               timedate_cfg.sntp_enabled,
-               timedate_cfg.timezone);
     mem_mon_stack();
     return msg;
 }
@@ -281,24 +221,14 @@ char *timedate_state_json_stringify(char *dest, int len)
 int timedate_cfg_save(void)
 {
     ALL("timedate_cfg_save");
-    if (timedate_saved_cfg_updated() == CFG_ok)
+    if (cfgstore_uptodate(&timedate_schema))
         return CFG_ok;
-    Cfgfile cfgfile(TIMEDATE_FILENAME);
-    if (cfgfile.clear() != SPIFFS_OK)
-        return CFG_error;
-    char str[35];
-    timedate_cfg_json_stringify(str, 35);
-    int res = cfgfile.n_append(str, os_strlen(str));
-    if (res < SPIFFS_OK)
-        return CFG_error;
-    mem_mon_stack();
-    return CFG_ok;
+    return cfgstore_save();
 }
 
 void timedate_init_essential(void)
 {
-    timedate_cfg.sntp_enabled = false;
-    timedate_cfg.timezone = 0; // UTC
+    cfg_defaults(&timedate_schema);
     timedate_state.sntp_running = false;
 
     struct espbot_time rtc_time;
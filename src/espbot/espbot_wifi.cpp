@@ -17,8 +17,10 @@ extern "C"
 
 #include "espbot.hpp"
 #include "espbot_cfgfile.hpp"
+#include "espbot_cfgstore.hpp"
 #include "espbot_diagnostic.hpp"
 #include "espbot_event_codes.h"
+#include "espbot_http_cache.hpp"
 #include "espbot_json.hpp"
 #include "espbot_mem_mon.hpp"
 #include "espbot_utils.hpp"
@@ -26,8 +28,23 @@ extern "C"
 
 // connection management vars
 static struct softap_config ap_config;
-static char station_ssid[32];
-static char station_pwd[64];
+
+// applied to ap_config by espwifi_work_as_ap
+static struct wifi_config
+{
+    char station_ssid[32];
+    char station_pwd[64];
+    uint8 ap_channel;
+    char ap_pwd[64];
+} wifi_cfg;
+
+#define WIFI_CFG_FIELDS(FIELD, type)                      \
+    FIELD(type, station_ssid, "station_ssid", CFG_str, 0) \
+    FIELD(type, station_pwd, "station_pwd", CFG_str, 0)   \
+    FIELD(type, ap_channel, "ap_channel", CFG_uint, 1)    \
+    FIELD(type, ap_pwd, "ap_pwd", CFG_str, 0)
+
+CFG_SCHEMA(wifi_schema, struct wifi_config, wifi_cfg, WIFI_CFG_FIELDS);
 // static bool timeout_timer_active;
 // static os_timer_t station_connect_timeout;
 static os_timer_t wait_before_reconnect;
@@ -198,6 +215,8 @@ void espwifi_work_as_ap(void)
     // wifi_set_opmode_current(SOFTAP_MODE);
     // now switch to STATIONAP
     wifi_set_opmode_current(STATIONAP_MODE);
+    os_memcpy(ap_config.password, wifi_cfg.ap_pwd, 64);
+    ap_config.channel = wifi_cfg.ap_channel;
     if (!wifi_softap_set_config_current(&ap_config))
     {
         dia_error_evnt(WIFI_SETAP_ERROR);
@@ -250,7 +269,7 @@ void espwifi_connect_to_ap(void)
     ALL("espwifi_connect_to_ap");
     struct station_config stationConf;
 
-    if (os_strlen(station_ssid) == 0)
+    if (os_strlen(wifi_cfg.station_ssid) == 0)
     {
         dia_error_evnt(WIFI_CONNECT_NO_SSID_AVAILABLE);
         ERROR("espwifi_connect_to_ap no ssid available");
@@ -263,8 +282,8 @@ void espwifi_connect_to_ap(void)
 
     // setup station
     os_memset(&stationConf, 0, sizeof(stationConf));
-    os_memcpy(stationConf.ssid, station_ssid, 32);
-    os_memcpy(stationConf.password, station_pwd, 64);
+    os_memcpy(stationConf.ssid, wifi_cfg.station_ssid, 32);
+    os_memcpy(stationConf.password, wifi_cfg.station_pwd, 64);
     stationConf.bssid_set = 0;
     wifi_station_set_config_current(&stationConf);
     wifi_station_set_hostname(espbot_get_name());
@@ -374,54 +393,57 @@ void espwifi_free_ap_list(void)
 void espwifi_station_set_ssid(char *t_str, int t_len)
 {
     ALL("espwifi_station_set_ssid");
-    os_memset(station_ssid, 0, 32);
+    os_memset(wifi_cfg.station_ssid, 0, 32);
     if (t_len > 31)
     {
         dia_warn_evnt(WIFI_TRUNCATING_STRING_TO_31_CHAR);
         WARN("espwifi_station_set_ssid: truncating ssid to 31 characters");
-        os_strncpy(station_ssid, t_str, 31);
+        os_strncpy(wifi_cfg.station_ssid, t_str, 31);
     }
     else
     {
-        os_strncpy(station_ssid, t_str, t_len);
+        os_strncpy(wifi_cfg.station_ssid, t_str, t_len);
     }
+    http_cache_invalidate(f_str("/api/wifi/ap/cfg"));
 }
 
 char *espwifi_station_get_ssid(void)
 {
-    return station_ssid;
+    return wifi_cfg.station_ssid;
 }
 
 void espwifi_station_set_pwd(char *t_str, int t_len)
 {
     ALL("espwifi_station_set_pwd");
-    os_memset(station_pwd, 0, 64);
+    os_memset(wifi_cfg.station_pwd, 0, 64);
     if (t_len > 63)
     {
         dia_warn_evnt(WIFI_TRUNCATING_STRING_TO_63_CHAR);
         WARN("espwifi_station_set_pwd: truncating pwd to 63 characters");
-        os_strncpy(station_pwd, t_str, 63);
+        os_strncpy(wifi_cfg.station_pwd, t_str, 63);
     }
     else
     {
-        os_strncpy(station_pwd, t_str, t_len);
+        os_strncpy(wifi_cfg.station_pwd, t_str, t_len);
     }
+    http_cache_invalidate(f_str("/api/wifi/ap/cfg"));
 }
 
 void espwifi_ap_set_pwd(char *t_str, int t_len)
 {
     ALL("espwifi_ap_set_pwd");
-    os_memset(ap_config.password, 0, 64);
+    os_memset(wifi_cfg.ap_pwd, 0, 64);
     if (t_len > 63)
     {
         dia_warn_evnt(WIFI_TRUNCATING_STRING_TO_63_CHAR);
         WARN("espwifi_ap_set_pwd: truncating pwd to 63 characters");
-        os_strncpy((char *)ap_config.password, t_str, 63);
+        os_strncpy(wifi_cfg.ap_pwd, t_str, 63);
     }
     else
     {
-        os_strncpy((char *)ap_config.password, t_str, t_len);
+        os_strncpy(wifi_cfg.ap_pwd, t_str, t_len);
     }
+    http_cache_invalidate(f_str("/api/wifi/ap/cfg"));
     // in case wifi is already in STATIONAP_MODE update config
     if (wifi_get_opmode() != STATION_MODE)
     {
@@ -436,12 +458,13 @@ void espwifi_ap_set_ch(int ch)
     {
         dia_error_evnt(WIFI_AP_SET_CH_OOR, ch);
         ERROR("espwifi_ap_set_ch: %d is OOR, AP channel set to 1");
-        ap_config.channel = 1;
+        wifi_cfg.ap_channel = 1;
     }
     else
     {
-        ap_config.channel = ch;
+        wifi_cfg.ap_channel = ch;
     }
+    http_cache_invalidate(f_str("/api/wifi/ap/cfg"));
     // in case wifi is already in STATIONAP_MODE update config
     if (wifi_get_opmode() == STATIONAP_MODE)
     {
@@ -454,105 +477,44 @@ void espwifi_ap_set_ch(int ch)
 static int wifi_cfg_restore(void)
 {
     ALL("espwifi_wifi_cfg_restore");
-    if (!Espfile::exists(WIFI_CFG_FILENAME))
-        return CFG_cantRestore;
-    Cfgfile cfgfile(WIFI_CFG_FILENAME);
-    if (cfgfile.getErr() != JSON_noerr)
+    // missing pairs are fine (and keep the default value)
+    uint32 found;
+    int res = cfgstore_restore(WIFI_CFG_FILENAME, &wifi_schema, &found);
+    mem_mon_stack();
+    if (res == CFG_error)
     {
         dia_error_evnt(WIFI_CFG_RESTORE_ERROR);
         ERROR("wifi_cfg_restore error");
-        return CFG_error;
     }
-    os_memset(station_ssid, 0, 32);
-    cfgfile.getStr(f_str("station_ssid"), station_ssid, 32);
-    if (cfgfile.getErr() == JSON_notFound)
+    if (res != CFG_ok)
+        return res;
+    if (!(found & 0x01))
     {
         dia_info_evnt(WIFI_CFG_RESTORE_NO_SSID_FOUND);
         INFO("espwifi_wifi_cfg_restore no SSID found");
-        cfgfile.clearErr();
     }
-    os_memset(station_pwd, 0, 64);
-    cfgfile.getStr(f_str("station_pwd"), station_pwd, 64);
-    if (cfgfile.getErr() == JSON_notFound)
+    if (!(found & 0x02))
     {
         dia_info_evnt(WIFI_CFG_RESTORE_NO_PWD_FOUND);
         INFO("espwifi_wifi_cfg_restore no PWD found");
-        cfgfile.clearErr();
     }
-    int channel = cfgfile.getInt(f_str("ap_channel"));
-    if (cfgfile.getErr() == JSON_notFound)
+    if ((wifi_cfg.ap_channel < 1) || (wifi_cfg.ap_channel > 11))
     {
-        dia_info_evnt(WIFI_CFG_RESTORE_AP_CH, 1);
-        INFO("espwifi_wifi_cfg_restore AP channel: %d", 1);
+        dia_error_evnt(WIFI_CFG_RESTORE_AP_CH_OOR, wifi_cfg.ap_channel);
+        ERROR("espwifi_wifi_cfg_restore AP channel out of range (%)", wifi_cfg.ap_channel);
+        wifi_cfg.ap_channel = 1;
     }
-    if (cfgfile.getErr() == JSON_noerr)
-    {
-        if ((channel < 1) || (channel > 11))
-        {
-            dia_error_evnt(WIFI_CFG_RESTORE_AP_CH_OOR, channel);
-            ERROR("espwifi_wifi_cfg_restore AP channel out of range (%)", channel);
-            channel = 1;
-        }
-        ap_config.channel = channel;
-        dia_info_evnt(WIFI_CFG_RESTORE_AP_CH, channel);
-        INFO("espwifi_wifi_cfg_restore AP channel: %d", channel);
-    }
-    char ap_password[64];
-    os_memset(ap_password, 0, 64);
-    mem_mon_stack();
-    cfgfile.getStr(f_str("ap_pwd"), ap_password, 64);
-    if (cfgfile.getErr() == JSON_notFound)
+    dia_info_evnt(WIFI_CFG_RESTORE_AP_CH, wifi_cfg.ap_channel);
+    INFO("espwifi_wifi_cfg_restore AP channel: %d", wifi_cfg.ap_channel);
+    if (0 == os_strcmp(wifi_cfg.ap_pwd, f_str("espbot123456")))
     {
         dia_info_evnt(WIFI_CFG_RESTORE_AP_DEFAULT_PWD);
         INFO("espwifi_wifi_cfg_restore AP default password");
     }
-    if (cfgfile.getErr() == JSON_noerr)
-    {
-        os_memset((char *)ap_config.password, 0, 64);
-        os_strncpy((char *)ap_config.password, ap_password, 63);
-        if (0 == os_strcmp((char *)ap_config.password, f_str("espbot123456")))
-        {
-            dia_info_evnt(WIFI_CFG_RESTORE_AP_DEFAULT_PWD);
-            INFO("espwifi_wifi_cfg_restore AP default password");
-        }
-        else
-        {
-            dia_info_evnt(WIFI_CFG_RESTORE_AP_CUSTOM_PWD);
-            INFO("espwifi_wifi_cfg_restore AP custom password: %s", ap_password);
-        }
-    }
-    return CFG_ok;
-}
-
-static int wifi_cfg_uptodate(void)
-{
-    ALL("espwifi_wifi_cfg_uptodate");
-    if (!Espfile::exists(WIFI_CFG_FILENAME))
-    {
-        return CFG_notUpdated;
-    }
-    Cfgfile cfgfile(WIFI_CFG_FILENAME);
-    char st_ssid[32];
-    cfgfile.getStr(f_str("station_ssid"), st_ssid, 32);
-    char st_pwd[64];
-    cfgfile.getStr(f_str("station_pwd"), st_pwd, 64);
-    char ap_pwd[64];
-    cfgfile.getStr(f_str("ap_pwd"), ap_pwd, 64);
-    int ap_channel = cfgfile.getInt(f_str("ap_channel"));
-    mem_mon_stack();
-    if (cfgfile.getErr() != JSON_noerr)
-    {
-        // no need to raise an error, the cfg file will be overwritten
-        // dia_error_evnt(WIFI_CFG_UPTODATE_ERROR);
-        // ERROR("wifi_cfg_uptodate error");
-        return CFG_error;
-    }
-    if (os_strcmp(station_ssid, st_ssid) ||
-        os_strcmp(station_pwd, st_pwd) ||
-        os_strcmp((const char *)ap_config.password, ap_pwd) ||
-        (ap_channel != ap_config.channel))
+    else
     {
-        return CFG_notUpdated;
+        dia_info_evnt(WIFI_CFG_RESTORE_AP_CUSTOM_PWD);
+        INFO("espwifi_wifi_cfg_restore AP custom password: %s", wifi_cfg.ap_pwd);
     }
     return CFG_ok;
 }
@@ -560,137 +522,81 @@ static int wifi_cfg_uptodate(void)
 int espwifi_cfg_save(void)
 {
     ALL("espwifi_cfg_save");
-    if (wifi_cfg_uptodate() == CFG_ok)
+    if (cfgstore_uptodate(&wifi_schema))
         return CFG_ok;
-    Cfgfile cfgfile(WIFI_CFG_FILENAME);
-    if (cfgfile.clear() != SPIFFS_OK)
-        return CFG_error;
-
-    char str[225];
-    espwifi_cfg_json_stringify(str, 225);
-    int res = cfgfile.n_append(str, os_strlen(str));
-    mem_mon_stack();
-    if (res < SPIFFS_OK)
-        return CFG_error;
-    return CFG_ok;
+    return cfgstore_save();
 }
 
 char *espwifi_cfg_json_stringify(char *dest, int len)
 {
-    // {"station_ssid":"","station_pwd":"","ap_channel":,"ap_pwd":""}
-    int msg_len = 62 + 32 + 64 + 2 + 64 + 1;
-    char *msg;
-    if (dest == NULL)
+    char *msg = cfg_json_stringify(&wifi_schema, dest, len);
+    if (msg == NULL)
     {
-        msg = new char[msg_len];
-        if (msg == NULL)
-        {
-            dia_error_evnt(WIFI_CFG_STRINGIFY_HEAP_EXHAUSTED, msg_len);
-            ERROR("espwifi_cfg_json_stringify heap exhausted [%d]", msg_len);
-            return NULL;
-        }
+        dia_error_evnt(WIFI_CFG_STRINGIFY_HEAP_EXHAUSTED, wifi_schema_json_len);
+        ERROR("espwifi_cfg_json_stringify heap exhausted [%d]", wifi_schema_json_len);
     }
-    else
-    {
-        msg = dest;
-        if (len < msg_len)
-        {
-            *msg = 0;
-            return msg;
-        }
-    }
-    fs_sprintf(msg,
-               "{\"station_ssid\":\"%s\",\"station_pwd\":\"%s\",\"ap_channel\":%d,\"ap_pwd\":\"%s\"}",
-               station_ssid,
-               station_pwd,
-               ap_config.channel,
-               (char *)ap_config.password);
+    mem_mon_stack();
     return msg;
 }
 
 char *espwifi_status_json_stringify(char *dest, int len)
 {
-    // {"op_mode":"STATION","SSID":"","ip_address":"123.123.123.123"}
-    int msg_len = 62 + 32 + 1;
-    char *msg;
-    if (dest == NULL)
-    {
-        msg = new char[msg_len];
-        if (msg == NULL)
-        {
-            dia_error_evnt(WIFI_STATUS_STRINGIFY_HEAP_EXHAUSTED, msg_len);
-            ERROR("espwifi_status_json_stringify heap exhausted [%d]", msg_len);
-            return NULL;
-        }
-    }
-    else
+    Json_writer json(dest, len);
+    struct ip_info tmp_ip;
+    espwifi_get_ip_address(&tmp_ip);
+    char *ip_ptr = (char *)&tmp_ip.ip.addr;
+    char ip_str[16];
+    fs_sprintf(ip_str, "%d.%d.%d.%d", ip_ptr[0], ip_ptr[1], ip_ptr[2], ip_ptr[3]);
+    while (json.pass())
     {
-        msg = dest;
-        if (len < msg_len)
+        json.obj_begin();
+        switch (wifi_get_opmode())
         {
-            *msg = 0;
-            return msg;
+        case STATION_MODE:
+            json.str(f_str("op_mode"), f_str("STATION"));
+            json.str(f_str("SSID"), espwifi_station_get_ssid());
+            break;
+        case SOFTAP_MODE:
+        case STATIONAP_MODE:
+            json.str(f_str("op_mode"), f_str("AP"));
+            json.str(f_str("SSID"), espbot_get_name());
+            break;
+        default:
+            break;
         }
+        json.str(f_str("ip_address"), ip_str);
+        json.obj_end();
     }
-    switch (wifi_get_opmode())
+    char *msg = json.result();
+    if (msg == NULL)
     {
-    case STATION_MODE:
-        fs_sprintf(msg, "{\"op_mode\":\"STATION\",\"SSID\":\"%s\",", espwifi_station_get_ssid());
-        break;
-    case SOFTAP_MODE:
-        fs_sprintf(msg, "{\"op_mode\":\"AP\",\"SSID\":\"%s\",", espbot_get_name());
-        break;
-    case STATIONAP_MODE:
-        fs_sprintf(msg, "{\"op_mode\":\"AP\",\"SSID\":\"%s\",", espbot_get_name());
-        break;
-    default:
-        break;
+        dia_error_evnt(WIFI_STATUS_STRINGIFY_HEAP_EXHAUSTED, json.len());
+        ERROR("espwifi_status_json_stringify heap exhausted [%d]", json.len());
     }
-    char *ptr = msg + os_strlen(msg);
-    struct ip_info tmp_ip;
-    espwifi_get_ip_address(&tmp_ip);
-    char *ip_ptr = (char *)&tmp_ip.ip.addr;
-    fs_sprintf(ptr, "\"ip_address\":\"%d.%d.%d.%d\"}", ip_ptr[0], ip_ptr[1], ip_ptr[2], ip_ptr[3]);
     mem_mon_stack();
     return msg;
 }
 
 char *espwifi_scan_results_json_stringify(char *dest, int len)
 {
-    // {"AP_count":,"AP_SSIDs":["",]}
-    int msg_len = 27 + (32 + 3) * espwifi_get_ap_count();
-    char *msg;
-    if (dest == NULL)
+    Json_writer json(dest, len);
+    while (json.pass())
     {
-        msg = new char[msg_len];
-        if (msg == NULL)
-        {
-            dia_error_evnt(WIFI_SCAN_RESULTS_STRINGIFY_HEAP_EXHAUSTED, msg_len);
-            ERROR("espwifi_scan_results_json_stringify heap exhausted [%d]", msg_len);
-            return NULL;
-        }
+        json.obj_begin();
+        json.num(f_str("AP_count"), espwifi_get_ap_count());
+        json.array_begin(f_str("AP_SSIDs"));
+        for (int idx = 0; idx < espwifi_get_ap_count(); idx++)
+            json.str(NULL, espwifi_get_ap_name(idx));
+        json.array_end();
+        json.obj_end();
     }
-    else
-    {
-        msg = dest;
-        if (len < msg_len)
-        {
-            *msg = 0;
-            return msg;
-        }
-    }
-    char *tmp_ptr;
-    fs_sprintf(msg, "{\"AP_count\":%d,\"AP_SSIDs\":[", espwifi_get_ap_count());
-    for (int idx = 0; idx < espwifi_get_ap_count(); idx++)
+    espwifi_free_ap_list();
+    char *msg = json.result();
+    if (msg == NULL)
     {
-        tmp_ptr = msg + os_strlen(msg);
-        if (idx > 0)
-            *(tmp_ptr++) = ',';
-        os_sprintf(tmp_ptr, "\"%s\"", espwifi_get_ap_name(idx));
+        dia_error_evnt(WIFI_SCAN_RESULTS_STRINGIFY_HEAP_EXHAUSTED, json.len());
+        ERROR("espwifi_scan_results_json_stringify heap exhausted [%d]", json.len());
     }
-    tmp_ptr = msg + os_strlen(msg);
-    fs_sprintf(tmp_ptr, "]}");
-    espwifi_free_ap_list();
     mem_mon_stack();
     return msg;
 }
@@ -699,10 +605,7 @@ void espwifi_init()
 {
     // default AP config
     os_strncpy((char *)ap_config.ssid, espbot_get_name(), 32);    // uint8 ssid[32];
-    os_memset((char *)ap_config.password, 0, 64);                 //
-    os_strcpy((char *)ap_config.password, f_str("espbot123456")); // uint8 password[64];
     ap_config.ssid_len = os_strlen(espbot_get_name());            // uint8 ssid_len;
-    ap_config.channel = 1;                                        // uint8 channel;
     ap_config.authmode = AUTH_WPA2_PSK;                           // uint8 authmode;
     ap_config.ssid_hidden = 0;                                    // uint8 ssid_hidden;
     ap_config.max_connection = 4;                                 // uint8 max_connection;
@@ -717,8 +620,9 @@ void espwifi_init()
     if (wifi_get_phy_mode() != PHY_MODE_11N)
         wifi_set_phy_mode(PHY_MODE_11N);
     wifi_set_event_handler_cb((wifi_event_handler_cb_t)wifi_event_handler);
-    os_memset(station_ssid, 0, 32);
-    os_memset(station_pwd, 0, 64);
+    // default cfg: no station, AP on channel 1 with the default password
+    cfg_defaults(&wifi_schema);
+    os_strcpy(wifi_cfg.ap_pwd, f_str("espbot123456"));
     stamode_connected = false;
     stamode_connecting = 0; // never connected
 
@@ -734,7 +638,7 @@ void espwifi_init()
     espwifi_work_as_ap(); // make effective the restored configration
     // signal that SOFTAPMODE is ready
     system_os_post(USER_TASK_PRIO_0, SIG_softapMode_ready, '0');
-    if (os_strlen(station_ssid) > 0)
+    if (os_strlen(wifi_cfg.station_ssid) > 0)
         espwifi_connect_to_ap();
     mem_mon_stack();
 }
\ No newline at end of file
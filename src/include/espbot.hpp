@@ -22,7 +22,8 @@ enum
   SIG_softapMode_staDisconnected,
   SIG_softapMode_ready,
   SIG_http_checkPendingResponse,
-  SIG_next_function
+  SIG_next_function,
+  SIG_jobs_step
 };
 
 enum
@@ -0,0 +1,116 @@
+/*
+ * ----------------------------------------------------------------------------
+ * "THE BEER-WARE LICENSE" (Revision 42):
+ * <quackmore-ff@yahoo.com> wrote this file.  As long as you retain this notice
+ * you can do whatever you want with this stuff. If we meet some day, and you 
+ * think this stuff is worth it, you can buy me a beer in return. Quackmore
+ * ----------------------------------------------------------------------------
+ */
+#ifndef __CFG_SCHEMA_HPP__
+#define __CFG_SCHEMA_HPP__
+
+extern "C"
+{
+#include "c_types.h"
+}
+
+#include "espbot_json_writer.hpp"
+#include "espbot_mem_macros.h"
+
+#define CFG_KEY_LEN 24   // terminator included
+#define CFG_FIELDS_MAX 8 // fields of a cfg struct
+#define CFG_SIZE_MAX 256 // a cfg struct (restore works on a static copy)
+
+typedef enum
+{
+  CFG_bool = 0,
+  CFG_int,  // signed char, short or int member
+  CFG_uint, // unsigned char, short or int member
+  CFG_str   // char[] member, terminator included
+} Cfg_field_type;
+
+// a member of a cfg struct (32 bit members, so that the table can be read from flash)
+struct cfg_field
+{
+  char name[CFG_KEY_LEN]; // the JSON key
+  uint32 type;            // Cfg_field_type
+  uint32 offset;
+  uint32 size;
+  int def; // numbers default value (strings default to "")
+};
+
+struct cfg_schema
+{
+  const struct cfg_field *fields;
+  int count;
+  void *cfg;
+  int cfg_size;
+  int json_len;   // the max JSON length, terminator included
+  uint32 *digest; // of the saved (or restored) values, 0 when unknown
+};
+
+/*
+ * a cfg struct is declared once as a list of fields, e.g.
+ *
+ *   struct mdns_config
+ *   {
+ *       bool enabled;
+ *   } mdns_cfg;
+ *
+ *   #define MDNS_CFG_FIELDS(FIELD, type) \
+ *       FIELD(type, enabled, "mdns_enabled", CFG_bool, 0)
+ *
+ *   CFG_SCHEMA(mdns_schema, struct mdns_config, mdns_cfg, MDNS_CFG_FIELDS);
+ *
+ * and CFG_SCHEMA generates (at compile time) the descriptors table in flash,
+ * the max JSON length (mdns_schema_json_len) and the mdns_schema used by
+ * cfg_defaults, cfg_json_write, cfg_digest, ... and the cfgstore restore/save
+ */
+#define CFG_MEMBER_SIZE(type, member) sizeof(((type *)0)->member)
+
+#define CFG_FIELD_DESC(type, member, key, field_type, def) \
+  {key, field_type, __builtin_offsetof(type, member), CFG_MEMBER_SIZE(type, member), def},
+
+// "key": + the value + a ',' (or the terminator)
+#define CFG_NUM_LEN(size) (((size) == 1) ? 3 : (((size) == 2) ? 5 : 10))
+#define CFG_VALUE_LEN(field_type, size)                                  \
+  (((field_type) == CFG_bool) ? 1                                        \
+   : ((field_type) == CFG_int) ? (CFG_NUM_LEN(size) + 1)                 \
+   : ((field_type) == CFG_uint) ? CFG_NUM_LEN(size)                      \
+   : (2 + ((size)-1) * 6)) // every char escaped as \u00XX
+#define CFG_FIELD_JSON_LEN(type, member, key, field_type, def) \
+  +(sizeof(key) + 2 + CFG_VALUE_LEN(field_type, CFG_MEMBER_SIZE(type, member)) + 1)
+
+#define CFG_SCHEMA(name, type, cfg_var, FIELDS)                                         \
+  static const struct cfg_field name##_fields[] IROM_TEXT ALIGNED_4 = {                 \
+      FIELDS(CFG_FIELD_DESC, type)};                                                    \
+  enum                                                                                  \
+  {                                                                                     \
+    name##_count = (sizeof(name##_fields) / sizeof(struct cfg_field)),                  \
+    name##_json_len = (2 FIELDS(CFG_FIELD_JSON_LEN, type))                              \
+  };                                                                                    \
+  typedef char name##_fits[((name##_count <= CFG_FIELDS_MAX) &&                         \
+                            (sizeof(type) <= CFG_SIZE_MAX))                             \
+                               ? 1                                                      \
+                               : -1];                                                   \
+  static uint32 name##_digest;                                                          \
+  static const struct cfg_schema name IROM_TEXT ALIGNED_4 = {                           \
+      name##_fields, name##_count, &cfg_var, sizeof(type), name##_json_len, &name##_digest}
+
+// numbers get their default value, strings are emptied
+void cfg_defaults(const struct cfg_schema *schema);
+
+// the cfg as a JSON object (bools as 0 and 1)
+void cfg_json_write(const struct cfg_schema *schema, Json_writer *json);
+
+// with dest NULL the result is heap allocated (the caller deletes it), NULL on heap exhausted
+char *cfg_json_stringify(const struct cfg_schema *schema, char *dest = NULL, int len = 0);
+
+// a field-wise hash of the cfg values (never 0)
+uint32 cfg_digest(const struct cfg_schema *schema);
+
+// numbers members of any size
+int cfg_get_num(const struct cfg_field *field, void *cfg);
+void cfg_set_num(const struct cfg_field *field, void *cfg, int value);
+
+#endif
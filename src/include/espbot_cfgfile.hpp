@@ -10,7 +10,10 @@
 #define __CFGFILE_HPP__
 
 #include "espbot_spiffs.hpp"
+#include "espbot_cfg_schema.hpp"
 #include "espbot_json.hpp"
+#include "espbot_json_sax.hpp"
+#include "espbot_json_writer.hpp"
 
 enum {
   CFG_ok = 0,
@@ -36,6 +39,34 @@ public:
    */
   Cfgfile(char *filename);
   ~Cfgfile();
+
+  /**
+   * @brief restore the fields from the file
+   * the file is read and parsed one LOG_PAGE_SIZE chunk at a time,
+   * with no buffer for the whole content
+   * 
+   * @param filename 
+   * @param fields the root object pairs to be restored
+   * @param count 
+   * @return int JSON_noerr
+   *             JSON_sintaxErr    -> bad content, read error or heap exhausted
+   *             JSON_typeMismatch -> a field value does not match
+   *             JSON_notFound     -> some field is missing (checkout the fields found flag)
+   */
+  static int restore(char *filename, struct json_field *fields, int count);
+
+  /**
+   * @brief restore the schema cfg from the file
+   * the cfg is changed only when the file content is fine
+   * 
+   * @param filename 
+   * @param schema 
+   * @param found NULL -> every field is required
+   *              otherwise missing fields are fine (and keep the current value)
+   *              and a bit is set for each field found
+   * @return int same as restore(filename, fields, count)
+   */
+  static int restore(char *filename, const struct cfg_schema *schema, uint32 *found = NULL);
 };
 
 
@@ -0,0 +1,86 @@
+/*
+ * ----------------------------------------------------------------------------
+ * "THE BEER-WARE LICENSE" (Revision 42):
+ * <quackmore-ff@yahoo.com> wrote this file.  As long as you retain this notice
+ * you can do whatever you want with this stuff. If we meet some day, and you 
+ * think this stuff is worth it, you can buy me a beer in return. Quackmore
+ * ----------------------------------------------------------------------------
+ */
+#ifndef __CFGSTORE_HPP__
+#define __CFGSTORE_HPP__
+
+extern "C"
+{
+#include "c_types.h"
+}
+
+#include "espbot_cfgfile.hpp"
+
+#define CFGSTORE_ENTRIES 16     // cfg structs kept into the store
+#define CFGSTORE_SIZE_MAX 2048  // the store content
+#define CFGSTORE_MAGIC 0x47464345 // "ECFG"
+#define CFGSTORE_SAVE_DELAY 1000  // ms, the saves requested meanwhile are written once
+#define CFGSTORE_RETRIES 5        // after failed writes, CFGSTORE_SAVE_DELAY * 2, 4, .. 32 later
+
+/*
+ * binary cfg store
+ *
+ * the cfg structs of every module are saved together into one of two files
+ * (the slots, written alternately) as records of typed fields:
+ *
+ *   header:  magic, sequence, length, CRC-32 (of the header words and the records)
+ *   record:  key hash, fields count, fields length
+ *   field:   name hash, type, length, value (numbers as 32 bit, strings terminated)
+ *            padded to 4 bytes
+ *
+ * at boot the valid slot with the highest sequence is read once,
+ * an interrupted save leaves the previous slot valid
+ * fields are found by name, so records saved by a different firmware
+ * restore the fields the two cfg structs have in common
+ *
+ * cfg saved as JSON files (e.g. "mdns.cfg") by a previous firmware are restored
+ * when the store has no record for them, and moved into the store by cfgstore_init_done
+ *
+ * modules restore their cfg at init, records not restored by then are dropped
+ * by the next save
+ *
+ * saves are written behind: a save request is written from the espbot task
+ * CFGSTORE_SAVE_DELAY later, together with any other request meanwhile
+ * (e.g. a web page posting several settings), and only when some cfg
+ * differs from the saved one
+ * a failed write is retried up to CFGSTORE_RETRIES times, each time twice as late,
+ * then the save is left pending until the next request or cfgstore_flush
+ * a store too long for CFGSTORE_SIZE_MAX is not retried
+ */
+
+// read the store (after the file system is mounted)
+void cfgstore_init(void);
+// every module restored its cfg: the boot content is released
+void cfgstore_init_done(void);
+
+/*
+ * restore the schema cfg saved with key (the key is kept, e.g. a f_str)
+ * and add it to the cfg saved by cfgstore_save
+ * the cfg is changed only when the content is fine
+ * found: NULL -> every field is required
+ *        otherwise missing fields are fine (and keep the current value)
+ *        and a bit is set for each field found
+ * result: CFG_ok
+ *         CFG_cantRestore -> nothing saved for key
+ *         CFG_error       -> bad content
+ */
+int cfgstore_restore(char *key, const struct cfg_schema *schema, uint32 *found = NULL);
+
+// the schema cfg is the saved one (checked against the digest, with no read)
+// the last written one: a save requested meanwhile is still pending
+bool cfgstore_uptodate(const struct cfg_schema *schema);
+
+// a cfg changed: every cfg restored so far is written into the other slot
+// CFGSTORE_SAVE_DELAY later
+// result: CFG_ok
+int cfgstore_save(void);
+// write a pending save now (e.g. before a restart)
+// result: CFG_ok or CFG_error (a write error leaves the save pending, see the retries above)
+int cfgstore_flush(void);
+
+#endif
@@ -0,0 +1,70 @@
+/*
+ * ----------------------------------------------------------------------------
+ * "THE BEER-WARE LICENSE" (Revision 42):
+ * <quackmore-ff@yahoo.com> wrote this file.  As long as you retain this notice
+ * you can do whatever you want with this stuff. If we meet some day, and you 
+ * think this stuff is worth it, you can buy me a beer in return. Quackmore
+ * ----------------------------------------------------------------------------
+ */
+#ifndef __CORS_HPP__
+#define __CORS_HPP__
+
+extern "C"
+{
+#include "c_types.h"
+#include "espconn.h"
+}
+
+#define CORS_ORIGINS_LEN 128 // comma separated list of origins or "*"
+#define CORS_METHODS_LEN 48
+#define CORS_HEADERS_LEN 64  // comma separated list of headers or "*" (echo the requested ones)
+#define CORS_ORIGIN_LEN 64   // max length of a single request origin
+
+void cors_init(void);
+char *cors_cfg_json_stringify(char *dest = NULL, int len = 0);
+int cors_cfg_save(void);
+
+/*
+ * setting a new policy will also recompute the preflight headers
+ * result: true  -> the policy was updated
+ *         false -> heap exhausted, the previous policy is still in use
+ */
+bool cors_set_cfg(char *origins, char *methods, char *headers, int max_age);
+
+/*
+ * called by the http server for every incoming request header
+ * selects the Access-Control-Allow-Origin value for the connection responses
+ * (upload segments and queued requests keep the value of their header)
+ */
+void cors_set_req_origin(struct espconn *p_espconn, char *origin);
+
+/*
+ * result: the Access-Control-Allow-Origin value for the connection
+ *         NULL when the request origin is not allowed (no CORS headers)
+ */
+char *cors_allowed_origin(struct espconn *p_espconn);
+
+/*
+ * called when the connection is closed
+ */
+void cors_forget(struct espconn *p_espconn);
+
+/*
+ * result: true when the allowed origin depends on the request origin
+ *         (a "Vary: Origin" header is required)
+ */
+bool cors_vary_origin(void);
+
+/*
+ * result: true when the Access-Control-Request-Headers must be echoed
+ *         (headers policy "*")
+ */
+bool cors_echo_req_headers(void);
+
+/*
+ * result: the precomputed preflight headers string
+ *         (Allow-Methods, Allow-Headers and Max-Age, "\r\n" terminated)
+ */
+char *cors_preflight_headers(void);
+
+#endif
@@ -0,0 +1,52 @@
+/*
+ * ----------------------------------------------------------------------------
+ * "THE BEER-WARE LICENSE" (Revision 42):
+ * <quackmore-ff@yahoo.com> wrote this file.  As long as you retain this notice
+ * you can do whatever you want with this stuff. If we meet some day, and you 
+ * think this stuff is worth it, you can buy me a beer in return. Quackmore
+ * ----------------------------------------------------------------------------
+ */
+#ifndef __DNS_HPP__
+#define __DNS_HPP__
+
+extern "C"
+{
+#include "c_types.h"
+#include "ip_addr.h"
+}
+
+#define DNS_NAME_LEN 64      // host name max length (terminator included)
+#define DNS_CACHE_MAX 4      // cached host names
+#define DNS_CACHE_TTL 300    // seconds a resolved address is reused
+#define DNS_CACHE_SWEEP 60   // seconds between expired entries checks
+#define DNS_LOOKUPS_MAX 4    // lookups in progress
+
+typedef enum
+{
+  DNS_resolved = 0, // the address is available straight away (cached or dotted IP)
+  DNS_in_progress,  // found_func will be called
+  DNS_error         // no lookup started, found_func won't be called
+} Dns_res;
+
+void dns_init(void);
+
+/*
+ * resolve a host name (or a dotted IP address, with no lookup)
+ * recently resolved names are served from the cache with no DNS round-trip
+ *
+ * result: DNS_resolved    -> *ip is ready, found_func won't be called
+ *         DNS_in_progress -> found_func(param, ip) will be called,
+ *                            ip is NULL when the name cannot be resolved
+ *         DNS_error       -> name too long, heap exhausted or too many lookups
+ */
+int dns_resolve(char *host, struct ip_addr *ip, void (*found_func)(void *, struct ip_addr *), void *param);
+
+// the pending lookups for param won't call back (e.g. param is going to be deleted)
+void dns_cancel(void *param);
+
+// cache only, no lookup: result true when host is cached (or a dotted IP)
+bool dns_cache_lookup(char *host, struct ip_addr *ip);
+// e.g. when the cached address does not answer anymore
+void dns_cache_forget(char *host);
+
+#endif
@@ -115,6 +115,12 @@
 #define HTTP_CHECK_PENDING_SEND_QUEUE_FULL 0x0092
 #define HTTP_PUSH_PENDING_SEND_QUEUE_FULL 0x0093
 #define HTTP_PUSH_PENDING_SEND_HEAP_EXHAUSTED 0x0094
+#define HTTP_PARSE_REQUEST_CANNOT_FIND_IF_NONE_MATCH 0x0095
+#define HTTP_RECV_HOLD 0x0096
+#define HTTP_RECV_UNHOLD 0x0097
+#define HTTP_RECV_HOLD_TIMEOUT 0x0098
+#define HTTP_CHECK_PENDING_REQUESTS_HEAP_EXHAUSTED 0x0099
+#define HTTP_PARSE_REQUEST_CANNOT_FIND_CONTENT_TYPE 0x009A
 
 #define HTTP_SVR_START 0x009D
 #define HTTP_SVR_STOP 0x009E
@@ -137,6 +143,7 @@
 #define ROUTES_GETDIAGNOSTICEVENTS_NEXT_HEAP_EXHAUSTED 0x00C5
 #define ROUTES_GETDIAGNOSTICEVENTS_NEXT_PENDING_RES_QUEUE_FULL 0x00C6
 #define ROUTES_GETDIAGEVENTS_PENDING_RES_QUEUE_FULL 0x00C7
+#define ROUTES_JOB_HEAP_EXHAUSTED 0x00C8
 
 #define OTA_INIT_DEFAULT_CFG 0x00D0
 #define OTA_PATH_TRUNCATED 0x00D1
@@ -164,6 +171,12 @@
 #define HTTP_CLT_CONNECTED_CANNOT_FIND_ESPCONN 0x0107
 #define HTTP_CLT_CONNECT_CONN_FAILURE 0x0108
 #define HTTP_CLT_SEND_REQ_HEAP_EXHAUSTED 0x0109
+#define HTTP_CLT_POOL_GET_HEAP_EXHAUSTED 0x010A
+#define HTTP_CLT_POOL_STATS_STRINGIFY_HEAP_EXHAUSTED 0x010B
+#define HTTP_CLT_RECV_HEAP_EXHAUSTED 0x010C
+#define HTTP_CLT_RECV_BAD_RESPONSE 0x010D
+#define HTTP_CLT_DOWNLOAD_HEAP_EXHAUSTED 0x010E
+#define HTTP_CLT_DOWNLOAD_FILE_WRITE_ERROR 0x010F
 
 #define SPIFFS_INIT_CANNOT_MOUNT 0x0110
 #define SPIFFS_INIT_FS_FORMATTED 0x0111
@@ -177,6 +190,8 @@
 #define SPIFFS_CHECK_FS_NOT_MOUNTED 0x0119
 #define SPIFFS_CHECK_SUCCESSFULLY 0x011A
 #define SPIFFS_CHECK_ERRORS 0x011B
+#define SPIFFS_STATS_STRINGIFY_HEAP_EXHAUSTED 0x011C
+#define SPIFFS_GC_INLINE 0x011D
 
 #define ESPFILE_FS_NOT_MOUNTED 0x0120
 #define ESPFILE_OPEN_ERROR 0x0121
@@ -196,6 +211,8 @@
 #define ESPFILE_REMOVE_ERROR 0x012F
 #define ESPFILE_EXISTS_FS_NOT_MOUNTED 0x0130
 #define ESPFILE_SIZE_FS_NOT_MOUNTED 0x0131
+#define ESPFILE_FLUSH_FS_NOT_MOUNTED 0x0132
+#define ESPFILE_FLUSH_ERROR 0x0133
 
 #define SPIFFS_FLASH_READ_OUT_OF_BOUNDARY 0x0140
 #define SPIFFS_FLASH_READ_ERROR 0x0141
@@ -234,4 +251,47 @@
 #define CRON_DISABLED 0x0177
 #define CRON_CFG_STRINGIFY_HEAP_EXHAUSTED 0x0178
 
+#define JOBS_ADD_TABLE_FULL 0x0180
+#define JOBS_ADD_HEAP_EXHAUSTED 0x0181
+#define JOBS_STRINGIFY_HEAP_EXHAUSTED 0x0182
+#define JOBS_LIST_STRINGIFY_HEAP_EXHAUSTED 0x0183
+#define JOBS_STARTED 0x0184
+#define JOBS_COMPLETED 0x0185
+#define JOBS_FAILED 0x0186
+#define JOBS_CANCELLED 0x0187
+#define JOBS_ADD_SAME_TYPE_PENDING 0x0188
+
+#define CORS_RESTORE_CFG_ERROR 0x0190
+#define CORS_INIT_DEFAULT_CFG 0x0191
+#define CORS_CFG_STRINGIFY_HEAP_EXHAUSTED 0x0192
+#define CORS_UPDATE_HEADERS_HEAP_EXHAUSTED 0x0193
+#define CORS_ORIGIN_NOT_ALLOWED 0x0194
+#define CORS_ORIGIN_HEAP_EXHAUSTED 0x0195
+
+#define HTTP_CACHE_PUT_HEAP_EXHAUSTED 0x01A0
+#define HTTP_CACHE_RESPONSE_HEAP_EXHAUSTED 0x01A1
+#define HTTP_CACHE_STATS_STRINGIFY_HEAP_EXHAUSTED 0x01A2
+
+#define UPLOAD_HEAP_EXHAUSTED 0x01B0
+#define UPLOAD_TABLE_FULL 0x01B1
+#define UPLOAD_BAD_SYNTAX 0x01B2
+#define UPLOAD_FILE_WRITE_ERROR 0x01B3
+#define UPLOAD_COMPLETED 0x01B4
+
+#define HTTP_CLT_QUEUE_REQ_HEAP_EXHAUSTED 0x01C0
+#define HTTP_CLT_QUEUE_REQ_FULL 0x01C1
+
+#define DNS_HEAP_EXHAUSTED 0x01D0
+#define DNS_NAME_TOO_LONG 0x01D1
+#define DNS_TOO_MANY_LOOKUPS 0x01D2
+#define DNS_LOOKUP_ERROR 0x01D3
+#define DNS_NOT_FOUND 0x01D4
+
+#define CFGSTORE_HEAP_EXHAUSTED 0x01E0
+#define CFGSTORE_BAD_SLOT 0x01E1
+#define CFGSTORE_WRITE_ERROR 0x01E2
+#define CFGSTORE_TABLE_FULL 0x01E3
+#define CFGSTORE_TOO_LONG 0x01E4
+#define CFGSTORE_SAVE_GIVEN_UP 0x01E5
+
 #endif
\ No newline at end of file
@@ -22,6 +22,7 @@ extern "C"
 #define HTTP_OK 200
 #define HTTP_CREATED 201
 #define HTTP_ACCEPTED 202
+#define HTTP_NOT_MODIFIED 304
 #define HTTP_BAD_REQUEST 400
 #define HTTP_UNAUTHORIZED 401
 #define HTTP_FORBIDDEN 403
@@ -78,6 +79,8 @@ public:
   char *url;
   char *acrh;
   char *origin;
+  char *if_none_match;
+  char *content_type;
   int h_content_len;
   int content_len;
   char *req_content;
@@ -92,6 +95,7 @@ void http_sentcb(void *arg);
 // http requests can come in split into different messages
 // if that is the case then the incomplete messages are queued
 // and elaborated on completion
+// (bodies are parsed once, by the route, when complete)
 void http_save_pending_request(void *arg, char *precdata, unsigned short length, Http_parsed_req *parsed_req);
 
 // will check for pending requests on p_espconn
@@ -99,6 +103,22 @@ void http_save_pending_request(void *arg, char *precdata, unsigned short length,
 // will call msg_complete function one the message is complete
 void http_check_pending_requests(struct espconn *p_espconn, char *new_msg, unsigned short length, void (*msg_complete)(void *, char *, unsigned short ));
 
+//
+// receive flow control
+// the connection receiving is paused (espconn_recv_hold) when the heap is low or
+// too many bytes are waiting to be sent, and resumed (espconn_recv_unhold) when drained
+// (a split request that cannot be allocated yet is kept partial while the connection is held)
+//
+#define HTTP_RECV_HEAP_WATERMARK 6144 // bytes, hold when the free heap would go below
+#define HTTP_RECV_QUEUED_MAX 4096     // bytes, hold when the responses waiting to be sent exceed
+#define HTTP_RECV_HOLD_CHECK 100      // ms, held connections check period
+#define HTTP_RECV_HOLD_MAX_CHECKS 100 // per held connection, then its partial request fails
+
+// called on every received segment
+void http_recv_flow_check(struct espconn *p_espconn);
+// called when the connection is closed
+void http_recv_flow_forget(struct espconn *p_espconn);
+
 
 //
 // HTTP RESPONSE
@@ -114,7 +134,8 @@ public:
   int m_code;
   char *m_content_type;
   char *m_acrh;
-  char *m_origin;
+  bool m_cors_preflight; // add the CORS preflight headers
+  uint32 m_etag;         // 0 -> no ETag header
   int m_content_length;
   int m_content_range_start;
   int m_content_range_end;
@@ -146,13 +167,17 @@ void clean_pending_send(struct espconn *p_espconn);
 // check if there are pending http send
 void http_check_pending_send(void);
 
+// nothing being sent and no pending http send
+bool http_send_idle(void);
+
 // quick format an http response and send it
 //    free_msg must be false when passing a "string" allocated into text or data segment
 //    free_msg must be true when passing an heap allocated string
 void http_response(struct espconn *p_espconn, int code, char *content_type, const char *msg, bool free_msg);
 
 // format header string
-char *http_format_header(class Http_header *);
+// (the CORS headers depend on the origin of the connection request)
+char *http_format_header(struct espconn *p_espconn, class Http_header *);
 
 // sending http messages using espconn
 
@@ -185,22 +210,10 @@ public:
   int content_range_size;
   int h_content_len;
   int content_len;
+  bool connection_close; // "Connection: close" or HTTP/1.0 response
   char *body;
 };
 
-// parse_response takes the incoming string response and fill in parsed_response
-void http_parse_response(char *response, int length, Http_parsed_response *parsed_response);
-
-// http responses can come in split into different messages
-// if that is the case then the incomplete messages are queued
-// and elaborated on completion
-void http_save_pending_response(struct espconn *p_espconn, char *precdata, unsigned short length, Http_parsed_response *parsed_res);
-
-// will check for pending responses on p_espconn
-// will add the new message part new_msg
-// will call msg_complete function one the message is complete
-void http_check_pending_responses(struct espconn *p_espconn, char *new_msg, unsigned short length, void (*msg_complete)(void *, char *, unsigned short ));
-
 //
 //
 void clean_pending_responses(struct espconn *p_espconn);
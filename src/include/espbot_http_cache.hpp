@@ -0,0 +1,40 @@
+/*
+ * ----------------------------------------------------------------------------
+ * "THE BEER-WARE LICENSE" (Revision 42):
+ * <quackmore-ff@yahoo.com> wrote this file.  As long as you retain this notice
+ * you can do whatever you want with this stuff. If we meet some day, and you 
+ * think this stuff is worth it, you can buy me a beer in return. Quackmore
+ * ----------------------------------------------------------------------------
+ */
+#ifndef __HTTP_CACHE_HPP__
+#define __HTTP_CACHE_HPP__
+
+#include "espbot_http.hpp"
+
+#define HTTP_CACHE_MAX_ENTRIES 8
+#define HTTP_CACHE_MAX_BYTES 1024 // memory budget for the cached bodies
+
+void http_cache_init(void);
+
+/*
+ * GET response for routes whose content changes only when the cfg changes
+ * the content is looked up by route (the request url):
+ * - found   -> the cached body is sent (or 304 when If-None-Match matches the ETag)
+ * - missing -> the body is produced by json_stringify, sent and cached
+ *              (least recently used entries are evicted to fit the memory budget)
+ */
+void http_cache_response(struct espconn *p_espconn,
+                         Http_parsed_req *parsed_req,
+                         char *(*json_stringify)(char *dest, int len));
+
+/*
+ * to be called whenever the content served by route changes
+ * (the cfg *_set and *_cfg_save functions; before the cfgstore_uptodate check,
+ * that compares with the last cfg written and a save can still be pending)
+ */
+void http_cache_invalidate(const char *route);
+void http_cache_invalidate_all(void);
+
+char *http_cache_stats_json_stringify(char *dest = NULL, int len = 0);
+
+#endif
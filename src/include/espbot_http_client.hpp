@@ -17,6 +17,8 @@ extern "C"
 }
 
 #include "espbot_http.hpp"
+#include "espbot_http_parser.hpp"
+#include "espbot_queue.hpp"
 
 
 // Init the httpclient <-> espconn association data strucures
@@ -25,6 +27,15 @@ void init_http_clients_data_stuctures(void);
 #define HTTP_CLT_COMM_TIMEOUT 10000
 // #define HTTP_CLT_SEND_REQ_TIMEOUT 10000
 
+#define HTTP_CLT_POOL_MAX_IDLE 2          // idle keep-alive connections kept open
+#define HTTP_CLT_POOL_IDLE_TIMEOUT 15000  // default ms before an idle connection is closed
+
+#define HTTP_CLT_REQ_QUEUE_MAX 8      // queued requests per client
+#define HTTP_CLT_PIPELINE_DEPTH 3     // requests sent before their responses are received
+#define HTTP_CLT_BODY_CHUNK 256       // buffer increment for bodies with no Content-Length
+
+struct http_clt_queued_req;
+
 typedef enum
 {
   HTTP_CLT_DISCONNECTED = 1,
@@ -36,7 +47,9 @@ typedef enum
   HTTP_CLT_WAITING_RESPONSE,
   HTTP_CLT_RESPONSE_ERROR,
   HTTP_CLT_RESPONSE_TIMEOUT,
-  HTTP_CLT_RESPONSE_READY
+  HTTP_CLT_RESPONSE_READY,
+  HTTP_CLT_RESOLVING,
+  HTTP_CLT_RESOLVE_FAILURE
 } Http_clt_status_type;
 
 class Http_clt
@@ -47,22 +60,44 @@ private:
   struct ip_addr _host;
   uint32 _port;
   Http_clt_status_type _status;
+  uint32 _resolving_port; // connecting by host name, waiting for the address
 
   void (*_completed_func)(void *);
   void *_param;
   void format_request(char *);
 
+  Http_res_parser *_parser;
+  Http_parsed_response *_response; // the response being received
+  bool _discard;                   // the remains of an aborted response are ignored
+  char *_body;                     // not streaming: the body being received
+  int _body_len;
+  int _body_size;
+  bool _streaming;
+  bool (*_on_headers)(void *, Http_parsed_response *);
+  bool (*_on_body_chunk)(void *, char *, int);
+  bool _stream_recv_hold;
+  bool _stream_held;
+  bool response_init(void);
+  void response_complete(void);
+
+  Queue<struct http_clt_queued_req> *_req_queue; // waiting for their responses, in order
+  int _req_sent;                                 // queued requests already sent
+  bool _pipelining;
+  void queue_send(void);
+
 public:
   Http_clt();
   ~Http_clt();
 
   os_timer_t _connect_timeout_timer;
   os_timer_t _send_req_timeout_timer;
+  os_timer_t _idle_timer; // armed while parked into the pool (not touched by the recv path)
   uint32 _comm_timeout;
 
   char *request;
   int req_len;
   Http_parsed_response *parsed_response;
+  bool keep_alive; // the last response did not ask to close the connection
 
   // connect will temporary change httpclient status to HTTP_CLT_CONNECTING
   // and will end up into one of the following:
@@ -70,8 +105,16 @@ public:
   // HTTP_CLT_CONNECTED
   // HTTP_CLT_CONNECT_TIMEOUT
   // HTTP_CLT_DISCONNECTED (??) not sure so just in case
+  //
+  // a client (from the pool) already connected to the same host:port is reused:
+  // completed_func will be called with status HTTP_CLT_CONNECTED with no new TCP handshake
   void connect(struct ip_addr, uint32, void (*completed_func)(void *), void *param, int comm_tout = 10000);
 
+  // same as above with a host name (or a dotted IP address)
+  // the address comes from the DNS cache or from a lookup (status HTTP_CLT_RESOLVING meanwhile)
+  // HTTP_CLT_RESOLVE_FAILURE: the host name cannot be resolved
+  void connect(char *host, uint32, void (*completed_func)(void *), void *param, int comm_tout = 10000);
+
   // disconnect will change httpclient status to HTTP_CLT_DISCONNECTED
   void disconnect(void (*completed_func)(void *), void *param);
 
@@ -86,15 +129,104 @@ public:
   // HTTP_CLT_DISCONNECTED (??) not sure so just in case
   void send_req(char *msg, int msg_len, void (*completed_func)(void *), void *param);
 
+  // streaming version of send_req, the response body is not buffered:
+  // - on_headers is called once the header is received, parsed_response has no body
+  // - on_body_chunk is called for every received piece of body
+  //   (with recv_hold true receiving is paused after every chunk until recv_resume is called)
+  // - on_complete is called (once) when the whole body was received (HTTP_CLT_RESPONSE_READY)
+  //   or on error/timeout (HTTP_CLT_RESPONSE_ERROR, HTTP_CLT_RESPONSE_TIMEOUT ...)
+  //   parsed_response is still available (with no body) for checking http_code
+  // bodies can be Content-Length framed, chunked or terminated by the server disconnecting
+  // on_headers and on_body_chunk returning false abort the response (HTTP_CLT_RESPONSE_ERROR)
+  void send_req_stream(char *msg, int msg_len,
+                       bool (*on_headers)(void *param, Http_parsed_response *response),
+                       bool (*on_body_chunk)(void *param, char *data, int len),
+                       void (*on_complete)(void *param),
+                       void *param,
+                       bool recv_hold = false);
+  void recv_resume(void);
+
+  // request queue: requests are sent back-to-back on the same connection
+  // and completed_func is called for each one, in order, when its response is ready
+  // (same as send_req, check get_status and parsed_response)
+  // - the client must be connected
+  // - with pipelining enabled, once the server proved to keep the connection alive,
+  //   up to HTTP_CLT_PIPELINE_DEPTH requests are sent with no waiting for the responses
+  // - on error or timeout all the queued requests are completed with the error status
+  // - the client can be deleted (or released to the pool) only by the last completed_func
+  // - don't mix with send_req/send_req_stream
+  // result: false when the request cannot be queued (queue full or heap exhausted)
+  bool queue_req(char *msg, int msg_len, void (*completed_func)(void *), void *param);
+  void set_pipelining(bool enabled);
+  int queued_reqs(void);
+  void queue_completed(void);
+
   Http_clt_status_type get_status(void);
 
+  // zero-copy view of a response header (valid into completed_func or on_headers)
+  // result: the value length (the value is not terminated), -1 when missing
+  int get_header(const char *name, char **value);
+
   void update_status(Http_clt_status_type);
 
   void call_completed_func(void);
 
   void print_status(void);
+
+  // connection pool support
+  bool is_connected_to(struct ip_addr host, uint32 port);
+  bool is_reusable(void);
+  void park(void);
+
+  // connecting by host name
+  void host_resolved(struct ip_addr *ip);
+
+  // receiving (used by the espconn callbacks and the response parser)
+  // result: the bytes used, the remaining ones belong to the next (pipelined) response
+  int recv(char *data, int len);
+  // result: true when the disconnection ended a response
+  bool recv_closed(void);
+  void response_failed(Http_clt_status_type status);
+  bool res_headers(Http_res_parser *parser);
+  bool res_body(char *data, int len);
 };
 
+/*
+ * downloading into a file with no buffering (the file size is not limited by the heap)
+ * the client must be connected, the file is overwritten
+ * on completion completed_func is called with the client status:
+ * HTTP_CLT_RESPONSE_READY -> the file was written
+ * anything else           -> the download failed and the file was removed
+ */
+void http_clt_download_file(Http_clt *client,
+                            char *request,
+                            int req_len,
+                            char *filename,
+                            void (*completed_func)(void *),
+                            void *param);
+
+/*
+ * CONNECTION POOL
+ *
+ * instead of new Http_clt ... disconnect ... delete for every request
+ * get a client from the pool, connect it as usual and release it when done:
+ * - http_clt_pool_get returns an idle client already connected to host:port
+ *   (when available and still healthy) or a new one
+ * - http_clt_pool_release keeps the connection open (when the server allows it)
+ *   for the next request to the same server, otherwise disconnects and deletes the client
+ *
+ * idle connections are closed after the idle timeout or when the pool is full
+ * a released client must not be used anymore
+ */
+
+// result: NULL when heap exhausted
+Http_clt *http_clt_pool_get(struct ip_addr host, uint32 port);
+// host name version (idle connections are found when the host name is into the DNS cache)
+Http_clt *http_clt_pool_get(char *host, uint32 port);
+void http_clt_pool_release(Http_clt *client);
+void http_clt_pool_set_idle_timeout(uint32 idle_timeout_ms);
+char *http_clt_pool_stats_json_stringify(char *dest = NULL, int len = 0);
+
 /* 
 
 EXAMPLE EXAMPLE EXAMPLE EXAMPLE EXAMPLE EXAMPLE EXAMPLE EXAMPLE EXAMPLE
@@ -155,5 +287,22 @@ void whatever(void)
     ...
 }
 
+USING THE CONNECTION POOL
+the same structure, with
+1) espclient = http_clt_pool_get(<host_ip>, <host_port>);
+   espclient->connect(<host_ip>, <host_port>, get_info, NULL);
+4) check_info: on completion http_clt_pool_release(espclient);
+or by host name
+1) espclient = http_clt_pool_get(<host_name>, <host_port>);
+   espclient->connect(<host_name>, <host_port>, get_info, NULL);
+
+USING THE REQUEST QUEUE
+no need to chain the requests into the callbacks
+2) connect (once connected call send_all)
+3) send_all: espclient->set_pipelining(true);
+             espclient->queue_req(<req_1>, check_1, NULL);
+             espclient->queue_req(<req_2>, check_2, NULL);
+4) check_1 and check_2 are called in order, the last one releases the client
+
 */
 #endif
\ No newline at end of file
@@ -0,0 +1,101 @@
+/*
+ * ----------------------------------------------------------------------------
+ * "THE BEER-WARE LICENSE" (Revision 42):
+ * <quackmore-ff@yahoo.com> wrote this file.  As long as you retain this notice
+ * you can do whatever you want with this stuff. If we meet some day, and you 
+ * think this stuff is worth it, you can buy me a beer in return. Quackmore
+ * ----------------------------------------------------------------------------
+ */
+#ifndef __HTTP_PARSER_HPP__
+#define __HTTP_PARSER_HPP__
+
+extern "C"
+{
+#include "c_types.h"
+}
+
+#define HTTP_RES_HEADER_MAX 1024 // status line + headers
+
+typedef enum
+{
+  HTTP_RES_PARSER_ok = 0,
+  HTTP_RES_PARSER_completed = 1, // the whole response was received
+  HTTP_RES_PARSER_bad_syntax = -1,
+  HTTP_RES_PARSER_header_too_long = -2,
+  HTTP_RES_PARSER_aborted = -3,
+  HTTP_RES_PARSER_heap_exhausted = -4
+} Http_res_parser_err;
+
+typedef enum
+{
+  RES_header = 0,
+  RES_body_fixed,       // Content-Length
+  RES_body_until_close, // no framing, the body ends when the server disconnects
+  RES_chunk_size,
+  RES_chunk_ext,
+  RES_chunk_data,
+  RES_chunk_data_end,   // CRLF after the chunk data
+  RES_trailers,
+  RES_completed,
+  RES_error
+} Http_res_parser_state;
+
+/*
+ * incremental HTTP response parser
+ *
+ * the response is fed one TCP segment at a time (any split is fine)
+ * - the status line and headers are kept into a HTTP_RES_HEADER_MAX buffer
+ * - on_headers is called once the header is complete
+ * - the body (Content-Length, chunked or until close) is passed to on_body
+ *   straight from the fed data with no copy (chunk framing removed)
+ * callbacks returning false abort the parsing (HTTP_RES_PARSER_aborted)
+ *
+ * 1xx interim responses (e.g. 100 Continue) are skipped
+ * 204 and 304 responses have no body
+ */
+class Http_res_parser
+{
+public:
+  Http_res_parser(void *param,
+                  bool (*on_headers)(void *param, Http_res_parser *parser),
+                  bool (*on_body)(void *param, char *data, int len));
+  ~Http_res_parser();
+
+  // ready for a new response (header views are no more valid)
+  void reset(void);
+  // result: Http_res_parser_err
+  // *consumed: the bytes used, on completion the remaining ones belong to the next response
+  int feed(char *data, int len, int *consumed);
+  // the server closed the connection, result: Http_res_parser_err
+  int closed(void);
+  bool completed(void);
+
+  // available from on_headers on
+  int http_code;
+  bool connection_close;     // "Connection: close" or HTTP/1.0 with no keep-alive
+  int content_length;        // -1 when missing
+  bool chunked;
+  int content_range_start;
+  int content_range_end;
+  int content_range_size;
+
+  // zero-copy header view (into the header buffer, not terminated, valid until reset)
+  // name is case insensitive
+  // result: the value length, -1 when the header is missing
+  int header(const char *name, char **value);
+
+private:
+  void *m_param;
+  bool (*m_on_headers)(void *, Http_res_parser *);
+  bool (*m_on_body)(void *, char *, int);
+  Http_res_parser_state m_state;
+  char *m_header;
+  int m_header_len;
+  int m_line_len;  // current line length (CR excluded)
+  int m_remaining; // body or chunk bytes still expected
+  int m_digits;    // chunk size digits
+
+  int parse_header(void);
+};
+
+#endif
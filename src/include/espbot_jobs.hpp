@@ -0,0 +1,100 @@
+/*
+ * ----------------------------------------------------------------------------
+ * "THE BEER-WARE LICENSE" (Revision 42):
+ * <quackmore-ff@yahoo.com> wrote this file.  As long as you retain this notice
+ * you can do whatever you want with this stuff. If we meet some day, and you 
+ * think this stuff is worth it, you can buy me a beer in return. Quackmore
+ * ----------------------------------------------------------------------------
+ */
+#ifndef __JOBS_HPP__
+#define __JOBS_HPP__
+
+#define JOBS_MAX_COUNT 6      // jobs kept into the job table (queued, running and finished)
+#define JOBS_MAX_RUNNING 2    // jobs executed concurrently
+#define JOBS_START_DELAY 200  // ms, let the 202 reply leave before the job starts
+#define JOBS_WAIT_TIMEOUT 180 // s, a job waiting for longer than this will fail
+
+typedef enum
+{
+  JOB_queued = 0,
+  JOB_running,
+  JOB_completed,
+  JOB_failed,
+  JOB_cancelled
+} Job_status;
+
+typedef enum
+{
+  JOB_step_again = 0, // call the step function again on next time slice
+  JOB_step_waiting,   // waiting for an asynchronous completion (jobs_set_completed)
+  JOB_step_completed,
+  JOB_step_failed
+} Job_step_res;
+
+typedef enum
+{
+  JOB_ok = 0,
+  JOB_not_found = -1,
+  JOB_table_full = -2,
+  JOB_heap_exhausted = -3,
+  JOB_already_finished = -4,
+  JOB_same_type_pending = -5
+} Job_err;
+
+void jobs_init(void);
+
+/*
+ * JOB DEFINITION
+ *
+ * type:    a (flash) string describing the job e.g. "fs_check"
+ * step:    the job work, executed by the espbot task one time slice after another
+ *          (keep each step short) until it returns something different
+ *          from JOB_step_again
+ * release: called when the job is finished, cancelled or evicted
+ *          (free the param here), can be NULL
+ *          (release is called also when the job cannot be added)
+ *
+ * a job is refused while another one of the same type is queued or running
+ * (e.g. two wifi scans or two OTA upgrades would step on each other)
+ *
+ * asynchronous completion (e.g. waiting for an SDK callback) is obtained returning
+ * JOB_step_waiting and later calling jobs_set_completed (within JOBS_WAIT_TIMEOUT);
+ * callbacks should refer to the job by id, not by param, because a cancelled job
+ * param is released immediately
+ *
+ * result: > 0  -> job id
+ *         < 0  -> Job_err
+ */
+int jobs_add(const char *type,
+             Job_step_res (*step)(int job_id, void *param),
+             void (*release)(void *param),
+             void *param);
+
+/*
+ * set the job result (a json string allocated with new char[])
+ * the job will take care of deleting it
+ * (the result is deleted straight away when the job was cancelled)
+ */
+void jobs_set_result(int job_id, char *result);
+
+/*
+ * complete a job that was waiting (JOB_step_waiting)
+ */
+void jobs_set_completed(int job_id, bool success);
+
+/*
+ * result: Job_err
+ */
+int jobs_cancel(int job_id);
+
+bool jobs_exists(int job_id);
+
+/*
+ * time slice execution, called by espbot task on SIG_jobs_step
+ */
+void jobs_step(void);
+
+char *jobs_json_stringify(int job_id, char *dest = NULL, int len = 0);
+char *jobs_list_json_stringify(char *dest = NULL, int len = 0);
+
+#endif
@@ -9,6 +9,11 @@
 #ifndef __JSON_HPP__
 #define __JSON_HPP__
 
+extern "C"
+{
+#include "c_types.h"
+}
+
 /**
  * @brief 
  * 
@@ -38,6 +43,41 @@ typedef enum
 
 class JSONP_ARRAY;
 
+/*
+ * indexed JSONP: an entry for every pair of the object
+ * (offsets into the JSON string, so the string must be shorter than 64 KB)
+ */
+struct jsonp_token
+{
+  unsigned short key_hash;
+  unsigned char key_len;
+  unsigned char type; // Json_value_type
+  unsigned short key;
+  unsigned short value; // strings: after the opening '"'
+  unsigned short value_len;
+};
+
+/*
+ * JSONP_ARRAY element offset table entry
+ */
+struct jsonp_elem
+{
+  unsigned short start; // strings: after the opening '"'
+  unsigned short len;
+  unsigned char type; // Json_value_type
+};
+
+#define JSON_ARRAY_OFFSETS_MIN 4 // shorter arrays are scanned with no offset table
+
+/*
+ * nesting limit: the root object/array plus JSON_DEPTH_MAX levels
+ * a deeper document is a syntax error, even when it is valid JSON
+ * (this bounds the syntax check recursion, and so the stack, on any input)
+ */
+#ifndef JSON_DEPTH_MAX
+#define JSON_DEPTH_MAX 8
+#endif
+
 /**
  * @brief a class for JSONP parsin
  * 
@@ -51,7 +91,11 @@ public:
   JSONP(char *, int);
   ~JSONP(){};
 
+  // numbers are parsed in place (no copy), a value out of the type range is a JSON_typeMismatch
   int getInt(const char *name);
+  uint32 getUint(const char *name);
+  sint64 getInt64(const char *name);
+  int getFixed(const char *name, int decimals); // the value times 10^decimals
   float getFloat(const char *name);
   void getStr(const char *name, char *dest, int len);
   int getStrlen(const char *name);
@@ -63,9 +107,26 @@ public:
   void getStr(char *str, int str_len);
 #endif
 
+  /*
+   * indexed mode: the object pairs are scanned once and kept into tokens
+   * (supplied by the caller, e.g. on the stack, and valid as long as the JSONP is used)
+   * from then on finding a key is a binary search on the key hash instead of a scan
+   * result: JSON_noerr
+   *         JSON_outOfBoundary -> more pairs than max_tokens, the keys will be scanned for
+   *         a syntax error      -> no index
+   */
+  int index(struct jsonp_token *tokens, int max_tokens);
+
+  // zero-copy value view (strings with no quotes, not terminated)
+  // result: the value length, -1 when the key is missing
+  int getView(const char *name, char **value, Json_value_type *type = NULL);
+
 private:
   char *_jstr;
   int _len;
+  bool _syntax_ok; // checked once by the constructor
+  struct jsonp_token *_tokens;
+  int _tokens_count;
   char *_cursor;
   char *_cur_name;
   int _cur_name_len;
@@ -77,6 +138,8 @@ private:
   int syntax_check(void);
   int find_key(const char *t_string);
   int find_pair(void);
+  int find_token(const char *t_string);
+  bool num_value(const char *name);
 };
 
 class JSONP_ARRAY
@@ -85,9 +148,15 @@ public:
   JSONP_ARRAY();
   JSONP_ARRAY(char *);
   JSONP_ARRAY(char *, int);
-  ~JSONP_ARRAY(){};
+  // copies don't share the offset table (it's built again when needed)
+  JSONP_ARRAY(const JSONP_ARRAY &);
+  JSONP_ARRAY &operator=(const JSONP_ARRAY &);
+  ~JSONP_ARRAY();
   int len(void);
   int getInt(int id);
+  uint32 getUint(int id);
+  sint64 getInt64(int id);
+  int getFixed(int id, int decimals);
   float getFloat(int id);
   void getStr(int id, char *dest, int len);
   int getStrlen(int id);
@@ -99,9 +168,23 @@ public:
   void getStr(char *str, int str_len);
 #endif
 
+  /*
+   * forward iteration, for callers not needing random access
+   * rewind, then call next until it returns -1
+   * next result: the element length, value is a zero-copy view (strings with no quotes)
+   */
+  void rewind(void);
+  int next(char **value, Json_value_type *type = NULL);
+
 private:
   char *_jstr;
   int _len;
+  bool _syntax_ok; // checked once by the constructor
+  // element offsets, built on the first random access (one scan for all the elements)
+  struct jsonp_elem *_elems;
+  bool _elems_tried;
+  char *_iter;
+  int _iter_id;
   char *_cursor;
   int _el_count;
   int _cur_id;
@@ -112,6 +195,9 @@ private:
 
   int syntax_check(void);
   int find_elem(int idx);
+  char *first_elem(void);
+  void build_offsets(void);
+  bool num_elem(int idx);
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,151 @@
+/*
+ * ----------------------------------------------------------------------------
+ * "THE BEER-WARE LICENSE" (Revision 42):
+ * <quackmore-ff@yahoo.com> wrote this file.  As long as you retain this notice
+ * you can do whatever you want with this stuff. If we meet some day, and you 
+ * think this stuff is worth it, you can buy me a beer in return. Quackmore
+ * ----------------------------------------------------------------------------
+ */
+#ifndef __JSON_SAX_HPP__
+#define __JSON_SAX_HPP__
+
+#include "espbot_json.hpp"
+
+#define JSON_SAX_DEPTH 8        // nested objects and arrays
+#define JSON_SAX_KEY_LEN 32     // terminator included
+#define JSON_SAX_VALUE_LEN 128  // scalar values, terminator included
+
+typedef enum
+{
+  JSON_SAX_ok = 0,
+  JSON_SAX_bad_syntax = -1,
+  JSON_SAX_too_deep = -2,
+  JSON_SAX_too_long = -3, // a key or a value does not fit the buffers
+  JSON_SAX_aborted = -4
+} Json_sax_err;
+
+typedef enum
+{
+  JSON_SAX_obj_begin = 0,
+  JSON_SAX_obj_end,
+  JSON_SAX_array_begin,
+  JSON_SAX_array_end,
+  JSON_SAX_value
+} Json_sax_event;
+
+typedef enum
+{
+  SAX_value = 0,
+  SAX_value_or_end, // after '['
+  SAX_key_or_end,   // after '{'
+  SAX_key,          // after ',' into an object
+  SAX_colon,
+  SAX_string,
+  SAX_escape,
+  SAX_unicode,
+  SAX_number,
+  SAX_literal,
+  SAX_after_value,
+  SAX_done,
+  SAX_error
+} Json_sax_state;
+
+class Json_sax;
+
+/*
+ * the value of JSON_SAX_value events is terminated (strings with no quotes, escapes resolved)
+ * and its type is JSON_str, JSON_num or JSON_unknown (true, false and null)
+ * returning false aborts the parsing (JSON_SAX_aborted)
+ */
+typedef bool (*Json_sax_cb)(void *param, Json_sax *sax, Json_sax_event event, Json_value_type type, char *value, int len);
+
+/*
+ * incremental (push) JSON parser
+ *
+ * the document is fed in chunks of any size (TCP segments, file pages, ...)
+ * and events are generated as soon as a key/value is complete
+ * the only bytes kept across chunks are the current key and scalar value
+ * so memory does not depend on the document size
+ *
+ * with no callback the document is just validated
+ * (and strings are not buffered, so they can be of any length)
+ */
+class Json_sax
+{
+public:
+  Json_sax(void *param = NULL, Json_sax_cb on_event = NULL);
+  ~Json_sax(){};
+
+  // result: Json_sax_err (an error is sticky)
+  int feed(char *data, int len);
+  // no more data: a number at the document root is completed
+  // result: Json_sax_err, JSON_SAX_bad_syntax when the document is incomplete
+  int end(void);
+  // the root object/array was closed
+  bool completed(void);
+  // the nesting level (1 for the root object pairs)
+  int depth(void);
+  // the key of the current obj_begin, array_begin or value event
+  // NULL for array elements and for the root
+  char *key(void);
+
+private:
+  void *m_param;
+  Json_sax_cb m_on_event;
+  Json_sax_state m_state;
+  Json_sax_err m_err;
+  char m_stack[JSON_SAX_DEPTH]; // '{' or '['
+  int m_depth;
+  char m_key[JSON_SAX_KEY_LEN];
+  bool m_has_key;
+  bool m_string_is_key;
+  char m_value[JSON_SAX_VALUE_LEN];
+  int m_len;
+  int m_unicode; // \uXXXX code point so far
+  int m_unicode_digits;
+
+  int push_char(char c);
+  int emit(Json_sax_event event, Json_value_type type);
+  int open(char c);
+  int close(char c);
+  int scalar_end(void);
+  int parse(char c);
+};
+
+/*
+ * binding the pairs of a flat object (e.g. a cfg file) to variables
+ * keys that are not listed are skipped, as nested objects and arrays
+ */
+struct json_field
+{
+  const char *name;     // e.g. f_str("port")
+  Json_value_type type; // JSON_num -> int (true and false accepted), JSON_str -> char[size]
+  void *value;
+  int size; // JSON_str: buffer size, terminator included
+  bool found;
+};
+
+class Json_binder
+{
+public:
+  Json_binder(struct json_field *fields, int count);
+  ~Json_binder(){};
+
+  // result: Json_sax_err
+  int feed(char *data, int len);
+  // result: JSON_noerr
+  //         JSON_sintaxErr    -> bad or incomplete document
+  //         JSON_typeMismatch -> a field value has a different type (or does not fit)
+  //         JSON_notFound     -> some field is missing (checkout the fields found flag)
+  int end(void);
+
+private:
+  Json_sax m_sax;
+  struct json_field *m_fields;
+  int m_count;
+  int m_err;
+
+  static bool on_event(void *param, Json_sax *sax, Json_sax_event event, Json_value_type type, char *value, int len);
+};
+
+#endif
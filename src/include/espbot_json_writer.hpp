@@ -0,0 +1,100 @@
+/*
+ * ----------------------------------------------------------------------------
+ * "THE BEER-WARE LICENSE" (Revision 42):
+ * <quackmore-ff@yahoo.com> wrote this file.  As long as you retain this notice
+ * you can do whatever you want with this stuff. If we meet some day, and you 
+ * think this stuff is worth it, you can buy me a beer in return. Quackmore
+ * ----------------------------------------------------------------------------
+ */
+#ifndef __JSON_WRITER_HPP__
+#define __JSON_WRITER_HPP__
+
+extern "C"
+{
+#include "c_types.h"
+}
+
+#define JSON_WRITER_DEPTH 32 // nested objects and arrays
+#define JSON_WRITER_PASSES 3 // heap message: sizing, writing and one more if the content changed
+
+/*
+ * JSON writer
+ *
+ * values are appended (with no formatting of the whole message) to one of the sinks:
+ * - a fixed buffer     (e.g. on the stack)
+ * - a heap buffer      (allocated exactly, once the message was sized)
+ * - a flush function   (a small buffer handed over whenever full, e.g. to a file)
+ *
+ * keys are NULL for array elements, strings are escaped
+ * errors (overflow, heap exhausted, flush failure) are sticky and checked once by result()
+ *
+ * the message is written in a pass loop, a heap message takes two passes (only counting the
+ * bytes the first time), so the content must not depend on the pass:
+ *
+ *   Json_writer json(dest, len);
+ *   while (json.pass())
+ *   {
+ *       json.obj_begin();
+ *       ...
+ *       json.obj_end();
+ *   }
+ *   char *msg = json.result();
+ */
+class Json_writer
+{
+public:
+  // fixed buffer of len bytes or, with dest NULL, a heap buffer
+  Json_writer(char *dest = NULL, int len = 0);
+  // buf is passed to flush when full and by result()
+  Json_writer(char *buf, int len, void *param, bool (*flush)(void *param, char *data, int len));
+  ~Json_writer();
+
+  void obj_begin(const char *key = NULL);
+  void obj_end(void);
+  void array_begin(const char *key = NULL);
+  void array_end(void);
+  void str(const char *key, const char *value);
+  void num(const char *key, int value);
+  void unum(const char *key, uint32 value);
+  void hex(const char *key, uint32 value); // "%X" string
+  void raw(const char *key, const char *json);
+  // a string value written in pieces
+  void str_begin(const char *key);
+  void str_append(const char *value, int len);
+  void str_end(void);
+
+  // true while the message has to be (re)written
+  bool pass(void);
+
+  // the message length so far (the needed size when the fixed buffer overflowed)
+  int len(void);
+  // fixed buffer:  dest, terminated (an empty string on overflow)
+  // heap buffer:   the heap allocated message (the caller deletes it), NULL on heap exhausted
+  // flush:         buf, NULL when a flush failed
+  char *result(void);
+
+private:
+  char *m_buf;
+  int m_size;
+  int m_len;   // m_buf content
+  int m_total; // the whole message
+  bool m_heap;
+  int m_pass;
+  bool m_err;
+  void *m_param;
+  bool (*m_flush)(void *, char *, int);
+  uint32 m_not_first; // a bit for each nesting level: a value was already written
+  int m_depth;
+
+  bool room(void);
+  void put(char c);
+  void put_str(const char *str);
+  void put_escaped(const char *str, int len);
+  void put_uint(uint32 value);
+  void put_hex(uint32 value);
+  void value_begin(const char *key);
+  void open(const char *key, char c);
+  void close(char c);
+};
+
+#endif
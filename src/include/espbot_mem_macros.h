@@ -11,7 +11,12 @@
 
 #define IRAM __attribute__((section(".iram.text")))
 #define IROM_TEXT __attribute__((section(".irom.text")))
+#ifdef ESPBOT_HOST
+// aligned(4) would lower the alignment of the structs with 64 bit pointers
+#define ALIGNED_4
+#else
 #define ALIGNED_4 __attribute__((aligned(4)))
+#endif
 
 // MACROS FOR PLACING STRINGS INTO FLASH MEMORY
 
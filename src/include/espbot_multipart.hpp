@@ -0,0 +1,95 @@
+/*
+ * ----------------------------------------------------------------------------
+ * "THE BEER-WARE LICENSE" (Revision 42):
+ * <quackmore-ff@yahoo.com> wrote this file.  As long as you retain this notice
+ * you can do whatever you want with this stuff. If we meet some day, and you 
+ * think this stuff is worth it, you can buy me a beer in return. Quackmore
+ * ----------------------------------------------------------------------------
+ */
+#ifndef __MULTIPART_HPP__
+#define __MULTIPART_HPP__
+
+#include "espbot_http.hpp"
+
+#define MULTIPART_BOUNDARY_MAX 70 // RFC 2046
+#define MULTIPART_HEADERS_MAX 256 // a part headers (Content-Disposition, Content-Type, ...)
+#define HTTP_UPLOAD_MAX_COUNT 2   // concurrent uploads (each one keeps a file open)
+
+typedef enum
+{
+  MULTIPART_ok = 0,
+  MULTIPART_bad_syntax = -1,
+  MULTIPART_headers_too_long = -2,
+  MULTIPART_aborted = -3,
+  MULTIPART_heap_exhausted = -4
+} Multipart_err;
+
+typedef enum
+{
+  MP_preamble = 0,
+  MP_after_delimiter,
+  MP_end_dash,
+  MP_delimiter_cr,
+  MP_headers,
+  MP_data,
+  MP_epilogue,
+  MP_error
+} Multipart_state;
+
+/*
+ * incremental multipart/form-data parser
+ *
+ * the message is fed one TCP segment at a time, each part data is passed
+ * to on_part_data as soon as it's received
+ * the only bytes kept across segments are the ones matching (so far)
+ * the boundary delimiter and the part headers, so memory does not depend
+ * on the message size
+ *
+ * on_part_begin: name and filename are NULL when missing from Content-Disposition
+ * callbacks returning false abort the parsing (MULTIPART_aborted)
+ */
+class Multipart_parser
+{
+public:
+  Multipart_parser(void *param,
+                   bool (*on_part_begin)(void *param, char *name, char *filename),
+                   bool (*on_part_data)(void *param, char *data, int len),
+                   bool (*on_part_end)(void *param));
+  ~Multipart_parser();
+
+  // extract the boundary from the Content-Type value, result: Multipart_err
+  int init(char *content_type);
+  // result: Multipart_err
+  int feed(char *data, int len);
+  // the close delimiter was found
+  bool completed(void);
+
+private:
+  void *m_param;
+  bool (*m_on_part_begin)(void *, char *, char *);
+  bool (*m_on_part_data)(void *, char *, int);
+  bool (*m_on_part_end)(void *);
+  Multipart_state m_state;
+  char *m_delimiter; // "\r\n--" + boundary
+  int m_delimiter_len;
+  int m_match; // delimiter bytes matched so far (the lookbehind)
+  char *m_headers;
+  int m_headers_len;
+
+  int parse_headers(void);
+  int emit(char *data, int len);
+};
+
+/*
+ * browser file uploads: POST /api/file with a multipart/form-data body
+ * each part with a filename is written to the homonymous file (overwritten if existing)
+ */
+
+// result: true when the request is an upload (and it has been taken in charge)
+bool http_upload_start(struct espconn *p_espconn, Http_parsed_req *parsed_req);
+// result: true when the data belong to an upload in progress on p_espconn
+bool http_upload_recv(struct espconn *p_espconn, char *data, int len);
+// called when the connection is closed or aborted
+void http_upload_forget(struct espconn *p_espconn);
+
+#endif
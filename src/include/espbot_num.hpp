@@ -0,0 +1,38 @@
+/*
+ * ----------------------------------------------------------------------------
+ * "THE BEER-WARE LICENSE" (Revision 42):
+ * <quackmore-ff@yahoo.com> wrote this file.  As long as you retain this notice
+ * you can do whatever you want with this stuff. If we meet some day, and you 
+ * think this stuff is worth it, you can buy me a beer in return. Quackmore
+ * ----------------------------------------------------------------------------
+ */
+#ifndef __NUM_HPP__
+#define __NUM_HPP__
+
+extern "C"
+{
+#include "c_types.h"
+}
+
+/*
+ * JSON numbers parsed in place
+ *
+ * the number is the span (ptr, len), e.g. a JSONP value view, with no terminator needed
+ * and no copy to a temporary string
+ * result: true  -> *value is set
+ *         false -> bad syntax or the value does not fit the type (*value is untouched)
+ *
+ * integers (int, uint, int64, uint64): no fraction and no exponent
+ */
+bool span_to_int(const char *ptr, int len, int *value);
+bool span_to_uint(const char *ptr, int len, uint32 *value);
+bool span_to_int64(const char *ptr, int len, sint64 *value);
+bool span_to_uint64(const char *ptr, int len, uint64 *value);
+
+// fixed point: the value times 10^decimals, rounded (e.g. "21.56" with 1 decimal -> 216)
+bool span_to_fixed(const char *ptr, int len, int decimals, int *value);
+
+// single precision only (no double arithmetic), digits beyond an uint32 mantissa are not significant
+bool span_to_float(const char *ptr, int len, float *value);
+
+#endif
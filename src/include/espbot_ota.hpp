@@ -15,6 +15,10 @@
 // #include "osapi.h"
 // }
 
+#include "espbot_dns.hpp"
+
+#define OTA_HOST_LEN DNS_NAME_LEN // host name or dotted IP address
+
 typedef enum
 {
   OTA_idle = 0,
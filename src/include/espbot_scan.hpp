@@ -0,0 +1,32 @@
+/*
+ * ----------------------------------------------------------------------------
+ * "THE BEER-WARE LICENSE" (Revision 42):
+ * <quackmore-ff@yahoo.com> wrote this file.  As long as you retain this notice
+ * you can do whatever you want with this stuff. If we meet some day, and you 
+ * think this stuff is worth it, you can buy me a beer in return. Quackmore
+ * ----------------------------------------------------------------------------
+ */
+#ifndef __SCAN_HPP__
+#define __SCAN_HPP__
+
+extern "C"
+{
+#include "c_types.h"
+}
+
+/*
+ * word at a time (SWAR) scanning
+ *
+ * [ptr, end) is checked 4 bytes at a time using aligned loads
+ * (with byte reads up to the alignment and for the tail)
+ * so the buffer must be in RAM, not in flash
+ *
+ * result: the first matching char, NULL when not found
+ */
+
+char *scan_char(char *ptr, char *end, char c);
+char *scan_char2(char *ptr, char *end, char c1, char c2);
+// the JSON structural chars: '"' '{' '}' '[' ']' ',' ':'
+char *scan_json(char *ptr, char *end);
+
+#endif
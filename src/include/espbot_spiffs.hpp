@@ -58,6 +58,19 @@ extern "C"
 #define SPIFFS_FLASH_RESULT_TIMEOUT -10201
 #define SPIFFS_FLASH_BOUNDARY_ERROR -10202
 
+/**
+ * @brief background garbage collection
+ * 
+ * SPIFFS collects garbage inside a write when the free blocks run low (3 or less)
+ * erasing sectors inline; so every FS_GC_PERIOD ms, when no http send is pending,
+ * blocks are cleaned to keep FS_GC_FREE_BLOCKS free
+ * one block per task: a GC run moves the used pages of a block (one block of page writes
+ * at most) then erases it, tens of ms; the next block is cleaned by the next task
+ * 
+ */
+#define FS_GC_PERIOD 2000 // ms
+#define FS_GC_FREE_BLOCKS 6
+
 extern "C"
 {
 #include "spiffs.h"
@@ -68,6 +81,57 @@ extern "C"
   s32_t esp_spiffs_erase(u32_t t_addr, u32_t t_size);
 }
 
+/**
+ * @brief flash operations by the file system
+ * 
+ * times are in microseconds (the cumulative ones wrap around after ~71 minutes)
+ * erases are counted by flash area, FLASH_STATS_AREAS areas covering FS_START..FS_END
+ * 
+ */
+#define FLASH_STATS_AREAS 32
+#define FLASH_STATS_AREA_SECTORS ((((FS_END - FS_START) / FLASH_SECT_SIZE) + FLASH_STATS_AREAS - 1) / FLASH_STATS_AREAS)
+
+struct flash_stats
+{
+  u32_t read_ops;
+  u32_t read_bytes;
+  u32_t read_us;
+  u32_t read_max_us;
+  u32_t write_ops;
+  u32_t write_bytes;
+  u32_t write_us;
+  u32_t write_max_us;
+  u32_t erase_ops; // sectors
+  u32_t erase_us;
+  u32_t erase_max_us;
+  u32_t erase_areas[FLASH_STATS_AREAS];
+};
+
+/**
+ * @brief get the flash operations since boot (or since the last reset)
+ * 
+ * @return struct flash_stats* the counters
+ */
+struct flash_stats *esp_spiffs_flash_stats(void);
+/**
+ * @brief clear the flash operations counters
+ * 
+ */
+void esp_spiffs_flash_stats_reset(void);
+/**
+ * @brief the flash operations and the SPIFFS cache and GC counters
+ * 
+ * @param dest the buffer (NULL for a heap allocated one)
+ * @param len the buffer size
+ * @return char* the JSON string, NULL on heap exhausted
+ */
+char *esp_spiffs_stats_json_stringify(char *dest = NULL, int len = 0);
+/**
+ * @brief clear the flash operations and the SPIFFS cache and GC counters
+ * 
+ */
+void esp_spiffs_stats_reset(void);
+
 /**
  * @brief Espbot file systems methods
  * 
@@ -179,6 +243,16 @@ public:
    */
   s32_t clear();
 
+  /**
+   * @brief write the file cache to flash
+   * same as SPIFFS_fflush
+   * (the destructor closes the file with no result, so that's the way
+   * to know that the appended data are on flash)
+   * @return s32_t, on success: SPIFFS_OK
+   *                on failure: the SPIFFS error code (negative number)
+   */
+  s32_t flush();
+
   /**
    * @brief read from file with offset
    * same as SPIFFS_fremove
@@ -44,7 +44,9 @@ typedef int16_t s16_t;
 typedef uint16_t u16_t;
 typedef int8_t s8_t;
 typedef uint8_t u8_t;
+#ifndef ESPBOT_HOST // the host build gets it from stdint.h
 typedef int32_t intptr_t;
+#endif
 
 #define memset os_memset
 #define memcpy os_memcpy
@@ -135,12 +135,13 @@ $('#fsinfo_refresh').on('click', function () {
 
 $('#fs_check').on('click', function () {
   alert("A File System check could take a while...\nCheck the results in the Event Journal.");
-  return esp_query({
+  return esp_job({
     type: 'POST',
     url: '/api/fs/check',
     dataType: 'json',
+    timeout: 60000,
     success: function (data) {
-      alert("" + data.msg);
+      alert("File System check completed (" + data.fs_check_result + ")");
     },
     error: query_err
   });
@@ -331,7 +332,7 @@ $('#memhexdump_length').on('change', function () {
 });
 
 function esp_get_memhexdump() {
-  return esp_query({
+  return esp_job({
     type: 'POST',
     url: '/api/debug/hexMemDump',
     dataType: 'json',
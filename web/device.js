@@ -136,7 +136,7 @@ $('#wifi_edit').on('click', function () {
 });
 
 function esp_wifi_scan() {
-  return esp_query({
+  return esp_job({
     type: 'GET',
     url: '/api/wifi/scan',
     dataType: 'json',
@@ -640,11 +640,11 @@ $('#ota_start').on('click', function () {
   device_running = 0;
   show_spinner()
     .then(function () {
-      return esp_query({
+      return esp_job({
         type: 'POST',
         url: '/api/ota',
         dataType: 'json',
-        timeout: 18000,
+        timeout: 60000,
         success: function (data) {
           if ((data.msg).includes("ebooting")) {
             device_running = 0;
@@ -106,6 +106,12 @@ code_str[parseInt("0091", 16)] = "HTTP_PARSE_RESPONSE_CANNOT_FIND_CONTENT_START"
 code_str[parseInt("0092", 16)] = "HTTP_CHECK_PENDING_SEND_QUEUE_FULL";
 code_str[parseInt("0093", 16)] = "HTTP_PUSH_PENDING_SEND_QUEUE_FULL";
 code_str[parseInt("0094", 16)] = "HTTP_PUSH_PENDING_SEND_HEAP_EXHAUSTED";
+code_str[parseInt("0095", 16)] = "HTTP_PARSE_REQUEST_CANNOT_FIND_IF_NONE_MATCH";
+code_str[parseInt("0096", 16)] = "HTTP_RECV_HOLD";
+code_str[parseInt("0097", 16)] = "HTTP_RECV_UNHOLD";
+code_str[parseInt("0098", 16)] = "HTTP_RECV_HOLD_TIMEOUT";
+code_str[parseInt("0099", 16)] = "HTTP_CHECK_PENDING_REQUESTS_HEAP_EXHAUSTED";
+code_str[parseInt("009A", 16)] = "HTTP_PARSE_REQUEST_CANNOT_FIND_CONTENT_TYPE";
 code_str[parseInt("009D", 16)] = "HTTP_SVR_START";
 code_str[parseInt("009E", 16)] = "HTTP_SVR_STOP";
 code_str[parseInt("009F", 16)] = "HTTP_SVR_EMPTY_URL";
@@ -126,6 +132,7 @@ code_str[parseInt("00C4", 16)] = "ROUTES_DISCONNECTWIFI_HEAP_EXHAUSTED";
 code_str[parseInt("00C5", 16)] = "ROUTES_GETDIAGNOSTICEVENTS_NEXT_HEAP_EXHAUSTED";
 code_str[parseInt("00C6", 16)] = "ROUTES_GETDIAGNOSTICEVENTS_NEXT_PENDING_RES_QUEUE_FULL";
 code_str[parseInt("00C7", 16)] = "ROUTES_GETDIAGEVENTS_PENDING_RES_QUEUE_FULL";
+code_str[parseInt("00C8", 16)] = "ROUTES_JOB_HEAP_EXHAUSTED";
 code_str[parseInt("00D0", 16)] = "OTA_INIT_DEFAULT_CFG";
 code_str[parseInt("00D1", 16)] = "OTA_PATH_TRUNCATED";
 code_str[parseInt("00D2", 16)] = "OTA_CANNOT_COMPLETE";
@@ -151,6 +158,12 @@ code_str[parseInt("0106", 16)] = "HTTP_CLT_DISCON_CANNOT_FIND_ESPCONN";
 code_str[parseInt("0107", 16)] = "HTTP_CLT_CONNECTED_CANNOT_FIND_ESPCONN";
 code_str[parseInt("0108", 16)] = "HTTP_CLT_CONNECT_CONN_FAILURE";
 code_str[parseInt("0109", 16)] = "HTTP_CLT_SEND_REQ_HEAP_EXHAUSTED";
+code_str[parseInt("010A", 16)] = "HTTP_CLT_POOL_GET_HEAP_EXHAUSTED";
+code_str[parseInt("010B", 16)] = "HTTP_CLT_POOL_STATS_STRINGIFY_HEAP_EXHAUSTED";
+code_str[parseInt("010C", 16)] = "HTTP_CLT_RECV_HEAP_EXHAUSTED";
+code_str[parseInt("010D", 16)] = "HTTP_CLT_RECV_BAD_RESPONSE";
+code_str[parseInt("010E", 16)] = "HTTP_CLT_DOWNLOAD_HEAP_EXHAUSTED";
+code_str[parseInt("010F", 16)] = "HTTP_CLT_DOWNLOAD_FILE_WRITE_ERROR";
 code_str[parseInt("0110", 16)] = "SPIFFS_INIT_CANNOT_MOUNT";
 code_str[parseInt("0111", 16)] = "SPIFFS_INIT_FS_FORMATTED";
 code_str[parseInt("0112", 16)] = "SPIFFS_INIT_CANNOT_FORMAT";
@@ -163,6 +176,8 @@ code_str[parseInt("0118", 16)] = "SPIFFS_LIST_FS_NOT_MOUNTED";
 code_str[parseInt("0119", 16)] = "SPIFFS_CHECK_FS_NOT_MOUNTED";
 code_str[parseInt("011A", 16)] = "SPIFFS_CHECK_SUCCESSFULLY";
 code_str[parseInt("011B", 16)] = "SPIFFS_CHECK_ERRORS";
+code_str[parseInt("011C", 16)] = "SPIFFS_STATS_STRINGIFY_HEAP_EXHAUSTED";
+code_str[parseInt("011D", 16)] = "SPIFFS_GC_INLINE";
 code_str[parseInt("0120", 16)] = "ESPFILE_FS_NOT_MOUNTED";
 code_str[parseInt("0121", 16)] = "ESPFILE_OPEN_ERROR";
 code_str[parseInt("0122", 16)] = "ESPFILE_NAME_TRUNCATED";
@@ -181,6 +196,8 @@ code_str[parseInt("012E", 16)] = "ESPFILE_REMOVE_FS_NOT_MOUNTED";
 code_str[parseInt("012F", 16)] = "ESPFILE_REMOVE_ERROR";
 code_str[parseInt("0130", 16)] = "ESPFILE_EXISTS_FS_NOT_MOUNTED";
 code_str[parseInt("0131", 16)] = "ESPFILE_SIZE_FS_NOT_MOUNTED";
+code_str[parseInt("0132", 16)] = "ESPFILE_FLUSH_FS_NOT_MOUNTED";
+code_str[parseInt("0133", 16)] = "ESPFILE_FLUSH_ERROR";
 code_str[parseInt("0140", 16)] = "SPIFFS_FLASH_READ_OUT_OF_BOUNDARY";
 code_str[parseInt("0141", 16)] = "SPIFFS_FLASH_READ_ERROR";
 code_str[parseInt("0142", 16)] = "SPIFFS_FLASH_READ_TIMEOUT";
@@ -214,4 +231,40 @@ code_str[parseInt("0175", 16)] = "CRON_ADD_JOB_HEAP_EXHAUSTED";
 code_str[parseInt("0176", 16)] = "CRON_ENABLED";
 code_str[parseInt("0177", 16)] = "CRON_DISABLED";
 code_str[parseInt("0178", 16)] = "CRON_CFG_STRINGIFY_HEAP_EXHAUSTED";
+code_str[parseInt("0180", 16)] = "JOBS_ADD_TABLE_FULL";
+code_str[parseInt("0181", 16)] = "JOBS_ADD_HEAP_EXHAUSTED";
+code_str[parseInt("0182", 16)] = "JOBS_STRINGIFY_HEAP_EXHAUSTED";
+code_str[parseInt("0183", 16)] = "JOBS_LIST_STRINGIFY_HEAP_EXHAUSTED";
+code_str[parseInt("0184", 16)] = "JOBS_STARTED";
+code_str[parseInt("0185", 16)] = "JOBS_COMPLETED";
+code_str[parseInt("0186", 16)] = "JOBS_FAILED";
+code_str[parseInt("0187", 16)] = "JOBS_CANCELLED";
+code_str[parseInt("0188", 16)] = "JOBS_ADD_SAME_TYPE_PENDING";
+code_str[parseInt("0190", 16)] = "CORS_RESTORE_CFG_ERROR";
+code_str[parseInt("0191", 16)] = "CORS_INIT_DEFAULT_CFG";
+code_str[parseInt("0192", 16)] = "CORS_CFG_STRINGIFY_HEAP_EXHAUSTED";
+code_str[parseInt("0193", 16)] = "CORS_UPDATE_HEADERS_HEAP_EXHAUSTED";
+code_str[parseInt("0194", 16)] = "CORS_ORIGIN_NOT_ALLOWED";
+code_str[parseInt("0195", 16)] = "CORS_ORIGIN_HEAP_EXHAUSTED";
+code_str[parseInt("01A0", 16)] = "HTTP_CACHE_PUT_HEAP_EXHAUSTED";
+code_str[parseInt("01A1", 16)] = "HTTP_CACHE_RESPONSE_HEAP_EXHAUSTED";
+code_str[parseInt("01A2", 16)] = "HTTP_CACHE_STATS_STRINGIFY_HEAP_EXHAUSTED";
+code_str[parseInt("01B0", 16)] = "UPLOAD_HEAP_EXHAUSTED";
+code_str[parseInt("01B1", 16)] = "UPLOAD_TABLE_FULL";
+code_str[parseInt("01B2", 16)] = "UPLOAD_BAD_SYNTAX";
+code_str[parseInt("01B3", 16)] = "UPLOAD_FILE_WRITE_ERROR";
+code_str[parseInt("01B4", 16)] = "UPLOAD_COMPLETED";
+code_str[parseInt("01C0", 16)] = "HTTP_CLT_QUEUE_REQ_HEAP_EXHAUSTED";
+code_str[parseInt("01C1", 16)] = "HTTP_CLT_QUEUE_REQ_FULL";
+code_str[parseInt("01D0", 16)] = "DNS_HEAP_EXHAUSTED";
+code_str[parseInt("01D1", 16)] = "DNS_NAME_TOO_LONG";
+code_str[parseInt("01D2", 16)] = "DNS_TOO_MANY_LOOKUPS";
+code_str[parseInt("01D3", 16)] = "DNS_LOOKUP_ERROR";
+code_str[parseInt("01D4", 16)] = "DNS_NOT_FOUND";
+code_str[parseInt("01E0", 16)] = "CFGSTORE_HEAP_EXHAUSTED";
+code_str[parseInt("01E1", 16)] = "CFGSTORE_BAD_SLOT";
+code_str[parseInt("01E2", 16)] = "CFGSTORE_WRITE_ERROR";
+code_str[parseInt("01E3", 16)] = "CFGSTORE_TABLE_FULL";
+code_str[parseInt("01E4", 16)] = "CFGSTORE_TOO_LONG";
+code_str[parseInt("01E5", 16)] = "CFGSTORE_SAVE_GIVEN_UP";
 return code_str[parseInt(code, 16)]; }
@@ -79,3 +79,71 @@ function esp_query(query) {
     });
   });
 }
+
+// expensive requests are executed by the device as jobs:
+// the request returns the job, that is then polled until finished
+// query.success will get the job result
+// query.timeout is the time allowed for the job to complete
+
+function esp_job_poll(job_id, deadline) {
+  return new Promise(function (resolve, reject) {
+    function poll() {
+      $.ajax({
+        type: 'GET',
+        url: esp8266.url + '/api/jobs/' + job_id,
+        dataType: 'json',
+        crossDomain: esp8266.cors,
+        timeout: 4000,
+        success: function (job) {
+          if ((job.status === "queued") || (job.status === "running")) {
+            if (Date.now() > deadline)
+              reject(job);
+            else
+              setTimeout(poll, 500);
+          }
+          else if (job.status === "completed")
+            resolve(job);
+          else
+            reject(job);
+        },
+        error: function (jqXHR, textStatus) {
+          reject(jqXHR, textStatus);
+        }
+      });
+    }
+    setTimeout(poll, 500);
+  });
+}
+
+function esp_job(query) {
+  var job_success = query.success;
+  var job_error = query.error;
+  var job_timeout = 4000;
+  if (query.hasOwnProperty('timeout'))
+    job_timeout = query.timeout;
+  query.success = null;
+  query.error = null;
+  delete query.timeout;
+  return esp_query(query)
+    .then(function (job) {
+      return esp_job_poll(job.id, Date.now() + job_timeout);
+    })
+    .then(function (job) {
+      if (job_success)
+        job_success(job.result);
+      return job.result;
+    }, function (err) {
+      if (err && err.hasOwnProperty('id')) {
+        // the job failed
+        if (err.result && err.result.msg)
+          alert("" + err.result.msg);
+        else
+          alert("Job " + err.type + " " + err.status);
+        hide_spinner(500);
+      }
+      else if (job_error) {
+        job_error(err, err.statusText);
+      }
+      return Promise.reject(err);
+    });
+}